@@ -41,9 +41,13 @@
 #pragma mark -
 
 extern const uint32_t           WSBIP37MaxFilterSize;
-extern const uint32_t           WSBIP37MaxHashFunctions;
 extern const uint32_t           WSBIP37HashMultiplier;
 
+// compile-time, sizes stack buffers
+#define WSBIP37MaxHashFunctions         50
+
+uint32_t WSBIP37MurmurHash3(const void *bytes, NSUInteger length, uint32_t seed);
+
 typedef enum {
     WSBIP37FlagsUpdateNone = 0,
     WSBIP37FlagsUpdateAll,
@@ -31,10 +31,9 @@
 #import "WSErrors.h"
 
 const uint32_t          WSBIP37MaxFilterSize                    = 36000;
-const uint32_t          WSBIP37MaxHashFunctions                 = 50;
 const uint32_t          WSBIP37HashMultiplier                   = 0xfba4c795;
 
-static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed);
+static inline uint32_t WSBIP37BitPosition(const uint8_t *bytes, NSUInteger length, uint32_t tweak, uint32_t index, uint32_t bitCount);
 
 #pragma mark -
 
@@ -94,8 +93,6 @@ static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed);
 @property (nonatomic, assign) uint32_t elements;
 @property (nonatomic, assign) uint32_t hashFunctions;
 
-- (uint32_t)hashData:(NSData *)data atIndex:(uint32_t)index;
-
 @end
 
 @implementation WSBIP37Filter
@@ -155,30 +152,51 @@ static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed);
     return self;
 }
 
+// bit positions are computed once, then both tested and set
 - (void)insertData:(NSData *)data
 {
     WSExceptionCheckIllegal(data != nil, @"Nil data");
 
+    const uint8_t *dataBytes = data.bytes;
+    const NSUInteger dataLength = data.length;
+    const uint32_t tweak = _parameters.tweak;
+    const uint32_t bitCount = (uint32_t)(_filter.length * 8);
+    const uint32_t hashFunctions = _hashFunctions;
+    uint8_t *bytes = _filter.mutableBytes;
+
+    uint32_t positions[WSBIP37MaxHashFunctions];
+    BOOL isContained = YES;
+    for (uint32_t i = 0; i < hashFunctions; ++i) {
+        const uint32_t h = WSBIP37BitPosition(dataBytes, dataLength, tweak, i, bitCount);
+        positions[i] = h;
+        isContained &= ((bytes[h >> 3] & (1 << (7 & h))) != 0);
+    }
+
     // if data matches don't get filter dirtier by reinserting
-    if ([self containsData:data]) {
+    if (isContained) {
         return;
     }
-    
-    uint8_t *bytes = _filter.mutableBytes;
-    for (uint32_t i = 0; i < self.hashFunctions; ++i) {
-        const uint32_t h = [self hashData:data atIndex:i];
+
+    for (uint32_t i = 0; i < hashFunctions; ++i) {
+        const uint32_t h = positions[i];
         bytes[h >> 3] |= (1 << (7 & h));
     }
-    ++self.elements;
+    ++_elements;
 }
 
 - (BOOL)containsData:(NSData *)data
 {
     WSExceptionCheckIllegal(data != nil, @"Nil data");
     
-    const uint8_t *bytes = self.filter.bytes;
-    for (uint32_t i = 0; i < self.hashFunctions; ++i) {
-        const uint32_t h = [self hashData:data atIndex:i];
+    const uint8_t *dataBytes = data.bytes;
+    const NSUInteger dataLength = data.length;
+    const uint32_t tweak = _parameters.tweak;
+    const uint32_t bitCount = (uint32_t)(_filter.length * 8);
+    const uint32_t hashFunctions = _hashFunctions;
+    const uint8_t *bytes = _filter.bytes;
+
+    for (uint32_t i = 0; i < hashFunctions; ++i) {
+        const uint32_t h = WSBIP37BitPosition(dataBytes, dataLength, tweak, i, bitCount);
         if (!(bytes[h >> 3] & (1 << (7 & h)))) {
             return NO;
         }
@@ -207,6 +225,7 @@ static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed);
 - (id)copyWithZone:(NSZone *)zone
 {
     WSBIP37Filter *copy = [[self class] allocWithZone:zone];
+    copy.parameters = [self.parameters copyWithZone:zone];
     copy.capacity = self.capacity;
     copy.filter = [self.filter mutableCopyWithZone:zone];
     copy.elements = self.elements;
@@ -234,15 +253,6 @@ static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed);
     return buffer;
 }
 
-#pragma mark Utils
-
-- (uint32_t)hashData:(NSData *)data atIndex:(uint32_t)index
-{
-    NSParameterAssert(data);
-    
-    return WSBIP37MurmurHash3(data, self.parameters.tweak + index * WSBIP37HashMultiplier) % (self.filter.length * 8);
-}
-
 @end
 
 #pragma mark -
@@ -252,17 +262,18 @@ static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed);
 //
 // murmurHash3 (x86_32): http://code.google.com/p/smhasher/source/browse/trunk/MurmurHash3.cpp
 //
-static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed)
+// always inlined so that constant lengths unroll the block loop and drop the tail switch
+//
+static inline __attribute__((always_inline)) uint32_t WSBIP37MurmurHash3Inline(const uint8_t *b, const uint32_t length, uint32_t seed)
 {
     static const uint32_t c1 = 0xcc9e2d51;
     static const uint32_t c2 = 0x1b873593;
     uint32_t h1 = seed;
     uint32_t k1 = 0;
     uint32_t k2 = 0;
-    uint32_t blocks = ((uint32_t)data.length / 4) * 4;
-    const uint8_t *b = data.bytes;
+    const uint32_t blocks = (length / 4) * 4;
     
-    for (NSUInteger i = 0; i < blocks; i += 4) {
+    for (uint32_t i = 0; i < blocks; i += 4) {
         k1 = ((uint32_t)b[i] | ((uint32_t)b[i + 1] << 8) |
               ((uint32_t)b[i + 2] << 16) | ((uint32_t)b[i + 3] << 24)) * c1;
         
@@ -271,7 +282,7 @@ static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed)
         h1 = ((h1 << 13) | (h1 >> 19)) * 5 + 0xe6546b64;
     }
     
-    switch (data.length & 3) {
+    switch (length & 3) {
         case 3: {
             k2 ^= b[blocks + 2] << 16; // fall through
         }
@@ -284,10 +295,39 @@ static uint32_t WSBIP37MurmurHash3(NSData *data, uint32_t seed)
         }
     }
     
-    h1 ^= data.length;
+    h1 ^= length;
     h1 = (h1 ^ (h1 >> 16)) * 0x85ebca6b;
     h1 = (h1 ^ (h1 >> 13)) * 0xc2b2ae35;
     h1 ^= h1 >> 16;
     
     return h1;
 }
+
+uint32_t WSBIP37MurmurHash3(const void *bytes, NSUInteger length, uint32_t seed)
+{
+    const uint8_t *b = bytes;
+
+    // lengths of watched wallet elements
+    switch (length) {
+        case 20: {
+            return WSBIP37MurmurHash3Inline(b, 20, seed); // hash160
+        }
+        case 33: {
+            return WSBIP37MurmurHash3Inline(b, 33, seed); // compressed public key
+        }
+        case 36: {
+            return WSBIP37MurmurHash3Inline(b, 36, seed); // outpoint
+        }
+        case 65: {
+            return WSBIP37MurmurHash3Inline(b, 65, seed); // uncompressed public key
+        }
+        default: {
+            return WSBIP37MurmurHash3Inline(b, (uint32_t)length, seed);
+        }
+    }
+}
+
+static inline uint32_t WSBIP37BitPosition(const uint8_t *bytes, NSUInteger length, uint32_t tweak, uint32_t index, uint32_t bitCount)
+{
+    return WSBIP37MurmurHash3(bytes, length, tweak + index * WSBIP37HashMultiplier) % bitCount;
+}
@@ -36,6 +36,7 @@
 @class WSFilteredBlock;
 @class WSBlockLocator;
 @class WSCoreDataManager;
+@class WSOrphanPool;
 
 #pragma mark -
 
@@ -50,11 +51,13 @@ typedef void (^WSBlockChainReorganizeBlock)(WSStorableBlock *, NSArray *, NSArra
 
 @property (nonatomic, assign) NSUInteger blockStoreSize;    // 2500
 @property (nonatomic, weak) id<WSBlockChainDelegate> delegate;
+@property (nonatomic, strong, readonly) WSOrphanPool *orphanPool;
 
 - (instancetype)initWithStore:(id<WSBlockStore>)blockStore;
 
 - (WSStorableBlock *)head;
 - (WSStorableBlock *)blockForId:(WSHash256 *)blockId;
+- (WSStorableBlock *)blockAtHeight:(uint32_t)height; // main chain, nil if unsupported by store
 - (NSArray *)allBlockIds;
 - (NSUInteger)currentHeight;
 - (uint32_t)currentTimestamp;
@@ -65,6 +68,9 @@ typedef void (^WSBlockChainReorganizeBlock)(WSStorableBlock *, NSArray *, NSArra
 - (WSStorableBlock *)addBlockWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions connectedOrphans:(NSArray **)connectedOrphans error:(NSError **)error;
 - (WSStorableBlock *)addBlockWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions reorganizeBlock:(WSBlockChainReorganizeBlock)reorganizeBlock connectedOrphans:(NSArray **)connectedOrphans error:(NSError **)error;
 
+// returns blocks added to main chain, a contiguous run extending head is stored at once
+- (NSArray *)addBlockHeaders:(NSArray *)headers reorganizeBlock:(WSBlockChainReorganizeBlock)reorganizeBlock connectedOrphans:(NSArray **)connectedOrphans error:(NSError **)error;
+
 - (BOOL)isBehindBlock:(WSStorableBlock *)block;
 - (WSStorableBlock *)addCheckpoint:(WSStorableBlock *)checkpoint error:(NSError **)error;
 
@@ -84,4 +90,9 @@ typedef void (^WSBlockChainReorganizeBlock)(WSStorableBlock *, NSArray *, NSArra
 - (void)blockChain:(WSBlockChain *)blockChain didReplaceHead:(WSStorableBlock *)head;
 - (void)blockChain:(WSBlockChain *)blockChain didReorganizeAtBase:(WSStorableBlock *)base oldBlocks:(NSArray *)oldBlocks newBlocks:(NSArray *)newBlocks;
 
+@optional
+
+// batch extension, falls back to blockChain:didAddNewBlock: if not implemented
+- (void)blockChain:(WSBlockChain *)blockChain didAddNewBlocks:(NSArray *)blocks;
+
 @end
@@ -31,6 +31,8 @@
 #import "WSStorableBlock.h"
 #import "WSBlockHeader.h"
 #import "WSBlockLocator.h"
+#import "WSOrphanPool.h"
+#import "WSBlockMacros.h"
 #import "WSConfig.h"
 #import "WSMacros.h"
 #import "WSErrors.h"
@@ -47,8 +49,9 @@
 @interface WSBlockChain ()
 
 @property (nonatomic, strong) id<WSBlockStore> store;
-@property (nonatomic, strong) NSMutableDictionary *orphans; // WSHash256 -> WSStorableBlock
+@property (nonatomic, strong) WSOrphanPool *orphanPool;
 @property (nonatomic, assign) BOOL doValidate;
+@property (nonatomic, assign) BOOL isStoreIndexedByHeight;
 
 - (WSStorableBlock *)addBlockWithHeader:(WSBlockHeader *)header
                            transactions:(NSOrderedSet *)transactions
@@ -57,9 +60,10 @@
                        connectedOrphans:(NSArray **)connectedOrphans
                                   error:(NSError *__autoreleasing *)error;
 
-- (NSArray *)connectCurrentOrphansWithReorganizeBlock:(WSBlockChainReorganizeBlock)reorganizeBlock;
+- (NSArray *)connectOrphansOfBlockIds:(NSArray *)blockIds reorganizeBlock:(WSBlockChainReorganizeBlock)reorganizeBlock;
 - (WSStorableBlock *)findForkBaseFromHead:(WSStorableBlock *)forkHead;
 - (NSArray *)subchainFromHead:(WSStorableBlock *)head toBase:(WSStorableBlock *)base;
+- (void)trimStore;
 
 @end
 
@@ -72,8 +76,9 @@
 
     if ((self = [super init])) {
         self.store = blockStore;
-        self.orphans = [[NSMutableDictionary alloc] init];
-        self.blockStoreSize = 2500;
+        self.orphanPool = [[WSOrphanPool alloc] initWithCapacity:WSOrphanPoolDefaultCapacity];
+        self.blockStoreSize = WSBlockChainDefaultStoreSize;
+        self.isStoreIndexedByHeight = [blockStore respondsToSelector:@selector(blockAtHeight:)];
 
         //
         // test networks (testnet3/regtest) validates blocks in
@@ -105,6 +110,24 @@
     return [self.store blockForId:blockId];
 }
 
+- (void)setBlockStoreSize:(NSUInteger)blockStoreSize
+{
+    _blockStoreSize = blockStoreSize;
+
+    // one more for the block added before trimming
+    if ([self.store respondsToSelector:@selector(reserveCapacity:)]) {
+        [self.store reserveCapacity:(blockStoreSize + 1)];
+    }
+}
+
+- (WSStorableBlock *)blockAtHeight:(uint32_t)height
+{
+    if (!self.isStoreIndexedByHeight) {
+        return nil;
+    }
+    return [self.store blockAtHeight:height];
+}
+
 - (NSArray *)allBlockIds
 {
     NSMutableArray *ids = [[NSMutableArray alloc] initWithCapacity:self.currentHeight];
@@ -129,7 +152,8 @@
 - (WSBlockLocator *)currentLocator
 {
     NSMutableArray *hashes = [[NSMutableArray alloc] initWithCapacity:100];
-    WSStorableBlock *block = self.head;
+    WSStorableBlock *head = self.head;
+    WSStorableBlock *block = head;
     WSHash256 *genesisBlockId = [self.store.parameters genesisBlockId];
 
     NSInteger i = 0;
@@ -139,7 +163,7 @@
         if (i >= 10) {
             step <<= 1;
         }
-        block = [block previousBlockInChain:self maxStep:step lastPreviousBlock:NULL];
+        block = ((block.height >= step) ? [head ancestorAtHeight:(uint32_t)(block.height - step) inChain:self] : nil);
         ++i;
     }
     [hashes addObject:genesisBlockId];
@@ -210,13 +234,14 @@
             return nil;
         }
     }
-    if (connectOrphans && self.orphans[header.blockId]) {
-        DDLogDebug(@"Ignoring known orphan: %@", header.blockId);
+    if (connectOrphans && [self.orphanPool containsBlockId:header.blockId]) {
+        DDLogDebug(@"Refreshing known orphan: %@", header.blockId);
+        [self.orphanPool addBlock:[[WSStorableBlock alloc] initWithHeader:header transactions:transactions]];
         return nil;
     }
 
     // main chain
-    if ([header.previousBlockId isEqual:self.head.blockId]) {
+    if ([header hasPreviousBlockId:self.head.blockId]) {
         DDLogVerbose(@"Block %@ is on main chain (head: %@)", header.blockId, self.head.blockId);
         WSStorableBlock *newHead = [self.head buildNextBlockFromHeader:header transactions:transactions];
         
@@ -231,9 +256,7 @@
         [self.store putBlock:newHead];
         [self.store setHead:newHead];
 
-        while (self.store.size > self.blockStoreSize) {
-            [self.store removeTailBlock];
-        }
+        [self trimStore];
         
         [self.delegate blockChain:self didAddNewBlock:newHead];
 
@@ -248,7 +271,7 @@
         // no parent, block is orphan
         if (!forkHead) {
             DDLogDebug(@"Added orphan block %@ (unknown height)", header.blockId);
-            self.orphans[header.blockId] = [[WSStorableBlock alloc] initWithHeader:header transactions:transactions];
+            [self.orphanPool addBlock:[[WSStorableBlock alloc] initWithHeader:header transactions:transactions]];
 
             return nil;
         }
@@ -291,9 +314,9 @@
         }
     }
     
-    // blockchain updated, orphans might not be anymore
+    // blockchain updated, children of this block are not orphans anymore
     if (connectOrphans) {
-        NSArray *localConnectedOrphans = [self connectCurrentOrphansWithReorganizeBlock:reorganizeBlock];
+        NSArray *localConnectedOrphans = [self connectOrphansOfBlockIds:@[header.blockId] reorganizeBlock:reorganizeBlock];
         if (connectedOrphans) {
             *connectedOrphans = localConnectedOrphans;
         }
@@ -302,46 +325,115 @@
     return addedBlock;
 }
 
-- (NSArray *)connectCurrentOrphansWithReorganizeBlock:(WSBlockChainReorganizeBlock)reorganizeBlock
+- (NSArray *)addBlockHeaders:(NSArray *)headers reorganizeBlock:(WSBlockChainReorganizeBlock)reorganizeBlock connectedOrphans:(NSArray *__autoreleasing *)connectedOrphans error:(NSError *__autoreleasing *)error
 {
-    NSMutableArray *connectedOrphans = [[NSMutableArray alloc] init];
-    do {
-        [connectedOrphans removeAllObjects];
-        
-        // WARNING: copy, don't modifiy iterated collection
-        for (WSStorableBlock *orphan in [[self.orphans allValues] copy]) {
-            WSStorableBlock *parentBlock = [self.store blockForId:orphan.previousBlockId];
+    WSExceptionCheckIllegal(headers != nil, @"Nil headers");
+
+    NSMutableArray *addedBlocks = [[NSMutableArray alloc] initWithCapacity:headers.count];
+    NSError *localError = nil;
 
-            // still orphan
-            if (!parentBlock) {
-                continue;
+    // validate the run extending main chain in one pass
+    WSStorableBlock *newHead = self.head;
+    NSUInteger i = 0;
+    for (; i < headers.count; ++i) {
+        WSBlockHeader *header = headers[i];
+        if (![header hasPreviousBlockId:newHead.blockId]) {
+            break;
+        }
+
+        WSStorableBlock *block = [newHead buildNextBlockFromHeader:header transactions:nil];
+        if (self.doValidate && ![block validateTargetInChain:self error:&localError]) {
+            DDLogDebug(@"Block %@ is invalid", header.blockId);
+            break;
+        }
+        [addedBlocks addObject:block];
+        newHead = block;
+    }
+
+    // then store it at once
+    if (addedBlocks.count > 0) {
+        DDLogVerbose(@"Extending main chain to %u with %u blocks", newHead.height, addedBlocks.count);
+        for (WSStorableBlock *block in addedBlocks) {
+            [self.store putBlock:block];
+        }
+        [self.store setHead:newHead];
+
+        [self trimStore];
+
+        if ([self.delegate respondsToSelector:@selector(blockChain:didAddNewBlocks:)]) {
+            [self.delegate blockChain:self didAddNewBlocks:addedBlocks];
+        }
+        else {
+            for (WSStorableBlock *block in addedBlocks) {
+                [self.delegate blockChain:self didAddNewBlock:block];
             }
+        }
+    }
 
-            // orphan has a parent, try readding to main chain or some fork (non-recursive)
+    // forks, orphans and duplicates one by one
+    if (!localError) {
+        for (; i < headers.count; ++i) {
+            WSStorableBlock *block = [self addBlockWithHeader:headers[i]
+                                                 transactions:nil
+                                              reorganizeBlock:reorganizeBlock
+                                               connectOrphans:NO
+                                             connectedOrphans:NULL
+                                                        error:&localError];
+            if (block) {
+                [addedBlocks addObject:block];
+            }
+            else if (localError) {
+                break;
+            }
+        }
+    }
+
+    // blockchain updated, children of these blocks are not orphans anymore
+    NSArray *localConnectedOrphans = [self connectOrphansOfBlockIds:[headers valueForKey:@"blockId"] reorganizeBlock:reorganizeBlock];
+    if (connectedOrphans) {
+        *connectedOrphans = localConnectedOrphans;
+    }
+
+    if (localError && error) {
+        *error = localError;
+    }
+    return addedBlocks;
+}
+
+- (NSArray *)connectOrphansOfBlockIds:(NSArray *)blockIds reorganizeBlock:(WSBlockChainReorganizeBlock)reorganizeBlock
+{
+    NSMutableArray *connectedOrphans = [[NSMutableArray alloc] init];
+    NSMutableArray *parentIds = [blockIds mutableCopy];
+
+    // depth-first, only direct children of stored blocks are tried
+    while (parentIds.count > 0) {
+        WSHash256 *parentId = parentIds.lastObject;
+        [parentIds removeLastObject];
+
+        if (![self.orphanPool hasChildrenOfBlockId:parentId] || ![self.store blockForId:parentId]) {
+            continue;
+        }
+
+        for (WSStorableBlock *orphan in [self.orphanPool removeChildrenOfBlockId:parentId]) {
             DDLogDebug(@"Trying to connect orphan block %@", orphan.blockId);
-            NSArray *otherConnectedOrphans;
             WSStorableBlock *connectedOrphan = [self addBlockWithHeader:orphan.header
                                                            transactions:orphan.transactions
                                                         reorganizeBlock:reorganizeBlock
                                                          connectOrphans:NO
-                                                       connectedOrphans:&otherConnectedOrphans
+                                                       connectedOrphans:NULL
                                                                   error:NULL];
             if (connectedOrphan) {
                 [connectedOrphans addObject:connectedOrphan];
             }
-            if (otherConnectedOrphans) {
-                [connectedOrphans addObjectsFromArray:otherConnectedOrphans];
-            }
 
-            // remove from original
-            [self.orphans removeObjectForKey:orphan.blockId];
-        }
-        
-        if (connectedOrphans.count > 0) {
-            DDLogDebug(@"Connected %u orphan blocks: %@", connectedOrphans.count, connectedOrphans);
+            // also on forks, its own children may connect now
+            [parentIds addObject:orphan.blockId];
         }
-    } while (connectedOrphans.count > 0);
+    }
 
+    if (connectedOrphans.count > 0) {
+        DDLogDebug(@"Connected %u orphan blocks (orphans: %@)", connectedOrphans.count, self.orphanPool);
+    }
     return connectedOrphans;
 }
 
@@ -352,16 +444,31 @@
     WSStorableBlock *mainBlock = self.head;
     WSStorableBlock *forkBlock = forkHead;
 
+    // same height first
+    if (mainBlock.height > forkBlock.height) {
+        mainBlock = [mainBlock ancestorAtHeight:forkBlock.height inChain:self];
+    }
+    else if (forkBlock.height > mainBlock.height) {
+        forkBlock = [forkBlock ancestorAtHeight:mainBlock.height inChain:self];
+    }
+    NSAssert(mainBlock && forkBlock, @"Attempt to follow an orphan chain");
+
+    // skip both while skip ancestors differ, base is below
     while (![mainBlock isEqual:forkBlock]) {
-        if (mainBlock.height > forkBlock.height) {
+        const uint32_t skipHeight = WSBlockGetSkipHeight(forkBlock.height);
+        WSStorableBlock *mainSkipBlock = [mainBlock ancestorAtHeight:skipHeight inChain:self];
+        WSStorableBlock *forkSkipBlock = [forkBlock ancestorAtHeight:skipHeight inChain:self];
+
+        if (mainSkipBlock && forkSkipBlock && ![mainSkipBlock isEqual:forkSkipBlock]) {
+            mainBlock = mainSkipBlock;
+            forkBlock = forkSkipBlock;
+        }
+        else {
             mainBlock = [mainBlock previousBlockInChain:self];
-            
-            NSAssert(mainBlock, @"Attempt to follow an orphan chain");
-        } else {
             forkBlock = [forkBlock previousBlockInChain:self];
-
-            NSAssert(forkBlock, @"Attempt to follow an orphan chain");
         }
+
+        NSAssert(mainBlock && forkBlock, @"Attempt to follow an orphan chain");
     }
 
     return forkBlock;
@@ -483,4 +590,17 @@
     return [NSString stringWithFormat:@"{%@}", WSStringDescriptionFromTokens(tokens, indent)];
 }
 
+
+// stops when the store can't trim more, e.g. forks exceed the limit but only head is left on main chain
+- (void)trimStore
+{
+    while (self.store.size > self.blockStoreSize) {
+        const NSUInteger size = self.store.size;
+        [self.store removeTailBlock];
+        if (self.store.size == size) {
+            DDLogDebug(@"Store can't be trimmed further (%u > %u)", size, self.blockStoreSize);
+            break;
+        }
+    }
+}
 @end
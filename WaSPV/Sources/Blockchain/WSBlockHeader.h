@@ -42,7 +42,20 @@
                               bits:(uint32_t)bits
                              nonce:(uint32_t)nonce;
 
+- (instancetype)initWithParameters:(id<WSParameters>)parameters
+                           version:(uint32_t)version
+                   previousBlockId:(WSHash256 *)previousBlockId
+                        merkleRoot:(WSHash256 *)merkleRoot
+                         timestamp:(uint32_t)timestamp
+                              bits:(uint32_t)bits
+                             nonce:(uint32_t)nonce
+                           blockId:(WSHash256 *)blockId; // trusted, not recomputed
+
+// raw 80 bytes (no txCount), nil blockId is computed
+- (instancetype)initWithParameters:(id<WSParameters>)parameters bytes:(const void *)bytes blockId:(WSHash256 *)blockId;
+
 - (id<WSParameters>)parameters;
+- (const void *)bytes; // raw 80 bytes
 - (uint32_t)version;
 - (WSHash256 *)previousBlockId;
 - (WSHash256 *)merkleRoot;
@@ -52,10 +65,14 @@
 - (uint32_t)txCount;
 
 - (WSHash256 *)blockId;
+- (BOOL)hasPreviousBlockId:(WSHash256 *)blockId; // no allocations
 - (NSData *)difficultyData;
 - (NSString *)difficultyString;
 - (NSData *)workData;
 - (NSString *)workString;
 - (BOOL)verifyWithError:(NSError **)error;
 
+// parallel, returns index of first invalid header or NSNotFound
++ (NSUInteger)verifyHeaders:(NSArray *)headers error:(NSError **)error;
+
 @end
@@ -25,29 +25,59 @@
 //  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
 //
 
-#import <openssl/bn.h>
+#import <CommonCrypto/CommonDigest.h>
+#import <stdatomic.h>
+#import "AutoCoding.h"
 
 #import "WSBlockHeader.h"
 #import "WSBlockMacros.h"
 #import "WSBitcoin.h"
+#import "WSConfig.h"
 #import "WSMacros.h"
 #import "WSErrors.h"
-#import "NSData+Hash.h"
 
-@interface WSBlockHeader ()
+//
+// header is kept as raw bytes (without txCount), fields are read
+// on demand and hash objects are only created when requested
+//
+// raw = version(4) | previous(32) | merkle root(32) | timestamp(4) | bits(4) | nonce(4)
+//
+#define WSBlockHeaderRawLength                  80
+
+static const NSUInteger WSBlockHeaderVersionOffset      = 0;
+static const NSUInteger WSBlockHeaderPreviousOffset     = 4;
+static const NSUInteger WSBlockHeaderMerkleRootOffset   = 36;
+static const NSUInteger WSBlockHeaderTimestampOffset    = 68;
+static const NSUInteger WSBlockHeaderBitsOffset         = 72;
+static const NSUInteger WSBlockHeaderNonceOffset        = 76;
+
+static inline uint32_t WSBlockHeaderReadUint32(const uint8_t *bytes)
+{
+    uint32_t n;
+    memcpy(&n, bytes, sizeof(n));
+    return CFSwapInt32LittleToHost(n);
+}
+
+static inline void WSBlockHeaderWriteUint32(uint8_t *bytes, uint32_t n)
+{
+    n = CFSwapInt32HostToLittle(n);
+    memcpy(bytes, &n, sizeof(n));
+}
+
+@interface WSBlockHeader () {
+    uint8_t _rawBytes[WSBlockHeaderRawLength];
+}
 
 @property (nonatomic, strong) id<WSParameters> parameters;
-@property (nonatomic, assign) uint32_t version;
-@property (nonatomic, strong) WSHash256 *previousBlockId;
-@property (nonatomic, strong) WSHash256 *merkleRoot;
-@property (nonatomic, assign) uint32_t timestamp;
-@property (nonatomic, assign) uint32_t bits;
-@property (nonatomic, assign) uint32_t nonce;
 
-@property (nonatomic, strong) WSHash256 *blockId;
+// lazy, atomic because headers are shared across queues
+@property (atomic, strong) WSHash256 *cachedBlockId;
+@property (atomic, strong) WSHash256 *cachedPreviousBlockId;
+@property (atomic, strong) WSHash256 *cachedMerkleRoot;
 
+- (void)setBlockId:(WSHash256 *)blockId;
 - (WSHash256 *)computeBlockId;
-+ (BIGNUM *)largestHash;
+- (BOOL)verifyWithCurrentTimestamp:(uint32_t)currentTimestamp error:(NSError **)error;
 
 @end
 
@@ -80,37 +110,119 @@
                              nonce:(uint32_t)nonce
                            blockId:(WSHash256 *)blockId
 {
-    WSExceptionCheckIllegal(parameters != nil, @"Nil parameters");
     WSExceptionCheckIllegal(previousBlockId != nil, @"Nil previousBlockId");
+
+    uint8_t bytes[WSBlockHeaderRawLength];
+    WSBlockHeaderWriteUint32(bytes + WSBlockHeaderVersionOffset, version);
+    memcpy(bytes + WSBlockHeaderPreviousOffset, previousBlockId.bytes, WSHash256Length);
+    if (merkleRoot) {
+        memcpy(bytes + WSBlockHeaderMerkleRootOffset, merkleRoot.bytes, WSHash256Length);
+    }
+    else {
+        memset(bytes + WSBlockHeaderMerkleRootOffset, 0, WSHash256Length);
+    }
+    WSBlockHeaderWriteUint32(bytes + WSBlockHeaderTimestampOffset, timestamp);
+    WSBlockHeaderWriteUint32(bytes + WSBlockHeaderBitsOffset, bits);
+    WSBlockHeaderWriteUint32(bytes + WSBlockHeaderNonceOffset, nonce);
+
+    if ((self = [self initWithParameters:parameters bytes:bytes blockId:blockId])) {
+        self.cachedPreviousBlockId = previousBlockId;
+        self.cachedMerkleRoot = merkleRoot;
+    }
+    return self;
+}
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters bytes:(const void *)bytes blockId:(WSHash256 *)blockId
+{
+    WSExceptionCheckIllegal(parameters != nil, @"Nil parameters");
+    WSExceptionCheckIllegal(bytes != NULL, @"NULL bytes");
     
     if ((self = [super init])) {
         self.parameters = parameters;
-        self.version = version;
-        self.previousBlockId = previousBlockId;
-        self.merkleRoot = merkleRoot;
-        self.timestamp = timestamp;
-        self.bits = bits;
-        self.nonce = nonce;
-        self.blockId = (blockId ? : [self computeBlockId]);
+        memcpy(_rawBytes, bytes, WSBlockHeaderRawLength);
+        self.cachedBlockId = blockId;
     }
     return self;
 }
 
+- (const void *)bytes
+{
+    return _rawBytes;
+}
+
+- (uint32_t)version
+{
+    return WSBlockHeaderReadUint32(_rawBytes + WSBlockHeaderVersionOffset);
+}
+
+- (WSHash256 *)previousBlockId
+{
+    WSHash256 *previousBlockId = self.cachedPreviousBlockId;
+    if (!previousBlockId) {
+        previousBlockId = WSHash256FromData([NSData dataWithBytes:(_rawBytes + WSBlockHeaderPreviousOffset) length:WSHash256Length]);
+        self.cachedPreviousBlockId = previousBlockId;
+    }
+    return previousBlockId;
+}
+
+- (WSHash256 *)merkleRoot
+{
+    WSHash256 *merkleRoot = self.cachedMerkleRoot;
+    if (!merkleRoot) {
+        merkleRoot = WSHash256FromData([NSData dataWithBytes:(_rawBytes + WSBlockHeaderMerkleRootOffset) length:WSHash256Length]);
+        self.cachedMerkleRoot = merkleRoot;
+    }
+    return merkleRoot;
+}
+
+- (uint32_t)timestamp
+{
+    return WSBlockHeaderReadUint32(_rawBytes + WSBlockHeaderTimestampOffset);
+}
+
+- (uint32_t)bits
+{
+    return WSBlockHeaderReadUint32(_rawBytes + WSBlockHeaderBitsOffset);
+}
+
+- (uint32_t)nonce
+{
+    return WSBlockHeaderReadUint32(_rawBytes + WSBlockHeaderNonceOffset);
+}
+
 - (uint32_t)txCount
 {
     return 0;
 }
 
+- (WSHash256 *)blockId
+{
+    WSHash256 *blockId = self.cachedBlockId;
+    if (!blockId) {
+        blockId = [self computeBlockId];
+        self.cachedBlockId = blockId;
+    }
+    return blockId;
+}
+
+- (void)setBlockId:(WSHash256 *)blockId
+{
+    self.cachedBlockId = blockId;
+}
+
+- (BOOL)hasPreviousBlockId:(WSHash256 *)blockId
+{
+    return ((blockId.length == WSHash256Length) && (memcmp(_rawBytes + WSBlockHeaderPreviousOffset, blockId.bytes, WSHash256Length) == 0));
+}
+
 - (WSHash256 *)computeBlockId
 {
-    WSMutableBuffer *buffer = [[WSMutableBuffer alloc] initWithCapacity:(WSBlockHeaderSize - 1)];
-    [buffer appendUint32:self.version];
-    [buffer appendHash256:self.previousBlockId];
-    [buffer appendHash256:self.merkleRoot];
-    [buffer appendUint32:self.timestamp];
-    [buffer appendUint32:self.bits];
-    [buffer appendUint32:self.nonce];
-    return [buffer computeHash256];
+    uint8_t digest[CC_SHA256_DIGEST_LENGTH];
+    NSMutableData *data = [[NSMutableData alloc] initWithLength:CC_SHA256_DIGEST_LENGTH];
+
+    CC_SHA256(_rawBytes, WSBlockHeaderRawLength, digest);
+    CC_SHA256(digest, CC_SHA256_DIGEST_LENGTH, data.mutableBytes);
+    return WSHash256FromData(data);
 }
 
 - (NSData *)difficultyData
@@ -125,103 +237,122 @@
 
 - (NSData *)workData
 {
-    BIGNUM bnWork;
-    BIGNUM bnTargetPlusOne;
+    WSUInt256 work;
+    WSBlockGetWorkFromBits(&work, self.bits);
+    return WSBlockDataFromWork(&work);
+}
 
-    BN_init(&bnWork);
-    BN_init(&bnTargetPlusOne);
+- (NSString *)workString
+{
+    WSUInt256 work;
+    WSBlockGetWorkFromBits(&work, self.bits);
+    return WSUInt256GetDecimalString(&work);
+}
 
-    BN_CTX *ctx = BN_CTX_new();
-    BN_CTX_start(ctx);
-    WSBlockSetBits(&bnTargetPlusOne, self.bits);
-    BN_add(&bnTargetPlusOne, &bnTargetPlusOne, BN_value_one());
-    BN_div(&bnWork, NULL, [[self class] largestHash], &bnTargetPlusOne, ctx);
-    BN_CTX_end(ctx);
-    BN_CTX_free(ctx);
+- (BOOL)verifyWithError:(NSError *__autoreleasing *)error
+{
+    return [self verifyWithCurrentTimestamp:WSCurrentTimestamp() error:error];
+}
 
-    NSMutableData *workData = [[NSMutableData alloc] initWithLength:BN_num_bytes(&bnWork)];
-    BN_bn2bin(&bnWork, workData.mutableBytes);
++ (NSUInteger)verifyHeaders:(NSArray *)headers error:(NSError *__autoreleasing *)error
+{
+    WSExceptionCheckIllegal(headers != nil, @"Nil headers");
+
+    const NSUInteger count = headers.count;
+    const NSUInteger chunkSize = WSBlockHeaderVerifyChunkSize;
+    const NSUInteger chunks = (count + chunkSize - 1) / chunkSize;
+    const uint32_t currentTimestamp = WSCurrentTimestamp();
+    if (chunks == 0) {
+        return NSNotFound;
+    }
 
-    BN_free(&bnWork);
-    BN_free(&bnTargetPlusOne);
+    // first invalid index per chunk, chunks above the lowest failed one can stop early
+    NSUInteger *failures = malloc(chunks * sizeof(NSUInteger));
+    if (!failures) {
+        DDLogWarn(@"Unable to allocate %u chunks, verifying %u headers serially", chunks, count);
 
-    return workData;
-}
+        for (NSUInteger i = 0; i < count; ++i) {
+            WSBlockHeader *header = headers[i];
+            if (![header verifyWithCurrentTimestamp:currentTimestamp error:error]) {
+                return i;
+            }
+        }
+        return NSNotFound;
+    }
+    _Atomic(int32_t) lowestFailedChunk = INT32_MAX;
+    _Atomic(int32_t) *lowestFailedChunkPtr = &lowestFailedChunk;
+
+    dispatch_apply(chunks, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t chunk) {
+        const NSUInteger from = chunk * chunkSize;
+        const NSUInteger to = MIN(from + chunkSize, count);
+
+        failures[chunk] = NSNotFound;
+        for (NSUInteger i = from; i < to; ++i) {
+            if (atomic_load_explicit(lowestFailedChunkPtr, memory_order_relaxed) < (int32_t)chunk) {
+                return;
+            }
+            WSBlockHeader *header = headers[i];
+            if (![header verifyWithCurrentTimestamp:currentTimestamp error:NULL]) {
+                failures[chunk] = i;
+
+                // lowest is reloaded on failure
+                int32_t lowest = atomic_load(lowestFailedChunkPtr);
+                while (((int32_t)chunk < lowest) && !atomic_compare_exchange_weak(lowestFailedChunkPtr, &lowest, (int32_t)chunk)) {
+                }
+                return;
+            }
+        }
+    });
 
-- (NSString *)workString
-{
-    BIGNUM work;
-    
-    BN_init(&work);
-    WSBlockWorkFromData(&work, self.workData);
-    NSString *workString = [[NSString alloc] initWithCString:BN_bn2dec(&work) encoding:NSUTF8StringEncoding];
-    BN_free(&work);
-    
-    return workString;
+    // chunks below the lowest failed one always run to completion
+    NSUInteger firstFailure = NSNotFound;
+    const int32_t lowestChunk = atomic_load(&lowestFailedChunk);
+    if (lowestChunk != INT32_MAX) {
+        firstFailure = failures[lowestChunk];
+    }
+    free(failures);
+
+    // serial re-run on the culprit for the error
+    if ((firstFailure != NSNotFound) && error) {
+        WSBlockHeader *header = headers[firstFailure];
+        [header verifyWithCurrentTimestamp:currentTimestamp error:error];
+    }
+    return firstFailure;
 }
 
-- (BOOL)verifyWithError:(NSError *__autoreleasing *)error
+- (BOOL)verifyWithCurrentTimestamp:(uint32_t)currentTimestamp error:(NSError *__autoreleasing *)error
 {
-    BOOL verificationFailed = NO;
-    BIGNUM target;
-    BIGNUM maxTarget;
-    BIGNUM hash;
+    WSUInt256 target;
+    WSUInt256 maxTarget;
+    WSUInt256 hash;
     
-    BN_init(&target);
-    BN_init(&maxTarget);
-    BN_init(&hash);
-
-    WSBlockSetBits(&target, self.bits);
+    const BOOL isValidTarget = WSBlockSetBits(&target, self.bits);
     WSBlockSetBits(&maxTarget, [self.parameters maxProofOfWork]);
 
     // range out of [1, maxProofOfWork]
-    if ((BN_cmp(&target, BN_value_one()) < 0) || (BN_cmp(&target, &maxTarget) > 0)) {
+    if (!isValidTarget || WSUInt256IsZero(&target) || (WSUInt256Compare(&target, &maxTarget) > 0)) {
         WSErrorSet(error, WSErrorCodeInvalidBlock, @"Target out of range (%x)", self.bits);
-        verificationFailed = YES;
+        return NO;
     }
 
     // invalid proof-of-work (smaller values are more difficult)
-    if (!verificationFailed) {
-        WSBlockSetHash(&hash, self.blockId);
-
-        if (BN_cmp(&hash, &target) > 0) {
-            WSErrorSet(error, WSErrorCodeInvalidBlock, @"Block less difficult (greater) than target (%x > %x)",
-                       WSBlockGetBits(&hash), self.bits);
+    WSBlockSetHash(&hash, self.blockId);
+    if (WSUInt256Compare(&hash, &target) > 0) {
+        WSErrorSet(error, WSErrorCodeInvalidBlock, @"Block less difficult (greater) than target (%x > %x)",
+                   WSBlockGetBits(&hash), self.bits);
 
-            verificationFailed = YES;
-        }
+        return NO;
     }
     
-//    DDLogDebug(@"Target: %s", BN_bn2hex(&target));
-//    DDLogDebug(@"Hash  : %s", BN_bn2hex(&hash));
-    
     // timestamp in the future
-    if (!verificationFailed) {
-        const uint32_t currentTimestamp = WSCurrentTimestamp();
-        if (self.timestamp > currentTimestamp + WSBlockAllowedTimeDrift) {
-            WSErrorSet(error, WSErrorCodeInvalidBlock, @"Timestamp ahead in the future (%u > %u + %u)",
-                       self.timestamp, currentTimestamp, WSBlockAllowedTimeDrift);
+    if (self.timestamp > currentTimestamp + WSBlockAllowedTimeDrift) {
+        WSErrorSet(error, WSErrorCodeInvalidBlock, @"Timestamp ahead in the future (%u > %u + %u)",
+                   self.timestamp, currentTimestamp, WSBlockAllowedTimeDrift);
 
-            verificationFailed = YES;
-        }
+        return NO;
     }
-    
-    BN_free(&target);
-    BN_free(&maxTarget);
-    BN_free(&hash);
 
-    return !verificationFailed;
-}
-
-+ (BIGNUM *)largestHash
-{
-    static BIGNUM largest;
-    static dispatch_once_t onceToken;
-    dispatch_once(&onceToken, ^{
-        BN_init(&largest);
-        BN_set_bit(&largest, 256);
-    });
-    return &largest;
+    return YES;
 }
 
 - (BOOL)isEqual:(id)object
@@ -234,12 +365,7 @@
     }
     WSBlockHeader *header = object;
     return ([header.blockId isEqual:self.blockId] &&
-            (header.version == self.version) &&
-            [header.previousBlockId isEqual:self.previousBlockId] &&
-            [header.merkleRoot isEqual:self.merkleRoot] &&
-            (header.timestamp == self.timestamp) &&
-            (header.bits == self.bits) &&
-            (header.nonce == self.nonce));
+            (memcmp(header.bytes, _rawBytes, WSBlockHeaderRawLength) == 0));
 }
 
 - (NSUInteger)hash
@@ -256,27 +382,15 @@
 
 - (instancetype)copyWithZone:(NSZone *)zone
 {
-    WSBlockHeader *copy = [[self class] allocWithZone:zone];
-    copy.version = self.version;
-    copy.previousBlockId = [self.previousBlockId copyWithZone:zone];
-    copy.merkleRoot = [self.merkleRoot copyWithZone:zone];
-    copy.timestamp = self.timestamp;
-    copy.bits = self.bits;
-    copy.nonce = self.nonce;
-    copy.blockId = [self.blockId copyWithZone:zone];
-    return copy;
+    // immutable
+    return self;
 }
 
 #pragma mark WSBufferEncoder
 
 - (void)appendToMutableBuffer:(WSMutableBuffer *)buffer
 {
-    [buffer appendUint32:self.version];
-    [buffer appendHash256:self.previousBlockId];
-    [buffer appendHash256:self.merkleRoot];
-    [buffer appendUint32:self.timestamp];
-    [buffer appendUint32:self.bits];
-    [buffer appendUint32:self.nonce];
+    [buffer appendBytes:_rawBytes length:WSBlockHeaderRawLength];
     [buffer appendUint8:self.txCount];
 }
 
@@ -295,28 +409,7 @@
         WSErrorSetNotEnoughBytes(error, [self class], available, WSBlockHeaderSize);
         return nil;
     }
-    NSUInteger offset = from;
-
-    const uint32_t version = [buffer uint32AtOffset:offset];
-    offset += sizeof(uint32_t);
-
-    WSHash256 *previousBlockId = [buffer hash256AtOffset:offset];
-    offset += WSHash256Length;
-
-    WSHash256 *merkleRoot = [buffer hash256AtOffset:offset];
-    offset += WSHash256Length;
-
-    const uint32_t timestamp = [buffer uint32AtOffset:offset];
-    offset += sizeof(uint32_t);
-
-    const uint32_t bits = [buffer uint32AtOffset:offset];
-    offset += sizeof(uint32_t);
-
-    const uint32_t nonce = [buffer uint32AtOffset:offset];
-    
-    WSHash256 *blockId = WSHash256Compute([buffer dataAtOffset:from length:(WSBlockHeaderSize - 1)]);
-    
-    return [self initWithParameters:parameters version:version previousBlockId:previousBlockId merkleRoot:merkleRoot timestamp:timestamp bits:bits nonce:nonce blockId:blockId];
+    return [self initWithParameters:parameters bytes:((const uint8_t *)buffer.bytes + from) blockId:nil];
 }
 
 #pragma mark WSIndentableDescription
@@ -335,4 +428,31 @@
     return [NSString stringWithFormat:@"{%@}", WSStringDescriptionFromTokens(tokens, indent)];
 }
 
+#pragma mark AutoCoding
+
+- (id)initWithCoder:(NSCoder *)aDecoder
+{
+    if ((self = [super initWithCoder:aDecoder])) {
+        NSData *rawData = [aDecoder decodeDataObject];
+        if (rawData.length != WSBlockHeaderRawLength) {
+            return nil;
+        }
+        memcpy(_rawBytes, rawData.bytes, WSBlockHeaderRawLength);
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)aCoder
+{
+    [super encodeWithCoder:aCoder];
+
+    [aCoder encodeDataObject:[NSData dataWithBytes:_rawBytes length:WSBlockHeaderRawLength]];
+}
+
++ (NSDictionary *)codableProperties
+{
+    return @{@"parameters": [NSObject class],
+             @"blockId": [WSHash256 class]};
+}
+
 @end
@@ -26,13 +26,179 @@
 //
 
 #import <Foundation/Foundation.h>
-#import <openssl/bn.h>
 
 #import "WSHash256.h"
 #import "NSData+Binary.h"
 
 @protocol WSParameters;
 
+#pragma mark - Unsigned 256-bit integer
+
+//
+// fixed-width unsigned 256-bit integer for targets and chain work,
+// lives on the stack or inline in other objects (no allocations)
+//
+// words are least significant first, arithmetic wraps modulo 2^256
+//
+typedef struct {
+    uint32_t words[8];
+} WSUInt256;
+
+static const NSUInteger WSUInt256Words = 8;
+
+static inline void WSUInt256SetZero(WSUInt256 *n)
+{
+    memset(n->words, 0, sizeof(n->words));
+}
+
+static inline void WSUInt256SetWord(WSUInt256 *n, uint32_t word)
+{
+    WSUInt256SetZero(n);
+    n->words[0] = word;
+}
+
+static inline BOOL WSUInt256IsZero(const WSUInt256 *n)
+{
+    for (NSUInteger i = 0; i < WSUInt256Words; ++i) {
+        if (n->words[i]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static inline int WSUInt256Compare(const WSUInt256 *a, const WSUInt256 *b)
+{
+    for (NSInteger i = WSUInt256Words - 1; i >= 0; --i) {
+        if (a->words[i] < b->words[i]) {
+            return -1;
+        }
+        if (a->words[i] > b->words[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// significant bits, 0 for zero
+static inline NSUInteger WSUInt256Bits(const WSUInt256 *n)
+{
+    for (NSInteger i = WSUInt256Words - 1; i >= 0; --i) {
+        if (n->words[i]) {
+            return 32 * i + (32 - __builtin_clz(n->words[i]));
+        }
+    }
+    return 0;
+}
+
+static inline void WSUInt256Add(WSUInt256 *r, const WSUInt256 *a, const WSUInt256 *b)
+{
+    uint64_t carry = 0;
+    for (NSUInteger i = 0; i < WSUInt256Words; ++i) {
+        const uint64_t sum = (uint64_t)a->words[i] + b->words[i] + carry;
+        r->words[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+}
+
+static inline void WSUInt256Subtract(WSUInt256 *r, const WSUInt256 *a, const WSUInt256 *b)
+{
+    uint64_t borrow = 0;
+    for (NSUInteger i = 0; i < WSUInt256Words; ++i) {
+        const uint64_t difference = (uint64_t)a->words[i] - b->words[i] - borrow;
+        r->words[i] = (uint32_t)difference;
+        borrow = (difference >> 32) & 1;
+    }
+}
+
+static inline void WSUInt256ShiftLeft(WSUInt256 *r, const WSUInt256 *a, NSUInteger shift)
+{
+    WSUInt256 x;
+    WSUInt256SetZero(&x);
+
+    const NSUInteger wordShift = shift / 32;
+    const NSUInteger bitShift = shift % 32;
+    for (NSUInteger i = wordShift; i < WSUInt256Words; ++i) {
+        x.words[i] = a->words[i - wordShift] << bitShift;
+        if (bitShift && (i > wordShift)) {
+            x.words[i] |= a->words[i - wordShift - 1] >> (32 - bitShift);
+        }
+    }
+    *r = x;
+}
+
+static inline void WSUInt256ShiftRight(WSUInt256 *r, const WSUInt256 *a, NSUInteger shift)
+{
+    WSUInt256 x;
+    WSUInt256SetZero(&x);
+
+    const NSUInteger wordShift = shift / 32;
+    const NSUInteger bitShift = shift % 32;
+    for (NSUInteger i = wordShift; i < WSUInt256Words; ++i) {
+        x.words[i - wordShift] = a->words[i] >> bitShift;
+        if (bitShift && (i + 1 < WSUInt256Words)) {
+            x.words[i - wordShift] |= a->words[i + 1] << (32 - bitShift);
+        }
+    }
+    *r = x;
+}
+
+static inline void WSUInt256MultiplyWord(WSUInt256 *r, const WSUInt256 *a, uint32_t word)
+{
+    uint64_t carry = 0;
+    for (NSUInteger i = 0; i < WSUInt256Words; ++i) {
+        const uint64_t product = (uint64_t)a->words[i] * word + carry;
+        r->words[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+}
+
+// returns remainder
+static inline uint32_t WSUInt256DivideWord(WSUInt256 *r, const WSUInt256 *a, uint32_t word)
+{
+    NSCParameterAssert(word > 0);
+
+    uint64_t remainder = 0;
+    for (NSInteger i = WSUInt256Words - 1; i >= 0; --i) {
+        const uint64_t dividend = (remainder << 32) | a->words[i];
+        r->words[i] = (uint32_t)(dividend / word);
+        remainder = dividend % word;
+    }
+    return (uint32_t)remainder;
+}
+
+// shift-subtract long division, remainder is optional
+static inline void WSUInt256Divide(WSUInt256 *quotient, WSUInt256 *remainder, const WSUInt256 *a, const WSUInt256 *b)
+{
+    NSCParameterAssert(!WSUInt256IsZero(b));
+
+    WSUInt256 q;
+    WSUInt256 r;
+    WSUInt256SetZero(&q);
+    WSUInt256SetZero(&r);
+
+    for (NSInteger i = (NSInteger)WSUInt256Bits(a) - 1; i >= 0; --i) {
+        const BOOL carry = ((r.words[WSUInt256Words - 1] & 0x80000000) != 0);
+        WSUInt256ShiftLeft(&r, &r, 1);
+        r.words[0] |= (a->words[i / 32] >> (i % 32)) & 1;
+
+        // wrapping subtraction is right when the shift carried out
+        if (carry || (WSUInt256Compare(&r, b) >= 0)) {
+            WSUInt256Subtract(&r, &r, b);
+            q.words[i / 32] |= (1u << (i % 32));
+        }
+    }
+
+    *quotient = q;
+    if (remainder) {
+        *remainder = r;
+    }
+}
+
+NSString *WSUInt256GetDecimalString(const WSUInt256 *n);
+
+#pragma mark - Block arithmetic
+
 //
 // "Compact" is a way to represent a 256-bit number as 32-bit.
 //
@@ -42,40 +208,46 @@
 //
 
 //
-// adapted from: https://github.com/voisine/breadwallet/blob/master/BreadWallet/BRMerkleBlock.m
+// adapted from: https://github.com/bitcoin/bitcoin/blob/master/src/arith_uint256.cpp
 //
-static inline void WSBlockSetBits(BIGNUM *target, uint32_t bits)
+// returns NO for negative or overflowing targets
+//
+static inline BOOL WSBlockSetBits(WSUInt256 *target, uint32_t bits)
 {
     const uint32_t size = bits >> 24;
-    const uint32_t word = bits & 0x007fffff;
+    uint32_t word = bits & 0x007fffff;
     
     if (size > 3) {
-        BN_set_word(target, word);
-        BN_lshift(target, target, 8 * (size - 3));
+        WSUInt256SetWord(target, word);
+        WSUInt256ShiftLeft(target, target, 8 * (size - 3));
     }
     else {
-        BN_set_word(target, word >> (8 * (3 - size)));
+        word >>= 8 * (3 - size);
+        WSUInt256SetWord(target, word);
     }
-    
-    BN_set_negative(target, (bits & 0x00800000) != 0);
+
+    const BOOL isNegative = ((word != 0) && ((bits & 0x00800000) != 0));
+    const BOOL isOverflow = ((word != 0) && ((size > 34) ||
+                                             ((word > 0xff) && (size > 33)) ||
+                                             ((word > 0xffff) && (size > 32))));
+    return (!isNegative && !isOverflow);
 }
 
 //
-// adapted from: https://github.com/voisine/breadwallet/blob/master/BreadWallet/BRMerkleBlock.m
+// adapted from: https://github.com/bitcoin/bitcoin/blob/master/src/arith_uint256.cpp
 //
-static inline uint32_t WSBlockGetBits(const BIGNUM *target)
+static inline uint32_t WSBlockGetBits(const WSUInt256 *target)
 {
-    uint32_t size = BN_num_bytes(target);
+    uint32_t size = (uint32_t)(WSUInt256Bits(target) + 7) / 8;
     uint32_t compact = 0;
-    BIGNUM x;
     
     if (size > 3) {
-        BN_init(&x);
-        BN_rshift(&x, target, 8 * (size - 3));
-        compact = BN_get_word(&x);
+        WSUInt256 x;
+        WSUInt256ShiftRight(&x, target, 8 * (size - 3));
+        compact = x.words[0];
     }
     else {
-        compact = BN_get_word(target) << (8 * (3 - size));
+        compact = target->words[0] << (8 * (3 - size));
     }
     
     // if sign is already set, divide the mantissa by 256 and increment the exponent
@@ -84,25 +256,69 @@ static inline uint32_t WSBlockGetBits(const BIGNUM *target)
         ++size;
     }
     
-    return (compact | (size << 24)) | (BN_is_negative(target) ? 0x00800000 : 0);
+    return (compact | (size << 24));
 }
 
-static inline void WSBlockSetHash(BIGNUM *hash, WSHash256 *blockId)
+// hash bytes are a little-endian number
+static inline void WSBlockSetHash(WSUInt256 *hash, WSHash256 *blockId)
 {
-    BN_bin2bn(blockId.data.reverse.bytes, (int)blockId.length, hash);
+    const uint8_t *bytes = blockId.bytes;
+    for (NSUInteger i = 0; i < WSUInt256Words; ++i) {
+        uint32_t word;
+        memcpy(&word, bytes + 4 * i, sizeof(word));
+        hash->words[i] = CFSwapInt32LittleToHost(word);
+    }
 }
 
-static inline NSData *WSBlockDataFromWork(BIGNUM *work)
+// minimal big-endian bytes
+static inline NSData *WSBlockDataFromWork(const WSUInt256 *work)
 {
-    NSMutableData *data = [[NSMutableData alloc] initWithLength:BN_num_bytes(work)];
-    BN_bn2bin(work, data.mutableBytes);
+    const NSUInteger length = (WSUInt256Bits(work) + 7) / 8;
+    NSMutableData *data = [[NSMutableData alloc] initWithLength:length];
+    uint8_t *bytes = data.mutableBytes;
+    for (NSUInteger i = 0; i < length; ++i) {
+        bytes[length - 1 - i] = (uint8_t)(work->words[i / 4] >> (8 * (i % 4)));
+    }
     return data;
 }
 
-static inline void WSBlockWorkFromData(BIGNUM *work, NSData *data)
+// big-endian bytes, excess leading bytes are dropped
+static inline void WSBlockWorkFromData(WSUInt256 *work, NSData *data)
 {
-    BN_bin2bn(data.bytes, (int)data.length, work);
+    WSUInt256SetZero(work);
+
+    const uint8_t *bytes = data.bytes;
+    const NSUInteger length = MIN(data.length, 4 * WSUInt256Words);
+    for (NSUInteger i = 0; i < length; ++i) {
+        work->words[i / 4] |= (uint32_t)bytes[data.length - 1 - i] << (8 * (i % 4));
+    }
 }
 
+// 2^256 / (target + 1), cached by bits, zero for invalid targets
+void WSBlockGetWorkFromBits(WSUInt256 *work, uint32_t bits);
+
 NSData *WSBlockGetDifficultyFromBits(id<WSParameters> parameters, uint32_t bits);
 NSString *WSBlockGetDifficultyStringFromBits(id<WSParameters> parameters, uint32_t bits);
+
+//
+// height of the skip ancestor, any height >= 2 skips at least
+// one block back and following skips reaches any ancestor
+// in O(log(height)) hops
+//
+// adapted from: https://github.com/bitcoin/bitcoin/blob/master/src/chain.cpp
+//
+static inline uint32_t WSBlockInvertLowestOne(uint32_t n)
+{
+    return (n & (n - 1));
+}
+
+static inline uint32_t WSBlockGetSkipHeight(uint32_t height)
+{
+    if (height < 2) {
+        return 0;
+    }
+    
+    // odd heights skip to a different even height than the previous one
+    return ((height & 1) ? WSBlockInvertLowestOne(WSBlockInvertLowestOne(height - 1)) + 1 : WSBlockInvertLowestOne(height));
+}
+
@@ -28,68 +28,111 @@
 #import "WSBlockMacros.h"
 #import "WSMacros.h"
 
+NSString *WSUInt256GetDecimalString(const WSUInt256 *n)
+{
+    if (WSUInt256IsZero(n)) {
+        return @"0";
+    }
+
+    // 2^256 has 78 digits
+    char digits[80];
+    NSUInteger i = sizeof(digits) - 1;
+    digits[i] = '\0';
+
+    WSUInt256 x = *n;
+    while (!WSUInt256IsZero(&x)) {
+        digits[--i] = '0' + WSUInt256DivideWord(&x, &x, 10);
+    }
+    return [NSString stringWithUTF8String:&digits[i]];
+}
+
+//
+// most headers in a retarget period share the same bits, so
+// the division is only needed once per period
+//
+// small direct-mapped cache per thread, headers are verified
+// concurrently and a shared cache would need locking
+//
+#define WSBlockWorkCacheSize    8
+
+typedef struct {
+    BOOL isValid;
+    uint32_t bits;
+    WSUInt256 work;
+} WSBlockWorkCacheEntry;
+
+static __thread WSBlockWorkCacheEntry WSBlockWorkCache[WSBlockWorkCacheSize];
+
+void WSBlockGetWorkFromBits(WSUInt256 *work, uint32_t bits)
+{
+    NSCParameterAssert(work);
+
+    WSBlockWorkCacheEntry *entry = &WSBlockWorkCache[(bits ^ (bits >> 24)) % WSBlockWorkCacheSize];
+
+    if (entry->isValid && (entry->bits == bits)) {
+        *work = entry->work;
+        return;
+    }
+
+    WSUInt256 target;
+    if (!WSBlockSetBits(&target, bits) || WSUInt256IsZero(&target)) {
+        WSUInt256SetZero(work);
+    }
+    else {
+
+        //
+        // 2^256 doesn't fit, but 2^256 / (target + 1) = ~target / (target + 1) + 1
+        //
+        // compact targets have 23 significant bits at most,
+        // target + 1 never wraps
+        //
+        WSUInt256 notTarget;
+        WSUInt256 one;
+        WSUInt256SetWord(&one, 1);
+        for (NSUInteger i = 0; i < WSUInt256Words; ++i) {
+            notTarget.words[i] = ~target.words[i];
+        }
+        WSUInt256Add(&target, &target, &one);
+        WSUInt256Divide(work, NULL, &notTarget, &target);
+        WSUInt256Add(work, work, &one);
+    }
+
+    entry->isValid = YES;
+    entry->bits = bits;
+    entry->work = *work;
+}
+
 //
 // difficulty = maxTarget / target > 1.0
 // maxDifficulty = maxTarget / maxTarget = 1.0
 //
-static inline void WSBlockGetDifficultyInteger(id<WSParameters> parameters, BIGNUM *diffInteger, BIGNUM *diffFraction, const BIGNUM *target)
+static inline void WSBlockGetDifficultyInteger(id<WSParameters> parameters, WSUInt256 *diffInteger, uint32_t bits)
 {
     NSCParameterAssert(parameters);
     
-    BIGNUM maxTarget;
-    
-    BN_init(&maxTarget);
+    WSUInt256 maxTarget;
+    WSUInt256 target;
+
     WSBlockSetBits(&maxTarget, [parameters maxProofOfWork]);
-    
-    BN_CTX *ctx = BN_CTX_new();
-    BN_CTX_start(ctx);
-    BN_div(diffInteger, diffFraction, &maxTarget, target, ctx);
-    BN_CTX_end(ctx);
-    BN_CTX_free(ctx);
-    
-    BN_free(&maxTarget);
+    if (!WSBlockSetBits(&target, bits) || WSUInt256IsZero(&target)) {
+        WSUInt256SetZero(diffInteger);
+        return;
+    }
+    WSUInt256Divide(diffInteger, NULL, &maxTarget, &target);
 }
 
 NSData *WSBlockGetDifficultyFromBits(id<WSParameters> parameters, uint32_t bits)
 {
-    BIGNUM target;
-    BIGNUM diffInteger;
-    BIGNUM diffFraction;
-    
-    BN_init(&target);
-    BN_init(&diffInteger);
-    BN_init(&diffFraction);
-    
-    WSBlockSetBits(&target, bits);
-    WSBlockGetDifficultyInteger(parameters, &diffInteger, &diffFraction, &target);
-    NSData *difficulty = WSBlockDataFromWork(&diffInteger);
-    
-    BN_free(&target);
-    BN_free(&diffInteger);
-    BN_free(&diffFraction);
-    
-    return difficulty;
+    WSUInt256 diffInteger;
+    WSBlockGetDifficultyInteger(parameters, &diffInteger, bits);
+
+    return WSBlockDataFromWork(&diffInteger);
 }
 
 NSString *WSBlockGetDifficultyStringFromBits(id<WSParameters> parameters, uint32_t bits)
 {
-    BIGNUM target;
-    BIGNUM diffInteger;
-//    BIGNUM diffFraction;
-    
-    BN_init(&target);
-    BN_init(&diffInteger);
-//    BN_init(&diffFraction);
-    
-    WSBlockSetBits(&target, bits);
-//    WSBlockGetDifficultyInteger(&diffInteger, &diffFraction, &target);
-//    NSString *string = [NSString stringWithFormat:@"%s.%s", BN_bn2dec(&diffInteger), BN_bn2dec(&diffFraction)];
-    WSBlockGetDifficultyInteger(parameters, &diffInteger, NULL, &target);
-    NSString *string = [NSString stringWithUTF8String:BN_bn2dec(&diffInteger)];
-    
-    BN_free(&target);
-    BN_free(&diffInteger);
-//    BN_free(&diffFraction);
-    
-    return string;
+    WSUInt256 diffInteger;
+    WSBlockGetDifficultyInteger(parameters, &diffInteger, bits);
+
+    return WSUInt256GetDecimalString(&diffInteger);
 }
@@ -0,0 +1,55 @@
+//
+//  WSBlockMatcher.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "WSBIP37.h"
+
+@class WSBloomFilter;
+@class WSBlock;
+@class WSFilteredBlock;
+@class WSSignedTransaction;
+
+//
+// local BIP37 matching, full blocks are turned into the filtered blocks
+// a full node would send with 'merkleblock' and the following 'tx' messages
+//
+// https://github.com/bitcoin/bips/blob/master/bip-0037.mediawiki
+//
+// thread-safety: not required
+//
+@interface WSBlockMatcher : NSObject
+
+- (instancetype)initWithBloomFilter:(WSBloomFilter *)bloomFilter;
+- (instancetype)initWithData:(NSArray *)data flags:(WSBIP37Flags)flags; // NSData, exact matching
+- (WSBIP37Flags)flags;
+
+// matched outpoints are added according to flags
+- (BOOL)matchTransaction:(WSSignedTransaction *)transaction;
+- (WSFilteredBlock *)filteredBlockWithBlock:(WSBlock *)block transactions:(NSOrderedSet **)transactions;
+
+@end
@@ -0,0 +1,186 @@
+//
+//  WSBlockMatcher.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSBlockMatcher.h"
+#import "WSBloomFilter.h"
+#import "WSBlock.h"
+#import "WSFilteredBlock.h"
+#import "WSPartialMerkleTree.h"
+#import "WSTransaction.h"
+#import "WSTransactionInput.h"
+#import "WSTransactionOutput.h"
+#import "WSTransactionOutPoint.h"
+#import "WSScript.h"
+#import "WSHash256.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+@interface WSBlockMatcher ()
+
+@property (nonatomic, strong) WSMutableBloomFilter *bloomFilter;
+@property (nonatomic, strong) NSMutableSet *data;
+@property (nonatomic, assign) WSBIP37Flags flags;
+
+- (BOOL)containsData:(NSData *)data;
+- (void)insertData:(NSData *)data;
+- (BOOL)shouldInsertOutpointForScript:(WSScript *)script;
+
+@end
+
+@implementation WSBlockMatcher
+
+- (instancetype)initWithBloomFilter:(WSBloomFilter *)bloomFilter
+{
+    WSExceptionCheckIllegal(bloomFilter != nil, @"Nil bloomFilter");
+    
+    if ((self = [super init])) {
+        self.bloomFilter = [bloomFilter mutableCopy];
+        self.flags = [bloomFilter flags];
+    }
+    return self;
+}
+
+- (instancetype)initWithData:(NSArray *)data flags:(WSBIP37Flags)flags
+{
+    WSExceptionCheckIllegal(data != nil, @"Nil data");
+    
+    if ((self = [super init])) {
+        self.data = [[NSMutableSet alloc] initWithArray:data];
+        self.flags = flags;
+    }
+    return self;
+}
+
+// same as CBloomFilter::IsRelevantAndUpdate in bitcoind
+- (BOOL)matchTransaction:(WSSignedTransaction *)transaction
+{
+    WSExceptionCheckIllegal(transaction != nil, @"Nil transaction");
+    
+    WSHash256 *txId = transaction.txId;
+    BOOL isMatched = [self containsData:txId.data];
+    
+    // outputs are always tested so that matched outpoints are added for later spends
+    uint32_t index = 0;
+    for (WSTransactionOutput *output in transaction.outputs) {
+        for (WSScriptChunk *chunk in output.script.chunks) {
+            if ((chunk.pushDataLength == 0) || ![self containsData:chunk.pushData]) {
+                continue;
+            }
+            
+            isMatched = YES;
+            if ([self shouldInsertOutpointForScript:output.script]) {
+                WSTransactionOutPoint *outpoint = [WSTransactionOutPoint outpointWithParameters:output.parameters txId:txId index:index];
+                [self insertData:[[outpoint toBuffer] data]];
+            }
+            break;
+        }
+        ++index;
+    }
+    if (isMatched) {
+        return YES;
+    }
+    
+    // coinbase has neither a real outpoint nor a parsed scriptSig
+    for (WSSignedTransactionInput *input in transaction.inputs) {
+        if ([input isCoinbase]) {
+            continue;
+        }
+        if ([self containsData:[[input.outpoint toBuffer] data]]) {
+            return YES;
+        }
+        for (WSScriptChunk *chunk in input.script.chunks) {
+            if ((chunk.pushDataLength > 0) && [self containsData:chunk.pushData]) {
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+- (WSFilteredBlock *)filteredBlockWithBlock:(WSBlock *)block transactions:(NSOrderedSet *__autoreleasing *)transactions
+{
+    WSExceptionCheckIllegal(block != nil, @"Nil block");
+    WSExceptionCheckIllegal(transactions != NULL, @"NULL transactions");
+    
+    NSMutableArray *txIds = [[NSMutableArray alloc] initWithCapacity:block.transactions.count];
+    NSMutableIndexSet *matches = [[NSMutableIndexSet alloc] init];
+    NSMutableOrderedSet *matchedTransactions = [[NSMutableOrderedSet alloc] init];
+    
+    // in block order, spends in the same block are matched by previously added outpoints
+    NSUInteger index = 0;
+    for (WSSignedTransaction *transaction in block.transactions) {
+        [txIds addObject:transaction.txId];
+        if ([self matchTransaction:transaction]) {
+            [matches addIndex:index];
+            [matchedTransactions addObject:transaction];
+        }
+        ++index;
+    }
+    
+    WSPartialMerkleTree *partialMerkleTree = [[WSPartialMerkleTree alloc] initWithTxIds:txIds matches:matches];
+    
+    *transactions = matchedTransactions;
+    return [[WSFilteredBlock alloc] initWithHeader:block.header partialMerkleTree:partialMerkleTree];
+}
+
+#pragma mark Helpers
+
+- (BOOL)containsData:(NSData *)data
+{
+    if (self.bloomFilter) {
+        return [self.bloomFilter containsData:data];
+    }
+    return [self.data containsObject:data];
+}
+
+- (void)insertData:(NSData *)data
+{
+    if (self.bloomFilter) {
+        [self.bloomFilter insertData:data];
+    }
+    else {
+        [self.data addObject:data];
+    }
+}
+
+- (BOOL)shouldInsertOutpointForScript:(WSScript *)script
+{
+    switch (self.flags) {
+        case WSBIP37FlagsUpdateNone: {
+            return NO;
+        }
+        case WSBIP37FlagsUpdateAll: {
+            return YES;
+        }
+        case WSBIP37FlagsUpdateP2PubKeyOnly: {
+            return ([script isPay2PubKey] || [script isScriptSigWithReedemNumberOfSignatures:NULL publicKeys:NULL]);
+        }
+    }
+    return NO;
+}
+
+@end
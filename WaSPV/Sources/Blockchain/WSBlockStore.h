@@ -49,4 +49,12 @@
 - (NSUInteger)size;
 - (void)truncate;
 
+@optional
+
+// main chain only, nil if not stored
+- (WSStorableBlock *)blockAtHeight:(uint32_t)height;
+
+// hint about the number of blocks to be kept
+- (void)reserveCapacity:(NSUInteger)capacity;
+
 @end
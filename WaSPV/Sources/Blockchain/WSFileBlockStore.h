@@ -0,0 +1,51 @@
+//
+//  WSFileBlockStore.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "WSBlockStore.h"
+
+@class WSFilteredBlock;
+
+#pragma mark -
+
+//
+// main chain is stored as an append-only file of fixed-size
+// records ordered by height, block ids are looked up through
+// an on-disk hash index (path + ".index")
+//
+// forks are kept in memory until they either become the main
+// chain or get trimmed along with the tail
+//
+// NOTE: transactions are not serialized
+//
+@interface WSFileBlockStore : NSObject <WSBlockStore>
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters path:(NSString *)path error:(NSError **)error;
+- (NSString *)path;
+
+@end
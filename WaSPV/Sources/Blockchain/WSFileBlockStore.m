@@ -0,0 +1,786 @@
+//
+//  WSFileBlockStore.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <errno.h>
+
+#import "WSFileBlockStore.h"
+#import "WSHash256.h"
+#import "WSStorableBlock.h"
+#import "WSBlockHeader.h"
+#import "WSFilteredBlock.h"
+#import "WSBitcoin.h"
+#import "WSConfig.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+//
+// file = magic | version | network magic | tail index | record #0 | record #1 | ...
+//
+// record = raw header (80) | block id (32) | height (4) | work (32, big-endian)
+//
+// records are ordered by height, the number of records is
+// inferred from the file length so that a partially written
+// record (e.g. after a crash) is simply discarded on load
+//
+static const uint32_t           WSFileBlockStoreMagic               = 0x53425357;   // "WSBS"
+static const uint32_t           WSFileBlockStoreVersion             = 1;
+static const NSUInteger         WSFileBlockStoreHeaderLength        = 16;
+static const NSUInteger         WSFileBlockStoreTailOffset          = 12;
+
+static const NSUInteger         WSFileBlockStoreRawHeaderLength     = 80;
+static const NSUInteger         WSFileBlockStoreIdOffset            = 80;
+static const NSUInteger         WSFileBlockStoreHeightOffset        = 112;
+static const NSUInteger         WSFileBlockStoreWorkOffset          = 116;
+static const NSUInteger         WSFileBlockStoreWorkLength          = 32;
+static const NSUInteger         WSFileBlockStoreRecordLength        = 148;
+
+static const size_t             WSFileBlockStoreMapGranularity      = (1 << 20);
+static const uint32_t           WSFileBlockStoreCompactionThreshold = 4096;
+
+//
+// index = magic | capacity | used slots | records | slot #0 | slot #1 | ...
+//
+// slot = record index + 1 (0 if empty), open addressing with
+// linear probing on the first 8 bytes of the block id
+//
+// records is the number of data records when the index was
+// last closed and UINT32_MAX while open, the index is rebuilt
+// from data on load if they don't match
+//
+static const uint32_t           WSFileBlockStoreIndexMagic          = 0x49425357;   // "WSBI"
+static const NSUInteger         WSFileBlockStoreIndexHeaderLength   = 16;
+static const uint32_t           WSFileBlockStoreIndexMinCapacity    = 4096;
+static const uint32_t           WSFileBlockStoreIndexDirty          = UINT32_MAX;
+
+static const uint32_t           WSFileBlockStoreNotFound            = UINT32_MAX;
+
+static inline uint32_t WSFileBlockStoreReadUint32(const uint8_t *bytes)
+{
+    uint32_t n;
+    memcpy(&n, bytes, sizeof(n));
+    return CFSwapInt32LittleToHost(n);
+}
+
+static inline void WSFileBlockStoreWriteUint32(uint8_t *bytes, uint32_t n)
+{
+    n = CFSwapInt32HostToLittle(n);
+    memcpy(bytes, &n, sizeof(n));
+}
+
+static inline uint64_t WSFileBlockStoreKey(const void *blockIdBytes)
+{
+    uint64_t key;
+    memcpy(&key, blockIdBytes, sizeof(key));
+    return key;
+}
+
+static inline void WSFileBlockStoreSetPOSIXError(NSError **error)
+{
+    if (error) {
+        *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+    }
+}
+
+@interface WSFileBlockStore ()
+
+@property (nonatomic, strong) WSFilteredBlock *genesisBlock;
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, copy) NSString *indexPath;
+@property (nonatomic, strong) WSStorableBlock *head;
+@property (nonatomic, strong) NSMutableDictionary *forkBlocks;          // WSHash256 -> WSStorableBlock
+@property (nonatomic, strong) NSMutableDictionary *transactionsById;    // WSHash256 -> NSOrderedSet
+
+@property (nonatomic, assign) int fd;
+@property (nonatomic, assign) uint8_t *map;
+@property (nonatomic, assign) size_t mapLength;
+@property (nonatomic, assign) uint32_t count;                           // includes trimmed records
+@property (nonatomic, assign) uint32_t tailIndex;
+@property (nonatomic, assign) uint32_t baseHeight;                      // height of record #0
+
+@property (nonatomic, assign) int indexFd;
+@property (nonatomic, assign) uint8_t *indexMap;
+@property (nonatomic, assign) size_t indexMapLength;
+@property (nonatomic, assign) uint32_t indexCapacity;
+@property (nonatomic, assign) uint32_t indexUsed;
+
+- (BOOL)openWithError:(NSError **)error;
+- (BOOL)openIndexWithError:(NSError **)error;
+- (void)close;
+
+- (const uint8_t *)unsafeRecordAtIndex:(uint32_t)index;
+- (WSStorableBlock *)unsafeBlockAtIndex:(uint32_t)index;
+- (void)unsafeGetRecord:(uint8_t *)record fromBlock:(WSStorableBlock *)block;
+- (BOOL)unsafeAppendBlock:(WSStorableBlock *)block;
+- (BOOL)unsafeReplaceBlock:(WSStorableBlock *)block atIndex:(uint32_t)index;
+- (void)unsafeTruncateToCount:(uint32_t)count keepingForks:(BOOL)keepingForks;
+- (BOOL)unsafeWriteTailIndex;
+- (BOOL)unsafeMapLength:(size_t)length;
+- (BOOL)unsafeCompact;
+
+- (uint32_t)unsafeIndexOfBlockId:(WSHash256 *)blockId;
+- (void)unsafeIndexInsertRecordAtIndex:(uint32_t)index;
+- (BOOL)unsafeRebuildIndex;
+
+@end
+
+@implementation WSFileBlockStore
+
+- (instancetype)init
+{
+    WSExceptionRaiseUnsupported(@"Use initWithParameters:path:error:");
+    return nil;
+}
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters path:(NSString *)path error:(NSError *__autoreleasing *)error
+{
+    WSExceptionCheckIllegal(parameters != nil, @"Nil parameters");
+    WSExceptionCheckIllegal(path != nil, @"Nil path");
+
+    if ((self = [super init])) {
+        self.genesisBlock = [parameters genesisBlock];
+        self.path = path;
+        self.indexPath = [path stringByAppendingPathExtension:@"index"];
+        self.forkBlocks = [[NSMutableDictionary alloc] init];
+        self.transactionsById = [[NSMutableDictionary alloc] init];
+        self.fd = -1;
+        self.indexFd = -1;
+
+        if (![self openWithError:error]) {
+            [self close];
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    [self close];
+}
+
+#pragma mark WSBlockStore
+
+- (id<WSParameters>)parameters
+{
+    return self.genesisBlock.parameters;
+}
+
+- (WSStorableBlock *)blockForId:(WSHash256 *)blockId
+{
+    WSExceptionCheckIllegal(blockId != nil, @"Nil blockId");
+
+    if ([blockId isEqual:self.head.blockId]) {
+        return self.head;
+    }
+    const uint32_t index = [self unsafeIndexOfBlockId:blockId];
+    if (index != WSFileBlockStoreNotFound) {
+        return [self unsafeBlockAtIndex:index];
+    }
+    return self.forkBlocks[blockId];
+}
+
+- (void)putBlock:(WSStorableBlock *)block
+{
+    WSExceptionCheckIllegal(block != nil, @"Nil block");
+
+    WSHash256 *blockId = block.blockId;
+    if (block.transactions) {
+        self.transactionsById[blockId] = block.transactions;
+    }
+
+    // main chain blocks are replaced in place, anything else
+    // stays in memory until (if ever) it becomes the head
+    const uint32_t index = [self unsafeIndexOfBlockId:blockId];
+    if (index != WSFileBlockStoreNotFound) {
+        [self unsafeReplaceBlock:block atIndex:index];
+
+        // head is cached, keep it in sync with its record
+        if ([blockId isEqual:self.head.blockId]) {
+            _head = block;
+        }
+        return;
+    }
+    self.forkBlocks[blockId] = block;
+}
+
+- (void)removeTailBlock
+{
+    NSAssert(self.size > 0, @"Empty block store");
+
+    if (self.count - self.tailIndex <= 1) {
+        DDLogWarn(@"Not removing tail block, would remove head");
+        return;
+    }
+
+    const uint8_t *record = [self unsafeRecordAtIndex:self.tailIndex];
+    WSHash256 *tailId = WSHash256FromData([NSData dataWithBytes:(record + WSFileBlockStoreIdOffset) length:WSHash256Length]);
+    [self.transactionsById removeObjectForKey:tailId];
+
+    ++self.tailIndex;
+    [self unsafeWriteTailIndex];
+
+    // forks below tail can't ever connect again
+    const uint32_t tailHeight = self.baseHeight + self.tailIndex;
+    for (WSStorableBlock *block in [[self.forkBlocks allValues] copy]) {
+        if ((block.height != WSBlockUnknownHeight) && (block.height < tailHeight)) {
+            [self.forkBlocks removeObjectForKey:block.blockId];
+            [self.transactionsById removeObjectForKey:block.blockId];
+        }
+    }
+
+    // reclaim space once trimmed records outnumber live ones
+    if ((self.tailIndex >= WSFileBlockStoreCompactionThreshold) && (self.tailIndex >= self.count - self.tailIndex)) {
+        [self unsafeCompact];
+    }
+}
+
+- (void)setHead:(WSStorableBlock *)head
+{
+    WSExceptionCheckIllegal(head != nil, @"Nil head");
+
+    // walk back through forks until main chain is found
+    NSMutableArray *newBlocks = [[NSMutableArray alloc] init];
+    WSStorableBlock *block = head;
+    uint32_t baseIndex = [self unsafeIndexOfBlockId:head.blockId];
+    while (block && (baseIndex == WSFileBlockStoreNotFound)) {
+        [newBlocks addObject:block];
+        baseIndex = [self unsafeIndexOfBlockId:block.previousBlockId];
+        block = self.forkBlocks[block.previousBlockId];
+    }
+
+    // disconnected from main chain (e.g. checkpoint), start over from head
+    if (baseIndex == WSFileBlockStoreNotFound) {
+        DDLogDebug(@"New head %@ not connected to stored chain, starting over at height %u", head.blockId, head.height);
+        [self unsafeTruncateToCount:0 keepingForks:NO];
+    }
+    // truncate on reorg (crash-safe, records count is inferred from file length)
+    else if (baseIndex + 1 < self.count) {
+        DDLogDebug(@"Truncating stored chain to height %u", self.baseHeight + baseIndex);
+        [self unsafeTruncateToCount:(baseIndex + 1) keepingForks:YES];
+    }
+
+    for (WSStorableBlock *newBlock in [newBlocks reverseObjectEnumerator]) {
+        if (![self unsafeAppendBlock:newBlock]) {
+            DDLogError(@"Unable to append block %@ to %@", newBlock.blockId, self.path);
+            break;
+        }
+    }
+
+    _head = head;
+}
+
+- (NSArray *)allBlocks
+{
+    NSMutableArray *blocks = [[NSMutableArray alloc] initWithCapacity:self.size];
+    for (uint32_t i = self.tailIndex; i < self.count; ++i) {
+        [blocks addObject:[self unsafeBlockAtIndex:i]];
+    }
+    [blocks addObjectsFromArray:[self.forkBlocks allValues]];
+    return blocks;
+}
+
+- (NSUInteger)size
+{
+    return (self.count - self.tailIndex) + self.forkBlocks.count;
+}
+
+- (void)truncate
+{
+    DDLogInfo(@"Truncating store at %@", self.path);
+
+    [self close];
+    unlink(self.path.fileSystemRepresentation);
+    unlink(self.indexPath.fileSystemRepresentation);
+
+    [self.forkBlocks removeAllObjects];
+    [self.transactionsById removeAllObjects];
+
+    NSError *error;
+    if (![self openWithError:&error]) {
+        DDLogError(@"Unable to recreate store at %@ (%@)", self.path, error);
+    }
+}
+
+- (WSStorableBlock *)blockAtHeight:(uint32_t)height
+{
+    if ((height < self.baseHeight + self.tailIndex) || (height >= self.baseHeight + self.count)) {
+        return nil;
+    }
+    return [self unsafeBlockAtIndex:(height - self.baseHeight)];
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"{path = %@, heights = [%u, %u], forks = %lu}",
+            self.path, self.baseHeight + self.tailIndex, self.baseHeight + self.count - 1, (unsigned long)self.forkBlocks.count];
+}
+
+#pragma mark Files
+
+- (BOOL)openWithError:(NSError *__autoreleasing *)error
+{
+    self.fd = open(self.path.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+    if (self.fd < 0) {
+        WSFileBlockStoreSetPOSIXError(error);
+        return NO;
+    }
+
+    struct stat st;
+    if (fstat(self.fd, &st) < 0) {
+        WSFileBlockStoreSetPOSIXError(error);
+        return NO;
+    }
+
+    uint8_t header[WSFileBlockStoreHeaderLength];
+    const uint32_t networkMagic = [self.parameters magicNumber];
+
+    if (st.st_size < (off_t)WSFileBlockStoreHeaderLength) {
+        WSFileBlockStoreWriteUint32(header, WSFileBlockStoreMagic);
+        WSFileBlockStoreWriteUint32(header + 4, WSFileBlockStoreVersion);
+        WSFileBlockStoreWriteUint32(header + 8, networkMagic);
+        WSFileBlockStoreWriteUint32(header + WSFileBlockStoreTailOffset, 0);
+
+        if ((ftruncate(self.fd, 0) < 0) || (pwrite(self.fd, header, sizeof(header), 0) != sizeof(header))) {
+            WSFileBlockStoreSetPOSIXError(error);
+            return NO;
+        }
+        st.st_size = sizeof(header);
+    }
+    else {
+        if (pread(self.fd, header, sizeof(header), 0) != sizeof(header)) {
+            WSFileBlockStoreSetPOSIXError(error);
+            return NO;
+        }
+        if ((WSFileBlockStoreReadUint32(header) != WSFileBlockStoreMagic) ||
+            (WSFileBlockStoreReadUint32(header + 4) != WSFileBlockStoreVersion)) {
+
+            WSErrorSet(error, WSErrorCodeMalformed, @"Unrecognized block store file: %@", self.path);
+            return NO;
+        }
+        if (WSFileBlockStoreReadUint32(header + 8) != networkMagic) {
+            WSErrorSet(error, WSErrorCodeMalformed, @"Block store file belongs to another network: %@", self.path);
+            return NO;
+        }
+    }
+
+    // discard partially written record, if any
+    const off_t recordsLength = st.st_size - WSFileBlockStoreHeaderLength;
+    self.count = (uint32_t)(recordsLength / WSFileBlockStoreRecordLength);
+    if (recordsLength % WSFileBlockStoreRecordLength != 0) {
+        DDLogWarn(@"Discarding partial record at the end of %@", self.path);
+
+        if (ftruncate(self.fd, WSFileBlockStoreHeaderLength + self.count * WSFileBlockStoreRecordLength) < 0) {
+            WSFileBlockStoreSetPOSIXError(error);
+            return NO;
+        }
+    }
+    self.tailIndex = WSFileBlockStoreReadUint32(header + WSFileBlockStoreTailOffset);
+    if (self.tailIndex >= MAX(self.count, 1)) {
+        self.tailIndex = MAX(self.count, 1) - 1;
+        [self unsafeWriteTailIndex];
+    }
+
+    if (![self unsafeMapLength:(WSFileBlockStoreHeaderLength + self.count * WSFileBlockStoreRecordLength)]) {
+        WSFileBlockStoreSetPOSIXError(error);
+        return NO;
+    }
+    if (![self openIndexWithError:error]) {
+        return NO;
+    }
+
+    if (self.count == 0) {
+        WSStorableBlock *genesis = [[WSStorableBlock alloc] initWithHeader:self.genesisBlock.header transactions:nil height:0];
+        if (![self unsafeAppendBlock:genesis]) {
+            WSFileBlockStoreSetPOSIXError(error);
+            return NO;
+        }
+    }
+    else {
+        self.baseHeight = WSFileBlockStoreReadUint32([self unsafeRecordAtIndex:0] + WSFileBlockStoreHeightOffset);
+    }
+    self.head = [self unsafeBlockAtIndex:(self.count - 1)];
+
+    DDLogDebug(@"Loaded %u blocks from %@ (head: %u)", self.count - self.tailIndex, self.path, self.head.height);
+
+    return YES;
+}
+
+- (BOOL)openIndexWithError:(NSError *__autoreleasing *)error
+{
+    self.indexFd = open(self.indexPath.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+    if (self.indexFd < 0) {
+        WSFileBlockStoreSetPOSIXError(error);
+        return NO;
+    }
+
+    struct stat st;
+    if (fstat(self.indexFd, &st) < 0) {
+        WSFileBlockStoreSetPOSIXError(error);
+        return NO;
+    }
+
+    BOOL isValid = NO;
+    if (st.st_size >= (off_t)WSFileBlockStoreIndexHeaderLength) {
+        uint8_t header[WSFileBlockStoreIndexHeaderLength];
+        if (pread(self.indexFd, header, sizeof(header), 0) == sizeof(header)) {
+            const uint32_t capacity = WSFileBlockStoreReadUint32(header + 4);
+
+            isValid = ((WSFileBlockStoreReadUint32(header) == WSFileBlockStoreIndexMagic) &&
+                       (capacity >= WSFileBlockStoreIndexMinCapacity) &&
+                       ((capacity & (capacity - 1)) == 0) &&
+                       (st.st_size == (off_t)(WSFileBlockStoreIndexHeaderLength + capacity * sizeof(uint32_t))) &&
+                       (WSFileBlockStoreReadUint32(header + 12) == self.count));
+
+            if (isValid) {
+                self.indexCapacity = capacity;
+                self.indexUsed = WSFileBlockStoreReadUint32(header + 8);
+                self.indexMapLength = (size_t)st.st_size;
+                self.indexMap = mmap(NULL, self.indexMapLength, PROT_READ | PROT_WRITE, MAP_SHARED, self.indexFd, 0);
+                if (self.indexMap == MAP_FAILED) {
+                    self.indexMap = NULL;
+                    WSFileBlockStoreSetPOSIXError(error);
+                    return NO;
+                }
+            }
+        }
+    }
+    if (!isValid) {
+        DDLogDebug(@"Rebuilding block index at %@", self.indexPath);
+
+        if (![self unsafeRebuildIndex]) {
+            WSFileBlockStoreSetPOSIXError(error);
+            return NO;
+        }
+    }
+
+    // mark dirty until closed
+    WSFileBlockStoreWriteUint32(self.indexMap + 12, WSFileBlockStoreIndexDirty);
+    return YES;
+}
+
+- (void)close
+{
+    if (self.indexMap) {
+        WSFileBlockStoreWriteUint32(self.indexMap + 8, self.indexUsed);
+        WSFileBlockStoreWriteUint32(self.indexMap + 12, self.count);
+        munmap(self.indexMap, self.indexMapLength);
+        self.indexMap = NULL;
+        self.indexMapLength = 0;
+    }
+    if (self.indexFd >= 0) {
+        close(self.indexFd);
+        self.indexFd = -1;
+    }
+    if (self.map) {
+        munmap(self.map, self.mapLength);
+        self.map = NULL;
+        self.mapLength = 0;
+    }
+    if (self.fd >= 0) {
+        close(self.fd);
+        self.fd = -1;
+    }
+}
+
+#pragma mark Records
+
+- (const uint8_t *)unsafeRecordAtIndex:(uint32_t)index
+{
+    NSAssert(index < self.count, @"Record index out of bounds (%u >= %u)", index, self.count);
+
+    return self.map + WSFileBlockStoreHeaderLength + index * WSFileBlockStoreRecordLength;
+}
+
+- (WSStorableBlock *)unsafeBlockAtIndex:(uint32_t)index
+{
+    const uint8_t *record = [self unsafeRecordAtIndex:index];
+
+    WSHash256 *blockId = WSHash256FromData([NSData dataWithBytes:(record + WSFileBlockStoreIdOffset) length:WSHash256Length]);
+    WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.parameters bytes:record blockId:blockId];
+
+    const uint32_t height = WSFileBlockStoreReadUint32(record + WSFileBlockStoreHeightOffset);
+    NSData *work = [NSData dataWithBytes:(record + WSFileBlockStoreWorkOffset) length:WSFileBlockStoreWorkLength];
+
+    return [[WSStorableBlock alloc] initWithHeader:header transactions:self.transactionsById[blockId] height:height work:work];
+}
+
+- (void)unsafeGetRecord:(uint8_t *)record fromBlock:(WSStorableBlock *)block
+{
+    memcpy(record, block.header.bytes, WSFileBlockStoreRawHeaderLength);
+    memcpy(record + WSFileBlockStoreIdOffset, block.blockId.bytes, WSHash256Length);
+    WSFileBlockStoreWriteUint32(record + WSFileBlockStoreHeightOffset, block.height);
+
+    // big-endian, left-padded
+    NSData *work = block.workData;
+    NSAssert(work.length <= WSFileBlockStoreWorkLength, @"Work exceeds %lu bytes", (unsigned long)WSFileBlockStoreWorkLength);
+    memset(record + WSFileBlockStoreWorkOffset, 0, WSFileBlockStoreWorkLength);
+    memcpy(record + WSFileBlockStoreWorkOffset + WSFileBlockStoreWorkLength - work.length, work.bytes, work.length);
+}
+
+- (BOOL)unsafeAppendBlock:(WSStorableBlock *)block
+{
+    if (self.count == 0) {
+        self.baseHeight = block.height;
+        self.tailIndex = 0;
+        [self unsafeWriteTailIndex];
+    }
+    NSAssert(block.height == self.baseHeight + self.count, @"Non-contiguous height (%u != %u)", block.height, self.baseHeight + self.count);
+
+    uint8_t record[WSFileBlockStoreRecordLength];
+    [self unsafeGetRecord:record fromBlock:block];
+
+    const off_t offset = WSFileBlockStoreHeaderLength + self.count * WSFileBlockStoreRecordLength;
+    if (pwrite(self.fd, record, sizeof(record), offset) != sizeof(record)) {
+        return NO;
+    }
+    ++self.count;
+
+    if (![self unsafeMapLength:(offset + sizeof(record))]) {
+        return NO;
+    }
+    [self unsafeIndexInsertRecordAtIndex:(self.count - 1)];
+    [self.forkBlocks removeObjectForKey:block.blockId];
+
+    return YES;
+}
+
+- (BOOL)unsafeReplaceBlock:(WSStorableBlock *)block atIndex:(uint32_t)index
+{
+    NSAssert(block.height == self.baseHeight + index, @"Replacing block at wrong height (%u != %u)", block.height, self.baseHeight + index);
+
+    uint8_t record[WSFileBlockStoreRecordLength];
+    [self unsafeGetRecord:record fromBlock:block];
+
+    const off_t offset = WSFileBlockStoreHeaderLength + index * WSFileBlockStoreRecordLength;
+    if (pwrite(self.fd, record, sizeof(record), offset) != sizeof(record)) {
+        DDLogError(@"Unable to replace block %@ in %@ (errno: %d)", block.blockId, self.path, errno);
+        return NO;
+    }
+    return YES;
+}
+
+- (void)unsafeTruncateToCount:(uint32_t)count keepingForks:(BOOL)keepingForks
+{
+    NSParameterAssert(count <= self.count);
+
+    // truncated blocks are still reachable as forks on reorg, a
+    // disconnected head drops them along with their transactions
+    for (uint32_t i = MAX(count, self.tailIndex); i < self.count; ++i) {
+        WSStorableBlock *block = [self unsafeBlockAtIndex:i];
+        if (keepingForks) {
+            self.forkBlocks[block.blockId] = block;
+        }
+        else {
+            [self.transactionsById removeObjectForKey:block.blockId];
+        }
+    }
+
+    if (ftruncate(self.fd, WSFileBlockStoreHeaderLength + count * WSFileBlockStoreRecordLength) < 0) {
+        DDLogError(@"Unable to truncate %@ to %u records (errno: %d)", self.path, count, errno);
+        return;
+    }
+    self.count = count;
+    if (self.tailIndex > self.count) {
+        self.tailIndex = self.count;
+        [self unsafeWriteTailIndex];
+    }
+}
+
+- (BOOL)unsafeWriteTailIndex
+{
+    uint8_t bytes[sizeof(uint32_t)];
+    WSFileBlockStoreWriteUint32(bytes, self.tailIndex);
+    if (pwrite(self.fd, bytes, sizeof(bytes), WSFileBlockStoreTailOffset) != sizeof(bytes)) {
+        DDLogError(@"Unable to update tail of %@ (errno: %d)", self.path, errno);
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL)unsafeMapLength:(size_t)length
+{
+    if (self.map && (length <= self.mapLength)) {
+        return YES;
+    }
+
+    // reserve some room past the end of file to amortize remapping
+    const size_t mapLength = (length / WSFileBlockStoreMapGranularity + 1) * WSFileBlockStoreMapGranularity;
+    uint8_t *map = mmap(NULL, mapLength, PROT_READ, MAP_SHARED, self.fd, 0);
+    if (map == MAP_FAILED) {
+        DDLogError(@"Unable to map %lu bytes of %@ (errno: %d)", (unsigned long)mapLength, self.path, errno);
+        return NO;
+    }
+    if (self.map) {
+        munmap(self.map, self.mapLength);
+    }
+    self.map = map;
+    self.mapLength = mapLength;
+    return YES;
+}
+
+- (BOOL)unsafeCompact
+{
+    const uint32_t liveCount = self.count - self.tailIndex;
+    NSString *tmpPath = [self.path stringByAppendingPathExtension:@"tmp"];
+
+    DDLogDebug(@"Compacting %@ (%u trimmed records, %u live)", self.path, self.tailIndex, liveCount);
+
+    const int tmpFd = open(tmpPath.fileSystemRepresentation, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (tmpFd < 0) {
+        DDLogError(@"Unable to create %@ (errno: %d)", tmpPath, errno);
+        return NO;
+    }
+
+    uint8_t header[WSFileBlockStoreHeaderLength];
+    memcpy(header, self.map, sizeof(header));
+    WSFileBlockStoreWriteUint32(header + WSFileBlockStoreTailOffset, 0);
+
+    const size_t liveLength = liveCount * WSFileBlockStoreRecordLength;
+    const BOOL written = ((pwrite(tmpFd, header, sizeof(header), 0) == (ssize_t)sizeof(header)) &&
+                          (pwrite(tmpFd, [self unsafeRecordAtIndex:self.tailIndex], liveLength, sizeof(header)) == (ssize_t)liveLength) &&
+                          (fsync(tmpFd) == 0));
+
+    // atomic replacement, the old file stays valid until here
+    if (!written || (rename(tmpPath.fileSystemRepresentation, self.path.fileSystemRepresentation) < 0)) {
+        DDLogError(@"Unable to compact %@ (errno: %d)", self.path, errno);
+        close(tmpFd);
+        unlink(tmpPath.fileSystemRepresentation);
+        return NO;
+    }
+
+    munmap(self.map, self.mapLength);
+    self.map = NULL;
+    self.mapLength = 0;
+    close(self.fd);
+
+    self.fd = tmpFd;
+    self.baseHeight += self.tailIndex;
+    self.tailIndex = 0;
+    self.count = liveCount;
+
+    return ([self unsafeMapLength:(sizeof(header) + liveLength)] && [self unsafeRebuildIndex]);
+}
+
+#pragma mark Index
+
+- (uint32_t)unsafeIndexOfBlockId:(WSHash256 *)blockId
+{
+    const uint32_t *slots = (const uint32_t *)(self.indexMap + WSFileBlockStoreIndexHeaderLength);
+    const uint32_t mask = self.indexCapacity - 1;
+    const void *blockIdBytes = blockId.bytes;
+
+    uint32_t slot = (uint32_t)(WSFileBlockStoreKey(blockIdBytes) & mask);
+    for (uint32_t i = 0; i < self.indexCapacity; ++i) {
+        const uint32_t value = slots[slot];
+        if (value == 0) {
+            break;
+        }
+
+        // stale slots (trimmed or truncated records) just fail the comparison
+        const uint32_t index = value - 1;
+        if ((index >= self.tailIndex) && (index < self.count) &&
+            (memcmp([self unsafeRecordAtIndex:index] + WSFileBlockStoreIdOffset, blockIdBytes, WSHash256Length) == 0)) {
+
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return WSFileBlockStoreNotFound;
+}
+
+- (void)unsafeIndexInsertRecordAtIndex:(uint32_t)index
+{
+    if (2 * (self.indexUsed + 1) > self.indexCapacity) {
+        if (![self unsafeRebuildIndex]) {
+            DDLogError(@"Unable to rebuild block index at %@ (errno: %d)", self.indexPath, errno);
+        }
+        return;
+    }
+
+    uint32_t *slots = (uint32_t *)(self.indexMap + WSFileBlockStoreIndexHeaderLength);
+    const uint32_t mask = self.indexCapacity - 1;
+
+    uint32_t slot = (uint32_t)(WSFileBlockStoreKey([self unsafeRecordAtIndex:index] + WSFileBlockStoreIdOffset) & mask);
+    while (YES) {
+        const uint32_t value = slots[slot];
+        if (value == 0) {
+            ++self.indexUsed;
+            break;
+        }
+
+        // reuse slots of trimmed or truncated records, probing chains are preserved
+        const uint32_t oldIndex = value - 1;
+        if ((oldIndex < self.tailIndex) || (oldIndex >= index)) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = index + 1;
+}
+
+- (BOOL)unsafeRebuildIndex
+{
+    const uint32_t liveCount = self.count - self.tailIndex;
+    uint32_t capacity = WSFileBlockStoreIndexMinCapacity;
+    while (capacity < 4 * liveCount) {
+        capacity <<= 1;
+    }
+
+    if (self.indexMap) {
+        munmap(self.indexMap, self.indexMapLength);
+        self.indexMap = NULL;
+        self.indexMapLength = 0;
+    }
+
+    const size_t indexLength = WSFileBlockStoreIndexHeaderLength + capacity * sizeof(uint32_t);
+    if ((ftruncate(self.indexFd, 0) < 0) || (ftruncate(self.indexFd, indexLength) < 0)) {
+        return NO;
+    }
+    uint8_t *indexMap = mmap(NULL, indexLength, PROT_READ | PROT_WRITE, MAP_SHARED, self.indexFd, 0);
+    if (indexMap == MAP_FAILED) {
+        return NO;
+    }
+    self.indexMap = indexMap;
+    self.indexMapLength = indexLength;
+    self.indexCapacity = capacity;
+    self.indexUsed = 0;
+
+    WSFileBlockStoreWriteUint32(self.indexMap, WSFileBlockStoreIndexMagic);
+    WSFileBlockStoreWriteUint32(self.indexMap + 4, capacity);
+    WSFileBlockStoreWriteUint32(self.indexMap + 12, WSFileBlockStoreIndexDirty);
+
+    for (uint32_t i = self.tailIndex; i < self.count; ++i) {
+        [self unsafeIndexInsertRecordAtIndex:i];
+    }
+    return YES;
+}
+
+@end
@@ -34,5 +34,6 @@
 @interface WSMemoryBlockStore : NSObject <WSBlockStore>
 
 - (instancetype)initWithParameters:(id<WSParameters>)parameters;
+- (instancetype)initWithParameters:(id<WSParameters>)parameters capacity:(NSUInteger)capacity;
 
 @end
@@ -37,13 +37,31 @@
 #import "WSMacros.h"
 #import "WSErrors.h"
 
+//
+// main chain is a ring buffer indexed by height (tail first),
+// forks are the only blocks kept apart until they either become
+// the main chain or get trimmed along with the tail
+//
+// blocks by id are still needed for blockForId:, but walking the
+// main chain (previous blocks, locators, tail eviction) only takes
+// height arithmetic
+//
 @interface WSMemoryBlockStore ()
 
 @property (nonatomic, strong) WSFilteredBlock *genesisBlock;
-@property (nonatomic, strong) NSMutableDictionary *blocks;          // WSHash256 -> WSStorableBlock
-@property (nonatomic, strong) NSMutableDictionary *nextIdsById;     // WSHash256 -> WSHash256
-@property (nonatomic, weak) WSStorableBlock *head;
-@property (nonatomic, weak) WSStorableBlock *tail;
+@property (nonatomic, strong) NSMutableArray *ring;                 // WSStorableBlock (or NSNull)
+@property (nonatomic, assign) NSUInteger ringStart;                 // slot of tail
+@property (nonatomic, assign) NSUInteger ringCount;
+@property (nonatomic, assign) uint32_t tailHeight;
+@property (nonatomic, strong) NSMutableDictionary *mainBlocksById;  // WSHash256 -> WSStorableBlock
+@property (nonatomic, strong) NSMutableDictionary *forkBlocks;      // WSHash256 -> WSStorableBlock
+@property (nonatomic, assign) NSUInteger capacity;
+
+- (NSUInteger)slotForHeight:(uint32_t)height;
+- (WSStorableBlock *)previousBlockOfBlock:(WSStorableBlock *)block;
+- (void)appendMainBlock:(WSStorableBlock *)block;
+- (void)truncateMainChainToCount:(NSUInteger)count keepingForks:(BOOL)keepingForks;
+- (void)resizeRingToCount:(NSUInteger)count;
 
 @end
 
@@ -56,11 +74,18 @@
 }
 
 - (instancetype)initWithParameters:(id<WSParameters>)parameters
+{
+    return [self initWithParameters:parameters capacity:WSMemoryBlockStoreDefaultCapacity];
+}
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters capacity:(NSUInteger)capacity
 {
     WSExceptionCheckIllegal(parameters != nil, @"Nil parameters");
+    WSExceptionCheckIllegal(capacity > 0, @"Non-positive capacity");
 
     if ((self = [super init])) {
         self.genesisBlock = [parameters genesisBlock];
+        self.capacity = capacity;
         [self truncate];
     }
     return self;
@@ -77,7 +102,15 @@
 {
     WSExceptionCheckIllegal(blockId != nil, @"Nil blockId");
     
-    return self.blocks[blockId];
+    return (self.mainBlocksById[blockId] ? : self.forkBlocks[blockId]);
+}
+
+- (WSStorableBlock *)blockAtHeight:(uint32_t)height
+{
+    if ((height < self.tailHeight) || (height - self.tailHeight >= self.ringCount)) {
+        return nil;
+    }
+    return self.ring[[self slotForHeight:height]];
 }
 
 - (void)putBlock:(WSStorableBlock *)block
@@ -85,57 +118,191 @@
     WSExceptionCheckIllegal(block != nil, @"Nil block");
 
     WSHash256 *blockId = block.blockId;
-    self.blocks[blockId] = block;
-    self.nextIdsById[block.previousBlockId] = blockId;
+
+    // replace in place if on main chain
+    if (self.mainBlocksById[blockId]) {
+        NSAssert([[self blockAtHeight:block.height] isEqual:block], @"Replacing main chain block at wrong height (%u)", block.height);
+
+        self.ring[[self slotForHeight:block.height]] = block;
+        self.mainBlocksById[blockId] = block;
+        return;
+    }
+    self.forkBlocks[blockId] = block;
 }
 
 - (void)removeTailBlock
 {
-    NSAssert(self.blocks.count > 0, @"Empty block store");
-    
-    WSHash256 *tailId = self.tail.blockId;
-    NSAssert(tailId, @"Tail is nil, store truncated without resetting?");
-
-    WSHash256 *newTailId = self.nextIdsById[tailId];
-    if (!newTailId) {
-        WSStorableBlock *block = self.head;
-        while (block) {
-            newTailId = block.blockId;
-            block = self.blocks[block.previousBlockId];
+    NSAssert(self.ringCount > 0, @"Empty block store");
+
+    if (self.ringCount == 1) {
+        DDLogWarn(@"Not removing tail block, would remove head");
+        return;
+    }
+
+    WSStorableBlock *tail = self.ring[self.ringStart];
+    self.ring[self.ringStart] = [NSNull null];
+    [self.mainBlocksById removeObjectForKey:tail.blockId];
+
+    self.ringStart = (self.ringStart + 1) % self.ring.count;
+    --self.ringCount;
+    ++self.tailHeight;
+
+    // forks below tail can't ever connect again
+    for (WSStorableBlock *block in [[self.forkBlocks allValues] copy]) {
+        if ((block.height != WSBlockUnknownHeight) && (block.height < self.tailHeight)) {
+            [self.forkBlocks removeObjectForKey:block.blockId];
         }
     }
+}
 
-    [self.blocks removeObjectForKey:tailId];
-    [self.nextIdsById removeObjectForKey:tailId];
-    self.tail = self.blocks[newTailId];
+- (WSStorableBlock *)head
+{
+    if (self.ringCount == 0) {
+        return nil;
+    }
+    return self.ring[[self slotForHeight:(self.tailHeight + (uint32_t)self.ringCount - 1)]];
 }
 
 - (void)setHead:(WSStorableBlock *)head
 {
     WSExceptionCheckIllegal(head != nil, @"Nil head");
-    
-    _head = head;
+
+    // walk back through forks until main chain is found
+    NSMutableArray *newBlocks = [[NSMutableArray alloc] init];
+    WSStorableBlock *block = head;
+    while (block && ![[self blockAtHeight:block.height] isEqual:block]) {
+        [newBlocks addObject:block];
+        block = [self previousBlockOfBlock:block];
+    }
+
+    // disconnected from main chain (e.g. checkpoint), start over from head
+    if (!block) {
+        DDLogDebug(@"New head %@ not connected to main chain, starting over at height %u", head.blockId, head.height);
+        [self truncateMainChainToCount:0 keepingForks:NO];
+    }
+    // reorganize
+    else {
+        [self truncateMainChainToCount:(block.height - self.tailHeight + 1) keepingForks:YES];
+    }
+
+    for (WSStorableBlock *newBlock in [newBlocks reverseObjectEnumerator]) {
+        [self appendMainBlock:newBlock];
+    }
+}
+
+- (void)reserveCapacity:(NSUInteger)capacity
+{
+    WSExceptionCheckIllegal(capacity > 0, @"Non-positive capacity");
+
+    self.capacity = capacity;
+    [self resizeRingToCount:MAX(capacity, self.ringCount)];
 }
 
 - (NSArray *)allBlocks
 {
-    return [self.blocks allValues];
+    NSMutableArray *blocks = [[NSMutableArray alloc] initWithCapacity:self.size];
+    for (NSUInteger i = 0; i < self.ringCount; ++i) {
+        [blocks addObject:self.ring[(self.ringStart + i) % self.ring.count]];
+    }
+    [blocks addObjectsFromArray:[self.forkBlocks allValues]];
+    return blocks;
 }
 
 - (NSUInteger)size
 {
-    return self.blocks.count;
+    return self.ringCount + self.forkBlocks.count;
 }
 
 - (void)truncate
 {
-    self.blocks = [[NSMutableDictionary alloc] init];
-    self.nextIdsById = [[NSMutableDictionary alloc] init];
+    self.ring = [[NSMutableArray alloc] initWithCapacity:self.capacity];
+    for (NSUInteger i = 0; i < self.capacity; ++i) {
+        [self.ring addObject:[NSNull null]];
+    }
+    self.ringStart = 0;
+    self.ringCount = 0;
+    self.tailHeight = 0;
+    self.mainBlocksById = [[NSMutableDictionary alloc] initWithCapacity:self.capacity];
+    self.forkBlocks = [[NSMutableDictionary alloc] init];
     
     WSStorableBlock *block = [[WSStorableBlock alloc] initWithHeader:self.genesisBlock.header transactions:nil height:0];
-    [self putBlock:block];
-    self.head = block;
-    self.tail = self.head;
+    [self appendMainBlock:block];
+}
+
+#pragma mark Ring
+
+- (NSUInteger)slotForHeight:(uint32_t)height
+{
+    return (self.ringStart + (height - self.tailHeight)) % self.ring.count;
+}
+
+- (WSStorableBlock *)previousBlockOfBlock:(WSStorableBlock *)block
+{
+    if ((block.height != WSBlockUnknownHeight) && (block.height > 0)) {
+        WSStorableBlock *mainBlock = [self blockAtHeight:(block.height - 1)];
+        if ([mainBlock.blockId isEqual:block.previousBlockId]) {
+            return mainBlock;
+        }
+    }
+    return self.forkBlocks[block.previousBlockId];
+}
+
+- (void)appendMainBlock:(WSStorableBlock *)block
+{
+    if (self.ringCount == 0) {
+        self.ringStart = 0;
+        self.tailHeight = block.height;
+    }
+    NSAssert(block.height == self.tailHeight + self.ringCount, @"Non-contiguous height (%u != %u)", block.height, self.tailHeight + self.ringCount);
+
+    // grow if full, trimming is up to the chain
+    if (self.ringCount == self.ring.count) {
+        [self resizeRingToCount:(2 * self.ring.count)];
+    }
+
+    self.ring[(self.ringStart + self.ringCount) % self.ring.count] = block;
+    ++self.ringCount;
+
+    WSHash256 *blockId = block.blockId;
+    self.mainBlocksById[blockId] = block;
+    [self.forkBlocks removeObjectForKey:blockId];
 }
 
+- (void)truncateMainChainToCount:(NSUInteger)count keepingForks:(BOOL)keepingForks
+{
+    // truncated blocks are still reachable as forks on reorg, a
+    // disconnected head drops them (they could never connect again)
+    while (self.ringCount > count) {
+        const NSUInteger slot = (self.ringStart + self.ringCount - 1) % self.ring.count;
+        WSStorableBlock *block = self.ring[slot];
+        self.ring[slot] = [NSNull null];
+        --self.ringCount;
+
+        WSHash256 *blockId = block.blockId;
+        [self.mainBlocksById removeObjectForKey:blockId];
+        if (keepingForks) {
+            self.forkBlocks[blockId] = block;
+        }
+    }
+}
+
+
+// blocks are moved in order, tail first
+- (void)resizeRingToCount:(NSUInteger)count
+{
+    NSParameterAssert(count >= self.ringCount);
+
+    if (count == self.ring.count) {
+        return;
+    }
+    NSMutableArray *ring = [[NSMutableArray alloc] initWithCapacity:count];
+    for (NSUInteger i = 0; i < self.ringCount; ++i) {
+        [ring addObject:self.ring[(self.ringStart + i) % self.ring.count]];
+    }
+    while (ring.count < count) {
+        [ring addObject:[NSNull null]];
+    }
+    self.ring = ring;
+    self.ringStart = 0;
+}
 @end
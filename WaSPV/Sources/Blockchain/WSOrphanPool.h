@@ -0,0 +1,54 @@
+//
+//  WSOrphanPool.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+@class WSHash256;
+@class WSStorableBlock;
+
+//
+// orphans indexed by previousBlockId, oldest evicted first when full
+//
+// thread-safe: no
+//
+@interface WSOrphanPool : NSObject
+
+@property (nonatomic, assign) NSUInteger capacity;                  // 1000
+@property (nonatomic, assign, readonly) NSUInteger addedCount;
+@property (nonatomic, assign, readonly) NSUInteger connectedCount;
+@property (nonatomic, assign, readonly) NSUInteger evictedCount;
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity;
+
+- (NSUInteger)count;
+- (BOOL)containsBlockId:(WSHash256 *)blockId;
+- (BOOL)hasChildrenOfBlockId:(WSHash256 *)blockId;
+- (void)addBlock:(WSStorableBlock *)block;
+- (NSArray *)removeChildrenOfBlockId:(WSHash256 *)blockId; // WSStorableBlock, counted as connected
+- (void)removeAllBlocks;
+
+@end
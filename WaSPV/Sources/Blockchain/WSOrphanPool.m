@@ -0,0 +1,246 @@
+//
+//  WSOrphanPool.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSOrphanPool.h"
+#import "WSHash256.h"
+#import "WSStorableBlock.h"
+#import "WSConfig.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+//
+// entries are linked by age for O(1) refresh and removal,
+// owned by the entries dictionary
+//
+@interface WSOrphanPoolEntry : NSObject
+
+@property (nonatomic, strong) WSStorableBlock *block;
+@property (nonatomic, weak) WSOrphanPoolEntry *older;
+@property (nonatomic, weak) WSOrphanPoolEntry *newer;
+
+@end
+
+@implementation WSOrphanPoolEntry
+
+@end
+
+#pragma mark -
+
+@interface WSOrphanPool ()
+
+@property (nonatomic, strong) NSMutableDictionary *entries;             // WSHash256 -> WSOrphanPoolEntry
+@property (nonatomic, strong) NSMutableDictionary *childrenByParentId;  // WSHash256 -> NSMutableArray (WSStorableBlock)
+@property (nonatomic, weak) WSOrphanPoolEntry *oldestEntry;
+@property (nonatomic, weak) WSOrphanPoolEntry *newestEntry;
+@property (nonatomic, assign) NSUInteger addedCount;
+@property (nonatomic, assign) NSUInteger connectedCount;
+@property (nonatomic, assign) NSUInteger evictedCount;
+
+- (void)removeBlock:(WSStorableBlock *)block;
+- (void)evictToCapacity;
+- (void)linkNewestEntry:(WSOrphanPoolEntry *)entry;
+- (void)unlinkEntry:(WSOrphanPoolEntry *)entry;
+
+@end
+
+@implementation WSOrphanPool
+
+- (instancetype)init
+{
+    return [self initWithCapacity:WSOrphanPoolDefaultCapacity];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    WSExceptionCheckIllegal(capacity > 0, @"Non-positive capacity");
+
+    if ((self = [super init])) {
+        self.entries = [[NSMutableDictionary alloc] init];
+        self.childrenByParentId = [[NSMutableDictionary alloc] init];
+        self.capacity = capacity;
+    }
+    return self;
+}
+
+- (void)setCapacity:(NSUInteger)capacity
+{
+    WSExceptionCheckIllegal(capacity > 0, @"Non-positive capacity");
+
+    _capacity = capacity;
+    [self evictToCapacity];
+}
+
+- (NSUInteger)count
+{
+    return self.entries.count;
+}
+
+- (BOOL)containsBlockId:(WSHash256 *)blockId
+{
+    WSExceptionCheckIllegal(blockId != nil, @"Nil blockId");
+
+    return (self.entries[blockId] != nil);
+}
+
+- (BOOL)hasChildrenOfBlockId:(WSHash256 *)blockId
+{
+    WSExceptionCheckIllegal(blockId != nil, @"Nil blockId");
+
+    return (self.childrenByParentId[blockId] != nil);
+}
+
+- (void)addBlock:(WSStorableBlock *)block
+{
+    WSExceptionCheckIllegal(block != nil, @"Nil block");
+
+    WSHash256 *blockId = block.blockId;
+    WSOrphanPoolEntry *existingEntry = self.entries[blockId];
+
+    // refresh age, replace with more detailed block if any
+    if (existingEntry) {
+        [self unlinkEntry:existingEntry];
+        [self linkNewestEntry:existingEntry];
+
+        WSStorableBlock *existingBlock = existingEntry.block;
+        if (block.transactions.count > existingBlock.transactions.count) {
+            NSMutableArray *siblings = self.childrenByParentId[block.previousBlockId];
+            [siblings replaceObjectAtIndex:[siblings indexOfObjectIdenticalTo:existingBlock] withObject:block];
+            existingEntry.block = block;
+        }
+        return;
+    }
+
+    WSOrphanPoolEntry *entry = [[WSOrphanPoolEntry alloc] init];
+    entry.block = block;
+    self.entries[blockId] = entry;
+    [self linkNewestEntry:entry];
+
+    NSMutableArray *siblings = self.childrenByParentId[block.previousBlockId];
+    if (!siblings) {
+        siblings = [[NSMutableArray alloc] initWithCapacity:1];
+        self.childrenByParentId[block.previousBlockId] = siblings;
+    }
+    [siblings addObject:block];
+
+    ++self.addedCount;
+    [self evictToCapacity];
+}
+
+- (NSArray *)removeChildrenOfBlockId:(WSHash256 *)blockId
+{
+    WSExceptionCheckIllegal(blockId != nil, @"Nil blockId");
+
+    NSArray *children = self.childrenByParentId[blockId];
+    if (!children) {
+        return nil;
+    }
+    [self.childrenByParentId removeObjectForKey:blockId];
+
+    for (WSStorableBlock *child in children) {
+        [self unlinkEntry:self.entries[child.blockId]];
+        [self.entries removeObjectForKey:child.blockId];
+    }
+    self.connectedCount += children.count;
+
+    return children;
+}
+
+- (void)removeAllBlocks
+{
+    [self.entries removeAllObjects];
+    [self.childrenByParentId removeAllObjects];
+    self.oldestEntry = nil;
+    self.newestEntry = nil;
+}
+
+#pragma mark Helpers
+
+- (void)removeBlock:(WSStorableBlock *)block
+{
+    NSMutableArray *siblings = self.childrenByParentId[block.previousBlockId];
+    [siblings removeObjectIdenticalTo:block];
+    if (siblings.count == 0) {
+        [self.childrenByParentId removeObjectForKey:block.previousBlockId];
+    }
+    [self unlinkEntry:self.entries[block.blockId]];
+    [self.entries removeObjectForKey:block.blockId];
+}
+
+- (void)evictToCapacity
+{
+    while (self.entries.count > self.capacity) {
+        WSStorableBlock *oldestBlock = self.oldestEntry.block;
+
+        DDLogDebug(@"Evicting oldest orphan %@ (capacity: %lu)", oldestBlock.blockId, (unsigned long)self.capacity);
+        [self removeBlock:oldestBlock];
+        ++self.evictedCount;
+    }
+}
+
+- (void)linkNewestEntry:(WSOrphanPoolEntry *)entry
+{
+    entry.older = self.newestEntry;
+    entry.newer = nil;
+    if (self.newestEntry) {
+        self.newestEntry.newer = entry;
+    }
+    else {
+        self.oldestEntry = entry;
+    }
+    self.newestEntry = entry;
+}
+
+- (void)unlinkEntry:(WSOrphanPoolEntry *)entry
+{
+    WSOrphanPoolEntry *older = entry.older;
+    WSOrphanPoolEntry *newer = entry.newer;
+    if (older) {
+        older.newer = newer;
+    }
+    else {
+        self.oldestEntry = newer;
+    }
+    if (newer) {
+        newer.older = older;
+    }
+    else {
+        self.newestEntry = older;
+    }
+    entry.older = nil;
+    entry.newer = nil;
+}
+
+#pragma mark NSObject
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"{count = %lu/%lu, added = %lu, connected = %lu, evicted = %lu}",
+            (unsigned long)self.count, (unsigned long)self.capacity, (unsigned long)self.addedCount,
+            (unsigned long)self.connectedCount, (unsigned long)self.evictedCount];
+}
+
+@end
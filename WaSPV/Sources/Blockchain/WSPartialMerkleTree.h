@@ -35,6 +35,7 @@
 @interface WSPartialMerkleTree : NSObject <WSBufferEncoder, WSBufferDecoder, WSIndentableDescription>
 
 - (instancetype)initWithTxCount:(uint32_t)txCount hashes:(NSArray *)hashes flags:(NSData *)flags error:(NSError **)error;
+- (instancetype)initWithTxIds:(NSArray *)txIds matches:(NSIndexSet *)matches; // WSHash256, block order
 - (uint32_t)txCount;
 - (NSArray *)hashes;
 - (NSData *)flags;
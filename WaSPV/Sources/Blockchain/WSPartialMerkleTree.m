@@ -25,6 +25,8 @@
 //  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#import <CommonCrypto/CommonDigest.h>
+
 #import "WSPartialMerkleTree.h"
 #import "WSHash256.h"
 #import "WSBitcoin.h"
@@ -66,8 +68,28 @@
 - (NSUInteger)treeHeight;
 - (NSUInteger)treeWidthAtHeight:(NSUInteger)height;
 
++ (NSArray *)treeLevelsWithTxIds:(NSArray *)txIds;
++ (void)buildWithTreeLevels:(NSArray *)levels
+                     height:(NSUInteger)height
+                   position:(NSUInteger)position
+                    matches:(NSIndexSet *)matches
+                     hashes:(NSMutableArray *)hashes
+                      flags:(NSMutableData *)flags
+                  usedBits:(NSUInteger *)usedBits;
+
 @end
 
+static void WSMerkleHashPair(const uint8_t *left, const uint8_t *right, uint8_t *hash)
+{
+    uint8_t pair[2 * CC_SHA256_DIGEST_LENGTH];
+    uint8_t single[CC_SHA256_DIGEST_LENGTH];
+
+    memcpy(pair, left, CC_SHA256_DIGEST_LENGTH);
+    memcpy(pair + CC_SHA256_DIGEST_LENGTH, right, CC_SHA256_DIGEST_LENGTH);
+    CC_SHA256(pair, sizeof(pair), single);
+    CC_SHA256(single, sizeof(single), hash);
+}
+
 @implementation WSPartialMerkleTree
 
 - (instancetype)initWithTxCount:(uint32_t)txCount hashes:(NSArray *)hashes flags:(NSData *)flags error:(NSError *__autoreleasing *)error
@@ -100,6 +122,23 @@
     return self;
 }
 
+// same tree a full node would build for 'merkleblock' (CPartialMerkleTree in bitcoind)
+- (instancetype)initWithTxIds:(NSArray *)txIds matches:(NSIndexSet *)matches
+{
+    WSExceptionCheckIllegal(txIds.count > 0, @"Empty txIds");
+    WSExceptionCheckIllegal((matches.count == 0) || (matches.lastIndex < txIds.count), @"Match out of range (%u >= %u)", matches.lastIndex, txIds.count);
+
+    // every node hash is computed once, bottom-up
+    NSArray *levels = [[self class] treeLevelsWithTxIds:txIds];
+
+    NSMutableArray *hashes = [[NSMutableArray alloc] init];
+    NSMutableData *flags = [[NSMutableData alloc] init];
+    NSUInteger usedBits = 0;
+    [[self class] buildWithTreeLevels:levels height:(levels.count - 1) position:0 matches:matches hashes:hashes flags:flags usedBits:&usedBits];
+
+    return [self initWithTxCount:(uint32_t)txIds.count hashes:hashes flags:flags error:NULL];
+}
+
 - (BOOL)containsTransactionWithId:(WSHash256 *)txId
 {
     WSExceptionCheckIllegal(txId != nil, @"Nil txId");
@@ -208,6 +247,81 @@
     return ((self.txCount + (1 << height) - 1) >> height);
 }
 
++ (NSArray *)treeLevelsWithTxIds:(NSArray *)txIds
+{
+    NSMutableArray *levels = [[NSMutableArray alloc] init];
+    
+    NSMutableData *level = [[NSMutableData alloc] initWithCapacity:(txIds.count * WSHash256Length)];
+    for (WSHash256 *txId in txIds) {
+        [level appendData:txId.data];
+    }
+    [levels addObject:level];
+    
+    NSUInteger width = txIds.count;
+    while (width > 1) {
+        const NSUInteger parentWidth = (width + 1) / 2;
+        const uint8_t *children = level.bytes;
+        NSMutableData *parentLevel = [[NSMutableData alloc] initWithLength:(parentWidth * WSHash256Length)];
+        uint8_t *parents = parentLevel.mutableBytes;
+        
+        // hash (left || right) if even children, (left || left) if odd
+        for (NSUInteger i = 0; i < parentWidth; ++i) {
+            const uint8_t *left = &children[2 * i * WSHash256Length];
+            const uint8_t *right = ((2 * i + 1 < width) ? &children[(2 * i + 1) * WSHash256Length] : left);
+            WSMerkleHashPair(left, right, &parents[i * WSHash256Length]);
+        }
+        
+        [levels addObject:parentLevel];
+        level = parentLevel;
+        width = parentWidth;
+    }
+    return levels;
+}
+
+// recursive function that traverses tree nodes, storing the data as bits and hashes
++ (void)buildWithTreeLevels:(NSArray *)levels
+                     height:(NSUInteger)height
+                   position:(NSUInteger)position
+                    matches:(NSIndexSet *)matches
+                     hashes:(NSMutableArray *)hashes
+                      flags:(NSMutableData *)flags
+                  usedBits:(NSUInteger *)usedBits
+{
+    NSData *level = levels[height];
+    const NSUInteger txCount = [levels[0] length] / WSHash256Length;
+
+    // determine whether this node is the parent of at least one matched txid
+    const NSUInteger from = (position << height);
+    const NSUInteger to = MIN((position + 1) << height, txCount);
+    const BOOL parentOfMatch = [matches intersectsIndexesInRange:NSMakeRange(from, to - from)];
+
+    // store as flag bit
+    if (*usedBits % 8 == 0) {
+        [flags increaseLengthBy:1];
+    }
+    if (parentOfMatch) {
+        uint8_t *flagsBytes = flags.mutableBytes;
+        flagsBytes[*usedBits / 8] |= (1 << (*usedBits % 8));
+    }
+    ++*usedBits;
+
+    // if at height 0, or nothing interesting below, store hash and stop
+    if ((height == 0) || !parentOfMatch) {
+        NSData *hashData = [level subdataWithRange:NSMakeRange(position * WSHash256Length, WSHash256Length)];
+        [hashes addObject:[[WSHash256 alloc] initWithData:hashData]];
+    }
+    // otherwise, don't store any hash, but descend into the subtrees
+    else {
+        const NSUInteger childHeight = height - 1;
+        const NSUInteger childWidth = [levels[childHeight] length] / WSHash256Length;
+
+        [self buildWithTreeLevels:levels height:childHeight position:(position * 2) matches:matches hashes:hashes flags:flags usedBits:usedBits];
+        if (position * 2 + 1 < childWidth) {
+            [self buildWithTreeLevels:levels height:childHeight position:(position * 2 + 1) matches:matches hashes:hashes flags:flags usedBits:usedBits];
+        }
+    }
+}
+
 #pragma mark WSBufferEncoder
 
 - (void)appendToMutableBuffer:(WSMutableBuffer *)buffer
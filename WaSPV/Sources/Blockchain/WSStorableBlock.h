@@ -43,7 +43,7 @@
 
 - (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions;
 - (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions height:(uint32_t)height;
-- (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions height:(uint32_t)height work:(NSData *)work;
+- (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions height:(uint32_t)height work:(NSData *)work; // nil for header work
 
 - (id<WSParameters>)parameters;
 - (WSBlockHeader *)header;
@@ -60,6 +60,7 @@
 
 - (WSStorableBlock *)previousBlockInChain:(WSBlockChain *)blockChain;
 - (WSStorableBlock *)previousBlockInChain:(WSBlockChain *)blockChain maxStep:(NSUInteger)maxStep lastPreviousBlock:(WSStorableBlock **)lastPreviousBlock;
+- (WSStorableBlock *)ancestorAtHeight:(uint32_t)height inChain:(WSBlockChain *)blockChain; // O(log(n)) through skip blocks
 - (BOOL)validateTargetInChain:(WSBlockChain *)blockChain error:(NSError **)error;
 
 @end
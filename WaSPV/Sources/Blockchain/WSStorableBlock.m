@@ -42,10 +42,23 @@
 
 @property (nonatomic, strong) WSBlockHeader *header;
 @property (nonatomic, assign) uint32_t height;
-@property (nonatomic, unsafe_unretained) BIGNUM *work;
+@property (nonatomic, assign) WSUInt256 work;
 @property (nonatomic, strong) NSOrderedSet *transactions; // WSSignedTransaction
 
+//
+// in-memory links only, weak not to retain the whole chain
+// beyond the store, missing links fall back to store lookups
+//
+@property (nonatomic, weak) WSStorableBlock *previousBlock;
+@property (nonatomic, weak) WSStorableBlock *skipBlock;     // at WSBlockGetSkipHeight(height)
+
+// retarget index, strong because only period starts are retained (nil if self)
+@property (nonatomic, strong) WSStorableBlock *periodStartBlock;
+
 - (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions previousBlock:(WSStorableBlock *)previousBlock;
+- (WSStorableBlock *)linkedPreviousBlockInChain:(WSBlockChain *)blockChain;
+- (WSStorableBlock *)linkedPeriodStartBlockInChain:(WSBlockChain *)blockChain;
+- (WSStorableBlock *)unsafeAncestorAtHeight:(uint32_t)height inChain:(WSBlockChain *)blockChain;
 - (BOOL)validateTargetFromPreviousBlock:(WSStorableBlock *)previousBlock retargetBlock:(WSStorableBlock *)retargetBlock error:(NSError **)error;
 
 @end
@@ -54,12 +67,12 @@
 
 - (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions
 {
-    return [self initWithHeader:header transactions:transactions height:WSBlockUnknownHeight work:[header workData]];
+    return [self initWithHeader:header transactions:transactions height:WSBlockUnknownHeight work:nil];
 }
 
 - (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions height:(uint32_t)height
 {
-    return [self initWithHeader:header transactions:transactions height:height work:[header workData]];
+    return [self initWithHeader:header transactions:transactions height:height work:nil];
 }
 
 - (instancetype)initWithHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions height:(uint32_t)height work:(NSData *)work
@@ -70,9 +83,13 @@
         self.header = header;
         self.transactions = transactions;
         self.height = height;
-        self.work = BN_new();
-        
-        WSBlockWorkFromData(self.work, work);
+
+        if (work) {
+            WSBlockWorkFromData(&_work, work);
+        }
+        else {
+            WSBlockGetWorkFromBits(&_work, header.bits);
+        }
     }
     return self;
 }
@@ -85,12 +102,9 @@
         self.header = header;
         self.transactions = transactions;
         self.height = WSBlockUnknownHeight;
-        self.work = BN_new();
-        NSAssert(self.work, @"Unable to allocate work BIGNUM");
-        
+
         // start from own work
-        NSData *workData = [header workData];
-        BN_bin2bn(workData.bytes, (int)workData.length, self.work);
+        WSBlockGetWorkFromBits(&_work, header.bits);
         
         // accumulate previous block work (if any)
         if (previousBlock) {
@@ -100,26 +114,31 @@
             else {
                 self.height = previousBlock.height + 1;
             }
-            BN_add(self.work, self.work, previousBlock.work);
+            const WSUInt256 previousWork = previousBlock.work;
+            WSUInt256Add(&_work, &_work, &previousWork);
+
+            self.previousBlock = previousBlock;
+            if (self.height != WSBlockUnknownHeight) {
+                self.skipBlock = [previousBlock unsafeAncestorAtHeight:WSBlockGetSkipHeight(self.height) inChain:nil];
+
+                const uint32_t retargetInterval = [self.parameters retargetInterval];
+                if (self.height % retargetInterval != 0) {
+                    self.periodStartBlock = ((previousBlock.height % retargetInterval == 0) ? previousBlock : previousBlock.periodStartBlock);
+                }
+            }
         }
     }
     return self;
 }
 
-- (void)dealloc
-{
-    BN_free(self.work);
-    self.work = NULL;
-}
-
 - (NSData *)workData
 {
-    return WSBlockDataFromWork(self.work);
+    return WSBlockDataFromWork(&_work);
 }
 
 - (NSString *)workString
 {
-    return [NSString stringWithUTF8String:BN_bn2dec(self.work)];
+    return WSUInt256GetDecimalString(&_work);
 }
 
 - (BOOL)isEqual:(id)object
@@ -163,7 +182,8 @@
 
 - (BOOL)hasMoreWorkThanBlock:(WSStorableBlock *)block
 {
-    return (BN_cmp(self.work, block.work) > 0);
+    const WSUInt256 work = block.work;
+    return (WSUInt256Compare(&_work, &work) > 0);
 }
 
 - (WSStorableBlock *)buildNextBlockFromHeader:(WSBlockHeader *)header transactions:(NSOrderedSet *)transactions
@@ -192,7 +212,18 @@
         if (!previousBlockId) {
             return nil;
         }
-        previousBlock = [blockChain blockForId:previousBlockId];
+
+        // try main chain by height first (no hashing)
+        WSStorableBlock *mainBlock = nil;
+        if ((previousBlock.height != WSBlockUnknownHeight) && (previousBlock.height > 0)) {
+            mainBlock = [blockChain blockAtHeight:(previousBlock.height - 1)];
+        }
+        if (mainBlock && [mainBlock.blockId isEqual:previousBlockId]) {
+            previousBlock = mainBlock;
+        }
+        else {
+            previousBlock = [blockChain blockForId:previousBlockId];
+        }
         if (!previousBlock) {
             return nil;
         }
@@ -200,16 +231,98 @@
     return previousBlock;
 }
 
+- (WSStorableBlock *)ancestorAtHeight:(uint32_t)height inChain:(WSBlockChain *)blockChain
+{
+    WSExceptionCheckIllegal(blockChain != nil, @"Nil blockChain");
+
+    return [self unsafeAncestorAtHeight:height inChain:blockChain];
+}
+
+- (WSStorableBlock *)unsafeAncestorAtHeight:(uint32_t)height inChain:(WSBlockChain *)blockChain
+{
+    if ((self.height == WSBlockUnknownHeight) || (height > self.height)) {
+        return nil;
+    }
+
+    WSStorableBlock *block = self;
+    uint32_t blockHeight = self.height;
+    BOOL shouldTryMainChain = (blockChain != nil);
+    BOOL isFirstBlock = YES;
+    while (block && (blockHeight > height)) {
+
+        // main chain indexed by height, checked again whenever the walk
+        // goes through unlinked blocks (e.g. loaded from store)
+        if (shouldTryMainChain && (isFirstBlock || !block.skipBlock)) {
+            if ([[blockChain blockAtHeight:blockHeight] isEqual:block]) {
+                WSStorableBlock *ancestor = [blockChain blockAtHeight:height];
+                if (ancestor) {
+                    return ancestor;
+                }
+                shouldTryMainChain = NO;
+            }
+        }
+        isFirstBlock = NO;
+
+        const uint32_t skipHeight = WSBlockGetSkipHeight(blockHeight);
+        const uint32_t previousSkipHeight = WSBlockGetSkipHeight(blockHeight - 1);
+        WSStorableBlock *skipBlock = block.skipBlock;
+
+        // only skip if previous block wouldn't skip better
+        if (skipBlock && ((skipHeight == height) ||
+                          ((skipHeight > height) && !((previousSkipHeight + 2 < skipHeight) && (previousSkipHeight >= height))))) {
+
+            block = skipBlock;
+            blockHeight = skipHeight;
+        }
+        else {
+            block = [block linkedPreviousBlockInChain:blockChain];
+            --blockHeight;
+        }
+    }
+    return block;
+}
+
+- (WSStorableBlock *)linkedPreviousBlockInChain:(WSBlockChain *)blockChain
+{
+    WSStorableBlock *previousBlock = self.previousBlock;
+    if (previousBlock || !blockChain) {
+        return previousBlock;
+    }
+    previousBlock = [self previousBlockInChain:blockChain];
+    self.previousBlock = previousBlock;
+    return previousBlock;
+}
+
+// self if period start, relinked for blocks loaded from store
+- (WSStorableBlock *)linkedPeriodStartBlockInChain:(WSBlockChain *)blockChain
+{
+    const uint32_t retargetInterval = [self.parameters retargetInterval];
+    if ((self.height == WSBlockUnknownHeight) || (self.height % retargetInterval == 0)) {
+        return self;
+    }
+    WSStorableBlock *periodStartBlock = self.periodStartBlock;
+    if (periodStartBlock || !blockChain) {
+        return periodStartBlock;
+    }
+    periodStartBlock = [self unsafeAncestorAtHeight:(self.height - self.height % retargetInterval) inChain:blockChain];
+    self.periodStartBlock = periodStartBlock;
+    return periodStartBlock;
+}
+
 - (BOOL)validateTargetInChain:(WSBlockChain *)blockChain error:(NSError *__autoreleasing *)error
 {
     WSExceptionCheckIllegal(blockChain != nil, @"Nil blockChain");
     
-    WSStorableBlock *previousBlock = [self previousBlockInChain:blockChain];
+    // linked first, self may not be stored yet (batches)
+    WSStorableBlock *previousBlock = [self linkedPreviousBlockInChain:blockChain];
     if (!previousBlock) {
         WSErrorSet(error, WSErrorCodeInvalidBlock, @"Orphaned block");
         return NO;
     }
 
+    // first block of previous period, blocks built on top inherit the relinked one
+    WSStorableBlock *retargetBlock = [previousBlock linkedPeriodStartBlockInChain:blockChain];
+
     if (![self isTransitionBlock]) {
         if (self.header.bits != previousBlock.header.bits) {
             WSErrorSet(error, WSErrorCodeInvalidBlock, @"Unexpected target at height %u (%x != %x)",
@@ -217,16 +330,18 @@
 
             return NO;
         }
+        if (!self.periodStartBlock) {
+            self.periodStartBlock = retargetBlock;
+        }
         return YES;
     }
 
-    WSStorableBlock *retargetBlock = previousBlock;
     const uint32_t retargetInterval = [self.parameters retargetInterval];
-    for (NSUInteger i = 1; i < retargetInterval; ++i) {
-        retargetBlock = [retargetBlock previousBlockInChain:blockChain];
+    if (!retargetBlock || (retargetBlock.height != self.height - retargetInterval)) {
+        retargetBlock = [previousBlock ancestorAtHeight:(self.height - retargetInterval) inChain:blockChain];
     }
     if (!retargetBlock) {
-        WSErrorSet(error, WSErrorCodeInvalidBlock, @"Incomplete chain, last retarget block not found at height %u", self.height - retargetInterval + 1);
+        WSErrorSet(error, WSErrorCodeInvalidBlock, @"Incomplete chain, last retarget block not found at height %u", self.height - retargetInterval);
         return NO;
     }
 
@@ -248,44 +363,22 @@
         span = maxRetargetTimespan;
     }
 
-    BIGNUM bnTarget;
-    BIGNUM bnMaxTarget;
-    BIGNUM bnSpan;
-    BIGNUM bnRetargetSpan;
-    BIGNUM bnTargetXSpan;
-    
-    BN_init(&bnTarget);
-    BN_init(&bnMaxTarget);
-    BN_init(&bnSpan);
-    BN_init(&bnRetargetSpan);
-    BN_init(&bnTargetXSpan);
-
-    BN_CTX *ctx = BN_CTX_new();
-    BN_CTX_start(ctx);
-
-    WSBlockSetBits(&bnTarget, retargetBlock.header.bits);
-    WSBlockSetBits(&bnMaxTarget, [self.parameters maxProofOfWork]);
-    BN_set_word(&bnSpan, span);
-    BN_set_word(&bnRetargetSpan, [self.parameters retargetTimespan]);
-    BN_mul(&bnTargetXSpan, &bnTarget, &bnSpan, ctx);
-    BN_div(&bnTarget, NULL, &bnTargetXSpan, &bnRetargetSpan, ctx);
+    WSUInt256 target;
+    WSUInt256 maxTarget;
+
+    // target is at most max target (< 2^224) and span < 2^32, no overflow
+    WSBlockSetBits(&target, retargetBlock.header.bits);
+    WSBlockSetBits(&maxTarget, [self.parameters maxProofOfWork]);
+    WSUInt256MultiplyWord(&target, &target, span);
+    WSUInt256DivideWord(&target, &target, [self.parameters retargetTimespan]);
 
     // cap target to max target
-    if (BN_cmp(&bnTarget, &bnMaxTarget) > 0) {
-        BN_copy(&bnTarget, &bnMaxTarget);
+    if (WSUInt256Compare(&target, &maxTarget) > 0) {
+        target = maxTarget;
     }
     
-    const uint32_t expectedBits = WSBlockGetBits(&bnTarget);
+    const uint32_t expectedBits = WSBlockGetBits(&target);
 
-    BN_CTX_end(ctx);
-    BN_CTX_free(ctx);
-    
-    BN_free(&bnTarget);
-    BN_free(&bnMaxTarget);
-    BN_free(&bnSpan);
-    BN_free(&bnRetargetSpan);
-    BN_free(&bnTargetXSpan);
-    
     if (self.header.bits != expectedBits) {
         WSErrorSet(error, WSErrorCodeInvalidBlock, @"Unexpected target at height %u (%x != %x)",
                    self.height, self.header.bits, expectedBits);
@@ -344,7 +437,7 @@
 
 - (NSUInteger)estimatedSize
 {
-    const NSUInteger workLength = BN_num_bytes(self.work);
+    const NSUInteger workLength = (WSUInt256Bits(&_work) + 7) / 8;
     const NSUInteger workLengthLength = WSBufferVarIntSize(workLength);
     
     return WSBlockHeaderSize + sizeof(uint32_t) + workLengthLength + workLength;
@@ -367,8 +460,7 @@
 - (id)initWithCoder:(NSCoder *)aDecoder
 {
     if ((self = [super initWithCoder:aDecoder])) {
-        self.work = BN_new();
-        WSBlockWorkFromData(self.work, [aDecoder decodeDataObject]);
+        WSBlockWorkFromData(&_work, [aDecoder decodeDataObject]);
     }
     return self;
 }
@@ -377,7 +469,7 @@
 {
     [super encodeWithCoder:aCoder];
  
-    [aCoder encodeDataObject:WSBlockDataFromWork(self.work)];
+    [aCoder encodeDataObject:WSBlockDataFromWork(&_work)];
 }
 
 + (NSDictionary *)codableProperties
@@ -39,6 +39,7 @@
 
 - (instancetype)init;
 - (instancetype)initWithData:(NSData *)data;
+- (instancetype)initWithBorrowedData:(NSData *)data; // no copy, data MUST NOT be mutated afterwards
 - (NSData *)data;
 
 - (uint8_t)uint8AtOffset:(NSUInteger)offset;
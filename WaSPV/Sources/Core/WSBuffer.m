@@ -38,9 +38,15 @@
 #import "NSData+Hash.h"
 #import "NSData+Binary.h"
 
+// slices below this length are copied rather than retaining a larger borrowed buffer
+static const NSUInteger WSBufferMinBorrowedSliceLength = 1024;
+
 @interface WSBuffer ()
 
 @property (nonatomic, strong) NSMutableData *mutableData;
+@property (nonatomic, strong) NSData *borrowedData;
+
+- (NSData *)sliceWithRange:(NSRange)range;
 
 - (instancetype)initWithCapacity:(NSUInteger)capacity;
 
@@ -66,6 +72,16 @@
     return self;
 }
 
+- (instancetype)initWithBorrowedData:(NSData *)data
+{
+    WSExceptionCheckIllegal(data != nil, @"Nil data");
+    
+    if ((self = [super init])) {
+        self.borrowedData = data;
+    }
+    return self;
+}
+
 - (instancetype)initWithCapacity:(NSUInteger)capacity
 {
     if ((self = [super init])) {
@@ -76,7 +92,7 @@
 
 - (NSData *)data
 {
-    return _mutableData;
+    return (_borrowedData ? : _mutableData);
 }
 
 - (uint8_t)uint8AtOffset:(NSUInteger)offset
@@ -191,7 +207,7 @@
 
 - (WSHash256 *)hash256AtOffset:(NSUInteger)offset
 {
-    WSHash256 *hash256 = WSHash256FromData([self.data subdataWithRange:NSMakeRange(offset, WSHash256Length)]);
+    WSHash256 *hash256 = WSHash256FromData([self sliceWithRange:NSMakeRange(offset, WSHash256Length)]);
     if (!hash256) {
         return nil;
     }
@@ -210,7 +226,7 @@
     if ((varIntLength == 0) || (self.data.length < offset + totalLength)) {
         return nil;
     }
-    return [self.data subdataWithRange:NSMakeRange(offset + varIntLength, dataLength)];
+    return [self sliceWithRange:NSMakeRange(offset + varIntLength, dataLength)];
 }
 
 - (NSData *)dataAtOffset:(NSUInteger)offset length:(NSUInteger)length
@@ -218,11 +234,14 @@
     if (self.data.length < offset + length) {
         return nil;
     }
-    return [self.data subdataWithRange:NSMakeRange(offset, length)];
+    return [self sliceWithRange:NSMakeRange(offset, length)];
 }
 
 - (WSBuffer *)subBufferWithRange:(NSRange)range
 {
+    if (self.borrowedData) {
+        return [[WSBuffer alloc] initWithBorrowedData:[self sliceWithRange:range]];
+    }
     return [[WSBuffer alloc] initWithData:[self.data subdataWithRange:range]];
 }
 
@@ -263,6 +282,22 @@
     return [self.data description];
 }
 
+#pragma mark Helpers
+
+// borrowed buffers are immutable, large slices can safely reference them
+- (NSData *)sliceWithRange:(NSRange)range
+{
+    NSData *data = self.data;
+    if (!self.borrowedData || (range.length < WSBufferMinBorrowedSliceLength)) {
+        return [data subdataWithRange:range];
+    }
+    WSExceptionCheckIllegal(NSMaxRange(range) <= data.length, @"Slice out of bounds (%@ > %u)", NSStringFromRange(range), data.length);
+
+    return [[NSData alloc] initWithBytesNoCopy:((uint8_t *)data.bytes + range.location) length:range.length deallocator:^(void *bytes, NSUInteger length) {
+        (void)data;
+    }];
+}
+
 #pragma mark NSData
 
 - (const void *)bytes
@@ -280,7 +315,12 @@
 - (id)copyWithZone:(NSZone *)zone
 {
     WSBuffer *copy = [[self class] allocWithZone:zone];
-    copy.mutableData = [self.data mutableCopyWithZone:zone];
+    if (self.borrowedData) {
+        copy.borrowedData = self.borrowedData;
+    }
+    else {
+        copy.mutableData = [self.data mutableCopyWithZone:zone];
+    }
     return copy;
 }
 
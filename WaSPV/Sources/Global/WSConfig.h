@@ -48,26 +48,49 @@ extern const uint32_t           WSSeedGeneratorDefaultEntropyBits;
 
 extern const uint32_t           WSBlockUnknownHeight;
 extern const uint32_t           WSBlockUnknownTimestamp;
+extern const NSUInteger         WSBlockHeaderVerifyChunkSize;
+
+extern const NSUInteger         WSBlockChainDefaultStoreSize;
+extern const NSUInteger         WSMemoryBlockStoreDefaultCapacity;
+extern const NSUInteger         WSOrphanPoolDefaultCapacity;
+
+extern const NSUInteger         WSConnectionOutputHighWaterMark;
+
+extern const NSUInteger         WSBlockDownloadSchedulerDefaultWindowSize;
+extern const NSUInteger         WSBlockDownloadSchedulerDefaultMaxWindows;
+extern const NSUInteger         WSBlockDownloadSchedulerDefaultMaxBuffered;
 
 extern const NSTimeInterval     WSPeerConnectTimeout;
 extern const uint32_t           WSPeerProtocol;
 extern const uint32_t           WSPeerMinProtocol;
 extern const NSUInteger         WSPeerEnabledServices;
 extern const NSUInteger         WSPeerMaxFilteredBlockCount;
+extern const double             WSPeerPingTimeSmoothing;
+extern const double             WSPeerDownloadSpeedSmoothing;
+extern const NSTimeInterval     WSPeerDownloadSpeedMinSampleInterval;
+extern const NSTimeInterval     WSPeerDownloadSpeedMaxSampleInterval;
+extern const NSUInteger         WSPeerDownloadSpeedMinSampleBytes;
 
 extern const NSUInteger         WSPeerGroupDefaultMaxConnections;
 extern const NSUInteger         WSPeerGroupDefaultMaxConnectionFailures;
 extern const NSTimeInterval     WSPeerGroupDefaultReconnectionDelay;
-//extern const NSTimeInterval     WSPeerGroupDefaultPingInterval;
+extern const NSTimeInterval     WSPeerGroupDefaultPingInterval;
 extern const NSTimeInterval     WSPeerGroupDefaultRequestTimeout;
+extern const NSTimeInterval     WSPeerGroupDefaultRateWindow;
+extern const double             WSPeerGroupDefaultMinBlockRate;
+extern const double             WSPeerGroupDefaultMinByteRate;
+extern const NSTimeInterval     WSPeerGroupStallCheckInterval;
 //extern const NSUInteger         WSPeerGroupMaxPeerHours;
-extern const NSUInteger         WSPeerGroupMaxInactivePeers;
+extern const NSUInteger         WSPeerGroupScoreReferenceBytes;
+extern const double             WSPeerGroupDownloadPeerSwitchRatio;
 
 extern const double             WSPeerGroupDefaultBFRateMin;
 extern const double             WSPeerGroupDefaultBFRateDelta;
 extern const double             WSPeerGroupDefaultBFObservedRateMax;
 extern const double             WSPeerGroupDefaultBFLowPassRatio;
 extern const NSUInteger         WSPeerGroupDefaultBFTxsPerBlock;
+extern const double             WSPeerGroupDefaultBFRebuildRatio;
+extern const NSUInteger         WSPeerGroupDefaultBFHorizon;
 
 extern const uint32_t           WSMessageVersionLocalhost;
 
@@ -45,26 +45,49 @@ const uint32_t          WSSeedGeneratorDefaultEntropyBits           = 128;
 
 const uint32_t          WSBlockUnknownHeight                        = UINT32_MAX;
 const uint32_t          WSBlockUnknownTimestamp                     = UINT32_MAX;
+const NSUInteger        WSBlockHeaderVerifyChunkSize                = 250;
+
+const NSUInteger        WSBlockChainDefaultStoreSize                = 2500;
+const NSUInteger        WSMemoryBlockStoreDefaultCapacity           = 2500;
+const NSUInteger        WSOrphanPoolDefaultCapacity                 = 1000;
+
+const NSUInteger        WSConnectionOutputHighWaterMark             = 1024 * 1024;
+
+const NSUInteger        WSBlockDownloadSchedulerDefaultWindowSize   = 100;
+const NSUInteger        WSBlockDownloadSchedulerDefaultMaxWindows   = 2;
+const NSUInteger        WSBlockDownloadSchedulerDefaultMaxBuffered  = 2000;
 
 const NSTimeInterval    WSPeerConnectTimeout                        = 3.0;
 const uint32_t          WSPeerProtocol                              = 70002;
 const uint32_t          WSPeerMinProtocol                           = 70001;    // SPV mode required
 const NSUInteger        WSPeerEnabledServices                       = 0;        // we don't provide full blocks to remote nodes
 const NSUInteger        WSPeerMaxFilteredBlockCount                 = 2000;
+const double            WSPeerPingTimeSmoothing                     = 0.2;
+const double            WSPeerDownloadSpeedSmoothing                = 0.2;
+const NSTimeInterval    WSPeerDownloadSpeedMinSampleInterval        = 1.0;
+const NSTimeInterval    WSPeerDownloadSpeedMaxSampleInterval        = 5.0;      // longer gaps are idle time
+const NSUInteger        WSPeerDownloadSpeedMinSampleBytes           = 16 * 1024;
 
 const NSUInteger        WSPeerGroupDefaultMaxConnections            = 3;
 const NSUInteger        WSPeerGroupDefaultMaxConnectionFailures     = 15;
 const NSTimeInterval    WSPeerGroupDefaultReconnectionDelay         = 10.0;
-//const NSTimeInterval    WSPeerGroupDefaultPingInterval              = 5.0;
+const NSTimeInterval    WSPeerGroupDefaultPingInterval              = 5.0;
 const NSTimeInterval    WSPeerGroupDefaultRequestTimeout            = 5.0;
+const NSTimeInterval    WSPeerGroupDefaultRateWindow                = 20.0;
+const double            WSPeerGroupDefaultMinBlockRate              = 1.0;      // blocks (or headers) per second
+const double            WSPeerGroupDefaultMinByteRate               = 4 * 1024; // bytes per second
+const NSTimeInterval    WSPeerGroupStallCheckInterval               = 1.0;
 //const NSUInteger        WSPeerGroupMaxPeerHours                     = 4;
-const NSUInteger        WSPeerGroupMaxInactivePeers                 = 1000;
+const NSUInteger        WSPeerGroupScoreReferenceBytes              = 1024 * 1024;
+const double            WSPeerGroupDownloadPeerSwitchRatio          = 3.0;      // new peer must be 3x faster
 
 const double            WSPeerGroupDefaultBFRateMin                 = 0.0001;
 const double            WSPeerGroupDefaultBFRateDelta               = 0.0004;
 const double            WSPeerGroupDefaultBFObservedRateMax         = 10.0 * (WSPeerGroupDefaultBFRateMin + WSPeerGroupDefaultBFRateDelta);
 const double            WSPeerGroupDefaultBFLowPassRatio            = 0.01;     // 1%
 const NSUInteger        WSPeerGroupDefaultBFTxsPerBlock             = 600;
+const double            WSPeerGroupDefaultBFRebuildRatio            = 2.0;      // incremental filter up to 2x target rate
+const NSUInteger        WSPeerGroupDefaultBFHorizon                 = 144;      // ~1 day of blocks
 
 const uint32_t          WSMessageVersionLocalhost                   = 0x0100007f;
 
@@ -0,0 +1,66 @@
+//
+//  WSAddressManager.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+@protocol WSParameters;
+@class WSNetworkAddress;
+
+#pragma mark -
+
+//
+// known addresses are split in a "new" table (heard of) and a "tried"
+// table (handshake succeeded at least once), both made of fixed-size
+// buckets picked by a keyed hash of the network group, so that a
+// single network can't flood either table
+//
+// hosts are indexed for O(1) lookup, selection favors tried addresses
+// with recent successes, few failed attempts and low ping time
+//
+// NOTE: not thread-safe
+//
+@interface WSAddressManager : NSObject
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters;
+- (instancetype)initWithParameters:(id<WSParameters>)parameters path:(NSString *)path; // loads path if any
+- (NSString *)path;
+
+- (NSUInteger)count;
+- (NSUInteger)triedCount;
+- (BOOL)hasRecentSuccess; // any handshake within the last day
+- (BOOL)containsHost:(NSString *)host;
+- (NSUInteger)addAddresses:(NSArray *)addresses; // WSNetworkAddress, returns number of new hosts
+- (void)removeHost:(NSString *)host;
+- (WSNetworkAddress *)bestAddressPassingTest:(BOOL (^)(WSNetworkAddress *address))test;
+
+- (void)didAttemptHost:(NSString *)host;
+- (void)didConnectToAddress:(WSNetworkAddress *)address; // moves to tried, as actually connected
+- (void)setPingTime:(NSTimeInterval)pingTime forHost:(NSString *)host;
+
+- (BOOL)saveWithError:(NSError **)error;
+
+@end
@@ -0,0 +1,516 @@
+//
+//  WSAddressManager.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSAddressManager.h"
+#import "WSNetworkAddress.h"
+#import "WSBuffer.h"
+#import "WSParameters.h"
+#import "WSBitcoin.h"
+#import "WSConfig.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+//
+// file = magic | version | network magic | key (8) | count (4) | entry #0 | entry #1 | ...
+//
+// entry = ipv6 address (16) | port (2) | services (8) | timestamp (4) | tried (1) |
+//         last attempt (4) | last success (4) | attempts (4) | successes (4) | ping time (4, ms)
+//
+static const uint32_t           WSAddressManagerMagic               = 0x4d415357;   // "WSAM"
+static const uint32_t           WSAddressManagerVersion             = 1;
+static const NSUInteger         WSAddressManagerHeaderLength        = 24;
+static const NSUInteger         WSAddressManagerEntryLength         = 51;
+static const uint32_t           WSAddressManagerUnknownPingTime     = UINT32_MAX;
+
+static const NSUInteger         WSAddressManagerUntriedBucketCount  = 64;
+static const NSUInteger         WSAddressManagerTriedBucketCount    = 16;
+static const NSUInteger         WSAddressManagerBucketSize          = 32;
+static const uint64_t           WSAddressManagerBucketsPerGroup     = 4;
+static const uint64_t           WSAddressManagerTriedSalt           = 0x6465697274;   // "tried"
+
+static const uint32_t           WSAddressManagerRetryDelay          = 10 * WSDatesOneMinute;
+static const uint32_t           WSAddressManagerHorizon             = 30 * WSDatesOneDay;
+static const uint32_t           WSAddressManagerRecentSuccess       = WSDatesOneDay;
+static const uint32_t           WSAddressManagerMaxAttempts         = 3;            // without any success
+static const NSTimeInterval     WSAddressManagerDefaultPingTime     = 1.0;
+static const double             WSAddressManagerExploreRatio        = 0.25;
+
+// FNV-1a seeded with key, then a splitmix64 finalizer
+static inline uint64_t WSAddressManagerHash(uint64_t key, const void *bytes, size_t length)
+{
+    const uint8_t *p = bytes;
+    uint64_t h = key ^ 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+@interface WSAddressManagerEntry : NSObject
+
+@property (nonatomic, strong) WSNetworkAddress *address;
+@property (nonatomic, assign) BOOL isTried;
+@property (nonatomic, assign) uint32_t lastAttempt;
+@property (nonatomic, assign) uint32_t lastSuccess;
+@property (nonatomic, assign) uint32_t attempts;        // since last success
+@property (nonatomic, assign) uint32_t successes;
+@property (nonatomic, assign) NSTimeInterval pingTime;  // DBL_MAX if unknown
+
+- (double)chanceAtTimestamp:(uint32_t)timestamp;
+- (BOOL)isTerribleAtTimestamp:(uint32_t)timestamp;
+
+@end
+
+@implementation WSAddressManagerEntry
+
+- (instancetype)init
+{
+    if ((self = [super init])) {
+        self.pingTime = DBL_MAX;
+    }
+    return self;
+}
+
+// adapted from bitcoind CAddrInfo::GetChance()
+- (double)chanceAtTimestamp:(uint32_t)timestamp
+{
+    double chance = 1.0;
+    if (timestamp - self.lastAttempt < WSAddressManagerRetryDelay) {
+        chance *= 0.01;
+    }
+    chance *= pow(0.66, MIN(self.attempts, 8));
+    return chance;
+}
+
+// adapted from bitcoind CAddrInfo::IsTerrible()
+- (BOOL)isTerribleAtTimestamp:(uint32_t)timestamp
+{
+    if (self.lastAttempt && (timestamp - self.lastAttempt < WSDatesOneMinute)) {
+        return NO;
+    }
+    if (self.address.timestamp + WSAddressManagerHorizon < timestamp) {
+        return YES;
+    }
+    if (!self.lastSuccess && (self.attempts >= WSAddressManagerMaxAttempts)) {
+        return YES;
+    }
+    return NO;
+}
+
+@end
+
+#pragma mark -
+
+@interface WSAddressManager ()
+
+@property (nonatomic, strong) id<WSParameters> parameters;
+@property (nonatomic, copy) NSString *path;
+@property (nonatomic, assign) uint64_t key;
+@property (nonatomic, strong) NSMutableDictionary *entriesByHost;   // NSString -> WSAddressManagerEntry
+@property (nonatomic, strong) NSArray *untriedBuckets;              // NSMutableArray (WSAddressManagerEntry)
+@property (nonatomic, strong) NSArray *triedBuckets;                // NSMutableArray (WSAddressManagerEntry)
+@property (nonatomic, assign) NSUInteger triedCount;
+@property (nonatomic, assign) uint32_t lastSuccess;
+
+- (void)removeAllEntries;
+- (BOOL)loadFromData:(NSData *)data error:(NSError **)error;
+- (NSMutableArray *)bucketForEntry:(WSAddressManagerEntry *)entry;
+- (void)insertEntry:(WSAddressManagerEntry *)entry;
+- (void)removeEntry:(WSAddressManagerEntry *)entry;
+- (WSAddressManagerEntry *)worstEntryInBucket:(NSArray *)bucket;
+
+@end
+
+@implementation WSAddressManager
+
+- (instancetype)init
+{
+    WSExceptionRaiseUnsupported(@"Use initWithParameters:");
+    return nil;
+}
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters
+{
+    return [self initWithParameters:parameters path:nil];
+}
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters path:(NSString *)path
+{
+    WSExceptionCheckIllegal(parameters != nil, @"Nil parameters");
+    
+    if ((self = [super init])) {
+        self.parameters = parameters;
+        self.path = path;
+        [self removeAllEntries];
+
+        if (path) {
+            NSData *data = [NSData dataWithContentsOfFile:path];
+            if (!data) {
+                DDLogDebug(@"No known addresses at %@", path);
+            }
+            else {
+                NSError *error;
+                if (![self loadFromData:data error:&error]) {
+                    DDLogWarn(@"Discarding known addresses at %@ (%@)", path, error);
+                    [self removeAllEntries];
+                }
+                else {
+                    DDLogDebug(@"Loaded %u known addresses (tried: %u) from %@", self.count, self.triedCount, path);
+                }
+            }
+        }
+    }
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return self.entriesByHost.count;
+}
+
+- (BOOL)hasRecentSuccess
+{
+    return (self.lastSuccess + WSAddressManagerRecentSuccess >= WSCurrentTimestamp());
+}
+
+- (BOOL)containsHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    return (self.entriesByHost[host] != nil);
+}
+
+- (NSUInteger)addAddresses:(NSArray *)addresses
+{
+    NSParameterAssert(addresses);
+    
+    NSUInteger count = 0;
+    for (WSNetworkAddress *address in addresses) {
+        NSString *host = address.host;
+        if (!host) {
+            continue;
+        }
+
+        // same host keeps its bucket, only refresh address
+        WSAddressManagerEntry *entry = self.entriesByHost[host];
+        if (entry) {
+            if (address.timestamp > entry.address.timestamp) {
+                entry.address = address;
+            }
+            continue;
+        }
+        
+        entry = [[WSAddressManagerEntry alloc] init];
+        entry.address = address;
+        [self insertEntry:entry];
+        ++count;
+    }
+    return count;
+}
+
+- (void)removeHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    WSAddressManagerEntry *entry = self.entriesByHost[host];
+    if (entry) {
+        [self removeEntry:entry];
+    }
+}
+
+- (WSNetworkAddress *)bestAddressPassingTest:(BOOL (^)(WSNetworkAddress *))test
+{
+    const uint32_t now = WSCurrentTimestamp();
+    
+    WSAddressManagerEntry *bestTried = nil;
+    WSAddressManagerEntry *bestUntried = nil;
+    double bestTriedWeight = 0.0;
+    double bestUntriedWeight = 0.0;
+    
+    for (WSAddressManagerEntry *entry in [self.entriesByHost objectEnumerator]) {
+        if (test && !test(entry.address)) {
+            continue;
+        }
+        
+        const double chance = [entry chanceAtTimestamp:now];
+        
+        // tried: known-good and fast first
+        if (entry.isTried) {
+            const NSTimeInterval pingTime = ((entry.pingTime != DBL_MAX) ? entry.pingTime : WSAddressManagerDefaultPingTime);
+            const double weight = chance / MAX(pingTime, 0.001);
+            if (!bestTried || (weight > bestTriedWeight)) {
+                bestTried = entry;
+                bestTriedWeight = weight;
+            }
+        }
+        // untried: recently seen first
+        else {
+            const uint32_t age = ((now > entry.address.timestamp) ? (now - entry.address.timestamp) : 0);
+            const double weight = chance / (1.0 + (double)age / WSDatesOneDay);
+            if (!bestUntried || (weight > bestUntriedWeight)) {
+                bestUntried = entry;
+                bestUntriedWeight = weight;
+            }
+        }
+    }
+    
+    // explore untried table once in a while to grow tried table
+    if (bestUntried && (!bestTried || (drand48() < WSAddressManagerExploreRatio))) {
+        return bestUntried.address;
+    }
+    return bestTried.address;
+}
+
+- (void)didAttemptHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    WSAddressManagerEntry *entry = self.entriesByHost[host];
+    entry.lastAttempt = WSCurrentTimestamp();
+    ++entry.attempts;
+}
+
+- (void)didConnectToAddress:(WSNetworkAddress *)address
+{
+    NSParameterAssert(address.host);
+    
+    const uint32_t now = WSCurrentTimestamp();
+    
+    WSAddressManagerEntry *entry = self.entriesByHost[address.host];
+    if (!entry) {
+        entry = [[WSAddressManagerEntry alloc] init];
+    }
+    else {
+        [self removeEntry:entry];
+    }
+    entry.address = [[WSNetworkAddress alloc] initWithTimestamp:now services:address.services ipv6Address:address.ipv6Address port:address.port];
+    entry.isTried = YES;
+    entry.lastSuccess = now;
+    self.lastSuccess = now;
+    entry.attempts = 0;
+    ++entry.successes;
+    [self insertEntry:entry];
+}
+
+- (void)setPingTime:(NSTimeInterval)pingTime forHost:(NSString *)host
+{
+    NSParameterAssert(host);
+    
+    WSAddressManagerEntry *entry = self.entriesByHost[host];
+    entry.pingTime = pingTime;
+}
+
+- (BOOL)saveWithError:(NSError *__autoreleasing *)error
+{
+    WSExceptionCheckIllegal(self.path != nil, @"Nil path");
+    
+    WSMutableBuffer *buffer = [[WSMutableBuffer alloc] initWithCapacity:(WSAddressManagerHeaderLength + self.count * WSAddressManagerEntryLength)];
+    [buffer appendUint32:WSAddressManagerMagic];
+    [buffer appendUint32:WSAddressManagerVersion];
+    [buffer appendUint32:[self.parameters magicNumber]];
+    [buffer appendUint64:self.key];
+    [buffer appendUint32:(uint32_t)self.count];
+    
+    for (WSAddressManagerEntry *entry in [self.entriesByHost objectEnumerator]) {
+        WSNetworkAddress *address = entry.address;
+        [buffer appendData:address.ipv6Address];
+        [buffer appendUint16:address.port];
+        [buffer appendUint64:address.services];
+        [buffer appendUint32:address.timestamp];
+        [buffer appendUint8:entry.isTried];
+        [buffer appendUint32:entry.lastAttempt];
+        [buffer appendUint32:entry.lastSuccess];
+        [buffer appendUint32:entry.attempts];
+        [buffer appendUint32:entry.successes];
+        [buffer appendUint32:((entry.pingTime != DBL_MAX) ? (uint32_t)MIN(entry.pingTime * 1000.0, UINT32_MAX - 1) : WSAddressManagerUnknownPingTime)];
+    }
+    NSAssert(buffer.length == WSAddressManagerHeaderLength + self.count * WSAddressManagerEntryLength, @"Unexpected file length");
+    
+    return [buffer.data writeToFile:self.path options:NSDataWritingAtomic error:error];
+}
+
+#pragma mark Helpers
+
+- (void)removeAllEntries
+{
+    uint64_t key;
+    arc4random_buf(&key, sizeof(key));
+    self.key = key;
+    self.entriesByHost = [[NSMutableDictionary alloc] init];
+    self.triedCount = 0;
+    self.lastSuccess = 0;
+    
+    NSMutableArray *untriedBuckets = [[NSMutableArray alloc] initWithCapacity:WSAddressManagerUntriedBucketCount];
+    for (NSUInteger i = 0; i < WSAddressManagerUntriedBucketCount; ++i) {
+        [untriedBuckets addObject:[[NSMutableArray alloc] initWithCapacity:WSAddressManagerBucketSize]];
+    }
+    NSMutableArray *triedBuckets = [[NSMutableArray alloc] initWithCapacity:WSAddressManagerTriedBucketCount];
+    for (NSUInteger i = 0; i < WSAddressManagerTriedBucketCount; ++i) {
+        [triedBuckets addObject:[[NSMutableArray alloc] initWithCapacity:WSAddressManagerBucketSize]];
+    }
+    self.untriedBuckets = untriedBuckets;
+    self.triedBuckets = triedBuckets;
+}
+
+- (BOOL)loadFromData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    NSParameterAssert(data);
+    
+    WSBuffer *buffer = [[WSBuffer alloc] initWithBorrowedData:data];
+    if ((buffer.length < WSAddressManagerHeaderLength) ||
+        ([buffer uint32AtOffset:0] != WSAddressManagerMagic) ||
+        ([buffer uint32AtOffset:4] != WSAddressManagerVersion)) {
+        
+        WSErrorSet(error, WSErrorCodeMalformed, @"Unrecognized addresses file");
+        return NO;
+    }
+    if ([buffer uint32AtOffset:8] != [self.parameters magicNumber]) {
+        WSErrorSet(error, WSErrorCodeMalformed, @"Addresses file belongs to another network");
+        return NO;
+    }
+    
+    // count is untrusted, compare before multiplying
+    const uint32_t count = [buffer uint32AtOffset:20];
+    if (count > (buffer.length - WSAddressManagerHeaderLength) / WSAddressManagerEntryLength) {
+        WSErrorSet(error, WSErrorCodeMalformed, @"Truncated addresses file (%lu bytes, %u entries)",
+                   (unsigned long)buffer.length, count);
+        return NO;
+    }
+    
+    // buckets depend on key
+    self.key = [buffer uint64AtOffset:12];
+    
+    NSUInteger offset = WSAddressManagerHeaderLength;
+    for (uint32_t i = 0; i < count; ++i) {
+        NSData *ipv6Address = [buffer dataAtOffset:offset length:16];
+        const uint16_t port = [buffer uint16AtOffset:(offset + 16)];
+        const uint64_t services = [buffer uint64AtOffset:(offset + 18)];
+        const uint32_t timestamp = [buffer uint32AtOffset:(offset + 26)];
+        
+        WSAddressManagerEntry *entry = [[WSAddressManagerEntry alloc] init];
+        entry.address = [[WSNetworkAddress alloc] initWithTimestamp:timestamp services:services ipv6Address:ipv6Address port:port];
+        entry.isTried = ([buffer uint8AtOffset:(offset + 30)] != 0);
+        entry.lastAttempt = [buffer uint32AtOffset:(offset + 31)];
+        entry.lastSuccess = [buffer uint32AtOffset:(offset + 35)];
+        entry.attempts = [buffer uint32AtOffset:(offset + 39)];
+        entry.successes = [buffer uint32AtOffset:(offset + 43)];
+        self.lastSuccess = MAX(self.lastSuccess, entry.lastSuccess);
+        const uint32_t pingTime = [buffer uint32AtOffset:(offset + 47)];
+        if (pingTime != WSAddressManagerUnknownPingTime) {
+            entry.pingTime = pingTime / 1000.0;
+        }
+        offset += WSAddressManagerEntryLength;
+        
+        if (!entry.address.host || self.entriesByHost[entry.address.host]) {
+            continue;
+        }
+        [self insertEntry:entry];
+    }
+    return YES;
+}
+
+// network group is /16 for IPv4 and /32 for IPv6, each group spans a few buckets at most
+- (NSMutableArray *)bucketForEntry:(WSAddressManagerEntry *)entry
+{
+    NSParameterAssert(entry);
+    
+    const uint8_t *bytes = entry.address.ipv6Address.bytes;
+    const BOOL isIPv4 = (entry.address.ipv4Address > 0);
+    const uint8_t *group = (isIPv4 ? bytes + 12 : bytes);
+    const size_t groupLength = (isIPv4 ? 2 : 4);
+    
+    const uint64_t key = (entry.isTried ? (self.key ^ WSAddressManagerTriedSalt) : self.key);
+    const uint64_t slot = WSAddressManagerHash(key, bytes, 16) % WSAddressManagerBucketsPerGroup;
+    uint64_t hash = WSAddressManagerHash(key, group, groupLength);
+    hash = WSAddressManagerHash(hash, &slot, sizeof(slot));
+    
+    NSArray *buckets = (entry.isTried ? self.triedBuckets : self.untriedBuckets);
+    return buckets[(NSUInteger)(hash % buckets.count)];
+}
+
+// full tried buckets demote their worst entry, full untried buckets drop it
+- (void)insertEntry:(WSAddressManagerEntry *)entry
+{
+    NSParameterAssert(entry);
+    
+    NSMutableArray *bucket = [self bucketForEntry:entry];
+    if (bucket.count >= WSAddressManagerBucketSize) {
+        WSAddressManagerEntry *worstEntry = [self worstEntryInBucket:bucket];
+        [self removeEntry:worstEntry];
+        if (worstEntry.isTried) {
+            worstEntry.isTried = NO;
+            [self insertEntry:worstEntry];
+        }
+    }
+    
+    [bucket addObject:entry];
+    self.entriesByHost[entry.address.host] = entry;
+    if (entry.isTried) {
+        ++self.triedCount;
+    }
+}
+
+- (void)removeEntry:(WSAddressManagerEntry *)entry
+{
+    NSParameterAssert(entry);
+    
+    [[self bucketForEntry:entry] removeObjectIdenticalTo:entry];
+    [self.entriesByHost removeObjectForKey:entry.address.host];
+    if (entry.isTried) {
+        --self.triedCount;
+    }
+}
+
+- (WSAddressManagerEntry *)worstEntryInBucket:(NSArray *)bucket
+{
+    NSParameterAssert(bucket.count > 0);
+    
+    const uint32_t now = WSCurrentTimestamp();
+    
+    WSAddressManagerEntry *worstEntry = nil;
+    for (WSAddressManagerEntry *entry in bucket) {
+        if ([entry isTerribleAtTimestamp:now]) {
+            return entry;
+        }
+        
+        // tried by last success, untried by last seen
+        const uint32_t time = (entry.isTried ? entry.lastSuccess : entry.address.timestamp);
+        const uint32_t worstTime = (worstEntry.isTried ? worstEntry.lastSuccess : worstEntry.address.timestamp);
+        if (!worstEntry || (time < worstTime)) {
+            worstEntry = entry;
+        }
+    }
+    return worstEntry;
+}
+
+@end
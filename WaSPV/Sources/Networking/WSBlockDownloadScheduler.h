@@ -0,0 +1,62 @@
+//
+//  WSBlockDownloadScheduler.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+@class WSHash256;
+@class WSFilteredBlock;
+
+//
+// splits announced block ids into windows assigned to multiple peers,
+// then hands completed blocks back in announcement (chain) order
+//
+// a window is only completed by the peer it was assigned to, windows of
+// failed or idle (no progress) peers are released for reassignment
+//
+// thread-safe: no
+//
+@interface WSBlockDownloadScheduler : NSObject
+
+@property (nonatomic, assign) NSUInteger windowSize;                // 100
+@property (nonatomic, assign) NSUInteger maxWindowsPerPeer;         // 2
+@property (nonatomic, assign) NSUInteger maxBufferedBlocks;         // 2000
+
+- (NSUInteger)numberOfPendingBlocks;
+- (NSUInteger)numberOfWindowsForPeer:(id)peer;
+- (BOOL)isScheduledBlockId:(WSHash256 *)blockId;
+
+- (void)enqueueBlockIds:(NSArray *)blockIds; // WSHash256, in chain order
+- (NSArray *)assignWindowToPeer:(id)peer atTime:(NSTimeInterval)time; // WSHash256, nil if none
+- (BOOL)completeFilteredBlock:(WSFilteredBlock *)filteredBlock transactions:(NSOrderedSet *)transactions fromPeer:(id)peer atTime:(NSTimeInterval)time;
+- (NSUInteger)dequeueCompletedBlocksWithHandler:(void (^)(WSFilteredBlock *filteredBlock, NSOrderedSet *transactions, id peer))handler;
+
+- (NSUInteger)releaseWindowsOfPeer:(id)peer;
+- (NSSet *)releaseWindowsIdleSince:(NSTimeInterval)time; // peers
+- (void)requeueAllBlocks;
+- (void)reset;
+
+@end
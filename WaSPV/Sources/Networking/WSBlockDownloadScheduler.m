@@ -0,0 +1,277 @@
+//
+//  WSBlockDownloadScheduler.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSBlockDownloadScheduler.h"
+#import "WSHash256.h"
+#import "WSFilteredBlock.h"
+#import "WSBlockHeader.h"
+#import "WSConfig.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+@interface WSBlockDownloadWindow : NSObject
+
+@property (nonatomic, strong) id peer;
+@property (nonatomic, strong) NSMutableOrderedSet *pendingBlockIds;    // WSHash256
+@property (nonatomic, assign) NSTimeInterval lastActivityTime;  // assignment or last completed block
+
+@end
+
+@implementation WSBlockDownloadWindow
+
+@end
+
+#pragma mark -
+
+@interface WSBlockDownloadScheduler ()
+
+@property (nonatomic, strong) NSMutableOrderedSet *blockIds;            // WSHash256, chain order, not yet dequeued
+@property (nonatomic, strong) NSMutableOrderedSet *unassignedBlockIds;  // WSHash256, chain order
+@property (nonatomic, strong) NSMutableArray *windows;                  // WSBlockDownloadWindow
+@property (nonatomic, strong) NSMutableDictionary *windowsByBlockId;    // WSHash256 -> WSBlockDownloadWindow
+@property (nonatomic, strong) NSMutableDictionary *completedBlocks;     // WSHash256 -> WSFilteredBlock
+@property (nonatomic, strong) NSMutableDictionary *completedTransactions; // WSHash256 -> NSOrderedSet
+@property (nonatomic, strong) NSMutableDictionary *completedPeers;      // WSHash256 -> id
+
+- (void)releaseWindow:(WSBlockDownloadWindow *)window;
+- (void)sortUnassignedBlockIds;
+
+@end
+
+@implementation WSBlockDownloadScheduler
+
+- (instancetype)init
+{
+    if ((self = [super init])) {
+        self.windowSize = WSBlockDownloadSchedulerDefaultWindowSize;
+        self.maxWindowsPerPeer = WSBlockDownloadSchedulerDefaultMaxWindows;
+        self.maxBufferedBlocks = WSBlockDownloadSchedulerDefaultMaxBuffered;
+
+        self.blockIds = [[NSMutableOrderedSet alloc] init];
+        self.unassignedBlockIds = [[NSMutableOrderedSet alloc] init];
+        self.windows = [[NSMutableArray alloc] init];
+        self.windowsByBlockId = [[NSMutableDictionary alloc] init];
+        self.completedBlocks = [[NSMutableDictionary alloc] init];
+        self.completedTransactions = [[NSMutableDictionary alloc] init];
+        self.completedPeers = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (NSUInteger)numberOfPendingBlocks
+{
+    return self.blockIds.count;
+}
+
+- (NSUInteger)numberOfWindowsForPeer:(id)peer
+{
+    NSParameterAssert(peer);
+
+    NSUInteger count = 0;
+    for (WSBlockDownloadWindow *window in self.windows) {
+        if (window.peer == peer) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+- (BOOL)isScheduledBlockId:(WSHash256 *)blockId
+{
+    NSParameterAssert(blockId);
+
+    return [self.blockIds containsObject:blockId];
+}
+
+- (void)enqueueBlockIds:(NSArray *)blockIds
+{
+    NSParameterAssert(blockIds);
+
+    for (WSHash256 *blockId in blockIds) {
+        if ([self.blockIds containsObject:blockId]) {
+            continue;
+        }
+        [self.blockIds addObject:blockId];
+        [self.unassignedBlockIds addObject:blockId];
+    }
+}
+
+- (NSArray *)assignWindowToPeer:(id)peer atTime:(NSTimeInterval)time
+{
+    NSParameterAssert(peer);
+
+    if ((self.unassignedBlockIds.count == 0) || ([self numberOfWindowsForPeer:peer] >= self.maxWindowsPerPeer)) {
+        return nil;
+    }
+
+    // bound the reorder buffer, don't run too far ahead of the next block to dequeue
+    const NSUInteger firstIndex = [self.blockIds indexOfObject:self.unassignedBlockIds.firstObject];
+    if (firstIndex >= self.maxBufferedBlocks) {
+        return nil;
+    }
+    const NSUInteger length = MIN(MIN(self.windowSize, self.unassignedBlockIds.count), self.maxBufferedBlocks - firstIndex);
+
+    NSArray *windowBlockIds = [self.unassignedBlockIds.array subarrayWithRange:NSMakeRange(0, length)];
+    [self.unassignedBlockIds removeObjectsInRange:NSMakeRange(0, length)];
+
+    WSBlockDownloadWindow *window = [[WSBlockDownloadWindow alloc] init];
+    window.peer = peer;
+    window.pendingBlockIds = [[NSMutableOrderedSet alloc] initWithArray:windowBlockIds];
+    window.lastActivityTime = time;
+    [self.windows addObject:window];
+    for (WSHash256 *blockId in windowBlockIds) {
+        self.windowsByBlockId[blockId] = window;
+    }
+    return windowBlockIds;
+}
+
+- (BOOL)completeFilteredBlock:(WSFilteredBlock *)filteredBlock transactions:(NSOrderedSet *)transactions fromPeer:(id)peer atTime:(NSTimeInterval)time
+{
+    NSParameterAssert(filteredBlock);
+    NSParameterAssert(transactions);
+    NSParameterAssert(peer);
+
+    WSHash256 *blockId = filteredBlock.header.blockId;
+    WSBlockDownloadWindow *window = self.windowsByBlockId[blockId];
+    if (!window || (window.peer != peer)) {
+        DDLogDebug(@"Drop filtered block %@ from %@ (not assigned)", blockId, peer);
+        return NO;
+    }
+
+    [self.windowsByBlockId removeObjectForKey:blockId];
+    [window.pendingBlockIds removeObject:blockId];
+    window.lastActivityTime = time;
+    if (window.pendingBlockIds.count == 0) {
+        [self.windows removeObject:window];
+    }
+
+    self.completedBlocks[blockId] = filteredBlock;
+    self.completedTransactions[blockId] = transactions;
+    self.completedPeers[blockId] = peer;
+    return YES;
+}
+
+- (NSUInteger)dequeueCompletedBlocksWithHandler:(void (^)(WSFilteredBlock *, NSOrderedSet *, id))handler
+{
+    NSParameterAssert(handler);
+
+    NSUInteger count = 0;
+    while (self.blockIds.count > 0) {
+        WSHash256 *blockId = self.blockIds.firstObject;
+        WSFilteredBlock *filteredBlock = self.completedBlocks[blockId];
+        if (!filteredBlock) {
+            break;
+        }
+        NSOrderedSet *transactions = self.completedTransactions[blockId];
+        id peer = self.completedPeers[blockId];
+
+        [self.blockIds removeObjectAtIndex:0];
+        [self.completedBlocks removeObjectForKey:blockId];
+        [self.completedTransactions removeObjectForKey:blockId];
+        [self.completedPeers removeObjectForKey:blockId];
+
+        handler(filteredBlock, transactions, peer);
+        ++count;
+    }
+    return count;
+}
+
+- (NSUInteger)releaseWindowsOfPeer:(id)peer
+{
+    NSParameterAssert(peer);
+
+    NSUInteger count = 0;
+    for (WSBlockDownloadWindow *window in [self.windows copy]) {
+        if (window.peer == peer) {
+            [self releaseWindow:window];
+            ++count;
+        }
+    }
+    if (count > 0) {
+        [self sortUnassignedBlockIds];
+    }
+    return count;
+}
+
+- (NSSet *)releaseWindowsIdleSince:(NSTimeInterval)time
+{
+    NSMutableSet *peers = [[NSMutableSet alloc] init];
+    for (WSBlockDownloadWindow *window in [self.windows copy]) {
+        if (window.lastActivityTime < time) {
+            [peers addObject:window.peer];
+            [self releaseWindow:window];
+        }
+    }
+    if (peers.count > 0) {
+        [self sortUnassignedBlockIds];
+    }
+    return peers;
+}
+
+- (void)requeueAllBlocks
+{
+    [self.windows removeAllObjects];
+    [self.windowsByBlockId removeAllObjects];
+    [self.completedBlocks removeAllObjects];
+    [self.completedTransactions removeAllObjects];
+    [self.completedPeers removeAllObjects];
+
+    self.unassignedBlockIds = [self.blockIds mutableCopy];
+}
+
+- (void)reset
+{
+    [self requeueAllBlocks];
+    [self.blockIds removeAllObjects];
+    [self.unassignedBlockIds removeAllObjects];
+}
+
+#pragma mark Helpers
+
+- (void)releaseWindow:(WSBlockDownloadWindow *)window
+{
+    NSParameterAssert(window);
+
+    for (WSHash256 *blockId in window.pendingBlockIds) {
+        [self.windowsByBlockId removeObjectForKey:blockId];
+        [self.unassignedBlockIds addObject:blockId];
+    }
+    [self.windows removeObject:window];
+}
+
+// released blocks go back in chain order, i.e. before later unassigned blocks
+- (void)sortUnassignedBlockIds
+{
+    NSOrderedSet *blockIds = self.blockIds;
+    [self.unassignedBlockIds sortUsingComparator:^NSComparisonResult(WSHash256 *blockId1, WSHash256 *blockId2) {
+        const NSUInteger index1 = [blockIds indexOfObject:blockId1];
+        const NSUInteger index2 = [blockIds indexOfObject:blockId2];
+        return ((index1 < index2) ? NSOrderedAscending : ((index1 > index2) ? NSOrderedDescending : NSOrderedSame));
+    }];
+}
+
+@end
@@ -0,0 +1,63 @@
+//
+//  WSBloomFilterTuner.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+//
+// picks the false positive rate minimizing the expected bytes transferred, i.e.
+// filter size (once per peer) plus false positive traffic over the blocks left
+//
+// rate estimates are corrected with the false positives observed on the
+// current filter (matched but irrelevant transactions)
+//
+// thread-safe: no
+//
+@interface WSBloomFilterTuner : NSObject
+
+@property (nonatomic, assign) double minFalsePositiveRate;  // WSPeerGroupDefaultBFRateMin
+@property (nonatomic, assign) double maxFalsePositiveRate;  // WSPeerGroupDefaultBFRateMin + WSPeerGroupDefaultBFRateDelta
+@property (nonatomic, assign) double lowPassRatio;          // WSPeerGroupDefaultBFLowPassRatio
+@property (nonatomic, assign) NSUInteger horizon;           // WSPeerGroupDefaultBFHorizon, blocks served by a filter once synced
+
++ (NSUInteger)filterSizeForElements:(NSUInteger)elements falsePositiveRate:(double)falsePositiveRate;
+
+- (instancetype)initWithTxsPerBlock:(NSUInteger)txsPerBlock;
+
+// filters
+- (double)falsePositiveRateForElements:(NSUInteger)elements blocksLeft:(NSUInteger)blocksLeft peers:(NSUInteger)peers;
+- (void)resetWithElements:(NSUInteger)elements falsePositiveRate:(double)falsePositiveRate;
+- (BOOL)shouldResetWithBlocksLeft:(NSUInteger)blocksLeft peers:(NSUInteger)peers;
+
+// observations
+- (void)addBlockWithTxCount:(NSUInteger)txCount matchedTxCount:(NSUInteger)matchedTxCount relevantTxCount:(NSUInteger)relevantTxCount matchedBytes:(NSUInteger)matchedBytes;
+- (NSUInteger)observedBlocks;
+- (double)observedFalsePositiveRate;    // current filter
+- (double)falsePositiveMultiplier;      // observed / nominal rate
+- (double)averageTxsPerBlock;
+- (double)averageTxSize;
+
+@end
@@ -0,0 +1,192 @@
+//
+//  WSBloomFilterTuner.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSBloomFilterTuner.h"
+#import "WSBIP37.h"
+#import "WSConfig.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+static const double     WSBloomFilterTunerDefaultTxSize         = 250.0;
+static const NSUInteger WSBloomFilterTunerMinObservedBlocks     = 10;
+static const double     WSBloomFilterTunerMinMultiplier         = 0.25;
+static const double     WSBloomFilterTunerMaxMultiplier         = 4.0;
+static const double     WSBloomFilterTunerResetMargin           = 0.8;      // new filter must save at least 20%
+
+@interface WSBloomFilterTuner ()
+
+@property (nonatomic, assign) NSUInteger elements;
+@property (nonatomic, assign) double falsePositiveRate;
+@property (nonatomic, assign) NSUInteger observedBlocks;
+@property (nonatomic, assign) NSUInteger observedFalsePositives;
+@property (nonatomic, assign) NSUInteger observedIrrelevantTxs;
+@property (nonatomic, assign) double falsePositiveMultiplier;
+@property (nonatomic, assign) double averageTxsPerBlock;
+@property (nonatomic, assign) double averageTxSize;
+
+- (double)expectedBytesForElements:(NSUInteger)elements falsePositiveRate:(double)falsePositiveRate blocks:(NSUInteger)blocks peers:(NSUInteger)peers;
+
+@end
+
+@implementation WSBloomFilterTuner
+
+// same as WSBIP37Filter
++ (NSUInteger)filterSizeForElements:(NSUInteger)elements falsePositiveRate:(double)falsePositiveRate
+{
+    NSUInteger size = -1.0 / pow(M_LN2, 2) * elements * log(falsePositiveRate) / 8.0;
+    if (size < 1) {
+        size = 1;
+    }
+    else if (size > WSBIP37MaxFilterSize) {
+        size = WSBIP37MaxFilterSize;
+    }
+    return size;
+}
+
+- (instancetype)init
+{
+    WSExceptionRaiseUnsupported(@"Use initWithTxsPerBlock:");
+    return nil;
+}
+
+- (instancetype)initWithTxsPerBlock:(NSUInteger)txsPerBlock
+{
+    WSExceptionCheckIllegal(txsPerBlock > 0, @"Non-positive txsPerBlock");
+    
+    if ((self = [super init])) {
+        self.minFalsePositiveRate = WSPeerGroupDefaultBFRateMin;
+        self.maxFalsePositiveRate = WSPeerGroupDefaultBFRateMin + WSPeerGroupDefaultBFRateDelta;
+        self.lowPassRatio = WSPeerGroupDefaultBFLowPassRatio;
+        self.horizon = WSPeerGroupDefaultBFHorizon;
+
+        self.falsePositiveMultiplier = 1.0;
+        self.averageTxsPerBlock = txsPerBlock;
+        self.averageTxSize = WSBloomFilterTunerDefaultTxSize;
+        [self resetWithElements:0 falsePositiveRate:self.minFalsePositiveRate];
+    }
+    return self;
+}
+
+//
+// bytes(p) = size(p) * peers + k * p * txs * txSize * blocks
+// size(p)  = -elements * ln(p) / (8 * ln2^2)
+//
+// d(bytes)/dp = 0 -> p = elements * peers / (8 * ln2^2 * k * txs * txSize * blocks)
+//
+- (double)falsePositiveRateForElements:(NSUInteger)elements blocksLeft:(NSUInteger)blocksLeft peers:(NSUInteger)peers
+{
+    const NSUInteger blocks = blocksLeft + self.horizon;
+    const double traffic = self.falsePositiveMultiplier * self.averageTxsPerBlock * self.averageTxSize * blocks;
+    
+    double rate = self.maxFalsePositiveRate;
+    if (traffic > 0.0) {
+        rate = MAX(elements, 1) * MAX(peers, 1) / (8.0 * pow(M_LN2, 2) * traffic);
+    }
+
+    // a lower rate would only be wasted on a truncated filter
+    if (elements > 0) {
+        const double minSizedRate = exp(-8.0 * WSBIP37MaxFilterSize * pow(M_LN2, 2) / elements);
+        rate = MAX(rate, minSizedRate);
+    }
+    return MIN(MAX(rate, self.minFalsePositiveRate), self.maxFalsePositiveRate);
+}
+
+- (void)resetWithElements:(NSUInteger)elements falsePositiveRate:(double)falsePositiveRate
+{
+    WSExceptionCheckIllegal(falsePositiveRate > 0.0, @"Non-positive falsePositiveRate");
+    
+    self.elements = elements;
+    self.falsePositiveRate = falsePositiveRate;
+    self.observedBlocks = 0;
+    self.observedFalsePositives = 0;
+    self.observedIrrelevantTxs = 0;
+}
+
+// current filter is already paid, a new one must save more than it costs
+- (BOOL)shouldResetWithBlocksLeft:(NSUInteger)blocksLeft peers:(NSUInteger)peers
+{
+    if (self.observedBlocks < WSBloomFilterTunerMinObservedBlocks) {
+        return NO;
+    }
+    
+    const NSUInteger blocks = blocksLeft + self.horizon;
+    const double currentBytes = self.observedFalsePositiveRate * self.averageTxsPerBlock * self.averageTxSize * blocks;
+    
+    const double rate = [self falsePositiveRateForElements:self.elements blocksLeft:blocksLeft peers:peers];
+    const double resetBytes = [self expectedBytesForElements:self.elements falsePositiveRate:rate blocks:blocks peers:peers];
+    
+    return (resetBytes < WSBloomFilterTunerResetMargin * currentBytes);
+}
+
+- (void)addBlockWithTxCount:(NSUInteger)txCount matchedTxCount:(NSUInteger)matchedTxCount relevantTxCount:(NSUInteger)relevantTxCount matchedBytes:(NSUInteger)matchedBytes
+{
+    WSExceptionCheckIllegal(matchedTxCount <= txCount, @"More matched than total transactions (%u > %u)", matchedTxCount, txCount);
+    WSExceptionCheckIllegal(relevantTxCount <= matchedTxCount, @"More relevant than matched transactions (%u > %u)", relevantTxCount, matchedTxCount);
+
+    const double ratio = self.lowPassRatio;
+    self.averageTxsPerBlock = (1.0 - ratio) * self.averageTxsPerBlock + ratio * txCount;
+    if (matchedTxCount > 0) {
+        self.averageTxSize = (1.0 - ratio) * self.averageTxSize + ratio * matchedBytes / matchedTxCount;
+    }
+
+    ++self.observedBlocks;
+    self.observedFalsePositives += matchedTxCount - relevantTxCount;
+    self.observedIrrelevantTxs += txCount - relevantTxCount;
+    
+    // persists across resets, mismatch with the model is not filter specific
+    if ((self.observedBlocks >= WSBloomFilterTunerMinObservedBlocks) && (self.observedIrrelevantTxs > 0)) {
+        const double multiplier = self.observedFalsePositiveRate / self.falsePositiveRate;
+        self.falsePositiveMultiplier = MIN(MAX(multiplier, WSBloomFilterTunerMinMultiplier), WSBloomFilterTunerMaxMultiplier);
+    }
+}
+
+- (double)observedFalsePositiveRate
+{
+    if (self.observedIrrelevantTxs == 0) {
+        return self.falsePositiveRate;
+    }
+    return (double)self.observedFalsePositives / self.observedIrrelevantTxs;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"{rate=%f, observed=%f (%u blocks), multiplier=%.2f, txs/block=%.1f, txSize=%.1f}",
+            self.falsePositiveRate, self.observedFalsePositiveRate, self.observedBlocks,
+            self.falsePositiveMultiplier, self.averageTxsPerBlock, self.averageTxSize];
+}
+
+#pragma mark Helpers
+
+- (double)expectedBytesForElements:(NSUInteger)elements falsePositiveRate:(double)falsePositiveRate blocks:(NSUInteger)blocks peers:(NSUInteger)peers
+{
+    const double filterBytes = [[self class] filterSizeForElements:elements falsePositiveRate:falsePositiveRate] * MAX(peers, 1);
+    const double trafficBytes = self.falsePositiveMultiplier * falsePositiveRate * self.averageTxsPerBlock * self.averageTxSize * blocks;
+
+    return filterBytes + trafficBytes;
+}
+
+@end
@@ -35,7 +35,8 @@
 @protocol WSConnection <NSObject>
 
 - (void)submitBlock:(void (^)())block;
-- (void)writeMessage:(id<WSMessage>)message; // MUST be executed from within submitBlock:
+- (BOOL)writeMessage:(id<WSMessage>)message; // MUST be executed from within submitBlock:, NO if output is above high-water mark
+- (NSUInteger)queuedBytes; // pending output
 - (void)disconnectWithError:(NSError *)error;
 
 @end
@@ -45,6 +46,7 @@
 - (void)setConnection:(id<WSConnection>)connection;
 - (void)openedConnectionToHost:(NSString *)host port:(uint16_t)port queue:(dispatch_queue_t)queue;
 - (void)processMessage:(id<WSMessage>)message;
+- (void)finishedProcessingMessages; // after all messages parsed from last read
 - (void)closedConnectionWithError:(NSError *)error;
 
 @end
@@ -31,22 +31,28 @@
 @protocol WSConnectionProcessor;
 @protocol WSConnectionHandlerDelegate;
 
-@interface WSConnectionHandler : NSObject <NSStreamDelegate>
+@interface WSConnectionHandler : NSObject
 
 @property (nonatomic, weak) id<WSConnectionHandlerDelegate> delegate;
 
-- (instancetype)initWithParameters:(id<WSParameters>)parameters host:(NSString *)host port:(uint16_t)port processor:(id<WSConnectionProcessor>)processor;
+// all I/O and processor callbacks are serialized on the given (possibly shared) queue
+- (instancetype)initWithParameters:(id<WSParameters>)parameters host:(NSString *)host port:(uint16_t)port processor:(id<WSConnectionProcessor>)processor queue:(dispatch_queue_t)queue;
 - (NSString *)host;
 - (uint16_t)port;
 - (id<WSConnectionProcessor>)processor;
+- (dispatch_queue_t)queue;
 
 - (void)connectWithTimeout:(NSTimeInterval)timeout error:(NSError **)error;
+- (BOOL)isConnecting; // started, socket not open yet
 - (BOOL)isConnected;
 - (void)disconnectWithError:(NSError *)error;
 
 - (void)runBlock:(void (^)())block;
-- (void)unsafeEnqueueData:(NSData *)data;
+- (BOOL)unsafeEnqueueData:(NSData *)data; // NO if output is above high-water mark
 - (void)unsafeFlush;
+- (NSUInteger)queuedBytes;
+- (uint64_t)totalQueuedBytes;
+- (uint64_t)totalWrittenBytes;
 - (NSString *)identifier;
 
 @end
@@ -25,106 +25,155 @@
 //  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#import <sys/socket.h>
+#import <sys/uio.h>
+#import <netdb.h>
+#import <fcntl.h>
+#import <unistd.h>
+
 #import "WSConnectionHandler.h"
 #import "WSConnection.h"
 #import "WSProtocolDeserializer.h"
+#import "WSConfig.h"
 #import "WSErrors.h"
 #import "WSMacros.h"
 
+static const NSUInteger WSConnectionHandlerReadChunkLength     = 64 * 1024;
+static const int        WSConnectionHandlerMaxWriteVectors      = 64;
+static const NSUInteger WSConnectionHandlerMaxReadPerEvent      = 256 * 1024;
+
 @interface WSConnectionHandler ()
 
 @property (nonatomic, strong) id<WSParameters> parameters;
 @property (nonatomic, strong) NSString *host;
 @property (nonatomic, assign) uint16_t port;
 @property (nonatomic, weak) id<WSConnectionProcessor> processor;
+@property (nonatomic, strong) dispatch_queue_t queue;
 @property (nonatomic, strong) NSString *identifier;
 
-@property (nonatomic, strong) dispatch_queue_t queue;
-@property (nonatomic, strong) NSRunLoop *runLoop;
-@property (nonatomic, strong) NSInputStream *inputStream;
-@property (nonatomic, strong) NSOutputStream *outputStream;
+// queue
+@property (nonatomic, assign) int socket;
+@property (nonatomic, strong) dispatch_source_t readSource;
+@property (nonatomic, strong) dispatch_source_t writeSource;
+@property (nonatomic, assign) BOOL isWriteSourceSuspended;
 @property (nonatomic, strong) WSProtocolDeserializer *inputDeserializer;
-@property (nonatomic, strong) NSMutableData *outputBuffer;
+@property (nonatomic, strong) NSMutableArray *outputBuffers;   // NSData
+@property (nonatomic, assign) NSUInteger outputOffset;          // into first buffer
+
+// any queue
+@property (atomic, assign) BOOL isStarted;
+@property (atomic, assign) BOOL didOpen;
+@property (atomic, assign) BOOL isDisconnected;
+@property (atomic, assign) NSUInteger queuedBytes;
+@property (atomic, assign) uint64_t totalQueuedBytes;
+@property (atomic, assign) uint64_t totalWrittenBytes;
+
+- (void)unsafeOpenSocketWithAddresses:(struct addrinfo *)addresses;
+- (void)unsafeHandleOpen;
+- (void)unsafeHandleReadable;
+- (void)unsafeReadAndProcessMessages;
+- (void)unsafeHandleWritable;
+- (void)unsafeCloseWithError:(NSError *)error;
+- (void)unsafeSuspendWriteSource;
+- (void)unsafeResumeWriteSource;
 
 @end
 
 @implementation WSConnectionHandler
 
-- (instancetype)initWithParameters:(id<WSParameters>)parameters host:(NSString *)host port:(uint16_t)port processor:(id<WSConnectionProcessor>)processor
+- (instancetype)init
+{
+    WSExceptionRaiseUnsupported(@"Use initWithParameters:host:port:processor:queue:");
+    return nil;
+}
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters host:(NSString *)host port:(uint16_t)port processor:(id<WSConnectionProcessor>)processor queue:(dispatch_queue_t)queue
 {
     WSExceptionCheckIllegal(parameters != nil, @"Nil parameters");
     WSExceptionCheckIllegal(host != nil, @"Nil host");
     WSExceptionCheckIllegal(port > 0, @"Non-positive port");
+    WSExceptionCheckIllegal(queue != NULL, @"NULL queue");
     
     if ((self = [super init])) {
         self.parameters = parameters;
         self.host = host;
         self.port = port;
         self.processor = processor;
+        self.queue = queue;
         self.identifier = [NSString stringWithFormat:@"%@:%u", self.host, self.port];
+        self.socket = -1;
     }
     return self;
 }
 
-- (void)dealloc
-{
-    [NSObject cancelPreviousPerformRequestsWithTarget:self];
-}
-
 - (void)connectWithTimeout:(NSTimeInterval)timeout error:(NSError *__autoreleasing *)error
 {
-    if (self.queue) {
-        return;
+    @synchronized (self) {
+        if (self.isStarted) {
+            return;
+        }
+        self.isStarted = YES;
     }
     
-    NSString *label = [NSString stringWithFormat:@"%@-%@", [self class], self.identifier];
-    
-    self.queue = dispatch_queue_create(label.UTF8String, NULL);
     self.inputDeserializer = [[WSProtocolDeserializer alloc] initWithParameters:self.parameters host:self.host port:self.port];
-    self.outputBuffer = [[NSMutableData alloc] initWithCapacity:10240];
-    
-    dispatch_async(self.queue, ^{
-        self.runLoop = [NSRunLoop currentRunLoop];
-        
-        NSInputStream *inputStream;
-        NSOutputStream *outputStream;
-        [NSStream getStreamsToHostWithName:self.host port:self.port inputStream:&inputStream outputStream:&outputStream];
-        
-        self.inputStream = inputStream;
-        self.outputStream = outputStream;
-        self.inputStream.delegate = self;
-        self.outputStream.delegate = self;
-        
-        [self.inputStream scheduleInRunLoop:self.runLoop forMode:NSRunLoopCommonModes];
-        [self.outputStream scheduleInRunLoop:self.runLoop forMode:NSRunLoopCommonModes];
-        
-        [self performSelector:@selector(disconnectWithError:) withObject:WSErrorMake(WSErrorCodeConnectionTimeout, @"Connection timed out") afterDelay:timeout];
-        
-        [self.inputStream open];
-        [self.outputStream open];
-        
-        [self.runLoop run];
+    self.outputBuffers = [[NSMutableArray alloc] init];
+
+    __weak WSConnectionHandler *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC)), self.queue, ^{
+        WSConnectionHandler *strongSelf = weakSelf;
+        if (strongSelf && !strongSelf.didOpen) {
+            [strongSelf unsafeCloseWithError:WSErrorMake(WSErrorCodeConnectionTimeout, @"Connection timed out")];
+        }
+    });
+
+    // name resolution is blocking, keep it off the shared queue
+    NSString *host = self.host;
+    NSString *service = [NSString stringWithFormat:@"%u", self.port];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+
+        struct addrinfo *addresses = NULL;
+        const int result = getaddrinfo(host.UTF8String, service.UTF8String, &hints, &addresses);
+
+        WSConnectionHandler *strongSelf = weakSelf;
+        if (!strongSelf) {
+            if (result == 0) {
+                freeaddrinfo(addresses);
+            }
+            return;
+        }
+        dispatch_async(strongSelf.queue, ^{
+            WSConnectionHandler *handler = weakSelf;
+            if (result != 0) {
+                [handler unsafeCloseWithError:WSErrorMake(WSErrorCodeNetworking, @"Unable to resolve host (%s)", gai_strerror(result))];
+                return;
+            }
+            if (handler) {
+                [handler unsafeOpenSocketWithAddresses:addresses];
+            }
+            freeaddrinfo(addresses);
+        });
     });
 }
 
+- (BOOL)isConnecting
+{
+    return (self.isStarted && !self.didOpen && !self.isDisconnected);
+}
+
 - (BOOL)isConnected
 {
-    return (self.queue != NULL);
+    return (self.didOpen && !self.isDisconnected);
 }
 
 - (void)disconnectWithError:(NSError *)error
 {
     [self runBlock:^{
-        [NSObject cancelPreviousPerformRequestsWithTarget:self];
-
-        [self.inputStream close];
-        [self.outputStream close];
-        [self.inputStream removeFromRunLoop:self.runLoop forMode:NSRunLoopCommonModes];
-        [self.outputStream removeFromRunLoop:self.runLoop forMode:NSRunLoopCommonModes];
-        
-        [self.delegate connectionHandler:self didDisconnectWithError:error];
-        [self.processor closedConnectionWithError:error];
-        self.queue = NULL;
+        [self unsafeCloseWithError:error];
     }];
 }
 
@@ -132,12 +181,7 @@
 {
     NSParameterAssert(block);
     
-    CFRunLoopPerformBlock([self.runLoop getCFRunLoop], kCFRunLoopCommonModes, ^{
-        block();
-        
-        CFRunLoopStop([self.runLoop getCFRunLoop]);
-    });
-    CFRunLoopWakeUp([self.runLoop getCFRunLoop]);
+    dispatch_async(self.queue, block);
 }
 
 - (NSString *)description
@@ -147,82 +191,275 @@
 
 #pragma mark Helpers
 
-- (void)unsafeEnqueueData:(NSData *)data
+- (BOOL)unsafeEnqueueData:(NSData *)data
 {
     NSParameterAssert(data);
     
-    [self.outputBuffer appendData:data];
+    if (data.length == 0) {
+        return (self.queuedBytes < WSConnectionOutputHighWaterMark);
+    }
+
+    // buffers are queued as they are, never coalesced
+    [self.outputBuffers addObject:data];
+    self.queuedBytes += data.length;
+    self.totalQueuedBytes += data.length;
+
+    return (self.queuedBytes < WSConnectionOutputHighWaterMark);
 }
 
 - (void)unsafeFlush
 {
-    while ((self.outputBuffer.length > 0) && [self.outputStream hasSpaceAvailable]) {
-        const NSInteger written = [self.outputStream write:self.outputBuffer.bytes maxLength:self.outputBuffer.length];
-        if (written > 0) {
-            [self.outputBuffer replaceBytesInRange:NSMakeRange(0, written) withBytes:NULL length:0];
+    if (!self.didOpen || self.isDisconnected) {
+        return;
+    }
+    while (self.outputBuffers.count > 0) {
+        struct iovec vectors[WSConnectionHandlerMaxWriteVectors];
+        int count = 0;
+        for (NSData *buffer in self.outputBuffers) {
+            if (count == WSConnectionHandlerMaxWriteVectors) {
+                break;
+            }
+            const NSUInteger offset = ((count == 0) ? self.outputOffset : 0);
+            vectors[count].iov_base = (uint8_t *)buffer.bytes + offset;
+            vectors[count].iov_len = buffer.length - offset;
+            ++count;
+        }
+
+        const ssize_t written = writev(self.socket, vectors, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                break;
+            }
+            [self unsafeCloseWithError:[NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil]];
+            return;
+        }
+        self.queuedBytes -= written;
+        self.totalWrittenBytes += written;
+
+        // pop fully written buffers, keep offset into the partial one
+        NSUInteger remaining = written;
+        while (remaining > 0) {
+            NSData *buffer = self.outputBuffers[0];
+            const NSUInteger available = buffer.length - self.outputOffset;
+            if (remaining < available) {
+                self.outputOffset += remaining;
+                break;
+            }
+            remaining -= available;
+            [self.outputBuffers removeObjectAtIndex:0];
+            self.outputOffset = 0;
         }
     }
+
+    // only wake up on writability while there is pending output
+    if (self.outputBuffers.count > 0) {
+        [self unsafeResumeWriteSource];
+    }
+    else {
+        [self unsafeSuspendWriteSource];
+    }
 }
 
-#pragma mark NSStreamDelegate
+#pragma mark Event loop (queue)
 
-- (void)stream:(NSStream *)aStream handleEvent:(NSStreamEvent)eventCode
+- (void)unsafeOpenSocketWithAddresses:(struct addrinfo *)addresses
 {
-    switch (eventCode) {
-        case NSStreamEventOpenCompleted: {
-//            DDLogDebug(@"Connected to %@", self);
-            
-            if (aStream == self.outputStream) {
-                [NSObject cancelPreviousPerformRequestsWithTarget:self];
+    NSParameterAssert(addresses);
 
-                [self.delegate connectionHandlerDidConnect:self];
-                [self.processor openedConnectionToHost:self.host port:self.port queue:self.queue];
-                [self unsafeFlush];
-            }
+    if (self.isDisconnected) {
+        return;
+    }
+
+    int fd = -1;
+    int lastError = 0;
+    for (struct addrinfo *address = addresses; address; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0) {
+            lastError = errno;
+            continue;
+        }
+
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+        if ((connect(fd, address->ai_addr, address->ai_addrlen) == 0) || (errno == EINPROGRESS)) {
             break;
         }
-        case NSStreamEventHasSpaceAvailable: {
-            if (aStream != self.outputStream) {
+        lastError = errno; // close() may overwrite it
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        [self unsafeCloseWithError:WSErrorMake(WSErrorCodeNetworking, @"Unable to open socket (%s)", strerror(lastError))];
+        return;
+    }
+    self.socket = fd;
+
+    // both sources share the socket, close it when the last one is cancelled
+    __block NSUInteger openSources = 2;
+    dispatch_block_t cancelHandler = ^{
+        if (--openSources == 0) {
+            close(fd);
+        }
+    };
+    
+    __weak WSConnectionHandler *weakSelf = self;
+
+    self.readSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, fd, 0, self.queue);
+    dispatch_source_set_event_handler(self.readSource, ^{
+        [weakSelf unsafeHandleReadable];
+    });
+    dispatch_source_set_cancel_handler(self.readSource, cancelHandler);
+
+    // first writability event completes the non-blocking connect
+    self.writeSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_WRITE, fd, 0, self.queue);
+    dispatch_source_set_event_handler(self.writeSource, ^{
+        [weakSelf unsafeHandleWritable];
+    });
+    dispatch_source_set_cancel_handler(self.writeSource, cancelHandler);
+
+    dispatch_resume(self.writeSource);
+}
+
+- (void)unsafeHandleOpen
+{
+    int socketError = 0;
+    socklen_t socketErrorLength = sizeof(socketError);
+    if (getsockopt(self.socket, SOL_SOCKET, SO_ERROR, &socketError, &socketErrorLength) < 0) {
+        socketError = errno;
+    }
+    if (socketError != 0) {
+        [self unsafeCloseWithError:[NSError errorWithDomain:NSPOSIXErrorDomain code:socketError userInfo:nil]];
+        return;
+    }
+
+//    DDLogDebug(@"Connected to %@", self);
+
+    self.didOpen = YES;
+    dispatch_resume(self.readSource);
+
+    [self.delegate connectionHandlerDidConnect:self];
+    [self.processor openedConnectionToHost:self.host port:self.port queue:self.queue];
+    [self unsafeFlush];
+}
+
+- (void)unsafeHandleReadable
+{
+    [self unsafeReadAndProcessMessages];
+
+    // processor may now deliver its batched output
+    [self.processor finishedProcessingMessages];
+}
+
+- (void)unsafeReadAndProcessMessages
+{
+    // read straight into the deserializer and parse every complete message after each read,
+    // yield to other peers on the shared queue once enough input was consumed (the read
+    // source fires again as long as the socket is still readable)
+    NSUInteger totalRead = 0;
+    while (!self.isDisconnected && (totalRead < WSConnectionHandlerMaxReadPerEvent)) {
+        NSUInteger available;
+        void *bytes = [self.inputDeserializer writableBytesWithMinimumLength:WSConnectionHandlerReadChunkLength available:&available];
+        const ssize_t actuallyRead = read(self.socket, bytes, available);
+        if (actuallyRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
                 return;
             }
-            [self unsafeFlush];
-            break;
+            [self unsafeCloseWithError:[NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil]];
+            return;
         }
-        case NSStreamEventHasBytesAvailable: {
-            if (aStream != self.inputStream) {
-                return;
+        if (actuallyRead == 0) {
+            [self unsafeCloseWithError:nil];
+            return;
+        }
+        [self.inputDeserializer didWriteBytesWithLength:actuallyRead];
+        totalRead += actuallyRead;
+        
+        while (!self.isDisconnected) {
+            NSError *error;
+            id<WSMessage> message = [self.inputDeserializer parseMessageWithError:&error];
+            if (message) {
+                [self.processor processMessage:message];
             }
-            while ([self.inputStream hasBytesAvailable]) {
-                NSError *error;
-                id<WSMessage> message = [self.inputDeserializer parseMessageFromStream:self.inputStream error:&error];
-                if (message) {
-                    [self.processor processMessage:message];
+            else {
+                if (!error) {
+                    break;
                 }
-                else {
-                    if (error) {
-                        DDLogError(@"%@ Error deserializing message: %@", self, error);
-                        if (error.code == WSErrorCodeMalformed) {
-                            [self disconnectWithError:error];
-                        }
-                        return;
-                    }
+                DDLogError(@"%@ Error deserializing message: %@", self, error);
+                if (error.code == WSErrorCodeMalformed) {
+                    [self unsafeCloseWithError:error];
+                    return;
                 }
             }
-            break;
         }
-        case NSStreamEventErrorOccurred: {
-            [self disconnectWithError:aStream.streamError];
-            break;
-        }
-        case NSStreamEventEndEncountered: {
-            [self disconnectWithError:nil];
-            break;
-        }
-        default: {
-            DDLogError(@"Unknown network stream eventCode %u from %@", (int)eventCode, self);
-            break;
+    }
+}
+
+- (void)unsafeHandleWritable
+{
+    if (self.isDisconnected) {
+        return;
+    }
+    if (!self.didOpen) {
+        [self unsafeHandleOpen];
+        return;
+    }
+    [self unsafeFlush];
+}
+
+- (void)unsafeCloseWithError:(NSError *)error
+{
+    if (self.isDisconnected) {
+        return;
+    }
+    self.isDisconnected = YES;
+
+    if (self.readSource) {
+        if (!self.didOpen) {
+            dispatch_resume(self.readSource);
         }
+        dispatch_source_cancel(self.readSource);
+        self.readSource = nil;
+    }
+    if (self.writeSource) {
+        [self unsafeResumeWriteSource];
+        dispatch_source_cancel(self.writeSource);
+        self.writeSource = nil;
+    }
+    self.socket = -1;
+    [self.inputDeserializer resetBuffers];
+    [self.outputBuffers removeAllObjects];
+    self.outputOffset = 0;
+    self.queuedBytes = 0;
+
+    [self.delegate connectionHandler:self didDisconnectWithError:error];
+    [self.processor closedConnectionWithError:error];
+    self.isStarted = NO;
+}
+
+- (void)unsafeSuspendWriteSource
+{
+    if (!self.writeSource || self.isWriteSourceSuspended) {
+        return;
+    }
+    dispatch_suspend(self.writeSource);
+    self.isWriteSourceSuspended = YES;
+}
+
+- (void)unsafeResumeWriteSource
+{
+    if (!self.writeSource || !self.isWriteSourceSuspended) {
+        return;
     }
+    dispatch_resume(self.writeSource);
+    self.isWriteSourceSuspended = NO;
 }
 
 @end
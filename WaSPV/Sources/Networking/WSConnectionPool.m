@@ -51,6 +51,7 @@
 @property (nonatomic, strong) id<WSParameters> parameters;
 @property (nonatomic, strong) NSMutableArray *handlers;                     // WSConnectionHandler
 @property (nonatomic, strong) NSMutableDictionary *handlersByIdentifier;    // NSString -> WSConnectionHandler
+@property (nonatomic, strong) dispatch_queue_t queue;                       // shared by all handlers
 
 - (WSConnectionHandler *)handlerForProcessor:(id<WSConnectionProcessor>)processor;
 - (void)tryDisconnectHandler:(WSConnectionHandler *)handler error:(NSError *)error;
@@ -75,6 +76,9 @@
         self.handlers = [[NSMutableArray alloc] init];
         self.handlersByIdentifier = [[NSMutableDictionary alloc] init];
         self.connectionTimeout = 5.0;
+
+        NSString *label = [NSString stringWithFormat:@"%@-%p", [self class], self];
+        self.queue = dispatch_queue_create(label.UTF8String, DISPATCH_QUEUE_SERIAL);
     }
     return self;
 }
@@ -93,7 +97,7 @@
             }
         }
         
-        handler = [[WSConnectionHandler alloc] initWithParameters:self.parameters host:host port:port processor:processor];
+        handler = [[WSConnectionHandler alloc] initWithParameters:self.parameters host:host port:port processor:processor queue:self.queue];
         handler.delegate = self;
         [self.handlers addObject:handler];
         self.handlersByIdentifier[handler.identifier] = handler;
@@ -156,7 +160,7 @@
     }
 }
 
-#pragma mark WSConnectionHandlerDelegate (handler queue)
+#pragma mark WSConnectionHandlerDelegate (pool queue)
 
 - (void)connectionHandlerDidConnect:(WSConnectionHandler *)connectionHandler
 {
@@ -191,7 +195,7 @@
 {
     NSParameterAssert(handler);
 
-    if ([handler isConnected]) {
+    if ([handler isConnecting] || [handler isConnected]) {
         [handler disconnectWithError:error];
     }
     else {
@@ -237,7 +241,7 @@
     [self.handler runBlock:block];
 }
 
-- (void)writeMessage:(id<WSMessage>)message
+- (BOOL)writeMessage:(id<WSMessage>)message
 {
 //    @synchronized (self) {
 //        if (_peerStatus == WSPeerStatusDisconnected) {
@@ -250,14 +254,20 @@
     WSBuffer *buffer = [message toNetworkBufferWithHeaderLength:&headerLength];
     if (buffer.length > WSMessageMaxLength) {
         DDLogError(@"%@ Error sending '%@', message is too long (%u > %u)", self, message.messageType, buffer.length, WSMessageMaxLength);
-        return;
+        return YES;
     }
     
     DDLogVerbose(@"%@ Sending %@ (%u+%u bytes)", self, message, headerLength, buffer.length - headerLength);
     DDLogVerbose(@"%@ Sending data: %@", self, [buffer.data hexString]);
     
-    [self.handler unsafeEnqueueData:buffer.data];
+    const BOOL isBelowHighWaterMark = [self.handler unsafeEnqueueData:buffer.data];
     [self.handler unsafeFlush];
+    return (isBelowHighWaterMark || ([self.handler queuedBytes] < WSConnectionOutputHighWaterMark));
+}
+
+- (NSUInteger)queuedBytes
+{
+    return [self.handler queuedBytes];
 }
 
 - (void)disconnectWithError:(NSError *)error
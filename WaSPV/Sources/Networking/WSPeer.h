@@ -54,6 +54,7 @@ typedef enum {
 @interface WSPeerParameters : NSObject
 
 @property (nonatomic, assign) uint16_t port; // default network port
+@property (nonatomic, assign) NSTimeInterval pingInterval; // 0.0 disables periodic pings
 
 - (instancetype)initWithParameters:(id<WSParameters>)parameters;
 - (instancetype)initWithParameters:(id<WSParameters>)parameters
@@ -89,11 +90,16 @@ typedef enum {
 - (uint32_t)remoteAddress;
 - (uint16_t)remotePort;
 - (NSTimeInterval)connectionTime;
+- (NSTimeInterval)pingTime; // smoothed round-trip time, DBL_MAX if unknown
+- (double)downloadSpeed; // smoothed bytes per second, 0.0 if unknown
+- (uint64_t)sentBytes;
+- (uint64_t)receivedBytes;
 - (NSTimeInterval)lastSeenTimestamp;
 - (uint32_t)version;
 - (uint64_t)services;
 - (uint64_t)timestamp;
 - (uint32_t)lastBlockHeight;
+- (NSUInteger)queuedOutputBytes;
 - (void)cleanUpConnectionData;
 
 // protocol
@@ -109,14 +115,19 @@ typedef enum {
 - (void)sendMempoolMessage;
 - (void)sendPingMessage;
 - (void)sendFilterloadMessageWithFilter:(WSBloomFilter *)filter;
+- (void)sendFilteraddMessageWithData:(NSData *)data;
 
 // download
+@property (atomic, assign) BOOL shouldScheduleBlockRequests; // NO: request announced blocks directly, YES: report them to delegate
+@property (atomic, assign) BOOL shouldDownloadHeadersFirst;  // YES: only request headers up to tip, blocks are requested by delegate
+
 - (void)downloadBlockChain:(WSBlockChain *)blockChain
       fastCatchUpTimestamp:(uint32_t)fastCatchUpTimestamp
              prestartBlock:(void (^)(NSUInteger, NSUInteger))prestartBlock
                syncedBlock:(void (^)(NSUInteger))syncedBlock;
 
 - (void)requestOutdatedBlocks;
+- (void)stopDownloadWithCompletionBlock:(void (^)(NSArray *outstandingBlockIds))completionBlock; // WSHash256, on delegate queue
 
 // for testing, needs WASPV_TEST_MESSAGE_QUEUE to work
 - (id<WSMessage>)dequeueMessageSynchronouslyWithTimeout:(NSUInteger)timeout;
@@ -131,7 +142,8 @@ typedef enum {
 - (void)peer:(WSPeer *)peer didFailToConnectWithError:(NSError *)error;
 - (void)peer:(WSPeer *)peer didDisconnectWithError:(NSError *)error;
 - (void)peerDidKeepAlive:(WSPeer *)peer;
-- (void)peer:(WSPeer *)peer didReceiveHeader:(WSBlockHeader *)header;
+- (void)peer:(WSPeer *)peer didReceiveHeaders:(NSArray *)headers; // WSBlockHeader
+- (void)peer:(WSPeer *)peer didReceiveBlockHashes:(NSArray *)hashes; // WSHash256, only if shouldScheduleBlockRequests
 - (void)peer:(WSPeer *)peer didReceiveBlock:(WSBlock *)block;
 - (void)peer:(WSPeer *)peer didReceiveFilteredBlock:(WSFilteredBlock *)filteredBlock withTransactions:(NSOrderedSet *)transactions;
 - (void)peer:(WSPeer *)peer didReceiveTransaction:(WSSignedTransaction *)transaction;
@@ -140,8 +152,7 @@ typedef enum {
 - (void)peer:(WSPeer *)peer didReceiveDataRequestWithInventories:(NSArray *)inventories; // WSInventory
 - (void)peer:(WSPeer *)peer didReceiveRejectMessage:(WSMessageReject *)message;
 - (void)peerDidRequestFilterReload:(WSPeer *)peer;
-- (void)peer:(WSPeer *)peer didSendNumberOfBytes:(NSUInteger)numberOfBytes;
-- (void)peer:(WSPeer *)peer didReceiveNumberOfBytes:(NSUInteger)numberOfBytes;
+- (void)peer:(WSPeer *)peer didReceiveNumberOfBytes:(NSUInteger)numberOfBytes; // total of last read
 
 @end
 
@@ -25,6 +25,8 @@
 //  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#import <stdatomic.h>
+
 #import "WSPeer.h"
 #import "WSProtocolDeserializer.h"
 #import "WSNetworkAddress.h"
@@ -77,6 +79,16 @@
 
 #pragma mark -
 
+typedef void (*WSPeerReceiveIMP)(id, SEL, id<WSMessage>);
+
+typedef struct {
+    __unsafe_unretained Class messageClass;
+    SEL selector;
+    WSPeerReceiveIMP imp;
+} WSPeerReceiver;
+
+static WSPeerReceiver WSPeerReceivers[13];
+
 @interface WSPeer () {
     WSPeerStatus _peerStatus;
     BOOL _didReceiveVerack;
@@ -88,12 +100,21 @@
     uint64_t _nonce;
     NSTimeInterval _connectionStartTime;
     NSTimeInterval _connectionTime;
+    uint64_t _pingNonce;
+    NSTimeInterval _pingStartTime;
+    NSTimeInterval _pingTime;
+    double _downloadSpeed;
+    NSTimeInterval _speedSampleStartTime;
+    NSUInteger _speedSampleBytes;
     NSTimeInterval _lastSeenTimestamp;
     WSMessageVersion *_receivedVersion;
+    _Atomic(uint64_t) _sentBytes;
+    _Atomic(uint64_t) _receivedBytes;
 }
 
 // only set on creation
 @property (nonatomic, strong) id<WSParameters> parameters;
+@property (nonatomic, assign) NSTimeInterval pingInterval;
 #ifdef WASPV_TEST_MESSAGE_QUEUE
 @property (nonatomic, strong) NSCondition *messageQueueCondition;
 @property (nonatomic, strong) NSMutableArray *messageQueue;
@@ -112,6 +133,12 @@
 @property (nonatomic, strong) WSFilteredBlock *currentFilteredBlock;
 @property (nonatomic, strong) NSMutableOrderedSet *currentFilteredTransactions;
 @property (nonatomic, assign) NSUInteger filteredBlockCount;
+@property (nonatomic, assign) BOOL isOutputBackpressured;
+
+// delegate batching (connection queue)
+@property (nonatomic, strong) NSMutableArray *delegateBlocks;
+@property (nonatomic, assign) NSUInteger batchedReceivedBytes;
+@property (nonatomic, assign) BOOL isProcessingMessages;
 
 // protocol
 - (void)sendVersionMessageWithRelayTransactions:(uint8_t)relayTransactions;
@@ -142,13 +169,48 @@
 - (void)endCurrentFilteredBlock;
 
 // helpers
-- (void)unsafeSendMessage:(id<WSMessage>)message;
+- (BOOL)unsafeSendMessage:(id<WSMessage>)message; // NO if connection is backpressured
+- (void)unsafeSendPingMessage;
+- (void)unsafeSchedulePingMessage;
+- (void)unsafeUpdateDownloadSpeedWithNumberOfBytes:(NSUInteger)numberOfBytes;
+- (void)unsafeNotifyDelegateWithBlock:(void (^)())block;
+- (void)unsafeFlushDelegateBlocks;
 - (BOOL)tryFinishHandshake;
 
 @end
 
 @implementation WSPeer
 
++ (void)initialize
+{
+    if (self != [WSPeer class]) {
+        return;
+    }
+    
+    // most frequent first
+    const WSPeerReceiver receivers[] = {
+        {[WSMessageInv class], @selector(receiveInvMessage:)},
+        {[WSMessageTx class], @selector(receiveTxMessage:)},
+        {[WSMessageMerkleblock class], @selector(receiveMerkleblockMessage:)},
+        {[WSMessageHeaders class], @selector(receiveHeadersMessage:)},
+        {[WSMessageBlock class], @selector(receiveBlockMessage:)},
+        {[WSMessagePing class], @selector(receivePingMessage:)},
+        {[WSMessagePong class], @selector(receivePongMessage:)},
+        {[WSMessageAddr class], @selector(receiveAddrMessage:)},
+        {[WSMessageGetdata class], @selector(receiveGetdataMessage:)},
+        {[WSMessageNotfound class], @selector(receiveNotfoundMessage:)},
+        {[WSMessageVersion class], @selector(receiveVersionMessage:)},
+        {[WSMessageVerack class], @selector(receiveVerackMessage:)},
+        {[WSMessageReject class], @selector(receiveRejectMessage:)}
+    };
+    NSAssert(sizeof(receivers) == sizeof(WSPeerReceivers), @"Receivers table size mismatch");
+
+    for (NSUInteger i = 0; i < sizeof(receivers) / sizeof(WSPeerReceiver); ++i) {
+        WSPeerReceivers[i] = receivers[i];
+        WSPeerReceivers[i].imp = (WSPeerReceiveIMP)[self instanceMethodForSelector:receivers[i].selector];
+    }
+}
+
 - (instancetype)initWithHost:(NSString *)host parameters:(id<WSParameters>)parameters
 {
     return [self initWithHost:host peerParameters:[[WSPeerParameters alloc] initWithParameters:parameters]];
@@ -168,6 +230,7 @@
         self.parameters = peerParameters.parameters;
         self.shouldDownloadBlocks = peerParameters.shouldDownloadBlocks;
         self.needsBloomFiltering = peerParameters.needsBloomFiltering;
+        self.pingInterval = peerParameters.pingInterval;
 
         _peerStatus = WSPeerStatusDisconnected;
         _remoteHost = host;
@@ -176,6 +239,7 @@
 
         self.pendingBlockIds = [[NSCountedSet alloc] init];
         self.processingBlockIds = [[NSMutableOrderedSet alloc] initWithCapacity:(2 * WSMessageBlocksMaxCount)];
+        self.delegateBlocks = [[NSMutableArray alloc] init];
     }
     return self;
 }
@@ -233,55 +297,71 @@
         _nonce = mrand48();
         _connectionStartTime = DBL_MAX;
         _connectionTime = DBL_MAX;
+        _pingNonce = 0;
+        _pingStartTime = 0.0;
+        _pingTime = DBL_MAX;
+        _downloadSpeed = 0.0;
+        _speedSampleStartTime = 0.0;
+        _speedSampleBytes = 0;
         _lastSeenTimestamp = NSTimeIntervalSince1970;
         _receivedVersion = nil;
     }
+    [self.delegateBlocks removeAllObjects];
+    self.batchedReceivedBytes = 0;
+    self.isProcessingMessages = NO;
 
     DDLogDebug(@"%@ Connection opened", self);
 
     [self sendVersionMessageWithRelayTransactions:(uint8_t)!self.needsBloomFiltering];
 }
 
+// already on connection queue, delegate is notified once per read in finishedProcessingMessages
 - (void)processMessage:(id<WSMessage>)message
 {
-    dispatch_async(self.delegateQueue, ^{
-        [self.delegate peer:self didReceiveNumberOfBytes:message.length];
-        [self.delegate peerDidKeepAlive:self];
-    });
+    atomic_fetch_add_explicit(&_receivedBytes, message.length, memory_order_relaxed);
+    self.batchedReceivedBytes += message.length;
+    self.isProcessingMessages = YES;
+
+    [self unsafeUpdateDownloadSpeedWithNumberOfBytes:message.length];
+
+    if (message.originalLength < 1024) {
+        DDLogVerbose(@"%@ Received %@ (%u+%u bytes)", self, message, WSMessageHeaderLength, message.originalLength);
+    }
+    else {
+        DDLogVerbose(@"%@ Received %@ (%u+%u bytes, too long to display)", self, [message class], WSMessageHeaderLength, message.originalLength);
+    }
     
-    [self.connection submitBlock:^{
-        if (message.originalLength < 1024) {
-            DDLogVerbose(@"%@ Received %@ (%u+%u bytes)", self, message, WSMessageHeaderLength, message.originalLength);
-        }
-        else {
-            DDLogVerbose(@"%@ Received %@ (%u+%u bytes, too long to display)", self, [message class], WSMessageHeaderLength, message.originalLength);
-        }
-        
-        // stop reading txs for current merkleblock
-        if (self.currentFilteredBlock && ![message isKindOfClass:[WSMessageTx class]]) {
-            [self endCurrentFilteredBlock];
-        }
-        
-        SEL selector = NSSelectorFromString([NSString stringWithFormat:@"receive%@Message:", [message.messageType capitalizedString]]);
-        if ([self respondsToSelector:selector]) {
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Warc-performSelector-leaks"
-            
-            [self performSelector:selector withObject:message];
-            
-#pragma clang diagnostic pop
-        }
-        else {
-            DDLogDebug(@"%@ Unhandled message '%@'", self, message.messageType);
+    // stop reading txs for current merkleblock
+    if (self.currentFilteredBlock && ![message isKindOfClass:[WSMessageTx class]]) {
+        [self endCurrentFilteredBlock];
+    }
+    
+    const Class messageClass = [message class];
+    const WSPeerReceiver *receiver = NULL;
+    for (NSUInteger i = 0; i < sizeof(WSPeerReceivers) / sizeof(WSPeerReceiver); ++i) {
+        if (WSPeerReceivers[i].messageClass == messageClass) {
+            receiver = &WSPeerReceivers[i];
+            break;
         }
-        
+    }
+    if (receiver) {
+        receiver->imp(self, receiver->selector, message);
+    }
+    else {
+        DDLogDebug(@"%@ Unhandled message '%@'", self, message.messageType);
+    }
+    
 #ifdef WASPV_TEST_MESSAGE_QUEUE
-        [self.messageQueueCondition lock];
-        [self.messageQueue addObject:message];
-        [self.messageQueueCondition signal];
-        [self.messageQueueCondition unlock];
+    [self.messageQueueCondition lock];
+    [self.messageQueue addObject:message];
+    [self.messageQueueCondition signal];
+    [self.messageQueueCondition unlock];
 #endif
-    }];
+}
+
+- (void)finishedProcessingMessages
+{
+    [self unsafeFlushDelegateBlocks];
 }
 
 //- (void)processData:(NSData *)data
@@ -317,6 +397,9 @@
         _peerStatus = WSPeerStatusDisconnected;
     }
 
+    // deliver pending events before disconnection
+    [self unsafeFlushDelegateBlocks];
+
     dispatch_async(self.delegateQueue, ^{
         if (wasConnected) {
             [self.delegate peer:self didDisconnectWithError:error];
@@ -358,6 +441,30 @@
     }
 }
 
+- (NSTimeInterval)pingTime
+{
+    @synchronized (self) {
+        return _pingTime;
+    }
+}
+
+- (double)downloadSpeed
+{
+    @synchronized (self) {
+        return _downloadSpeed;
+    }
+}
+
+- (uint64_t)sentBytes
+{
+    return atomic_load_explicit(&_sentBytes, memory_order_relaxed);
+}
+
+- (uint64_t)receivedBytes
+{
+    return atomic_load_explicit(&_receivedBytes, memory_order_relaxed);
+}
+
 - (NSTimeInterval)lastSeenTimestamp
 {
     @synchronized (self) {
@@ -404,6 +511,11 @@
     }
 }
 
+- (NSUInteger)queuedOutputBytes
+{
+    return [self.connection queuedBytes];
+}
+
 //
 // VERY IMPORTANT: since the delegate (peer group) is the master peer controller, let it also do the
 // clean up in didDisconnectWithError.
@@ -603,7 +715,7 @@
     [self.connection submitBlock:^{
         NSAssert(_nonce, @"Nonce not set, is handshake complete?");
 
-        [self unsafeSendMessage:[WSMessagePing messageWithParameters:self.parameters]];
+        [self unsafeSendPingMessage];
     }];
 }
 
@@ -624,6 +736,15 @@
     }];
 }
 
+- (void)sendFilteraddMessageWithData:(NSData *)data
+{
+    WSExceptionCheckIllegal(data != nil, @"Nil data");
+
+    [self.connection submitBlock:^{
+        [self unsafeSendMessage:[WSMessageFilteradd messageWithParameters:self.parameters data:data]];
+    }];
+}
+
 #pragma mark Protocol: receive* (connection queue)
 
 //
@@ -669,9 +790,9 @@
     
     const BOOL isLastRelay = ((message.addresses.count > 1) && (message.addresses.count < WSMessageAddrMaxCount));
 
-    dispatch_async(self.delegateQueue, ^{
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peer:self didReceiveAddresses:message.addresses isLastRelay:isLastRelay];
-    });
+    }];
 }
 
 - (void)receiveInvMessage:(WSMessageInv *)message
@@ -687,13 +808,18 @@
     NSMutableArray *requestInventories = [[NSMutableArray alloc] initWithCapacity:message.inventories.count];
     NSMutableArray *requestBlockHashes = [[NSMutableArray alloc] initWithCapacity:message.inventories.count];
     
+    const BOOL shouldScheduleBlockRequests = self.shouldScheduleBlockRequests;
+
     for (WSInventory *inv in message.inventories) {
         if ([inv isBlockInventory]) {
-            if (self.needsBloomFiltering) {
-                [requestInventories addObject:WSInventoryFilteredBlock(inv.inventoryHash)];
-            }
-            else {
-                [requestInventories addObject:WSInventoryBlock(inv.inventoryHash)];
+            // scheduled blocks are requested by delegate
+            if (!shouldScheduleBlockRequests) {
+                if (self.needsBloomFiltering) {
+                    [requestInventories addObject:WSInventoryFilteredBlock(inv.inventoryHash)];
+                }
+                else {
+                    [requestInventories addObject:WSInventoryBlock(inv.inventoryHash)];
+                }
             }
             [requestBlockHashes addObject:inv.inventoryHash];
         }
@@ -701,21 +827,26 @@
             [requestInventories addObject:inv];
         }
     }
-    NSAssert(requestBlockHashes.count <= requestInventories.count, @"Requesting more blocks than total inventories?");
+    NSAssert(shouldScheduleBlockRequests || (requestBlockHashes.count <= requestInventories.count), @"Requesting more blocks than total inventories?");
 
     if (requestInventories.count > 0) {
         [self sendGetdataMessageWithInventories:requestInventories];
-        if (requestBlockHashes.count > 0) {
-            [self aheadRequestOnReceivedBlockHashes:requestBlockHashes];
+    }
+    if (requestBlockHashes.count > 0) {
+        if (shouldScheduleBlockRequests) {
+            [self unsafeNotifyDelegateWithBlock:^{
+                [self.delegate peer:self didReceiveBlockHashes:requestBlockHashes];
+            }];
         }
+        [self aheadRequestOnReceivedBlockHashes:requestBlockHashes];
     }
 }
 
 - (void)receiveGetdataMessage:(WSMessageGetdata *)message
 {
-    dispatch_async(self.delegateQueue, ^{
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peer:self didReceiveDataRequestWithInventories:message.inventories];
-    });
+    }];
 }
 
 - (void)receiveNotfoundMessage:(WSMessageNotfound *)message
@@ -732,9 +863,9 @@
         return;
     }
     
-    dispatch_async(self.delegateQueue, ^{
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peer:self didReceiveTransaction:transaction];
-    });
+    }];
 }
 
 - (void)receiveBlockMessage:(WSMessageBlock *)message
@@ -747,9 +878,13 @@
         return;
     }
     
-    dispatch_async(self.delegateQueue, ^{
+    WSHash256 *blockId = block.header.blockId;
+    [self.pendingBlockIds removeObject:blockId];
+    [self.processingBlockIds removeObject:blockId];
+
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peer:self didReceiveBlock:block];
-    });
+    }];
 }
 
 - (void)receiveHeadersMessage:(WSMessageHeaders *)message
@@ -760,12 +895,12 @@
         return;
     }
     
-    for (WSBlockHeader *header in message.headers) {
-        NSError *error;
-        if (![header verifyWithError:&error]) {
-            [self.connection disconnectWithError:error];
-            return;
-        }
+    NSError *error;
+    const NSUInteger invalidIndex = [WSBlockHeader verifyHeaders:headers error:&error];
+    if (invalidIndex != NSNotFound) {
+        DDLogDebug(@"%@ Invalid header #%u out of %u", self, invalidIndex, headers.count);
+        [self.connection disconnectWithError:error];
+        return;
     }
 
     [self aheadRequestOnReceivedHeaders:headers];
@@ -779,9 +914,26 @@
 
 - (void)receivePongMessage:(WSMessagePong *)message
 {
-    dispatch_async(self.delegateQueue, ^{
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+    @synchronized (self) {
+        if (_pingNonce && (message.nonce == _pingNonce)) {
+            const NSTimeInterval rtt = now - _pingStartTime;
+            if (_pingTime == DBL_MAX) {
+                _pingTime = rtt;
+            }
+            else {
+                _pingTime = WSPeerPingTimeSmoothing * rtt + (1.0 - WSPeerPingTimeSmoothing) * _pingTime;
+            }
+            _pingNonce = 0;
+
+            DDLogDebug(@"%@ Ping time %.3fs (smoothed: %.3fs)", self, rtt, _pingTime);
+        }
+    }
+
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peer:self didReceivePongMesage:message];
-    });
+    }];
 }
 
 - (void)receiveMerkleblockMessage:(WSMessageMerkleblock *)message
@@ -797,9 +949,9 @@
 
 - (void)receiveRejectMessage:(WSMessageReject *)message
 {
-    dispatch_async(self.delegateQueue, ^{
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peer:self didReceiveRejectMessage:message];
-    });
+    }];
 }
 
 #pragma mark Download (external queue)
@@ -845,7 +997,7 @@
     
     WSBlockLocator *locator = [blockChain currentLocator];
 
-    if (!self.shouldDownloadBlocks || (blockChain.currentTimestamp < self.fastCatchUpTimestamp)) {
+    if (!self.shouldDownloadBlocks || self.shouldDownloadHeadersFirst || (blockChain.currentTimestamp < self.fastCatchUpTimestamp)) {
         [self requestHeadersWithLocator:locator];
     }
     else {
@@ -904,6 +1056,27 @@
     }];
 }
 
+- (void)stopDownloadWithCompletionBlock:(void (^)(NSArray *))completionBlock
+{
+    [self.connection submitBlock:^{
+        self.isDownloading = NO;
+        self.shouldScheduleBlockRequests = NO;
+        self.shouldDownloadHeadersFirst = NO;
+
+        // pending ids are kept so that in-flight blocks are still delivered
+        NSArray *outstandingIds = [self.processingBlockIds array];
+        [self.processingBlockIds removeAllObjects];
+
+        DDLogDebug(@"%@ Stopped download with %u outstanding blocks", self, outstandingIds.count);
+
+        if (completionBlock) {
+            [self unsafeNotifyDelegateWithBlock:^{
+                completionBlock(outstandingIds);
+            }];
+        }
+    }];
+}
+
 #pragma mark Download automation (connection queue)
 
 - (void)aheadRequestOnReceivedHeaders:(NSArray *)headers
@@ -921,6 +1094,14 @@
     
     WSBlockHeader *firstHeader = [headers firstObject];
     WSBlockHeader *lastHeader = [headers lastObject];
+
+    // headers-first, keep requesting headers until tip
+    if (self.shouldDownloadHeadersFirst) {
+        WSBlockLocator *locator = [[WSBlockLocator alloc] initWithHashes:@[lastHeader.blockId, firstHeader.blockId]];
+        [self requestHeadersWithLocator:locator];
+        return;
+    }
+
     WSBlockHeader *lastHeaderBeforeFCU = nil;
     
     // infer the header we'll stop at
@@ -970,7 +1151,7 @@
 
 - (void)requestHeadersWithLocator:(WSBlockLocator *)locator
 {
-    DDLogDebug(@"%@ Behind catch-up (or headers-only mode), requesting headers with locator: %@", self, locator.hashes);
+    DDLogDebug(@"%@ Behind catch-up (or headers-only/headers-first mode), requesting headers with locator: %@", self, locator.hashes);
     [self sendGetheadersMessageWithLocator:locator hashStop:nil];
 }
 
@@ -984,17 +1165,26 @@
 {
     NSParameterAssert(headers.count > 0);
     
+    const BOOL shouldStopAtFastCatchUp = (self.shouldDownloadBlocks && self.isDownloading && !self.shouldDownloadHeadersFirst);
+
+    NSUInteger count = 0;
     for (WSBlockHeader *header in headers) {
         
         // download peer should stop requesting headers when fast catch-up reached
-        if (self.shouldDownloadBlocks && self.isDownloading && (header.timestamp >= self.fastCatchUpTimestamp)) {
+        if (shouldStopAtFastCatchUp && (header.timestamp >= self.fastCatchUpTimestamp)) {
             break;
         }
-        
-        dispatch_async(self.delegateQueue, ^{
-            [self.delegate peer:self didReceiveHeader:header];
-        });
+        ++count;
     }
+    if (count == 0) {
+        return;
+    }
+
+    // one delegate call per message
+    NSArray *acceptedHeaders = ((count < headers.count) ? [headers subarrayWithRange:NSMakeRange(0, count)] : headers);
+    [self unsafeNotifyDelegateWithBlock:^{
+        [self.delegate peer:self didReceiveHeaders:acceptedHeaders];
+    }];
 }
 
 - (void)beginFilteredBlock:(WSFilteredBlock *)filteredBlock
@@ -1061,14 +1251,14 @@
 
     [self.processingBlockIds removeObject:blockId];
 
-    dispatch_async(self.delegateQueue, ^{
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peer:self didReceiveFilteredBlock:filteredBlock withTransactions:transactions];
-    });
+    }];
 }
 
 #pragma mark Helpers
 
-- (void)unsafeSendMessage:(id<WSMessage>)message
+- (BOOL)unsafeSendMessage:(id<WSMessage>)message
 {
 //    @synchronized (self) {
 //        if (_peerStatus == WSPeerStatusDisconnected) {
@@ -1077,10 +1267,118 @@
 //        }
 //    }
 
-    [self.connection writeMessage:message];
+    const BOOL isWritable = [self.connection writeMessage:message];
+    if (!isWritable && !self.isOutputBackpressured) {
+        DDLogDebug(@"%@ Output above high-water mark (%u bytes queued)", self, [self.connection queuedBytes]);
+    }
+    self.isOutputBackpressured = !isWritable;
+
+    atomic_fetch_add_explicit(&_sentBytes, message.length, memory_order_relaxed);
+
+    return isWritable;
+}
+
+// only one ping is timed at a time, a lost pong is given up after one interval
+- (void)unsafeSendPingMessage
+{
+    WSMessagePing *ping = [WSMessagePing messageWithParameters:self.parameters];
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+    @synchronized (self) {
+        if (!_pingNonce || (now - _pingStartTime > self.pingInterval)) {
+            _pingNonce = ping.nonce;
+            _pingStartTime = now;
+        }
+    }
+
+    [self unsafeSendMessage:ping];
+}
+
+- (void)unsafeSchedulePingMessage
+{
+    if (self.pingInterval <= 0.0) {
+        return;
+    }
+
+    __weak WSPeer *weakSelf = self;
+    id<WSConnection> connection = self.connection;
+    const dispatch_time_t when = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.pingInterval * NSEC_PER_SEC));
+
+    dispatch_after(when, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [connection submitBlock:^{
+            WSPeer *peer = weakSelf;
+
+            // stop on disconnection or reconnection
+            if (!peer || (peer.connection != connection) || (peer.peerStatus != WSPeerStatusConnected)) {
+                return;
+            }
+            [peer unsafeSendPingMessage];
+            [peer unsafeSchedulePingMessage];
+        }];
+    });
+}
+
+// samples are only taken on bulk transfers, sparse messages don't count as throughput
+- (void)unsafeUpdateDownloadSpeedWithNumberOfBytes:(NSUInteger)numberOfBytes
+{
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+    @synchronized (self) {
+        const NSTimeInterval elapsed = now - _speedSampleStartTime;
+        if (elapsed > WSPeerDownloadSpeedMaxSampleInterval) {
+            _speedSampleStartTime = now;
+            _speedSampleBytes = numberOfBytes;
+            return;
+        }
+
+        _speedSampleBytes += numberOfBytes;
+        if ((elapsed < WSPeerDownloadSpeedMinSampleInterval) || (_speedSampleBytes < WSPeerDownloadSpeedMinSampleBytes)) {
+            return;
+        }
+
+        const double speed = _speedSampleBytes / elapsed;
+        if (_downloadSpeed == 0.0) {
+            _downloadSpeed = speed;
+        }
+        else {
+            _downloadSpeed = WSPeerDownloadSpeedSmoothing * speed + (1.0 - WSPeerDownloadSpeedSmoothing) * _downloadSpeed;
+        }
+        _speedSampleStartTime = now;
+        _speedSampleBytes = 0;
+    }
+}
+
+// events raised while processing messages wait for the end of the read, others are delivered right away
+- (void)unsafeNotifyDelegateWithBlock:(void (^)())block
+{
+    [self.delegateBlocks addObject:[block copy]];
+    if (!self.isProcessingMessages) {
+        [self unsafeFlushDelegateBlocks];
+    }
+}
+
+// one delegate queue hop for all pending events, in order
+- (void)unsafeFlushDelegateBlocks
+{
+    const NSUInteger receivedBytes = self.batchedReceivedBytes;
+    NSArray *blocks = ((self.delegateBlocks.count > 0) ? [self.delegateBlocks copy] : nil);
+
+    self.batchedReceivedBytes = 0;
+    [self.delegateBlocks removeAllObjects];
+    self.isProcessingMessages = NO;
+
+    if ((receivedBytes == 0) && !blocks) {
+        return;
+    }
 
     dispatch_async(self.delegateQueue, ^{
-        [self.delegate peer:self didSendNumberOfBytes:message.length];
+        if (receivedBytes > 0) {
+            [self.delegate peer:self didReceiveNumberOfBytes:receivedBytes];
+            [self.delegate peerDidKeepAlive:self];
+        }
+        for (void (^block)() in blocks) {
+            block();
+        }
     });
 }
 
@@ -1097,9 +1395,13 @@
     
     DDLogDebug(@"%@ Handshake complete", self);
 
-    dispatch_async(self.delegateQueue, ^{
+    // first ping estimates latency right away
+    [self unsafeSendPingMessage];
+    [self unsafeSchedulePingMessage];
+
+    [self unsafeNotifyDelegateWithBlock:^{
         [self.delegate peerDidConnect:self];
-    });
+    }];
     
     return YES;
 }
@@ -50,6 +50,9 @@
 - (NSArray *)recentBlocks;
 - (NSUInteger)sentBytes;
 - (NSUInteger)receivedBytes;
+- (NSString *)downloadPeerHost;
+- (NSDictionary *)pingTimes;        // NSString (host) -> NSNumber (seconds)
+- (NSDictionary *)downloadSpeeds;   // NSString (host) -> NSNumber (bytes per second)
 
 @end
 
@@ -75,13 +78,22 @@
 @property (nonatomic, assign) double bloomFilterObservedRateMax;            // 0.005
 @property (nonatomic, assign) double bloomFilterLowPassRatio;               // 0.01
 @property (nonatomic, assign) NSUInteger bloomFilterTxsPerBlock;            // 600
+@property (nonatomic, assign) double bloomFilterRebuildRatio;               // 2.0, filteradd until estimated rate exceeds ratio * target rate
+@property (nonatomic, assign) NSUInteger bloomFilterHorizon;                // 144, blocks a filter is expected to serve once synced
 @property (nonatomic, assign) NSUInteger blockStoreSize;                    // 2500
 
 // peer related
 @property (nonatomic, assign) BOOL headersOnly;                             // NO
+@property (nonatomic, assign) BOOL headersFirst;                            // NO
+@property (nonatomic, assign) BOOL localFiltering;                          // NO, wallet matched locally on full blocks (trusted peers)
 @property (nonatomic, assign) NSTimeInterval requestTimeout;                // 15.0
+@property (nonatomic, assign) NSTimeInterval pingInterval;                  // 5.0
+@property (nonatomic, assign) NSTimeInterval downloadRateWindow;            // 20.0
+@property (nonatomic, assign) double minDownloadBlockRate;                  // 1.0, blocks (or headers) per second
+@property (nonatomic, assign) double minDownloadByteRate;                   // 4096.0, bytes per second
 
 @property (nonatomic, strong) WSCoreDataManager *coreDataManager;           // nil
+@property (nonatomic, copy) NSString *addressesPath;                        // nil, known peers are not persisted
 
 - (instancetype)initWithBlockStore:(id<WSBlockStore>)store;
 - (instancetype)initWithBlockStore:(id<WSBlockStore>)store fastCatchUpTimestamp:(uint32_t)fastCatchUpTimestamp;
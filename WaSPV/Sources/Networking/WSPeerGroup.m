@@ -31,11 +31,17 @@
 #import "WSPeerGroup.h"
 #import "WSBlockStore.h"
 #import "WSConnectionPool.h"
+#import "WSBlockDownloadScheduler.h"
+#import "WSAddressManager.h"
+#import "WSRateMonitor.h"
+#import "WSBloomFilterTuner.h"
 #import "WSWallet.h"
 #import "WSHDWallet.h"
 #import "WSHash256.h"
 #import "WSPeer.h"
 #import "WSBloomFilter.h"
+#import "WSBlockMatcher.h"
+#import "WSBlock.h"
 #import "WSBlockHeader.h"
 #import "WSFilteredBlock.h"
 #import "WSPartialMerkleTree.h"
@@ -49,6 +55,12 @@
 #import "WSMacros.h"
 #import "WSErrors.h"
 
+// duplicate header batches start from one of the latest skeleton tips
+static const NSUInteger WSPeerGroupRecentSkeletonTips = 8;
+
+// consecutive failures before known addresses are considered stale
+static const NSUInteger WSPeerGroupFailuresBeforeDiscovery = 3;
+
 @interface WSPeerGroupStatus ()
 
 @property (nonatomic, strong) id<WSParameters> parameters;
@@ -60,6 +72,9 @@
 @property (nonatomic, strong) NSArray *recentBlocks;
 @property (nonatomic, assign) NSUInteger sentBytes;
 @property (nonatomic, assign) NSUInteger receivedBytes;
+@property (nonatomic, copy) NSString *downloadPeerHost;
+@property (nonatomic, strong) NSDictionary *pingTimes;
+@property (nonatomic, strong) NSDictionary *downloadSpeeds;
 
 @end
 
@@ -86,53 +101,88 @@
 @property (nonatomic, assign) BOOL keepConnected;
 @property (nonatomic, assign) NSUInteger activeDnsResolutions;
 @property (nonatomic, assign) NSUInteger connectionFailures;
-@property (nonatomic, strong) NSMutableOrderedSet *inactiveAddresses;       // WSNetworkAddress
+@property (nonatomic, strong) WSAddressManager *addressManager;
 @property (nonatomic, strong) NSMutableSet *misbehavingHosts;               // NSString
 @property (nonatomic, strong) NSMutableSet *pendingPeers;                   // WSPeer
 @property (nonatomic, strong) NSMutableSet *connectedPeers;                 // WSPeer
+@property (nonatomic, strong) NSMutableDictionary *rateMonitors;            // NSString (host) -> WSRateMonitor
 @property (nonatomic, strong) NSMutableDictionary *publishedTransactions;   // WSSignedTransaction
-@property (nonatomic, assign) NSUInteger sentBytes;
-@property (nonatomic, assign) NSUInteger receivedBytes;
+@property (nonatomic, assign) uint64_t closedSentBytes;                     // peers count their own traffic while open
+@property (nonatomic, assign) uint64_t closedReceivedBytes;
 
 // sync
 @property (nonatomic, assign) uint32_t fastCatchUpTimestamp;
 @property (nonatomic, assign) BOOL keepDownloading;
 @property (nonatomic, strong) WSPeer *downloadPeer;
+@property (nonatomic, strong) WSBlockDownloadScheduler *downloadScheduler;
+@property (nonatomic, strong) NSMutableSet *filteredPeers;                  // WSPeer, Bloom filter loaded during sync
+@property (nonatomic, strong) WSStorableBlock *skeletonBlock;               // headers-first, last validated header beyond catch-up (not stored)
+@property (nonatomic, assign) uint32_t skeletonHeight;
+@property (nonatomic, strong) NSMutableOrderedSet *recentSkeletonIds;       // WSHash256, latest skeleton tips
+@property (nonatomic, strong) WSHash256 *skeletonResyncBlockId;             // tip headers were last re-requested from
 @property (nonatomic, assign) BOOL didNotifyDownloadFinished;
 @property (nonatomic, strong) WSBIP37FilterParameters *bloomFilterParameters;
 @property (nonatomic, strong) WSBloomFilter *bloomFilter; // immutable, thread-safe
+@property (nonatomic, strong) WSBloomFilterTuner *bloomFilterTuner;
+@property (nonatomic, strong) WSBlockMatcher *blockMatcher;
 @property (nonatomic, assign) NSUInteger observedFilterHeight;
-@property (nonatomic, assign) double observedFalsePositiveRate;
+@property (nonatomic, assign) double observedFalsePositiveRate;             // initial rate of every filtering peer
+@property (nonatomic, strong) NSMutableDictionary *peerFalsePositiveRates;  // NSString (host) -> NSNumber (double)
 @property (nonatomic, assign) NSTimeInterval lastKeepAliveTime;
+@property (nonatomic, strong) dispatch_source_t stallTimer;
 
 - (void)connect;
 - (void)disconnect;
 - (void)discoverNewHostsWithResolutionCallback:(void (^)(NSString *, NSArray *))resolutionCallback failure:(void (^)(NSError *))failure;
 - (void)triggerConnectionsFromSeed:(NSString *)seed addresses:(NSArray *)addresses;
-- (void)triggerConnectionsFromInactive;
+- (NSUInteger)triggerConnectionsFromInactive;
 - (void)openConnectionToPeerHost:(NSString *)host;
 - (void)handleConnectionFailureFromPeer:(WSPeer *)peer error:(NSError *)error;
 - (void)reconnectAfterDelay:(NSTimeInterval)delay;
 - (NSArray *)disconnectedAddressesWithHosts:(NSArray *)hosts;
-- (void)removeInactiveHost:(NSString *)host;
-- (BOOL)isInactiveHost:(NSString *)host;
 - (BOOL)isPendingHost:(NSString *)host;
 - (BOOL)isConnectedHost:(NSString *)host;
 - (WSPeer *)bestPeer;
+- (WSPeer *)bestPeerExcludingPeer:(WSPeer *)excludedPeer;
+- (NSTimeInterval)estimatedTransferTimeForPeer:(WSPeer *)peer;
+- (void)trySwitchToFasterDownloadPeer;
 + (BOOL)isHardNetworkError:(NSError *)error;
++ (BOOL)isMisbehaviorError:(NSError *)error;
 
 - (void)loadFilterAndStartDownload;
+- (void)startDownloadFromDownloadPeer;
+- (void)scheduleBlockDownloads;
+- (void)requestOutdatedBlocksFromPeer:(WSPeer *)peer;
 - (void)resetBloomFilter;
+- (void)resetBlockMatcher;
 - (void)reloadBloomFilter;
 - (BOOL)maybeResetAndSendBloomFilter;
+- (BOOL)tryUpdateAndSendBloomFilter;
+- (void)loadBloomFilterOnPeers;
+- (void)tuneBloomFilterWithFilteredBlock:(WSFilteredBlock *)filteredBlock transactions:(NSOrderedSet *)transactions;
+- (NSUInteger)numberOfFilteringPeers;
 - (BOOL)shouldDownloadBlocks;
 - (BOOL)needsBloomFiltering;
-- (void)detectDownloadTimeout;
+- (BOOL)needsLocalFiltering;
+- (void)recordDownloadOfBlocks:(NSUInteger)blocks bytes:(NSUInteger)bytes fromPeer:(WSPeer *)peer;
+- (void)startStallDetection;
+- (void)stopStallDetection;
+- (void)detectDownloadStall;
+- (BOOL)isDownloadPeerBusy;
+- (void)handOffDownloadFromPeer:(WSPeer *)peer error:(NSError *)error;
+- (BOOL)shouldIgnoreDownloadFromPeer:(WSPeer *)peer;
 - (void)trySaveBlockChainToCoreData;
+- (void)trySaveAddresses;
 
-- (BOOL)validateHeaderAgainstCheckpoints:(WSBlockHeader *)header error:(NSError **)error;
+- (BOOL)validateHeaderAgainstCheckpoints:(WSBlockHeader *)header atHeight:(uint32_t)height error:(NSError **)error;
+- (NSUInteger)extendSkeletonWithHeaders:(NSArray *)headers fromPeer:(WSPeer *)peer;
+- (void)resyncSkeletonFromBlockId:(WSHash256 *)blockId withPeer:(WSPeer *)peer;
+- (void)resetSkeleton;
 - (void)handleAddedBlock:(WSStorableBlock *)block fromPeer:(WSPeer *)peer;
+- (void)handleAddedBlocks:(NSArray *)blocks fromPeer:(WSPeer *)peer;
 - (void)handleReplacedBlock:(WSStorableBlock *)block fromPeer:(WSPeer *)peer;
+- (void)handleFilteredBlock:(WSFilteredBlock *)filteredBlock withTransactions:(NSOrderedSet *)transactions fromPeer:(WSPeer *)peer;
+- (void)handleBlock:(WSBlock *)block fromPeer:(WSPeer *)peer;
 - (void)handleReceivedTransaction:(WSSignedTransaction *)transaction fromPeer:(WSPeer *)peer;
 - (void)handleReorganizeAtBase:(WSStorableBlock *)base oldBlocks:(NSArray *)oldBlocks newBlocks:(NSArray *)newBlocks fromPeer:(WSPeer *)peer;
 - (void)handleMisbehavingPeer:(WSPeer *)peer error:(NSError *)error;
@@ -225,22 +275,35 @@
         self.bloomFilterObservedRateMax = WSPeerGroupDefaultBFObservedRateMax;
         self.bloomFilterLowPassRatio = WSPeerGroupDefaultBFLowPassRatio;
         self.bloomFilterTxsPerBlock = WSPeerGroupDefaultBFTxsPerBlock;
+        self.bloomFilterRebuildRatio = WSPeerGroupDefaultBFRebuildRatio;
+        self.bloomFilterHorizon = WSPeerGroupDefaultBFHorizon;
         self.blockStoreSize = 2500;
 
         // peer related
         self.headersOnly = NO;
+        self.headersFirst = NO;
+        self.localFiltering = NO;
         self.requestTimeout = WSPeerGroupDefaultRequestTimeout;
+        self.pingInterval = WSPeerGroupDefaultPingInterval;
+        self.downloadRateWindow = WSPeerGroupDefaultRateWindow;
+        self.minDownloadBlockRate = WSPeerGroupDefaultMinBlockRate;
+        self.minDownloadByteRate = WSPeerGroupDefaultMinByteRate;
         
         self.keepConnected = NO;
         self.connectionFailures = 0;
-        self.inactiveAddresses = [[NSMutableOrderedSet alloc] init];
+        self.addressManager = [[WSAddressManager alloc] initWithParameters:self.parameters];
         self.misbehavingHosts = [[NSMutableSet alloc] init];
         self.pendingPeers = [[NSMutableSet alloc] init];
         self.connectedPeers = [[NSMutableSet alloc] init];
+        self.rateMonitors = [[NSMutableDictionary alloc] init];
+        self.peerFalsePositiveRates = [[NSMutableDictionary alloc] init];
         self.publishedTransactions = [[NSMutableDictionary alloc] init];
 
         self.keepDownloading = NO;
         self.downloadPeer = nil;
+        self.downloadScheduler = [[WSBlockDownloadScheduler alloc] init];
+        self.filteredPeers = [[NSMutableSet alloc] init];
+        self.recentSkeletonIds = [[NSMutableOrderedSet alloc] init];
         if (self.wallet) {
             self.bloomFilterParameters = [[WSBIP37FilterParameters alloc] init];
 #if WASPV_WALLET_FILTER == WASPV_WALLET_FILTER_UNSPENT
@@ -256,6 +319,9 @@
 - (void)dealloc
 {
     [NSObject cancelPreviousPerformRequestsWithTarget:self];
+    if (_stallTimer) {
+        dispatch_source_cancel(_stallTimer);
+    }
     [self disconnect];
     [[NSNotificationCenter defaultCenter] removeObserver:self];
     [self.reachability stopNotifier];
@@ -268,6 +334,18 @@
     [self.blockChain loadFromCoreDataManager:coreDataManager];
 }
 
+- (void)setAddressesPath:(NSString *)addressesPath
+{
+    NSString *path = [addressesPath copy];
+
+    // file is loaded off queue, manager is only swapped on queue
+    WSAddressManager *addressManager = [[WSAddressManager alloc] initWithParameters:self.parameters path:path];
+    dispatch_sync(self.queue, ^{
+        _addressesPath = path;
+        self.addressManager = addressManager;
+    });
+}
+
 - (void)setPeerHosts:(NSArray *)peerHosts
 {
     _peerHosts = peerHosts;
@@ -292,6 +370,7 @@
         self.keepDownloading = NO;
         self.keepConnected = NO;
         [self disconnect];
+        [self trySaveAddresses];
     });
     return YES;
 }
@@ -318,6 +397,7 @@
         self.keepDownloading = NO;
         self.keepConnected = NO;
         [self disconnect];
+        [self trySaveAddresses];
 
         if ([self unsafeIsConnected]) {
             __weak NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
@@ -411,6 +491,7 @@
     __block BOOL stopped = NO;
     dispatch_sync(self.queue, ^{
         self.keepDownloading = NO;
+        [self stopStallDetection];
         if (self.downloadPeer) {
 
             // not reconnecting without error
@@ -495,8 +576,27 @@
             status.recentBlocks = recentBlocks;
         }
 
-        status.sentBytes = self.sentBytes;
-        status.receivedBytes = self.receivedBytes;
+        uint64_t sentBytes = self.closedSentBytes;
+        uint64_t receivedBytes = self.closedReceivedBytes;
+        for (WSPeer *peer in [self.pendingPeers setByAddingObjectsFromSet:self.connectedPeers]) {
+            sentBytes += peer.sentBytes;
+            receivedBytes += peer.receivedBytes;
+        }
+        status.sentBytes = (NSUInteger)sentBytes;
+        status.receivedBytes = (NSUInteger)receivedBytes;
+
+        NSMutableDictionary *pingTimes = [[NSMutableDictionary alloc] initWithCapacity:self.connectedPeers.count];
+        NSMutableDictionary *downloadSpeeds = [[NSMutableDictionary alloc] initWithCapacity:self.connectedPeers.count];
+        for (WSPeer *peer in self.connectedPeers) {
+            const NSTimeInterval pingTime = peer.pingTime;
+            if (pingTime != DBL_MAX) {
+                pingTimes[peer.remoteHost] = @(pingTime);
+            }
+            downloadSpeeds[peer.remoteHost] = @(peer.downloadSpeed);
+        }
+        status.downloadPeerHost = self.downloadPeer.remoteHost;
+        status.pingTimes = pingTimes;
+        status.downloadSpeeds = downloadSpeeds;
     });
     return status;
 }
@@ -557,15 +657,18 @@
 - (void)saveState
 {
     [self trySaveBlockChainToCoreData];
+    dispatch_sync(self.queue, ^{
+        [self trySaveAddresses];
+    });
 }
 
 #pragma mark Events (group queue)
 
 - (void)peerDidConnect:(WSPeer *)peer
 {
-    [self removeInactiveHost:peer.remoteHost];
     [self.pendingPeers removeObject:peer];
     [self.connectedPeers addObject:peer];
+    self.rateMonitors[peer.remoteHost] = [[WSRateMonitor alloc] initWithWindow:self.downloadRateWindow];
     
     DDLogInfo(@"Connected to %@ at height %u (active: %u)", peer, peer.lastBlockHeight, self.connectedPeers.count);
     DDLogInfo(@"Active peers: %@", self.connectedPeers);
@@ -596,6 +699,9 @@
     
     // peer was accepted
     
+    [self.addressManager didConnectToAddress:WSNetworkAddressMake(peer.remoteAddress, peer.remotePort, peer.services, WSCurrentTimestamp())];
+    [self trySaveAddresses];
+
     if (self.downloadPeer && (peer.lastBlockHeight <= self.downloadPeer.lastBlockHeight)) {
         DDLogDebug(@"Peer %@ is not ahead of current download peer, marked common (height: %u <= %u)",
                    peer, peer.lastBlockHeight, self.downloadPeer.lastBlockHeight);
@@ -654,6 +760,8 @@
 {
     [peer cleanUpConnectionData];
     [self.pendingPeers removeObject:peer];
+    self.closedSentBytes += peer.sentBytes;
+    self.closedReceivedBytes += peer.receivedBytes;
 
     DDLogInfo(@"Failed to connect to %@%@", peer, WSStringOptional(error, @" (%@)"));
 
@@ -665,6 +773,14 @@
     [peer cleanUpConnectionData];
     [self.pendingPeers removeObject:peer];
     [self.connectedPeers removeObject:peer];
+    [self.rateMonitors removeObjectForKey:peer.remoteHost];
+    [self.peerFalsePositiveRates removeObjectForKey:peer.remoteHost];
+    self.closedSentBytes += peer.sentBytes;
+    self.closedReceivedBytes += peer.receivedBytes;
+    [self.filteredPeers removeObject:peer];
+    if ([self.downloadScheduler releaseWindowsOfPeer:peer] > 0) {
+        DDLogDebug(@"Reassigning blocks scheduled on %@", peer);
+    }
 
     DDLogInfo(@"Disconnected from %@ (active: %u)%@", peer, self.connectedPeers.count, WSStringOptional(error, @" (%@)"));
     DDLogInfo(@"Active peers: %@", self.connectedPeers);
@@ -676,8 +792,14 @@
     }
 
     if (error && (error.domain == WSErrorDomain)) {
-        DDLogDebug(@"Disconnection due to known error (%@)", error);
-        [self removeInactiveHost:peer.remoteHost];
+        if ([self.misbehavingHosts containsObject:peer.remoteHost] || [[self class] isMisbehaviorError:error]) {
+            DDLogDebug(@"Disconnection due to misbehavior, forgetting host (%@)", error);
+            [self.addressManager removeHost:peer.remoteHost];
+        }
+        else {
+            // attempt already recorded on connection
+            DDLogDebug(@"Disconnection due to known error, keeping host (%@)", error);
+        }
     }
 
     if (error.code == WSErrorCodePeerGroupRescan) {
@@ -719,137 +841,157 @@
             }
         }
     }
+    else {
+        [self scheduleBlockDownloads];
+    }
 
     [self handleConnectionFailureFromPeer:peer error:error];
 }
 
 - (void)peerDidKeepAlive:(WSPeer *)peer
 {
-    if (peer == self.downloadPeer) {
+    if ((peer == self.downloadPeer) || ([self.downloadScheduler numberOfWindowsForPeer:peer] > 0)) {
         self.lastKeepAliveTime = [NSDate timeIntervalSinceReferenceDate];
     }
 }
 
-- (void)peer:(WSPeer *)peer didReceiveHeader:(WSBlockHeader *)header
+- (void)peer:(WSPeer *)peer didReceiveHeaders:(NSArray *)headers
 {
-    DDLogVerbose(@"Received header from %@: %@", peer, header);
+    DDLogVerbose(@"Received %u headers from %@", headers.count, peer);
     
+    // late response from former download peer, headers must not bypass skeleton or current download
+    if ([self shouldIgnoreDownloadFromPeer:peer]) {
+        DDLogDebug(@"Ignoring %u headers from non-download peer %@ while syncing", headers.count, peer);
+        return;
+    }
+
+    // headers-first, headers beyond catch-up only extend skeleton, bodies are scheduled across peers
+    if ((peer == self.downloadPeer) && peer.shouldDownloadHeadersFirst) {
+        NSUInteger count = 0;
+        if (!self.skeletonBlock) {
+            for (WSBlockHeader *header in headers) {
+                if (header.timestamp >= self.fastCatchUpTimestamp) {
+                    break;
+                }
+                ++count;
+            }
+        }
+        if (count < headers.count) {
+            
+            // skeleton starts from updated head
+            if (count > 0) {
+                [self peer:peer didReceiveHeaders:[headers subarrayWithRange:NSMakeRange(0, count)]];
+            }
+            [self recordDownloadOfBlocks:(headers.count - count) bytes:0 fromPeer:peer];
+            [self extendSkeletonWithHeaders:[headers subarrayWithRange:NSMakeRange(count, headers.count - count)] fromPeer:peer];
+            return;
+        }
+    }
+
+    [self recordDownloadOfBlocks:headers.count bytes:0 fromPeer:peer];
+
     NSError *error;
-    WSStorableBlock *block = nil;
     __weak WSPeerGroup *weakSelf = self;
 
-    if (![self validateHeaderAgainstCheckpoints:header error:&error]) {
-        [self.pool closeConnectionForProcessor:peer error:error];
-        return;
+    // headers may fork or overlap main chain, check them at their actual heights (unknown for orphans)
+    WSStorableBlock *parent = nil;
+    if (headers.count > 0) {
+        parent = [self.blockChain blockForId:[headers.firstObject previousBlockId]];
+    }
+    if (parent) {
+        uint32_t height = parent.height;
+        for (WSBlockHeader *header in headers) {
+            ++height;
+            if (![self validateHeaderAgainstCheckpoints:header atHeight:height error:&error]) {
+                [self.pool closeConnectionForProcessor:peer error:error];
+                return;
+            }
+        }
     }
 
     NSArray *connectedOrphans;
-    block = [self.blockChain addBlockWithHeader:header reorganizeBlock:^(WSStorableBlock *base, NSArray *oldBlocks, NSArray *newBlocks) {
+    NSArray *blocks = [self.blockChain addBlockHeaders:headers reorganizeBlock:^(WSStorableBlock *base, NSArray *oldBlocks, NSArray *newBlocks) {
 
         [weakSelf handleReorganizeAtBase:base oldBlocks:oldBlocks newBlocks:newBlocks fromPeer:peer];
 
     } connectedOrphans:&connectedOrphans error:&error];
-    
-    if (!block) {
-        if (!error) {
-            DDLogDebug(@"Header not added: %@", header);
-        }
-        else {
-            DDLogDebug(@"Error adding header (%@): %@", error, header);
 
-            if ((error.domain == WSErrorDomain) && (error.code == WSErrorCodeInvalidBlock)) {
-                [self handleMisbehavingPeer:peer error:error];
-            }
-        }
-        DDLogDebug(@"Current head: %@", self.blockChain.head);
+    if (error) {
+        DDLogDebug(@"Error adding headers (%@), added %u out of %u", error, blocks.count, headers.count);
         
+        if ((error.domain == WSErrorDomain) && (error.code == WSErrorCodeInvalidBlock)) {
+            [self handleMisbehavingPeer:peer error:error];
+        }
+    }
+    if ((blocks.count == 0) && (connectedOrphans.count == 0)) {
+        DDLogDebug(@"Headers not added, current head: %@", self.blockChain.head);
         return;
     }
 
-    for (WSStorableBlock *addedBlock in [connectedOrphans arrayByAddingObject:block]) {
-        [self handleAddedBlock:addedBlock fromPeer:peer];
-    }
+    [self handleAddedBlocks:[blocks arrayByAddingObjectsFromArray:connectedOrphans] fromPeer:peer];
 }
 
 - (void)peer:(WSPeer *)peer didReceiveBlock:(WSBlock *)block
 {
     DDLogVerbose(@"Received full block from %@: %@", peer, block);
 
-#warning FIXME: handle full blocks, blockchain not extending in full blocks mode
+    if (![self needsLocalFiltering]) {
+        DDLogDebug(@"Ignoring unrequested full block from %@", peer);
+        return;
+    }
+    if ([self shouldIgnoreDownloadFromPeer:peer]) {
+        DDLogDebug(@"Ignoring full block from non-download peer %@ while syncing", peer);
+        return;
+    }
+
+    [self recordDownloadOfBlocks:1 bytes:0 fromPeer:peer];
+    [self handleBlock:block fromPeer:peer];
 }
 
-- (void)peer:(WSPeer *)peer didReceiveFilteredBlock:(WSFilteredBlock *)filteredBlock withTransactions:(NSOrderedSet *)transactions
+- (void)peer:(WSPeer *)peer didReceiveBlockHashes:(NSArray *)hashes
 {
-    DDLogVerbose(@"Received filtered block from %@: %@", peer, filteredBlock);
-
-    NSError *error;
-    WSStorableBlock *block = nil;
-    WSStorableBlock *previousHead = nil;
-    __weak WSPeerGroup *weakSelf = self;
+    DDLogVerbose(@"Received %u block hashes to schedule from %@", hashes.count, peer);
 
-    if (![self validateHeaderAgainstCheckpoints:filteredBlock.header error:&error]) {
-        [self.pool closeConnectionForProcessor:peer error:error];
+    // headers-first, announced blocks are also announced by headers until skeleton reaches tip
+    if (peer.shouldDownloadHeadersFirst && (self.skeletonHeight < peer.lastBlockHeight)) {
+        DDLogDebug(@"Skeleton still behind (%u < %u), ignoring announced blocks", self.skeletonHeight, peer.lastBlockHeight);
+        return;
+    }
+    if ([self shouldIgnoreDownloadFromPeer:peer]) {
+        DDLogDebug(@"Ignoring %u block hashes from non-download peer %@ while syncing", hashes.count, peer);
         return;
     }
 
-    NSArray *connectedOrphans;
-    previousHead = self.blockChain.head;
-    block = [self.blockChain addBlockWithHeader:filteredBlock.header transactions:transactions reorganizeBlock:^(WSStorableBlock *base, NSArray *oldBlocks, NSArray *newBlocks) {
+    [self.downloadScheduler enqueueBlockIds:hashes];
+    [self scheduleBlockDownloads];
+}
 
-        [weakSelf handleReorganizeAtBase:base oldBlocks:oldBlocks newBlocks:newBlocks fromPeer:peer];
+- (void)peer:(WSPeer *)peer didReceiveFilteredBlock:(WSFilteredBlock *)filteredBlock withTransactions:(NSOrderedSet *)transactions
+{
+    DDLogVerbose(@"Received filtered block from %@: %@", peer, filteredBlock);
 
-    } connectedOrphans:&connectedOrphans error:&error];
-    
-    if (!block) {
-        if (!error) {
-            DDLogDebug(@"Filtered block not added: %@", filteredBlock);
-        }
-        else {
-            DDLogDebug(@"Error adding filtered block (%@): %@", error, filteredBlock);
+    if (![self.downloadScheduler isScheduledBlockId:filteredBlock.header.blockId]) {
 
-            if ((error.domain == WSErrorDomain) && (error.code == WSErrorCodeInvalidBlock)) {
-                [self handleMisbehavingPeer:peer error:error];
-            }
+        // unscheduled blocks in flight on former download peer were requested again from current one
+        if ([self shouldIgnoreDownloadFromPeer:peer]) {
+            DDLogDebug(@"Ignoring unscheduled filtered block from non-download peer %@ while syncing", peer);
+            return;
         }
-        DDLogDebug(@"Current head: %@", self.blockChain.head);
-        
+        [self recordDownloadOfBlocks:1 bytes:0 fromPeer:peer];
+        [self handleFilteredBlock:filteredBlock withTransactions:transactions fromPeer:peer];
         return;
     }
 
-    //
-    // adapted from: https://github.com/voisine/breadwallet/blob/master/BreadWallet/BRPeerManager.m
-    //
-    // low-pass filter in [BRPeerManager peer:relayedBlock:]
-    //
-    if ((peer == self.downloadPeer) && (transactions.count > 0)) {
-        const double oldRate = self.observedFalsePositiveRate;
-        self.observedFalsePositiveRate = (self.observedFalsePositiveRate *
-                                          (1.0 - self.bloomFilterLowPassRatio * filteredBlock.partialMerkleTree.txCount / self.bloomFilterTxsPerBlock) +
-                                          self.bloomFilterLowPassRatio * transactions.count / self.bloomFilterTxsPerBlock);
-        
-        DDLogVerbose(@"Observed false positive rate at #%u: %f * (1.0 - %.2f * %u / %u) + %.2f * %u / %u = %f",
-                     self.blockChain.currentHeight, oldRate,
-                     self.bloomFilterLowPassRatio, filteredBlock.partialMerkleTree.txCount, self.bloomFilterTxsPerBlock,
-                     self.bloomFilterLowPassRatio, transactions.count, self.bloomFilterTxsPerBlock,
-                     self.observedFalsePositiveRate);
-        
-        if (self.observedFalsePositiveRate > self.bloomFilterObservedRateMax) {
-            [self.pool closeConnectionForProcessor:self.downloadPeer
-                                             error:WSErrorMake(WSErrorCodePeerGroupSync, @"Too many false positives (%f > %f) in the %u-%u range (%u blocks), disconnecting",
-                                                               self.observedFalsePositiveRate, self.bloomFilterObservedRateMax,
-                                                               self.observedFilterHeight, self.blockChain.currentHeight,
-                                                               self.blockChain.currentHeight - self.observedFilterHeight)];
-        }
-    }
-    
-    for (WSStorableBlock *addedBlock in [connectedOrphans arrayByAddingObject:block]) {
-        if (![addedBlock.blockId isEqual:previousHead.blockId]) {
-            [self handleAddedBlock:addedBlock fromPeer:peer];
-        }
-        else {
-            [self handleReplacedBlock:addedBlock fromPeer:peer];
-        }
+    [self recordDownloadOfBlocks:1 bytes:0 fromPeer:peer];
+
+    // blocks are added in chain order regardless of the peer they came from
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if ([self.downloadScheduler completeFilteredBlock:filteredBlock transactions:transactions fromPeer:peer atTime:now]) {
+        [self.downloadScheduler dequeueCompletedBlocksWithHandler:^(WSFilteredBlock *filteredBlock, NSOrderedSet *transactions, id sourcePeer) {
+            [self handleFilteredBlock:filteredBlock withTransactions:transactions fromPeer:sourcePeer];
+        }];
     }
+    [self scheduleBlockDownloads];
 }
 
 - (void)peer:(WSPeer *)peer didReceiveTransaction:(WSSignedTransaction *)transaction
@@ -867,7 +1009,7 @@
         return;
     }
 
-    [self.inactiveAddresses addObjectsFromArray:addresses];
+    [self.addressManager addAddresses:addresses];
 
 //    if (isLastRelay && (self.connectedPeers.count < self.maxConnections)) {
     if (self.connectedPeers.count < self.maxConnections) {
@@ -877,9 +1019,13 @@
 
 - (void)peer:(WSPeer *)peer didReceivePongMesage:(WSMessagePong *)pong
 {
-    DDLogDebug(@"Received 'pong' with nonce: %llu", pong.nonce);
+    DDLogDebug(@"Received 'pong' with nonce: %llu (ping time: %.3fs)", pong.nonce, peer.pingTime);
 
-#warning TODO: track ping time
+    if (peer.pingTime != DBL_MAX) {
+        [self.addressManager setPingTime:peer.pingTime forHost:peer.remoteHost];
+    }
+
+    [self trySwitchToFasterDownloadPeer];
 }
 
 - (void)peer:(WSPeer *)peer didReceiveDataRequestWithInventories:(NSArray *)inventories
@@ -948,14 +1094,9 @@
     [peer sendFilterloadMessageWithFilter:self.bloomFilter];
 }
 
-- (void)peer:(WSPeer *)peer didSendNumberOfBytes:(NSUInteger)numberOfBytes
-{
-    self.sentBytes += numberOfBytes;
-}
-
 - (void)peer:(WSPeer *)peer didReceiveNumberOfBytes:(NSUInteger)numberOfBytes
 {
-    self.receivedBytes += numberOfBytes;
+    [self recordDownloadOfBlocks:0 bytes:numberOfBytes fromPeer:peer];
 }
 
 #pragma mark Application state (main queue)
@@ -993,21 +1134,29 @@
     
     if (self.peerHosts.count > 0) {
         NSArray *newAddresses = [self disconnectedAddressesWithHosts:self.peerHosts];
-        [self.inactiveAddresses addObjectsFromArray:newAddresses];
+        [self.addressManager addAddresses:newAddresses];
         
-        DDLogInfo(@"Connecting to inactive peers (available: %u)", self.inactiveAddresses.count);
-//        DDLogDebug(@"%@", self.inactiveAddresses);
+        DDLogInfo(@"Connecting to inactive peers (available: %u)", self.addressManager.count);
         [self triggerConnectionsFromInactive];
     }
     else {
-        if (self.inactiveAddresses.count > 0) {
-            [self triggerConnectionsFromInactive];
-            return;
-        }
         
-        if ((self.connectedPeers.count > 0) || (self.pendingPeers.count > 0)) {
-            DDLogDebug(@"Active peers around, skip DNS discovery (connected: %u, pending: %u)", self.connectedPeers.count, self.pendingPeers.count);
-            return;
+        // known addresses first, no discovery needed unless they look stale
+        const NSUInteger triggered = [self triggerConnectionsFromInactive];
+        const BOOL areKnownAddressesStale = (![self.addressManager hasRecentSuccess] ||
+                                             (self.connectionFailures >= WSPeerGroupFailuresBeforeDiscovery));
+
+        if (!areKnownAddressesStale) {
+            if (triggered > 0) {
+                return;
+            }
+            if ((self.connectedPeers.count > 0) || (self.pendingPeers.count > 0)) {
+                DDLogDebug(@"Active peers around, skip DNS discovery (connected: %u, pending: %u)", self.connectedPeers.count, self.pendingPeers.count);
+                return;
+            }
+        }
+        else {
+            DDLogDebug(@"Known addresses look stale (failures: %u), falling back to DNS discovery", self.connectionFailures);
         }
         
         // first bootstrap is from DNS
@@ -1021,7 +1170,7 @@
                 return;
             }
             
-            [self.inactiveAddresses addObjectsFromArray:newAddresses];
+            [self.addressManager addAddresses:newAddresses];
             DDLogInfo(@"Connecting to discovered non-connected peers (available: %u)", newAddresses.count);
             DDLogDebug(@"%@", newAddresses);
             [self triggerConnectionsFromSeed:seed addresses:newAddresses];
@@ -1095,7 +1244,7 @@
                         const uint32_t address = rawAddress->sin_addr.s_addr;
                         NSString *host = WSNetworkHostFromIPv4(address);
                         
-                        if (host && ![self isInactiveHost:host]) {
+                        if (host && ![self.addressManager containsHost:host]) {
                             [hosts addObject:host];
                         }
                     }
@@ -1131,74 +1280,33 @@
         [self openConnectionToPeerHost:address.host];
         [triggered addObject:address];
     }
-    [self.inactiveAddresses removeObjectsInArray:triggered];
     
     DDLogDebug(@"Triggered %u new connections from %@", triggered.count, seed);
 }
 
-- (void)triggerConnectionsFromInactive
+- (NSUInteger)triggerConnectionsFromInactive
 {
-    NSMutableArray *triggered = [[NSMutableArray alloc] init];
-    
-    // recent first
-    [self.inactiveAddresses sortUsingComparator:^NSComparisonResult(WSNetworkAddress *a1, WSNetworkAddress *a2) {
-        if (a1.timestamp > a2.timestamp) {
-            return NSOrderedAscending;
-        }
-        else if (a1.timestamp < a2.timestamp) {
-            return NSOrderedDescending;
-        }
-        else {
-            return NSOrderedSame;
-        }
-    }];
-    
-    // cap total
-    if (self.inactiveAddresses.count > WSPeerGroupMaxInactivePeers) {
-        [self.inactiveAddresses removeObjectsInRange:NSMakeRange(WSPeerGroupMaxInactivePeers, self.inactiveAddresses.count - WSPeerGroupMaxInactivePeers)];
-    }
+    NSUInteger triggered = 0;
     
-    DDLogDebug(@"Sorted %u inactive addresses", self.inactiveAddresses.count);
-//    DDLogDebug(@">>> %@", self.inactiveAddresses);
-//
-//    // sequential
-//    for (WSNetworkAddress *address in self.inactiveAddresses) {
-//        if ([self isPendingHost:address.host] || [self.misbehavingHosts containsObject:address.host]) {
-//            continue;
-//        }
-//        if (self.connectedPeers.count + self.pendingPeers.count >= self.maxConnections) {
-//            break;
-//        }
-//
-//        [self openConnectionToPeerHost:address.host];
-//        [triggered addObject:address];
-//    }
-//    [self.inactiveAddresses removeObjectsInArray:triggered];
-    
-    // randomic
-    while (self.inactiveAddresses.count > 0) {
-        
-        //
-        // taken from: https://github.com/voisine/breadwallet/blob/master/BreadWallet/BRPeerManager.m
-        //
-        // prefer recent from inactive (higher probability of retrieving lower offsets)
-        //
-        WSNetworkAddress *address = self.inactiveAddresses[(NSUInteger)(pow(lrand48() % self.inactiveAddresses.count, 2) / self.inactiveAddresses.count)];
-        
-        if ([self isPendingHost:address.host] || [self.misbehavingHosts containsObject:address.host]) {
-            continue;
-        }
-        if (self.connectedPeers.count + self.pendingPeers.count >= self.maxConnections) {
+    while (self.connectedPeers.count + self.pendingPeers.count < self.maxConnections) {
+        WSNetworkAddress *address = [self.addressManager bestAddressPassingTest:^BOOL(WSNetworkAddress *address) {
+            return ((!self.peerHosts || [self.peerHosts containsObject:address.host]) &&
+                    ![self isPendingHost:address.host] &&
+                    ![self isConnectedHost:address.host] &&
+                    ![self.misbehavingHosts containsObject:address.host]);
+        }];
+        if (!address) {
             break;
         }
         
         [self openConnectionToPeerHost:address.host];
-        [triggered addObject:address];
-        
-        [self.inactiveAddresses removeObject:address];
+        ++triggered;
     }
     
-    DDLogDebug(@"Triggered %u new connections from inactive", triggered.count);
+    DDLogDebug(@"Triggered %u new connections from known addresses (available: %u, tried: %u)",
+               triggered, self.addressManager.count, self.addressManager.triedCount);
+    
+    return triggered;
 }
 
 - (void)openConnectionToPeerHost:(NSString *)host
@@ -1208,11 +1316,13 @@
     WSPeerParameters *peerParameters = [[WSPeerParameters alloc] initWithParameters:self.parameters
                                                                shouldDownloadBlocks:[self shouldDownloadBlocks]
                                                                 needsBloomFiltering:[self needsBloomFiltering]];
+    peerParameters.pingInterval = self.pingInterval;
     
     WSPeer *peer = [[WSPeer alloc] initWithHost:host peerParameters:peerParameters];
     peer.delegate = self;
     peer.delegateQueue = self.queue;
     [self.pendingPeers addObject:peer];
+    [self.addressManager didAttemptHost:host];
     
     DDLogInfo(@"Connecting to peer %@", peer);
     [self.pool openConnectionToPeer:peer];
@@ -1242,7 +1352,7 @@
             
             if ([[self class] isHardNetworkError:error]) {
                 DDLogDebug(@"Hard error from peer %@", peer.remoteHost);
-                [self removeInactiveHost:peer.remoteHost];
+                [self.addressManager removeHost:peer.remoteHost];
             }
             
             if (self.connectedPeers.count < self.maxConnections) {
@@ -1275,31 +1385,6 @@
     return disconnected;
 }
 
-- (void)removeInactiveHost:(NSString *)host
-{
-    WSNetworkAddress *addressToRemove;
-    for (WSNetworkAddress *address in self.inactiveAddresses) {
-        if ([address.host isEqualToString:host]) {
-            addressToRemove = address;
-        }
-    }
-    if (addressToRemove) {
-        [self.inactiveAddresses removeObject:addressToRemove];
-        
-        DDLogDebug(@"Removed host %@ from inactive (available: %u)", host, self.inactiveAddresses.count);
-    }
-}
-
-- (BOOL)isInactiveHost:(NSString *)host
-{
-    for (WSNetworkAddress *address in self.inactiveAddresses) {
-        if ([address.host isEqualToString:host]) {
-            return YES;
-        }
-    }
-    return NO;
-}
-
 - (BOOL)isPendingHost:(NSString *)host
 {
     for (WSPeer *peer in self.pendingPeers) {
@@ -1321,19 +1406,25 @@
 }
 
 - (WSPeer *)bestPeer
+{
+    return [self bestPeerExcludingPeer:nil];
+}
+
+- (WSPeer *)bestPeerExcludingPeer:(WSPeer *)excludedPeer
 {
     WSPeer *bestPeer = nil;
     for (WSPeer *peer in self.connectedPeers) {
         
         // double check connection status
-        if (peer.peerStatus != WSPeerStatusConnected) {
+        if ((peer == excludedPeer) || (peer.peerStatus != WSPeerStatusConnected)) {
             continue;
         }
         
-        // max chain height or min ping
+        // max chain height or min transfer time
         if (!bestPeer ||
             (peer.lastBlockHeight > bestPeer.lastBlockHeight) ||
-            ((peer.lastBlockHeight == bestPeer.lastBlockHeight) && (peer.connectionTime < bestPeer.connectionTime))) {
+            ((peer.lastBlockHeight == bestPeer.lastBlockHeight) &&
+             ([self estimatedTransferTimeForPeer:peer] < [self estimatedTransferTimeForPeer:bestPeer]))) {
             
             bestPeer = peer;
         }
@@ -1341,6 +1432,48 @@
     return bestPeer;
 }
 
+// latency plus time to receive a reference payload, unknown speed only counts latency
+- (NSTimeInterval)estimatedTransferTimeForPeer:(WSPeer *)peer
+{
+    NSParameterAssert(peer);
+    
+    NSTimeInterval latency = peer.pingTime;
+    if (latency == DBL_MAX) {
+        latency = peer.connectionTime;
+    }
+    const double speed = peer.downloadSpeed;
+    if (speed == 0.0) {
+        return latency;
+    }
+    return latency + WSPeerGroupScoreReferenceBytes / speed;
+}
+
+- (void)trySwitchToFasterDownloadPeer
+{
+    if (!self.downloadPeer || !self.keepDownloading || [self unsafeIsSynced]) {
+        return;
+    }
+    
+    WSPeer *bestPeer = [self bestPeer];
+    if (!bestPeer || (bestPeer == self.downloadPeer)) {
+        return;
+    }
+    
+    // only compare measured peers, then require a clear margin to pay off disconnection
+    if ((self.downloadPeer.downloadSpeed == 0.0) || (bestPeer.downloadSpeed == 0.0)) {
+        return;
+    }
+    const NSTimeInterval downloadTime = [self estimatedTransferTimeForPeer:self.downloadPeer];
+    const NSTimeInterval bestTime = [self estimatedTransferTimeForPeer:bestPeer];
+    if (bestTime * WSPeerGroupDownloadPeerSwitchRatio > downloadTime) {
+        return;
+    }
+    
+    DDLogInfo(@"Download peer %@ is slow (%.3fs > %.3fs of %@)", self.downloadPeer, downloadTime, bestTime, bestPeer);
+    [self handOffDownloadFromPeer:self.downloadPeer
+                            error:WSErrorMake(WSErrorCodePeerGroupSync, @"Found a faster download peer than %@", self.downloadPeer)];
+}
+
 + (BOOL)isHardNetworkError:(NSError *)error
 {
     static NSMutableDictionary *hardCodes;
@@ -1360,20 +1493,49 @@
     return ((error.domain != WSErrorDomain) && [hardCodes[error.domain] containsObject:@(error.code)]);
 }
 
+// invalid data or a different chain, other known errors are transient
++ (BOOL)isMisbehaviorError:(NSError *)error
+{
+    static NSSet *misbehaviorCodes;
+    static dispatch_once_t onceToken;
+    
+    dispatch_once(&onceToken, ^{
+        misbehaviorCodes = [NSSet setWithArray:@[@(WSErrorCodeMalformed),
+                                                 @(WSErrorCodePeerGroupRescan),
+                                                 @(WSErrorCodeInvalidPartialMerkleTree),
+                                                 @(WSErrorCodeInvalidBlock),
+                                                 @(WSErrorCodeInvalidTransaction)]];
+    });
+    
+    return ((error.domain == WSErrorDomain) && [misbehaviorCodes containsObject:@(error.code)]);
+}
+
 #pragma mark Sync helpers (unsafe)
 
 - (void)loadFilterAndStartDownload
 {
     NSAssert(self.downloadPeer, @"No download peer set");
     
+    [self.downloadScheduler reset];
+    [self.filteredPeers removeAllObjects];
+    [self resetSkeleton];
+
     if ([self needsBloomFiltering]) {
         [self resetBloomFilter];
         
         DDLogDebug(@"Loading Bloom filter for download peer %@", self.downloadPeer);
         [self.downloadPeer sendFilterloadMessageWithFilter:self.bloomFilter];
+        [self.filteredPeers addObject:self.downloadPeer];
     }
     else if ([self shouldDownloadBlocks]) {
-        DDLogDebug(@"No wallet provided, downloading full blocks");
+        [self resetBlockMatcher];
+
+        if (self.wallet) {
+            DDLogDebug(@"Local filtering, downloading full blocks");
+        }
+        else {
+            DDLogDebug(@"No wallet provided, downloading full blocks");
+        }
     }
     else {
         DDLogDebug(@"No wallet provided, downloading block headers");
@@ -1381,16 +1543,25 @@
     
     DDLogInfo(@"Preparing for blockchain sync");
     
-    [self.downloadPeer downloadBlockChain:self.blockChain fastCatchUpTimestamp:self.fastCatchUpTimestamp prestartBlock:^(NSUInteger fromHeight, NSUInteger toHeight) {
+    // filtered blocks are spread across peers in windows
+    self.downloadPeer.shouldScheduleBlockRequests = [self needsBloomFiltering];
+    self.downloadPeer.shouldDownloadHeadersFirst = ([self needsBloomFiltering] && self.headersFirst);
+
+    [self startDownloadFromDownloadPeer];
+}
+
+- (void)startDownloadFromDownloadPeer
+{
+    NSAssert(self.downloadPeer, @"No download peer set");
+
+    WSPeer *downloadPeer = self.downloadPeer;
+    [downloadPeer downloadBlockChain:self.blockChain fastCatchUpTimestamp:self.fastCatchUpTimestamp prestartBlock:^(NSUInteger fromHeight, NSUInteger toHeight) {
         [self.notifier notifyDownloadStartedFromHeight:fromHeight toHeight:toHeight];
         
-        self.lastKeepAliveTime = [NSDate timeIntervalSinceReferenceDate];
-        const NSTimeInterval delay = self.requestTimeout;
-        
-        dispatch_async(dispatch_get_main_queue(), ^{
-            [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(detectDownloadTimeout) object:nil];
-            [self performSelector:@selector(detectDownloadTimeout) withObject:nil afterDelay:delay];
-        });
+        const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+        self.lastKeepAliveTime = now;
+        [self.rateMonitors[downloadPeer.remoteHost] resetAtTime:now];
+        [self startStallDetection];
     } syncedBlock:^(NSUInteger height) {
         [self.notifier notifyDownloadStartedFromHeight:height toHeight:height];
         
@@ -1402,55 +1573,115 @@
     }];
 }
 
+- (void)scheduleBlockDownloads
+{
+    WSPeer *downloadPeer = self.downloadPeer;
+    if (!downloadPeer.shouldScheduleBlockRequests) {
+        return;
+    }
+
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    for (WSPeer *peer in [self.downloadScheduler releaseWindowsIdleSince:(now - self.requestTimeout)]) {
+        DDLogDebug(@"Released stalled block windows of peer %@", peer);
+    }
+
+    for (WSPeer *peer in self.connectedPeers) {
+        if ((peer.peerStatus != WSPeerStatusConnected) || (peer.lastBlockHeight < downloadPeer.lastBlockHeight)) {
+            continue;
+        }
+
+        NSArray *blockIds = nil;
+        while ((blockIds = [self.downloadScheduler assignWindowToPeer:peer atTime:now])) {
+            if (![self.filteredPeers containsObject:peer]) {
+                DDLogDebug(@"Loading Bloom filter for peer %@", peer);
+                [peer sendFilterloadMessageWithFilter:self.bloomFilter];
+                [self.filteredPeers addObject:peer];
+            }
+
+            DDLogDebug(@"Requesting %u filtered blocks from peer %@", blockIds.count, peer);
+            [peer sendGetdataMessageWithHashes:blockIds forInventoryType:WSInventoryTypeFilteredBlock];
+        }
+    }
+}
+
+- (void)requestOutdatedBlocksFromPeer:(WSPeer *)peer
+{
+    NSParameterAssert(peer);
+
+    // request scheduled blocks again with the new filter, outdated blocks come earlier in chain
+    if (self.downloadPeer.shouldScheduleBlockRequests) {
+        [self.downloadScheduler requeueAllBlocks];
+        [self scheduleBlockDownloads];
+    }
+    else {
+        [peer requestOutdatedBlocks];
+    }
+}
+
 - (void)resetBloomFilter
 {
     if (![self needsBloomFiltering]) {
         return;
     }
     
-    const NSUInteger blocksLeft = [self unsafeNumberOfBlocksLeft];
-    const NSUInteger retargetInterval = [self.parameters retargetInterval];
-    
-    // increase fp rate as we approach current height
-    NSUInteger filterRateGap = 0;
-    if (blocksLeft > 0) {
-        filterRateGap = MIN(blocksLeft, retargetInterval);
+    if (!self.bloomFilterTuner) {
+        self.bloomFilterTuner = [[WSBloomFilterTuner alloc] initWithTxsPerBlock:self.bloomFilterTxsPerBlock];
     }
+    self.bloomFilterTuner.minFalsePositiveRate = self.bloomFilterRateMin;
+    self.bloomFilterTuner.maxFalsePositiveRate = self.bloomFilterRateMin + self.bloomFilterRateDelta;
+    self.bloomFilterTuner.lowPassRatio = self.bloomFilterLowPassRatio;
+    self.bloomFilterTuner.horizon = self.bloomFilterHorizon;
     
-    //
-    // 0.0 if (left blocks >= retarget)
-    // 0.x if (left blocks < retarget)
-    // 1.0 if (left blocks == 0, i.e. blockchain synced)
-    //
-    double fpRateIncrease = 0.0;
-    if ([self unsafeIsSynced]) {
-        fpRateIncrease = 1.0 - (double)filterRateGap / retargetInterval;
-    }
+    // filter size vs false positive traffic, fewer blocks left allow a looser filter
+    const NSUInteger elements = [self.wallet bloomFilterElementCount];
+    const NSUInteger blocksLeft = [self unsafeNumberOfBlocksLeft];
+    const double falsePositiveRate = [self.bloomFilterTuner falsePositiveRateForElements:elements blocksLeft:blocksLeft peers:[self numberOfFilteringPeers]];
+    [self.bloomFilterTuner resetWithElements:elements falsePositiveRate:falsePositiveRate];
     
-    self.bloomFilterParameters.falsePositiveRate = self.bloomFilterRateMin + fpRateIncrease * self.bloomFilterRateDelta;
+    self.bloomFilterParameters.falsePositiveRate = falsePositiveRate;
     self.observedFilterHeight = self.blockChain.currentHeight;
     self.observedFalsePositiveRate = self.bloomFilterParameters.falsePositiveRate;
+    [self.peerFalsePositiveRates removeAllObjects];
     
     const NSTimeInterval rebuildStartTime = [NSDate timeIntervalSinceReferenceDate];
     self.bloomFilter = [self.wallet bloomFilterWithParameters:self.bloomFilterParameters];
     const NSTimeInterval rebuildTime = [NSDate timeIntervalSinceReferenceDate] - rebuildStartTime;
     
-    DDLogDebug(@"Bloom filter reset in %.3fs (false positive rate: %f)",
-               rebuildTime, self.bloomFilterParameters.falsePositiveRate);
+    DDLogDebug(@"Bloom filter reset in %.3fs (false positive rate: %f, elements: %u, blocks left: %u)",
+               rebuildTime, self.bloomFilterParameters.falsePositiveRate, elements, blocksLeft);
 }
 
-- (void)reloadBloomFilter
+// exact wallet elements, no false positives to absorb
+- (void)resetBlockMatcher
 {
-    if (![self needsBloomFiltering]) {
+    if (![self needsLocalFiltering]) {
         return;
     }
     
-    self.observedFilterHeight = self.blockChain.currentHeight;
+    NSArray *data = (self.wallet ? [self.wallet bloomFilterData] : @[]);
+    self.blockMatcher = [[WSBlockMatcher alloc] initWithData:data flags:self.bloomFilterParameters.flags];
+    
+    DDLogDebug(@"Block matcher reset with %u elements", data.count);
+}
+
+- (void)reloadBloomFilter
+{
+    if (![self needsBloomFiltering]) {
+        return;
+    }
+    
+    self.observedFilterHeight = self.blockChain.currentHeight;
     self.observedFalsePositiveRate = [self.bloomFilter estimatedFalsePositiveRate];
+    [self.peerFalsePositiveRates removeAllObjects];
 }
 
 - (BOOL)maybeResetAndSendBloomFilter
 {
+    // blocks are matched on arrival, nothing is ever outdated
+    if ([self needsLocalFiltering] && self.wallet) {
+        [self resetBlockMatcher];
+        return NO;
+    }
     if (![self needsBloomFiltering]) {
         return NO;
     }
@@ -1473,21 +1704,101 @@
         DDLogDebug(@"HD wallet: receive: %u, change: %u)", hdWallet.allReceiveAddresses.count, hdWallet.allChangeAddresses.count);
     }
     
+    // in-flight blocks don't need a new request, look-ahead addresses are beyond gap limit
+    if ([self tryUpdateAndSendBloomFilter]) {
+        return NO;
+    }
+    
     [self resetBloomFilter];
+    [self loadBloomFilterOnPeers];
     
-    if ([self needsBloomFiltering]) {
-        if (![self unsafeIsSynced]) {
-            DDLogDebug(@"Still syncing, loading rebuilt Bloom filter only for download peer %@", self.downloadPeer);
-            [self.downloadPeer sendFilterloadMessageWithFilter:self.bloomFilter];
+    return YES;
+}
+
+- (void)loadBloomFilterOnPeers
+{
+    if (![self needsBloomFiltering]) {
+        return;
+    }
+
+    if (![self unsafeIsSynced]) {
+        for (WSPeer *peer in self.filteredPeers) {
+            DDLogDebug(@"Still syncing, loading rebuilt Bloom filter only for filtering peer %@", peer);
+            [peer sendFilterloadMessageWithFilter:self.bloomFilter];
         }
-        else {
-            for (WSPeer *peer in self.connectedPeers) {
-                DDLogDebug(@"Synced, loading rebuilt Bloom filter for peer %@", peer);
-                [peer sendFilterloadMessageWithFilter:self.bloomFilter];
-            }
+    }
+    else {
+        for (WSPeer *peer in self.connectedPeers) {
+            DDLogDebug(@"Synced, loading rebuilt Bloom filter for peer %@", peer);
+            [peer sendFilterloadMessageWithFilter:self.bloomFilter];
+        }
+    }
+}
+
+// in-flight blocks are still matched by the old filter, no need to request them again
+- (void)tuneBloomFilterWithFilteredBlock:(WSFilteredBlock *)filteredBlock transactions:(NSOrderedSet *)transactions
+{
+    NSUInteger relevantTxCount = 0;
+    NSUInteger matchedBytes = 0;
+    for (WSSignedTransaction *transaction in transactions) {
+        if ([self.wallet isRelevantTransaction:transaction]) {
+            ++relevantTxCount;
+        }
+        matchedBytes += transaction.size;
+    }
+    [self.bloomFilterTuner addBlockWithTxCount:filteredBlock.partialMerkleTree.txCount
+                                matchedTxCount:transactions.count
+                               relevantTxCount:relevantTxCount
+                                  matchedBytes:matchedBytes];
+    
+    if (![self.bloomFilterTuner shouldResetWithBlocksLeft:[self unsafeNumberOfBlocksLeft] peers:[self numberOfFilteringPeers]]) {
+        return;
+    }
+    
+    DDLogDebug(@"False positives outweigh the cost of a new Bloom filter (%@), resetting", self.bloomFilterTuner);
+    
+    [self resetBloomFilter];
+    [self loadBloomFilterOnPeers];
+}
+
+- (NSUInteger)numberOfFilteringPeers
+{
+    const NSUInteger count = ([self unsafeIsSynced] ? self.connectedPeers.count : self.filteredPeers.count);
+    return MAX(count, 1);
+}
+
+// missing elements are sent with filteradd, NO if filter would get too loose and needs a reset
+- (BOOL)tryUpdateAndSendBloomFilter
+{
+    NSArray *uncoveredData = [self.wallet bloomFilterDataNotCoveredByFilter:self.bloomFilter];
+    if (uncoveredData.count == 0) {
+        return YES;
+    }
+
+    WSMutableBloomFilter *updatedFilter = [self.bloomFilter mutableCopy];
+    for (NSData *data in uncoveredData) {
+        [updatedFilter insertData:data];
+    }
+    
+    const double falsePositiveRate = [updatedFilter estimatedFalsePositiveRate];
+    const double maxFalsePositiveRate = self.bloomFilterRebuildRatio * self.bloomFilterParameters.falsePositiveRate;
+    if (falsePositiveRate > maxFalsePositiveRate) {
+        DDLogDebug(@"Updated Bloom filter would be too loose (%f > %f), resetting", falsePositiveRate, maxFalsePositiveRate);
+        return NO;
+    }
+    
+    // never mutated after assignment
+    self.bloomFilter = updatedFilter;
+    
+    NSSet *peers = ([self unsafeIsSynced] ? self.connectedPeers : self.filteredPeers);
+    for (WSPeer *peer in peers) {
+        DDLogDebug(@"Adding %u elements to Bloom filter of peer %@", uncoveredData.count, peer);
+        for (NSData *data in uncoveredData) {
+            [peer sendFilteraddMessageWithData:data];
         }
     }
     
+    DDLogDebug(@"Bloom filter updated with %u elements (false positive rate: %f)", uncoveredData.count, falsePositiveRate);
     return YES;
 }
 
@@ -1498,30 +1809,168 @@
 
 - (BOOL)needsBloomFiltering
 {
-    return (self.wallet != nil);
+    return ((self.wallet != nil) && !self.localFiltering);
 }
 
-// main queue
-- (void)detectDownloadTimeout
+- (BOOL)needsLocalFiltering
 {
-    dispatch_sync(self.queue, ^{
-        const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
-        const NSTimeInterval elapsed = now - self.lastKeepAliveTime;
+    return ([self shouldDownloadBlocks] && ![self needsBloomFiltering]);
+}
+
+- (void)recordDownloadOfBlocks:(NSUInteger)blocks bytes:(NSUInteger)bytes fromPeer:(WSPeer *)peer
+{
+    [self.rateMonitors[peer.remoteHost] addBlocks:blocks bytes:bytes atTime:[NSDate timeIntervalSinceReferenceDate]];
+}
+
+- (void)startStallDetection
+{
+    if (self.stallTimer) {
+        return;
+    }
+    
+    const uint64_t interval = (uint64_t)(WSPeerGroupStallCheckInterval * NSEC_PER_SEC);
+    __weak WSPeerGroup *weakSelf = self;
+    
+    self.stallTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+    dispatch_source_set_timer(self.stallTimer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+    dispatch_source_set_event_handler(self.stallTimer, ^{
+        [weakSelf detectDownloadStall];
+    });
+    dispatch_resume(self.stallTimer);
+}
+
+- (void)stopStallDetection
+{
+    if (!self.stallTimer) {
+        return;
+    }
+    dispatch_source_cancel(self.stallTimer);
+    self.stallTimer = nil;
+}
+
+// silent or slow download peer hands download off to next best peer
+- (void)detectDownloadStall
+{
+    WSPeer *downloadPeer = self.downloadPeer;
+    if (!downloadPeer || !self.keepDownloading || [self unsafeIsSynced]) {
+        return;
+    }
+    
+    // stalled windows may be moved to other peers
+    [self scheduleBlockDownloads];
+    
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    WSRateMonitor *monitor = self.rateMonitors[downloadPeer.remoteHost];
+    NSError *error = nil;
+
+    if (now - self.lastKeepAliveTime >= self.requestTimeout) {
+        error = WSErrorMake(WSErrorCodePeerGroupTimeout, @"Download timed out");
+    }
+    else if (![self isDownloadPeerBusy]) {
         
-        if (elapsed < self.requestTimeout) {
-            const NSTimeInterval delay = self.requestTimeout - elapsed;
-            dispatch_async(dispatch_get_main_queue(), ^{
-                [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(detectDownloadTimeout) object:nil];
-                [self performSelector:@selector(detectDownloadTimeout) withObject:nil afterDelay:delay];
-            });
-            return;
+        // idle time doesn't count against download rate
+        [monitor resetAtTime:now];
+        return;
+    }
+    else if ([monitor hasFullWindowAtTime:now]) {
+        const double blockRate = [monitor blocksPerSecondAtTime:now];
+        const double byteRate = [monitor bytesPerSecondAtTime:now];
+
+        if ((blockRate < self.minDownloadBlockRate) && (byteRate < self.minDownloadByteRate)) {
+            error = WSErrorMake(WSErrorCodePeerGroupSync, @"Download too slow (%.2f blocks/s, %.0f bytes/s)", blockRate, byteRate);
         }
+    }
+    if (!error) {
+        return;
+    }
+
+    DDLogInfo(@"Download peer %@ stalled (%@)", downloadPeer, error);
+    [self handOffDownloadFromPeer:downloadPeer error:error];
+}
+
+// scheduled download peer may legitimately wait for other peers' windows
+- (BOOL)isDownloadPeerBusy
+{
+    WSPeer *downloadPeer = self.downloadPeer;
+    if (!downloadPeer.shouldScheduleBlockRequests) {
+        return YES;
+    }
+    if ([self.downloadScheduler numberOfWindowsForPeer:downloadPeer] > 0) {
+        return YES;
+    }
+    return (downloadPeer.shouldDownloadHeadersFirst && (self.skeletonHeight < downloadPeer.lastBlockHeight));
+}
+
+// only the download peer drives sync, other peers may still deliver what was requested before a hand-off
+- (BOOL)shouldIgnoreDownloadFromPeer:(WSPeer *)peer
+{
+    return (self.downloadPeer && (peer != self.downloadPeer) && ![self unsafeIsSynced]);
+}
+
+// requested blocks are not lost: scheduled windows are requeued, other outstanding requests move to next peer
+- (void)handOffDownloadFromPeer:(WSPeer *)peer error:(NSError *)error
+{
+    NSParameterAssert(peer);
+    NSParameterAssert(error);
+
+    const BOOL isTimeout = (error.code == WSErrorCodePeerGroupTimeout);
+
+    WSPeer *nextPeer = [self bestPeerExcludingPeer:peer];
+    if (!nextPeer || (nextPeer.lastBlockHeight < peer.lastBlockHeight)) {
         
-        if (self.downloadPeer) {
-            [self.pool closeConnectionForProcessor:self.downloadPeer
-                                             error:WSErrorMake(WSErrorCodePeerGroupTimeout, @"Download timed out, disconnecting")];
+        // silent peer is useless, slow peer is still better than none
+        if (isTimeout) {
+            [self.pool closeConnectionForProcessor:peer error:error];
         }
-    });
+        else {
+            DDLogDebug(@"No better download peer than %@, keeping it", peer);
+            [self.rateMonitors[peer.remoteHost] resetAtTime:[NSDate timeIntervalSinceReferenceDate]];
+        }
+        return;
+    }
+
+    DDLogInfo(@"Handing off download from %@ to %@ (%@)", peer, nextPeer, error);
+
+    self.downloadPeer = nextPeer;
+    if ([self.downloadScheduler releaseWindowsOfPeer:peer] > 0) {
+        DDLogDebug(@"Reassigning blocks scheduled on %@", peer);
+    }
+
+    const WSInventoryType inventoryType = ([self needsBloomFiltering] ? WSInventoryTypeFilteredBlock : WSInventoryTypeBlock);
+    [peer stopDownloadWithCompletionBlock:^(NSArray *outstandingBlockIds) {
+        if (self.downloadPeer != nextPeer) {
+            return;
+        }
+
+        NSMutableArray *blockIds = [[NSMutableArray alloc] initWithCapacity:outstandingBlockIds.count];
+        for (WSHash256 *blockId in outstandingBlockIds) {
+            if (![self.downloadScheduler isScheduledBlockId:blockId]) {
+                [blockIds addObject:blockId];
+            }
+        }
+        if (blockIds.count > 0) {
+            DDLogDebug(@"Moving %u outstanding blocks from %@ to %@", blockIds.count, peer, nextPeer);
+            [nextPeer sendGetdataMessageWithHashes:blockIds forInventoryType:inventoryType];
+        }
+        [self scheduleBlockDownloads];
+    }];
+
+    if ([self needsBloomFiltering] && ![self.filteredPeers containsObject:nextPeer]) {
+        DDLogDebug(@"Loading Bloom filter for download peer %@", nextPeer);
+        [nextPeer sendFilterloadMessageWithFilter:self.bloomFilter];
+        [self.filteredPeers addObject:nextPeer];
+    }
+    nextPeer.shouldScheduleBlockRequests = [self needsBloomFiltering];
+    nextPeer.shouldDownloadHeadersFirst = ([self needsBloomFiltering] && self.headersFirst);
+
+    // skeleton is rebuilt from chain head, blocks already enqueued are not scheduled twice
+    [self resetSkeleton];
+
+    [self startDownloadFromDownloadPeer];
+
+    if (isTimeout) {
+        [self.pool closeConnectionForProcessor:peer error:error];
+    }
 }
 
 - (void)trySaveBlockChainToCoreData
@@ -1531,11 +1980,23 @@
     }
 }
 
+- (void)trySaveAddresses
+{
+    if (!self.addressesPath) {
+        return;
+    }
+    
+    NSError *error;
+    if (![self.addressManager saveWithError:&error]) {
+        DDLogError(@"Unable to save known addresses to %@ (%@)", self.addressesPath, error);
+    }
+}
+
 #pragma mark Handlers (unsafe)
 
-- (BOOL)validateHeaderAgainstCheckpoints:(WSBlockHeader *)header error:(NSError *__autoreleasing *)error
+- (BOOL)validateHeaderAgainstCheckpoints:(WSBlockHeader *)header atHeight:(uint32_t)height error:(NSError *__autoreleasing *)error
 {
-    WSStorableBlock *expected = [self.parameters checkpointAtHeight:(uint32_t)(self.blockChain.currentHeight + 1)];
+    WSStorableBlock *expected = [self.parameters checkpointAtHeight:height];
     if (!expected) {
         return YES;
     }
@@ -1554,16 +2015,129 @@
     return NO;
 }
 
-- (void)handleAddedBlock:(WSStorableBlock *)block fromPeer:(WSPeer *)peer
+// skeleton is linked, checkpointed and validated as the chain would, bodies are then added in order without orphans
+- (NSUInteger)extendSkeletonWithHeaders:(NSArray *)headers fromPeer:(WSPeer *)peer
+{
+    NSParameterAssert(headers.count > 0);
+
+    WSStorableBlock *previousBlock = self.skeletonBlock;
+    if (!previousBlock) {
+
+        // chain head may have moved on since request (e.g. after download hand-off)
+        WSBlockHeader *firstHeader = headers.firstObject;
+        previousBlock = [self.blockChain blockForId:firstHeader.previousBlockId];
+        if (!previousBlock) {
+            previousBlock = self.blockChain.head;
+        }
+    }
+
+    // same as blockchain, targets are not enforced on test networks
+    const BOOL shouldValidateTarget = ([self.parameters networkType] == WSNetworkTypeMain);
+
+    NSMutableArray *blockIds = [[NSMutableArray alloc] initWithCapacity:headers.count];
+    NSError *error;
+    WSHash256 *skeletonBlockId = previousBlock.blockId;
+    for (WSBlockHeader *header in headers) {
+        const uint32_t height = previousBlock.height + 1;
+
+        // stale, duplicate or forked batch, not proof of misbehavior
+        if (![header.previousBlockId isEqual:previousBlock.blockId]) {
+            if ((header == headers.firstObject) && [self.recentSkeletonIds containsObject:header.previousBlockId]) {
+                DDLogDebug(@"Discarding %u duplicate headers from %@", headers.count, peer);
+                return 0;
+            }
+            DDLogDebug(@"Header %@ does not extend skeleton at height %u, discarding %u headers", header.blockId, height, headers.count);
+            [self resyncSkeletonFromBlockId:skeletonBlockId withPeer:peer];
+            return 0;
+        }
+        if (![self validateHeaderAgainstCheckpoints:header atHeight:height error:&error]) {
+            [self.pool closeConnectionForProcessor:peer error:error];
+            return 0;
+        }
+
+        // bodies of invalid headers would be downloaded before the chain rejects them
+        WSStorableBlock *block = [previousBlock buildNextBlockFromHeader:header transactions:nil];
+        if (shouldValidateTarget && ![block validateTargetInChain:self.blockChain error:&error]) {
+            DDLogDebug(@"Header %@ is invalid at height %u, discarding %u headers (%@)", header.blockId, height, headers.count, error);
+            [self handleMisbehavingPeer:peer error:error];
+            return 0;
+        }
+        if (height > self.blockChain.currentHeight) {
+            [blockIds addObject:header.blockId];
+        }
+        previousBlock = block;
+    }
+
+    self.skeletonBlock = previousBlock;
+    self.skeletonHeight = previousBlock.height;
+    [self.recentSkeletonIds addObject:skeletonBlockId];
+    if (self.recentSkeletonIds.count > WSPeerGroupRecentSkeletonTips) {
+        [self.recentSkeletonIds removeObjectAtIndex:0];
+    }
+
+    DDLogDebug(@"Extended skeleton to height %u (%u/%u)", self.skeletonHeight, self.skeletonHeight, peer.lastBlockHeight);
+
+    [self.downloadScheduler enqueueBlockIds:blockIds];
+    [self scheduleBlockDownloads];
+
+    return blockIds.count;
+}
+
+// requested once per skeleton tip, further mismatching batches are in-flight followers of the discarded one
+- (void)resyncSkeletonFromBlockId:(WSHash256 *)blockId withPeer:(WSPeer *)peer
 {
-    [self.notifier notifyBlockAdded:block];
+    NSParameterAssert(blockId);
     
+    if ([self.skeletonResyncBlockId isEqual:blockId]) {
+        return;
+    }
+    self.skeletonResyncBlockId = blockId;
+
+    NSMutableArray *hashes = [[NSMutableArray alloc] initWithObjects:blockId, nil];
+    WSHash256 *headId = self.blockChain.head.blockId;
+    if (headId && ![headId isEqual:blockId]) {
+        [hashes addObject:headId];
+    }
+    DDLogDebug(@"Requesting headers again from skeleton header %@", blockId);
+    [peer sendGetheadersMessageWithLocator:[[WSBlockLocator alloc] initWithHashes:hashes] hashStop:nil];
+}
+
+- (void)resetSkeleton
+{
+    self.skeletonBlock = nil;
+    self.skeletonHeight = 0;
+    [self.recentSkeletonIds removeAllObjects];
+    self.skeletonResyncBlockId = nil;
+}
+
+- (void)handleAddedBlock:(WSStorableBlock *)block fromPeer:(WSPeer *)peer
+{
+    [self handleAddedBlocks:@[block] fromPeer:peer];
+}
+
+- (void)handleAddedBlocks:(NSArray *)blocks fromPeer:(WSPeer *)peer
+{
+    NSParameterAssert(blocks.count > 0);
+
+    [self.notifier notifyBlocksAdded:blocks];
+
     const NSUInteger lastBlockHeight = self.downloadPeer.lastBlockHeight;
-    const BOOL isDownloadFinished = (block.height == lastBlockHeight);
-    
+    BOOL isDownloadFinished = NO;
+    for (WSStorableBlock *block in blocks) {
+        if (block.height == lastBlockHeight) {
+            isDownloadFinished = YES;
+            break;
+        }
+    }
+
     if (isDownloadFinished) {
+        self.downloadPeer.shouldScheduleBlockRequests = NO;
+        self.downloadPeer.shouldDownloadHeadersFirst = NO;
+        [self.downloadScheduler reset];
+        [self resetSkeleton];
+
         for (WSPeer *peer in self.connectedPeers) {
-            if ([self needsBloomFiltering] && (peer != self.downloadPeer)) {
+            if ([self needsBloomFiltering] && ![self.filteredPeers containsObject:peer] && (peer != self.downloadPeer)) {
                 DDLogDebug(@"Loading Bloom filter for peer %@", peer);
                 [peer sendFilterloadMessageWithFilter:self.bloomFilter];
             }
@@ -1571,18 +2145,19 @@
             [peer sendMempoolMessage];
         }
 
+        [self.filteredPeers removeAllObjects];
         [self trySaveBlockChainToCoreData];
 
-        dispatch_async(dispatch_get_main_queue(), ^{
-            [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(detectDownloadTimeout) object:nil];
-        });
+        [self stopStallDetection];
         [self.notifier notifyDownloadFinished];
     }
     
     //
     
     if (self.wallet) {
-        [self recoverMissedBlockTransactions:block fromPeer:peer];
+        for (WSStorableBlock *block in blocks) {
+            [self recoverMissedBlockTransactions:block fromPeer:peer];
+        }
     }
 }
 
@@ -1593,6 +2168,124 @@
     }
 }
 
+- (void)handleFilteredBlock:(WSFilteredBlock *)filteredBlock withTransactions:(NSOrderedSet *)transactions fromPeer:(WSPeer *)peer
+{
+    NSError *error;
+    WSStorableBlock *block = nil;
+    WSStorableBlock *previousHead = nil;
+    __weak WSPeerGroup *weakSelf = self;
+
+    if (![self validateHeaderAgainstCheckpoints:filteredBlock.header atHeight:(uint32_t)(self.blockChain.currentHeight + 1) error:&error]) {
+        [self.pool closeConnectionForProcessor:peer error:error];
+        return;
+    }
+
+    NSArray *connectedOrphans;
+    previousHead = self.blockChain.head;
+    block = [self.blockChain addBlockWithHeader:filteredBlock.header transactions:transactions reorganizeBlock:^(WSStorableBlock *base, NSArray *oldBlocks, NSArray *newBlocks) {
+
+        [weakSelf handleReorganizeAtBase:base oldBlocks:oldBlocks newBlocks:newBlocks fromPeer:peer];
+
+    } connectedOrphans:&connectedOrphans error:&error];
+    
+    if (!block) {
+        if (!error) {
+            DDLogDebug(@"Filtered block not added: %@", filteredBlock);
+        }
+        else {
+            DDLogDebug(@"Error adding filtered block (%@): %@", error, filteredBlock);
+
+            if ((error.domain == WSErrorDomain) && (error.code == WSErrorCodeInvalidBlock)) {
+                [self handleMisbehavingPeer:peer error:error];
+            }
+        }
+        DDLogDebug(@"Current head: %@", self.blockChain.head);
+        
+        return;
+    }
+
+    //
+    // adapted from: https://github.com/voisine/breadwallet/blob/master/BreadWallet/BRPeerManager.m
+    //
+    // low-pass filter in [BRPeerManager peer:relayedBlock:], tracked per peer so that
+    // blocks from several filtered peers don't skew each other's rate
+    //
+    if ([self needsBloomFiltering] && ((peer == self.downloadPeer) || [self.filteredPeers containsObject:peer]) && (transactions.count > 0)) {
+        NSNumber *peerRate = self.peerFalsePositiveRates[peer.remoteHost];
+        const double oldRate = (peerRate ? [peerRate doubleValue] : self.observedFalsePositiveRate);
+        const double observedRate = (oldRate *
+                                     (1.0 - self.bloomFilterLowPassRatio * filteredBlock.partialMerkleTree.txCount / self.bloomFilterTxsPerBlock) +
+                                     self.bloomFilterLowPassRatio * transactions.count / self.bloomFilterTxsPerBlock);
+        self.peerFalsePositiveRates[peer.remoteHost] = @(observedRate);
+        
+        DDLogVerbose(@"Observed false positive rate from %@ at #%u: %f * (1.0 - %.2f * %u / %u) + %.2f * %u / %u = %f",
+                     peer, self.blockChain.currentHeight, oldRate,
+                     self.bloomFilterLowPassRatio, filteredBlock.partialMerkleTree.txCount, self.bloomFilterTxsPerBlock,
+                     self.bloomFilterLowPassRatio, transactions.count, self.bloomFilterTxsPerBlock,
+                     observedRate);
+        
+        if (observedRate > self.bloomFilterObservedRateMax) {
+            [self.pool closeConnectionForProcessor:peer
+                                             error:WSErrorMake(WSErrorCodePeerGroupSync, @"Too many false positives from %@ (%f > %f) in the %u-%u range (%u blocks), disconnecting",
+                                                               peer, observedRate, self.bloomFilterObservedRateMax,
+                                                               self.observedFilterHeight, self.blockChain.currentHeight,
+                                                               self.blockChain.currentHeight - self.observedFilterHeight)];
+        }
+    }
+    
+    if ([self needsBloomFiltering] && ((peer == self.downloadPeer) || [self.filteredPeers containsObject:peer])) {
+        [self tuneBloomFilterWithFilteredBlock:filteredBlock transactions:transactions];
+    }
+    
+    for (WSStorableBlock *addedBlock in [connectedOrphans arrayByAddingObject:block]) {
+        if (![addedBlock.blockId isEqual:previousHead.blockId]) {
+            [self handleAddedBlock:addedBlock fromPeer:peer];
+        }
+        else {
+            [self handleReplacedBlock:addedBlock fromPeer:peer];
+        }
+    }
+}
+
+// full blocks are matched locally, then handled like filtered blocks
+- (void)handleBlock:(WSBlock *)block fromPeer:(WSPeer *)peer
+{
+    if (!self.blockMatcher) {
+        [self resetBlockMatcher];
+    }
+    
+    NSOrderedSet *transactions = nil;
+    WSFilteredBlock *filteredBlock = [self.blockMatcher filteredBlockWithBlock:block transactions:&transactions];
+    
+    if (![filteredBlock.partialMerkleTree.merkleRoot isEqual:block.header.merkleRoot]) {
+        [self handleMisbehavingPeer:peer error:WSErrorMake(WSErrorCodeInvalidBlock, @"Merkle root mismatch in block %@", block.header.blockId)];
+        return;
+    }
+    
+    // as if relayed by 'tx' messages, new wallet addresses rebuild the matcher and the block is matched again
+    NSMutableSet *handledTxIds = [[NSMutableSet alloc] init];
+    while (YES) {
+        WSBlockMatcher *blockMatcher = self.blockMatcher;
+        
+        for (WSSignedTransaction *transaction in transactions) {
+            if ([handledTxIds containsObject:transaction.txId]) {
+                continue;
+            }
+            [self handleReceivedTransaction:transaction fromPeer:peer];
+            [handledTxIds addObject:transaction.txId];
+        }
+        
+        if (self.blockMatcher == blockMatcher) {
+            break;
+        }
+        
+        DDLogDebug(@"Wallet grew while handling block %@, matching again", block.header.blockId);
+        filteredBlock = [self.blockMatcher filteredBlockWithBlock:block transactions:&transactions];
+    }
+    
+    [self handleFilteredBlock:filteredBlock withTransactions:transactions fromPeer:peer];
+}
+
 - (void)handleReceivedTransaction:(WSSignedTransaction *)transaction fromPeer:(WSPeer *)peer
 {
     const BOOL isPublished = [self findAndRemovePublishedTransaction:transaction fromPeer:peer];
@@ -1609,7 +2302,7 @@
         DDLogDebug(@"Last transaction triggered new addresses generation");
         
         if ([self maybeResetAndSendBloomFilter]) {
-            [peer requestOutdatedBlocks];
+            [self requestOutdatedBlocksFromPeer:peer];
         }
     }
 }
@@ -1649,7 +2342,7 @@
         DDLogWarn(@"Reorganize triggered (unexpected) new addresses generation");
         
         if ([self maybeResetAndSendBloomFilter]) {
-            [peer requestOutdatedBlocks];
+            [self requestOutdatedBlocksFromPeer:peer];
         }
     }
 }
@@ -1693,7 +2386,7 @@
         DDLogWarn(@"Block registration triggered new addresses generation");
         
         if ([self maybeResetAndSendBloomFilter]) {
-            [peer requestOutdatedBlocks];
+            [self requestOutdatedBlocksFromPeer:peer];
         }
     }
 }
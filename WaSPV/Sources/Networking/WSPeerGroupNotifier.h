@@ -72,6 +72,7 @@ extern NSString *const WSPeerGroupErrorKey;
 - (void)notifyDownloadFinished;
 - (void)notifyDownloadFailedWithError:(NSError *)error;
 - (void)notifyBlockAdded:(WSStorableBlock *)block;
+- (void)notifyBlocksAdded:(NSArray *)blocks;
 - (void)notifyTransaction:(WSSignedTransaction *)transaction fromPeer:(WSPeer *)peer isPublished:(BOOL)isPublished;
 - (void)notifyRescan;
 
@@ -155,21 +155,35 @@ NSString *const WSPeerGroupErrorKey                             = @"Error";
 }
 
 - (void)notifyBlockAdded:(WSStorableBlock *)block
+{
+    [self notifyBlocksAdded:@[block]];
+}
+
+- (void)notifyBlocksAdded:(NSArray *)blocks
 {
     const NSUInteger fromHeight = self.syncFromHeight;
     const NSUInteger toHeight = self.syncToHeight;
-    const NSUInteger currentHeight = block.height;
+    NSUInteger lastProgressHeight = NSNotFound;
 
-    if (currentHeight <= toHeight) {
-        if (currentHeight % 1000 == 0) {
-            const double progress = WSUtilsProgress(fromHeight, toHeight, currentHeight);
+    for (WSStorableBlock *block in blocks) {
+        const NSUInteger currentHeight = block.height;
 
-            DDLogInfo(@"Download progress = %u/%u (%.2f%%)", currentHeight, toHeight, 100.0 * progress);
+        if (currentHeight <= toHeight) {
+            if (currentHeight % 1000 == 0) {
+                lastProgressHeight = currentHeight;
+            }
+        }
+        // only notify blocks after sync
+        else {
+            [self notifyWithName:WSPeerGroupDidDownloadBlockNotification userInfo:@{WSPeerGroupDownloadBlockKey: block}];
         }
     }
-    // only notify blocks after sync
-    else {
-        [self notifyWithName:WSPeerGroupDidDownloadBlockNotification userInfo:@{WSPeerGroupDownloadBlockKey: block}];
+
+    // log progress once per batch
+    if (lastProgressHeight != NSNotFound) {
+        const double progress = WSUtilsProgress(fromHeight, toHeight, lastProgressHeight);
+
+        DDLogInfo(@"Download progress = %u/%u (%.2f%%)", lastProgressHeight, toHeight, 100.0 * progress);
     }
 }
 
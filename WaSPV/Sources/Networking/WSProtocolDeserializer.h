@@ -36,7 +36,13 @@
 
 - (instancetype)init;
 - (instancetype)initWithParameters:(id<WSParameters>)parameters host:(NSString *)host port:(uint16_t)port;
-- (id<WSMessage>)parseMessageFromStream:(NSInputStream *)inputStream error:(NSError **)error;
+- (void)appendBytes:(const void *)bytes length:(NSUInteger)length;
+
+// read directly into the input buffer, then commit the bytes actually written
+- (void *)writableBytesWithMinimumLength:(NSUInteger)minimumLength available:(NSUInteger *)available;
+- (void)didWriteBytesWithLength:(NSUInteger)length;
+
+- (id<WSMessage>)parseMessageWithError:(NSError **)error; // nil and no error when more bytes are needed
 - (void)resetBuffers;
 
 @end
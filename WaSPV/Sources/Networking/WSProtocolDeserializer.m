@@ -25,6 +25,8 @@
 //  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#import <stdatomic.h>
+
 #import "WSProtocolDeserializer.h"
 #import "WSMessageFactory.h"
 #import "WSHash256.h"
@@ -33,17 +35,104 @@
 #import "WSMacros.h"
 #import "WSErrors.h"
 
+// input chunks are never resized so that decoded payloads can borrow them
+static const NSUInteger WSProtocolDeserializerChunkLength           = 256 * 1024;
+
+// smaller payloads are copied to avoid pinning a whole chunk
+static const NSUInteger WSProtocolDeserializerMinBorrowedLength     = 4096;
+
+static inline uint32_t WSProtocolDeserializerReadUint32(const uint8_t *bytes)
+{
+    uint32_t n;
+    memcpy(&n, bytes, sizeof(n));
+    return CFSwapInt32LittleToHost(n);
+}
+
+// memchr scans a word (or vector) at a time for the first magic byte, then the whole word is compared
+static NSUInteger WSProtocolDeserializerFindMagic(const uint8_t *bytes, NSUInteger length, uint32_t magicNumber)
+{
+    const uint32_t magic = CFSwapInt32HostToLittle(magicNumber);
+    const uint8_t first = (uint8_t)(magicNumber & 0xff);
+    const uint8_t *cursor = bytes;
+    const uint8_t *end = bytes + length;
+    
+    while (end - cursor >= (ptrdiff_t)sizeof(uint32_t)) {
+        cursor = memchr(cursor, first, end - cursor - (sizeof(uint32_t) - 1));
+        if (!cursor) {
+            break;
+        }
+        if (memcmp(cursor, &magic, sizeof(magic)) == 0) {
+            return cursor - bytes;
+        }
+        ++cursor;
+    }
+
+    // keep a possible partial magic number at the end
+    return ((length >= sizeof(uint32_t)) ? (length - (sizeof(uint32_t) - 1)) : 0);
+}
+
+//
+// borrowed payloads keep their chunk alive and may give it back from any thread,
+// the chunk can only be compacted in place once the last borrower is gone
+//
+@interface WSProtocolDeserializerChunk : NSObject {
+    _Atomic(NSUInteger) _borrowers;
+}
+
+@property (nonatomic, strong) NSMutableData *data;
+
+- (instancetype)initWithLength:(NSUInteger)length;
+- (BOOL)isBorrowed;
+- (void)borrow;
+- (void)giveBack;
+
+@end
+
+@implementation WSProtocolDeserializerChunk
+
+- (instancetype)initWithLength:(NSUInteger)length
+{
+    if ((self = [super init])) {
+        self.data = [[NSMutableData alloc] initWithLength:length];
+        atomic_init(&_borrowers, 0);
+    }
+    return self;
+}
+
+- (BOOL)isBorrowed
+{
+    // pairs with the release in giveBack, borrowers are done reading once this reads zero
+    return (atomic_load_explicit(&_borrowers, memory_order_acquire) > 0);
+}
+
+- (void)borrow
+{
+    atomic_fetch_add_explicit(&_borrowers, 1, memory_order_relaxed);
+}
+
+- (void)giveBack
+{
+    atomic_fetch_sub_explicit(&_borrowers, 1, memory_order_release);
+}
+
+@end
+
+#pragma mark -
+
 @interface WSProtocolDeserializer ()
 
 @property (nonatomic, strong) id<WSParameters> parameters;
 @property (nonatomic, strong) NSString *host;
 @property (nonatomic, assign) uint16_t port;
 @property (nonatomic, strong) WSMessageFactory *factory;
-@property (nonatomic, strong) WSMutableBuffer *builtHeader;
-@property (nonatomic, strong) WSMutableBuffer *builtPayload;
 @property (nonatomic, strong) NSString *identifier;
 
-- (id<WSMessage>)parseMessageFromStream:(NSInputStream *)inputStream keepParsing:(BOOL *)keepParsing error:(NSError *__autoreleasing *)error;
+@property (nonatomic, strong) WSProtocolDeserializerChunk *chunk;
+@property (nonatomic, assign) NSUInteger readOffset;
+@property (nonatomic, assign) NSUInteger writeOffset;
+
+- (void)ensureAvailableLength:(NSUInteger)length;
+- (NSData *)payloadWithBytes:(const uint8_t *)bytes length:(NSUInteger)length;
 
 @end
 
@@ -66,144 +155,153 @@
         self.host = host;
         self.port = port;
         self.factory = [[WSMessageFactory alloc] initWithParameters:self.parameters];
-        self.builtHeader = [[WSMutableBuffer alloc] init];
-        self.builtPayload = [[WSMutableBuffer alloc] init];
         self.identifier = [NSString stringWithFormat:@"%@:%u", self.host, self.port];
+        [self resetBuffers];
     }
     return self;
 }
 
-- (id<WSMessage>)parseMessageFromStream:(NSInputStream *)inputStream error:(NSError *__autoreleasing *)error
+- (void)appendBytes:(const void *)bytes length:(NSUInteger)length
 {
-    WSExceptionCheckIllegal(inputStream != nil, @"Nil inputStream");
-    
-//    DDLogVerbose(@"Buffer length: %u", self.buffer.length);
-    
-    BOOL keepParsing = NO;
-    id<WSMessage> message = [self parseMessageFromStream:inputStream keepParsing:&keepParsing error:error];
-    if (!keepParsing) {
-        [self resetBuffers];
-    }
-    return message;
+    NSParameterAssert(bytes || (length == 0));
+
+    NSUInteger available;
+    void *destination = [self writableBytesWithMinimumLength:length available:&available];
+    memcpy(destination, bytes, length);
+    [self didWriteBytesWithLength:length];
+}
+
+- (void *)writableBytesWithMinimumLength:(NSUInteger)minimumLength available:(NSUInteger *)available
+{
+    NSParameterAssert(available);
+
+    [self ensureAvailableLength:minimumLength];
+    *available = self.chunk.data.length - self.writeOffset;
+    return (uint8_t *)self.chunk.data.mutableBytes + self.writeOffset;
+}
+
+- (void)didWriteBytesWithLength:(NSUInteger)length
+{
+    NSParameterAssert(self.writeOffset + length <= self.chunk.data.length);
+
+    self.writeOffset += length;
 }
 
 - (void)resetBuffers
 {
-    self.builtHeader.length = 0;
-    self.builtPayload.length = 0;
+    self.chunk = [[WSProtocolDeserializerChunk alloc] initWithLength:WSProtocolDeserializerChunkLength];
+    self.readOffset = 0;
+    self.writeOffset = 0;
 }
 
 //
 // adapted from: https://github.com/voisine/breadwallet/blob/master/BreadWallet/BRPeer.m
 //
-// keepParsing: YES = read more bytes, NO = stop and reset buffers
-//
-- (id<WSMessage>)parseMessageFromStream:(NSInputStream *)inputStream keepParsing:(BOOL *)keepParsing error:(NSError *__autoreleasing *)error
+- (id<WSMessage>)parseMessageWithError:(NSError *__autoreleasing *)error
 {
-    NSParameterAssert(inputStream);
-    NSParameterAssert(keepParsing);
+    const uint8_t *chunkBytes = self.chunk.data.bytes;
 
-    NSInteger currentHeaderLength = self.builtHeader.length;
-    NSInteger currentPayloadLength = self.builtPayload.length;
-    
-    if (currentHeaderLength < WSMessageHeaderLength) {
-        self.builtHeader.length = WSMessageHeaderLength;
-        
-        uint8_t *freeHeader = (uint8_t *)self.builtHeader.mutableBytes + currentHeaderLength;
-        const NSUInteger toRead = self.builtHeader.length - currentHeaderLength;
-        const NSInteger actuallyRead = [inputStream read:freeHeader maxLength:toRead];
-        if (actuallyRead < 0) {
-            [self resetBuffers];
-            return nil;
-        }
+    // skip garbage up to the magic number that starts a new message header
+    self.readOffset += WSProtocolDeserializerFindMagic(chunkBytes + self.readOffset, self.writeOffset - self.readOffset, [self.parameters magicNumber]);
 
-//        DDLogVerbose(@"Needed for header: %u", toRead);
-//        DDLogVerbose(@"Current buffer length: %u", available);
-//        DDLogVerbose(@"Actually read: %u", actuallyRead);
+    const uint8_t *bytes = chunkBytes + self.readOffset;
+    const NSUInteger length = self.writeOffset - self.readOffset;
 
-        self.builtHeader.length = currentHeaderLength + actuallyRead;
-        
-        // consume one byte at a time, up to the magic number that starts a new message header
-        const uint32_t magicNumber = [self.parameters magicNumber];
-        while ((self.builtHeader.length >= sizeof(uint32_t)) && ([self.builtHeader uint32AtOffset:0] != magicNumber)) {
-            [self.builtHeader replaceBytesInRange:NSMakeRange(0, 1) withBytes:NULL length:0];
-        }
-        
-        if (self.builtHeader.length < WSMessageHeaderLength) {
-            *keepParsing = YES;
-            return nil;
-        }
+    if (length < (NSUInteger)WSMessageHeaderLength) {
+        return nil;
     }
     
     // checkpoint: header is complete from here
     
     // ensure message type is null-terminated
-    if ([self.builtHeader uint8AtOffset:15] != 0) {
-        WSErrorSet(error, WSErrorCodeMalformed, @"Message type is not null-terminated (partial header: %@)", self.builtHeader);
-        *keepParsing = NO;
+    if (bytes[15] != 0) {
+        WSErrorSet(error, WSErrorCodeMalformed, @"Message type is not null-terminated (partial header: %@)",
+                   [NSData dataWithBytes:bytes length:WSMessageHeaderLength]);
+        [self resetBuffers];
         return nil;
     }
     
-    NSString *messageType = [NSString stringWithUTF8String:((const char *)self.builtHeader.bytes + 4)];
-    const uint32_t expectedPayloadLength = [self.builtHeader uint32AtOffset:16];
-    const uint32_t expectedChecksum = [self.builtHeader uint32AtOffset:20];
+    const char *command = (const char *)bytes + 4;
+    const uint32_t expectedPayloadLength = WSProtocolDeserializerReadUint32(bytes + 16);
+    const uint32_t expectedChecksum = WSProtocolDeserializerReadUint32(bytes + 20);
     
     if (expectedPayloadLength > WSMessageMaxLength) {
-        WSErrorSet(error, WSErrorCodeMalformed, @"Error deserializing '%@', message is too long (%u > %u)", messageType, expectedPayloadLength, WSMessageMaxLength);
-        *keepParsing = NO;
+        WSErrorSet(error, WSErrorCodeMalformed, @"Error deserializing '%s', message is too long (%u > %u)", command, expectedPayloadLength, WSMessageMaxLength);
+        [self resetBuffers];
         return nil;
     }
-    
-    if (currentPayloadLength < expectedPayloadLength) {
-        self.builtPayload.length = expectedPayloadLength;
-        
-        uint8_t *freePayload = (uint8_t *)self.builtPayload.mutableBytes + currentPayloadLength;
-        const NSUInteger toRead = self.builtPayload.length - currentPayloadLength;
-        const NSInteger actuallyRead = [inputStream read:freePayload maxLength:toRead];
-        if (actuallyRead < 0) {
-            [self resetBuffers];
-            return nil;
-        }
+    const NSUInteger messageLength = WSMessageHeaderLength + expectedPayloadLength;
+    if (length < messageLength) {
 
-//        DDLogVerbose(@"Needed for payload: %u", toRead);
-//        DDLogVerbose(@"Current buffer length: %u", available);
-//        DDLogVerbose(@"Actually read: %u", actuallyRead);
-
-        self.builtPayload.length = currentPayloadLength + actuallyRead;
-        if (self.builtPayload.length < expectedPayloadLength) {
-            *keepParsing = YES;
-            return nil;
-        }
+        // make room for the whole message so that the payload ends up contiguous
+        [self ensureAvailableLength:(messageLength - length)];
+        return nil;
     }
     
     // checkpoint: payload is complete from here
     
-    const uint32_t payloadLength = (uint32_t)self.builtPayload.length;
-    WSHash256 *payloadHash256 = [self.builtPayload computeHash256];
-    const uint32_t checksum = *(const uint32_t *)payloadHash256.bytes;
+    NSData *payloadData = [self payloadWithBytes:(bytes + WSMessageHeaderLength) length:expectedPayloadLength];
+    WSHash256 *payloadHash256 = WSHash256Compute(payloadData);
+    const uint32_t checksum = WSProtocolDeserializerReadUint32(payloadHash256.bytes);
     if (checksum != expectedChecksum) {
-        WSErrorSet(error, WSErrorCodeMalformed, @"Bad checksum deserializing '%@' (payload: %u == %u, checksum: %x == %x, hash256: %@)",
-                   messageType, payloadLength, expectedPayloadLength, checksum, expectedChecksum, payloadHash256);
+        WSErrorSet(error, WSErrorCodeMalformed, @"Bad checksum deserializing '%s' (payload: %u, checksum: %x == %x, hash256: %@)",
+                   command, expectedPayloadLength, checksum, expectedChecksum, payloadHash256);
 
-        *keepParsing = NO;
+        [self resetBuffers];
         return nil;
     }
-    
-    NSAssert(self.builtHeader.length == WSMessageHeaderLength, @"Unexpected header length (%u != %u)", self.builtHeader.length, WSMessageHeaderLength);
-    
-    DDLogVerbose(@"%@ Deserialized header: %@", self.identifier, [self.builtHeader hexString]);
+
+    WSBuffer *payload = [[WSBuffer alloc] initWithBorrowedData:payloadData];
+
+    DDLogVerbose(@"%@ Deserialized header: %@", self.identifier, [[NSData dataWithBytes:bytes length:WSMessageHeaderLength] hexString]);
     if (ddLogLevel >= LOG_LEVEL_VERBOSE) {
-        if (self.builtPayload.length <= 4096) {
-            DDLogVerbose(@"%@ Deserialized payload: %@", self.identifier, [self.builtPayload hexString]);
+        if (payload.length <= 4096) {
+            DDLogVerbose(@"%@ Deserialized payload: %@", self.identifier, [payload hexString]);
         }
         else {
-            DDLogVerbose(@"%@ Deserialized payload: %u bytes (too long to display)", self.identifier, self.builtPayload.length);
+            DDLogVerbose(@"%@ Deserialized payload: %u bytes (too long to display)", self.identifier, payload.length);
         }
     }
 
-    *keepParsing = NO;
+    self.readOffset += messageLength;
+
+    return [self.factory messageFromCommand:command payload:payload error:error];
+}
+
+#pragma mark Helpers
+
+- (void)ensureAvailableLength:(NSUInteger)length
+{
+    NSMutableData *data = self.chunk.data;
+    if (data.length - self.writeOffset >= length) {
+        return;
+    }
+    const NSUInteger pendingLength = self.writeOffset - self.readOffset;
+
+    // parsed bytes may be referenced by decoded payloads, only compact a chunk nobody borrows anymore
+    if (![self.chunk isBorrowed] && (data.length - pendingLength >= length)) {
+        memmove(data.mutableBytes, (const uint8_t *)data.bytes + self.readOffset, pendingLength);
+    }
+    else {
+        WSProtocolDeserializerChunk *chunk = [[WSProtocolDeserializerChunk alloc] initWithLength:MAX(WSProtocolDeserializerChunkLength, pendingLength + length)];
+        memcpy(chunk.data.mutableBytes, (const uint8_t *)data.bytes + self.readOffset, pendingLength);
+        self.chunk = chunk;
+    }
+    self.readOffset = 0;
+    self.writeOffset = pendingLength;
+}
+
+- (NSData *)payloadWithBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+    if (length < WSProtocolDeserializerMinBorrowedLength) {
+        return [NSData dataWithBytes:bytes length:length];
+    }
 
-    return [self.factory messageFromType:messageType payload:self.builtPayload error:error];
+    WSProtocolDeserializerChunk *chunk = self.chunk;
+    [chunk borrow];
+    return [[NSData alloc] initWithBytesNoCopy:(void *)bytes length:length deallocator:^(void *bytes, NSUInteger length) {
+        [chunk giveBack];
+    }];
 }
 
 @end
@@ -0,0 +1,48 @@
+//
+//  WSRateMonitor.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+//
+// measures blocks/s and bytes/s over a sliding time window,
+// samples are aggregated in 1-second slots
+//
+// thread-safe: no
+//
+@interface WSRateMonitor : NSObject
+
+- (instancetype)initWithWindow:(NSTimeInterval)window;
+- (NSTimeInterval)window;
+- (NSTimeInterval)startTime;
+
+- (void)addBlocks:(NSUInteger)blocks bytes:(NSUInteger)bytes atTime:(NSTimeInterval)time;
+- (BOOL)hasFullWindowAtTime:(NSTimeInterval)time; // NO until a whole window elapsed since start
+- (double)blocksPerSecondAtTime:(NSTimeInterval)time;
+- (double)bytesPerSecondAtTime:(NSTimeInterval)time;
+- (void)resetAtTime:(NSTimeInterval)time;
+
+@end
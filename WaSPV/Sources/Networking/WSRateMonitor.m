@@ -0,0 +1,163 @@
+//
+//  WSRateMonitor.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSRateMonitor.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+static const NSTimeInterval WSRateMonitorSlotDuration  = 1.0;
+
+typedef struct {
+    int64_t slot;
+    NSUInteger blocks;
+    NSUInteger bytes;
+} WSRateMonitorSample;
+
+@interface WSRateMonitor ()
+
+@property (nonatomic, assign) NSTimeInterval window;
+@property (nonatomic, assign) NSTimeInterval startTime;
+@property (nonatomic, assign) NSUInteger numberOfSlots;
+@property (nonatomic, strong) NSMutableData *samples; // WSRateMonitorSample
+
+- (int64_t)slotAtTime:(NSTimeInterval)time;
+- (void)sumBlocks:(NSUInteger *)blocks bytes:(NSUInteger *)bytes elapsed:(NSTimeInterval *)elapsed atTime:(NSTimeInterval)time;
+
+@end
+
+@implementation WSRateMonitor
+
+- (instancetype)init
+{
+    WSExceptionRaiseUnsupported(@"Use initWithWindow:");
+    return nil;
+}
+
+- (instancetype)initWithWindow:(NSTimeInterval)window
+{
+    WSExceptionCheckIllegal(window >= WSRateMonitorSlotDuration, @"Window must be at least %.1fs", WSRateMonitorSlotDuration);
+    
+    if ((self = [super init])) {
+        self.window = window;
+
+        // one more slot for the current (partial) one
+        self.numberOfSlots = (NSUInteger)ceil(window / WSRateMonitorSlotDuration) + 1;
+        self.samples = [[NSMutableData alloc] initWithLength:(self.numberOfSlots * sizeof(WSRateMonitorSample))];
+        [self resetAtTime:[NSDate timeIntervalSinceReferenceDate]];
+    }
+    return self;
+}
+
+- (void)addBlocks:(NSUInteger)blocks bytes:(NSUInteger)bytes atTime:(NSTimeInterval)time
+{
+    const int64_t slot = [self slotAtTime:time];
+    WSRateMonitorSample *sample = (WSRateMonitorSample *)self.samples.mutableBytes + (slot % self.numberOfSlots);
+
+    // slot is being reused, discard expired sample
+    if (sample->slot != slot) {
+        sample->slot = slot;
+        sample->blocks = 0;
+        sample->bytes = 0;
+    }
+    sample->blocks += blocks;
+    sample->bytes += bytes;
+}
+
+- (BOOL)hasFullWindowAtTime:(NSTimeInterval)time
+{
+    return (time - self.startTime >= self.window);
+}
+
+- (double)blocksPerSecondAtTime:(NSTimeInterval)time
+{
+    NSUInteger blocks;
+    NSTimeInterval elapsed;
+    [self sumBlocks:&blocks bytes:NULL elapsed:&elapsed atTime:time];
+    return ((elapsed > 0.0) ? (blocks / elapsed) : 0.0);
+}
+
+- (double)bytesPerSecondAtTime:(NSTimeInterval)time
+{
+    NSUInteger bytes;
+    NSTimeInterval elapsed;
+    [self sumBlocks:NULL bytes:&bytes elapsed:&elapsed atTime:time];
+    return ((elapsed > 0.0) ? (bytes / elapsed) : 0.0);
+}
+
+- (void)resetAtTime:(NSTimeInterval)time
+{
+    self.startTime = time;
+    
+    WSRateMonitorSample *samples = self.samples.mutableBytes;
+    for (NSUInteger i = 0; i < self.numberOfSlots; ++i) {
+        samples[i].slot = -1;
+        samples[i].blocks = 0;
+        samples[i].bytes = 0;
+    }
+}
+
+- (NSString *)description
+{
+    const NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    return [NSString stringWithFormat:@"{%.2f blocks/s, %.0f bytes/s, window = %.1fs}",
+            [self blocksPerSecondAtTime:now], [self bytesPerSecondAtTime:now], self.window];
+}
+
+#pragma mark Helpers
+
+- (int64_t)slotAtTime:(NSTimeInterval)time
+{
+    return (int64_t)floor(time / WSRateMonitorSlotDuration);
+}
+
+// samples before start or out of window are ignored, rates are relative to the observed time only
+- (void)sumBlocks:(NSUInteger *)blocks bytes:(NSUInteger *)bytes elapsed:(NSTimeInterval *)elapsed atTime:(NSTimeInterval)time
+{
+    const int64_t lastSlot = [self slotAtTime:time];
+    const int64_t firstSlot = MAX(lastSlot - (int64_t)self.numberOfSlots + 1, [self slotAtTime:self.startTime]);
+
+    NSUInteger sumBlocks = 0;
+    NSUInteger sumBytes = 0;
+    const WSRateMonitorSample *samples = self.samples.bytes;
+    for (NSUInteger i = 0; i < self.numberOfSlots; ++i) {
+        if ((samples[i].slot < firstSlot) || (samples[i].slot > lastSlot)) {
+            continue;
+        }
+        sumBlocks += samples[i].blocks;
+        sumBytes += samples[i].bytes;
+    }
+
+    if (blocks) {
+        *blocks = sumBlocks;
+    }
+    if (bytes) {
+        *bytes = sumBytes;
+    }
+    *elapsed = MIN(time - self.startTime, self.window);
+}
+
+@end
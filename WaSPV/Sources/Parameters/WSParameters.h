@@ -80,7 +80,22 @@
 @property (nonatomic, strong) WSFilteredBlock *genesisBlock;
 
 - (instancetype)initWithNetworkType:(WSNetworkType)networkType;
-- (void)loadCheckpointsFromHex:(NSString *)hex;
+- (void)loadCheckpointsFromHex:(NSString *)hex; // serialized WSStorableBlock, converted to table
+- (void)loadCheckpointsFromTable:(const void *)table length:(NSUInteger)length; // not copied, must outlive parameters
 - (void)addDnsSeed:(NSString *)dnsSeed;
 
 @end
+
+#pragma mark -
+
+//
+// packed checkpoint records sorted by height (and timestamp)
+//
+// height (4, little-endian)
+// header (80)
+// block id (32)
+// work (32, big-endian)
+//
+extern const NSUInteger WSCheckpointRecordLength;
+
+NSData *WSCheckpointsTableFromBlocks(NSArray *blocks);
@@ -36,12 +36,32 @@
 #import "WSBlockMacros.h"
 #import "WSErrors.h"
 
+const NSUInteger WSCheckpointRecordLength = 148;
+
+static const NSUInteger WSCheckpointHeaderOffset    = 4;
+static const NSUInteger WSCheckpointHeaderLength    = 80;
+static const NSUInteger WSCheckpointBlockIdOffset   = 84;
+static const NSUInteger WSCheckpointWorkOffset      = 116;
+static const NSUInteger WSCheckpointWorkLength      = 32;
+static const NSUInteger WSCheckpointTimestampOffset = 72;
+
+static inline uint32_t WSCheckpointReadUint32(const uint8_t *bytes)
+{
+    uint32_t n;
+    memcpy(&n, bytes, sizeof(n));
+    return CFSwapInt32LittleToHost(n);
+}
+
 @interface WSMutableParameters ()
 
 @property (nonatomic, assign) WSNetworkType networkType;
 @property (nonatomic, strong) NSMutableArray *dnsSeeds;
-@property (nonatomic, strong) NSArray *checkpoints;
-@property (nonatomic, strong) NSDictionary *checkpointsByHeight;
+@property (nonatomic, assign) const uint8_t *checkpointsTable;
+@property (nonatomic, assign) NSUInteger checkpointsCount;
+@property (nonatomic, strong) NSData *checkpointsTableData; // owned table, when loaded from hex
+
+- (const uint8_t *)checkpointRecordAtIndex:(NSUInteger)index;
+- (WSStorableBlock *)checkpointFromRecord:(const uint8_t *)record;
 
 @end
 
@@ -52,7 +72,8 @@
     if ((self = [super init])) {
         self.networkType = networkType;
         self.dnsSeeds = [[NSMutableArray alloc] init];
-        self.checkpoints = nil;
+        self.checkpointsTable = NULL;
+        self.checkpointsCount = 0;
     }
     return self;
 }
@@ -69,7 +90,6 @@
     WSBuffer *buffer = WSBufferFromHex(hex);
 
     NSMutableArray *checkpoints = [[NSMutableArray alloc] initWithCapacity:100];
-    NSMutableDictionary *checkpointsByHeight = [[NSMutableDictionary alloc] initWithCapacity:100];
 
     NSUInteger offset = 0;
     while (offset < buffer.length) {
@@ -79,48 +99,96 @@
                                                                    available:(buffer.length - offset)
                                                                        error:NULL];
         [checkpoints addObject:block];
-        checkpointsByHeight[@(block.height)] = block;
 
         offset += [block estimatedSize];
     }
     NSAssert(offset == buffer.length, @"Malformed checkpoints file (consumed bytes: %u != %u)", offset, buffer.length);
 
-    [checkpoints enumerateObjectsUsingBlock:^(WSStorableBlock *cp, NSUInteger idx, BOOL *stop) {
-        if (idx > 0) {
-            WSStorableBlock *previousCp = checkpoints[idx - 1];
-            NSAssert(cp.height > previousCp.height, @"Checkpoint is older than last checkpoint");
-        }
-    }];
+    self.checkpointsTableData = WSCheckpointsTableFromBlocks(checkpoints);
+    [self loadCheckpointsFromTable:self.checkpointsTableData.bytes length:self.checkpointsTableData.length];
+}
+
+- (void)loadCheckpointsFromTable:(const void *)table length:(NSUInteger)length
+{
+    WSExceptionCheckIllegal((table != NULL) || (length == 0), @"NULL table");
+    WSExceptionCheckIllegal(length % WSCheckpointRecordLength == 0, @"Malformed checkpoints table (length: %u)", length);
+
+    if (table != self.checkpointsTableData.bytes) {
+        self.checkpointsTableData = nil;
+    }
+    self.checkpointsTable = table;
+    self.checkpointsCount = length / WSCheckpointRecordLength;
+
+    for (NSUInteger i = 1; i < self.checkpointsCount; ++i) {
+        const uint8_t *previousRecord = [self checkpointRecordAtIndex:(i - 1)];
+        const uint8_t *record = [self checkpointRecordAtIndex:i];
 
-    self.checkpoints = checkpoints;
-    self.checkpointsByHeight = checkpointsByHeight;
+        NSAssert(WSCheckpointReadUint32(record) > WSCheckpointReadUint32(previousRecord), @"Checkpoint is older than last checkpoint");
+        NSAssert(WSCheckpointReadUint32(record + WSCheckpointTimestampOffset) >= WSCheckpointReadUint32(previousRecord + WSCheckpointTimestampOffset), @"Checkpoints not sorted by timestamp");
+    }
+}
+
+- (NSArray *)checkpoints
+{
+    if (self.checkpointsCount == 0) {
+        return nil;
+    }
+
+    NSMutableArray *checkpoints = [[NSMutableArray alloc] initWithCapacity:self.checkpointsCount];
+    for (NSUInteger i = 0; i < self.checkpointsCount; ++i) {
+        [checkpoints addObject:[self checkpointFromRecord:[self checkpointRecordAtIndex:i]]];
+    }
+    return checkpoints;
 }
 
 - (WSStorableBlock *)checkpointAtHeight:(uint32_t)height
 {
-    return self.checkpointsByHeight[@(height)];
+    NSUInteger low = 0;
+    NSUInteger high = self.checkpointsCount;
+    while (low < high) {
+        const NSUInteger mid = low + (high - low) / 2;
+        const uint8_t *record = [self checkpointRecordAtIndex:mid];
+        const uint32_t recordHeight = WSCheckpointReadUint32(record);
+
+        if (recordHeight == height) {
+            return [self checkpointFromRecord:record];
+        }
+        if (recordHeight < height) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    return nil;
 }
 
 - (WSStorableBlock *)lastCheckpointBeforeTimestamp:(uint32_t)timestamp
 {
-    if (self.checkpoints.count == 0) {
+    if (self.checkpointsCount == 0) {
         return nil;
     }
     
-    // NOTE: assumes checkpoints are sorted by timestamp
-    WSStorableBlock *lastCheckpoint = nil;
-    for (WSStorableBlock *cp in [self.checkpoints reverseObjectEnumerator]) {
-        if (cp.header.timestamp <= timestamp) {
-            lastCheckpoint = cp;
-            break;
+    // first checkpoint after timestamp
+    NSUInteger low = 0;
+    NSUInteger high = self.checkpointsCount;
+    while (low < high) {
+        const NSUInteger mid = low + (high - low) / 2;
+        const uint8_t *record = [self checkpointRecordAtIndex:mid];
+
+        if (WSCheckpointReadUint32(record + WSCheckpointTimestampOffset) <= timestamp) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
         }
     }
-    if (!lastCheckpoint) {
+
+    if (low == 0) {
         WSFilteredBlock *genesisBlock = self.genesisBlock;
-        lastCheckpoint = [[WSStorableBlock alloc] initWithHeader:genesisBlock.header transactions:nil height:0];
+        return [[WSStorableBlock alloc] initWithHeader:genesisBlock.header transactions:nil height:0];
     }
-    
-    return lastCheckpoint;
+    return [self checkpointFromRecord:[self checkpointRecordAtIndex:(low - 1)]];
 }
 
 - (void)addDnsSeed:(NSString *)dnsSeed
@@ -128,4 +196,43 @@
     [self.dnsSeeds addObject:dnsSeed];
 }
 
+#pragma mark Helpers
+
+- (const uint8_t *)checkpointRecordAtIndex:(NSUInteger)index
+{
+    NSParameterAssert(index < self.checkpointsCount);
+
+    return (self.checkpointsTable + index * WSCheckpointRecordLength);
+}
+
+- (WSStorableBlock *)checkpointFromRecord:(const uint8_t *)record
+{
+    WSHash256 *blockId = WSHash256FromData([NSData dataWithBytes:(record + WSCheckpointBlockIdOffset) length:WSHash256Length]);
+    WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self bytes:(record + WSCheckpointHeaderOffset) blockId:blockId];
+    NSData *work = [NSData dataWithBytes:(record + WSCheckpointWorkOffset) length:WSCheckpointWorkLength];
+
+    return [[WSStorableBlock alloc] initWithHeader:header transactions:nil height:WSCheckpointReadUint32(record) work:work];
+}
+
 @end
+
+NSData *WSCheckpointsTableFromBlocks(NSArray *blocks)
+{
+    NSMutableData *table = [[NSMutableData alloc] initWithLength:(blocks.count * WSCheckpointRecordLength)];
+    uint8_t *record = table.mutableBytes;
+
+    for (WSStorableBlock *block in blocks) {
+        const uint32_t height = CFSwapInt32HostToLittle(block.height);
+        memcpy(record, &height, sizeof(height));
+        memcpy(record + WSCheckpointHeaderOffset, block.header.bytes, WSCheckpointHeaderLength);
+        memcpy(record + WSCheckpointBlockIdOffset, block.blockId.bytes, WSHash256Length);
+
+        // right-aligned big-endian
+        NSData *work = block.workData;
+        NSCAssert(work.length <= WSCheckpointWorkLength, @"Work overflow");
+        memcpy(record + WSCheckpointWorkOffset + WSCheckpointWorkLength - work.length, work.bytes, work.length);
+
+        record += WSCheckpointRecordLength;
+    }
+    return table;
+}
@@ -33,6 +33,186 @@
 #import "WSBitcoin.h"
 #import "WSMacros.h"
 
+// height, header, block id, work (see WSCheckpointRecordLength)
+static const uint8_t WSParametersMainCheckpoints[] = {
+    // #20160
+    0xc0, 0x4e, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x2f, 0x82, 0xb8, 0x76, 0x70, 0x84, 0x5f, 0xaa,
+    0xdd, 0xe3, 0xfe, 0xdd, 0x0d, 0xbf, 0x50, 0x40, 0xdb, 0x62, 0xba, 0x2b, 0x25, 0xc2, 0x3e, 0x2c,
+    0x84, 0x08, 0xc1, 0x74, 0x00, 0x00, 0x00, 0x00, 0xed, 0x73, 0xdf, 0x50, 0x23, 0xc8, 0xe8, 0xf4,
+    0x77, 0xfb, 0x96, 0x5f, 0xe4, 0xc3, 0xcb, 0xfe, 0x5e, 0xe3, 0x4b, 0x7d, 0x8b, 0x56, 0xc3, 0xef,
+    0xa3, 0xf3, 0xf9, 0xc0, 0xb2, 0x75, 0xc9, 0x13, 0x18, 0x52, 0x6a, 0x4a, 0xff, 0xff, 0x00, 0x1d,
+    0xd9, 0x53, 0x97, 0x04, 0x1e, 0x46, 0x6d, 0x56, 0x96, 0xfc, 0xcc, 0x98, 0xcd, 0xf4, 0x2f, 0x52,
+    0x2d, 0x13, 0x87, 0x64, 0x3e, 0x37, 0x3a, 0xd3, 0x63, 0xee, 0x0a, 0x19, 0x56, 0xef, 0x1a, 0x0f,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4e, 0xc1,
+    0x4e, 0xc1, 0x4e, 0xc1,
+    // #40320
+    0x80, 0x9d, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x1a, 0x23, 0x10, 0x97, 0xb6, 0xab, 0x62, 0x79,
+    0xc8, 0x0f, 0x24, 0x67, 0x4a, 0x2c, 0x8e, 0xe5, 0xb9, 0xa8, 0x48, 0xe1, 0xd4, 0x57, 0x15, 0xad,
+    0x89, 0xb6, 0x35, 0x81, 0x00, 0x00, 0x00, 0x00, 0xa8, 0x22, 0xba, 0xfe, 0x6e, 0xd8, 0x60, 0x0e,
+    0x3f, 0xfc, 0xe6, 0xd6, 0x1d, 0x10, 0xdf, 0x19, 0x27, 0xea, 0xfe, 0x9b, 0xbf, 0x67, 0x7c, 0xb4,
+    0x4c, 0x4d, 0x20, 0x9f, 0x14, 0x3c, 0x6b, 0xa8, 0xdb, 0x8c, 0x78, 0x4b, 0x57, 0x46, 0x65, 0x1c,
+    0xce, 0x22, 0x21, 0x18, 0x45, 0x72, 0x0d, 0x24, 0xea, 0xe3, 0x3a, 0xde, 0x0d, 0x10, 0x39, 0x7a,
+    0x2e, 0x02, 0x98, 0x9e, 0xde, 0xf8, 0x34, 0x70, 0x1b, 0x96, 0x5a, 0x9b, 0x16, 0x1e, 0x86, 0x45,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xaa, 0x83,
+    0x47, 0x0b, 0x02, 0x22,
+    // #60480
+    0x40, 0xec, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x93, 0x4c, 0x2b, 0xd5, 0xa4, 0x56, 0x18, 0x0b,
+    0x40, 0x43, 0x41, 0xa3, 0x80, 0xd2, 0x0f, 0x51, 0xd0, 0x86, 0x2b, 0x38, 0x31, 0x1d, 0xeb, 0x4d,
+    0x95, 0x05, 0x45, 0x09, 0x00, 0x00, 0x00, 0x00, 0x29, 0x9a, 0x17, 0x02, 0xe4, 0x9c, 0xf6, 0x9b,
+    0xc3, 0xd0, 0xa6, 0xee, 0xe2, 0x75, 0x10, 0xcc, 0x3c, 0xca, 0x5a, 0x42, 0x7e, 0x1d, 0x00, 0x0b,
+    0x2c, 0xca, 0xf9, 0x07, 0x11, 0x6a, 0xaf, 0x48, 0x22, 0xc6, 0x12, 0x4c, 0x64, 0xba, 0x0e, 0x1c,
+    0x54, 0x23, 0xc2, 0x04, 0x37, 0x38, 0x15, 0x55, 0xd6, 0xdf, 0x37, 0xf4, 0xaa, 0x0d, 0xe1, 0xc9,
+    0x2c, 0xff, 0x1c, 0xff, 0x08, 0xb4, 0xd5, 0x46, 0x8f, 0xd3, 0x3e, 0xe7, 0x2c, 0xe2, 0x32, 0x06,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x31, 0x08,
+    0x91, 0x80, 0x48, 0xf5,
+    // #80640
+    0x00, 0x3b, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0e, 0x86, 0x0d, 0xe6, 0x5c, 0x35, 0xa9, 0x4d,
+    0x2e, 0x33, 0x5b, 0xe7, 0xd7, 0x9a, 0xab, 0xb6, 0xe3, 0xdd, 0xf3, 0x91, 0x8e, 0x6d, 0x65, 0xc6,
+    0x1e, 0x5b, 0x23, 0x00, 0x00, 0x00, 0x00, 0x00, 0xe3, 0x6a, 0xbc, 0x21, 0x27, 0x22, 0x9d, 0x3a,
+    0x94, 0xae, 0x0e, 0x20, 0x67, 0xa0, 0xa7, 0x5c, 0xab, 0x61, 0x62, 0x9d, 0x5b, 0x2f, 0x01, 0xb9,
+    0x27, 0xdf, 0x43, 0xb6, 0xc0, 0x02, 0x5a, 0x08, 0x97, 0x6f, 0x95, 0x4c, 0xed, 0x66, 0x47, 0x1b,
+    0xfb, 0x11, 0xbb, 0x03, 0x59, 0xa6, 0xa3, 0x59, 0xd8, 0xd1, 0x65, 0x60, 0x4d, 0x8a, 0x8c, 0x51,
+    0x7e, 0xb6, 0x1d, 0xf0, 0xe2, 0x97, 0x06, 0x6a, 0x9f, 0xdf, 0x7e, 0xb8, 0x80, 0x7c, 0x30, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x57, 0x3c, 0x84,
+    0x22, 0x53, 0x3f, 0x62,
+    // #100800
+    0xc0, 0x89, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0xdd, 0xf7, 0x50, 0x90, 0xbe, 0xbe, 0x04, 0xfd,
+    0x00, 0xbd, 0x5d, 0x54, 0x94, 0x5a, 0x7e, 0x77, 0x5f, 0xf2, 0x1a, 0x01, 0x23, 0x74, 0xe2, 0x84,
+    0xfe, 0x5a, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7a, 0x71, 0x10, 0x0d, 0xa3, 0x2b, 0x45, 0x4f,
+    0x15, 0xe1, 0x86, 0x3b, 0x6d, 0xda, 0x14, 0x8c, 0x83, 0x0f, 0x92, 0xc0, 0xe9, 0x98, 0x06, 0xc1,
+    0x0f, 0x69, 0xac, 0x63, 0x92, 0xea, 0x3c, 0xb9, 0x33, 0x5a, 0x21, 0x4d, 0xcb, 0x04, 0x04, 0x1b,
+    0x24, 0xda, 0x04, 0xf8, 0x7a, 0xe4, 0x04, 0xb7, 0xac, 0xd5, 0x11, 0x96, 0xff, 0xf4, 0x9e, 0x98,
+    0x26, 0x40, 0x79, 0x46, 0x4a, 0x9a, 0x4a, 0xc6, 0x71, 0xc4, 0x3c, 0xd4, 0x83, 0xe3, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0xf5, 0xa2, 0x51,
+    0x4e, 0xcc, 0x5a, 0xe0,
+    // #120960
+    0x80, 0xd8, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x3d, 0x03, 0xef, 0x67, 0xe9, 0x23, 0x10, 0xf1,
+    0xf1, 0x16, 0x1f, 0xcf, 0x6e, 0x36, 0x31, 0xbc, 0xd2, 0x5a, 0x93, 0xe5, 0xe4, 0x22, 0xb5, 0xac,
+    0x84, 0xa3, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x96, 0x17, 0x30, 0x96, 0xe7, 0x3d, 0xb1,
+    0x73, 0xc4, 0xb2, 0x1a, 0xe7, 0x6b, 0xbb, 0xbf, 0x65, 0x5e, 0xbb, 0x5b, 0xd9, 0x66, 0x2e, 0x91,
+    0xda, 0x72, 0x11, 0x44, 0xc5, 0x4e, 0xea, 0xda, 0x8c, 0x79, 0xbb, 0x4d, 0xfa, 0x98, 0x00, 0x1b,
+    0x58, 0x98, 0xb8, 0x54, 0xfc, 0x36, 0x08, 0x77, 0xb0, 0xe1, 0x3d, 0xca, 0x90, 0xf4, 0x71, 0xf2,
+    0xc4, 0xb5, 0x07, 0xc8, 0xe9, 0x9a, 0x96, 0x6b, 0x40, 0xe4, 0xf7, 0x0c, 0x92, 0x2c, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x68, 0x23, 0xe1,
+    0xd7, 0x80, 0x11, 0xb6,
+    // #141120
+    0x40, 0x27, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0a, 0x5d, 0x88, 0xcc, 0xd0, 0xc5, 0x6b, 0x9b,
+    0xbe, 0x4c, 0x84, 0xac, 0xae, 0x72, 0x50, 0xa2, 0xd4, 0xdc, 0x5b, 0xa9, 0x2f, 0x52, 0x78, 0x3d,
+    0xd3, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2c, 0x92, 0x03, 0x0e, 0x62, 0x81, 0xbe, 0x57,
+    0xbe, 0xc7, 0x76, 0xb0, 0x84, 0xdc, 0x31, 0x6f, 0xeb, 0xfc, 0xb2, 0x48, 0x7a, 0xb9, 0x6e, 0xc7,
+    0x17, 0x08, 0xaf, 0x36, 0x53, 0x19, 0x55, 0xe9, 0x76, 0xaf, 0x49, 0x4e, 0x86, 0x4a, 0x09, 0x1a,
+    0x1d, 0xda, 0x09, 0xed, 0x14, 0x61, 0x88, 0x89, 0xe1, 0x92, 0x63, 0x8b, 0x12, 0xc0, 0xb5, 0x8a,
+    0x69, 0x46, 0x84, 0x0a, 0x78, 0x0a, 0xda, 0x5e, 0x08, 0xaf, 0xe1, 0x14, 0xd2, 0x02, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x71, 0x70, 0xe1, 0xc1,
+    0x2b, 0xfa, 0x4b, 0x30,
+    // #161280
+    0x00, 0x76, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0xc4, 0x83, 0x81, 0xc4, 0x3b, 0x1d, 0x2e, 0xbd,
+    0x38, 0x6c, 0x70, 0x97, 0x12, 0x89, 0xaa, 0x69, 0xe9, 0x74, 0xff, 0x28, 0x1f, 0xed, 0xd2, 0x7f,
+    0x1b, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0xec, 0x01, 0x45, 0x02, 0x5b, 0x8a, 0xc8,
+    0x11, 0xb4, 0x86, 0xfc, 0x91, 0xf0, 0x7f, 0x5a, 0x39, 0xa2, 0x17, 0x0c, 0x2e, 0xee, 0x10, 0x66,
+    0x23, 0x8d, 0xda, 0x45, 0x45, 0xaf, 0x70, 0xb6, 0xc8, 0xdf, 0x09, 0x4f, 0xd7, 0x69, 0x0d, 0x1a,
+    0x35, 0x09, 0x99, 0xb5, 0x99, 0x3b, 0x94, 0x31, 0xdc, 0x68, 0x4b, 0x43, 0xfd, 0xef, 0x5c, 0xb7,
+    0x75, 0x64, 0x30, 0xa8, 0x10, 0xf5, 0x7f, 0xde, 0x09, 0x62, 0xe2, 0x1f, 0x91, 0x05, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0b, 0x27, 0x88, 0x72, 0x28,
+    0x44, 0xce, 0x4b, 0xff,
+    // #181440
+    0xc0, 0xc4, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0xb8, 0x07, 0xc2, 0xde, 0xc8, 0xb7, 0x35, 0xf7,
+    0x1b, 0xba, 0x13, 0x19, 0x6f, 0x69, 0xdc, 0x26, 0xd2, 0xc7, 0x5e, 0xa8, 0x31, 0x86, 0x2b, 0xd7,
+    0xb4, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x90, 0x61, 0xc7, 0x19, 0x6a, 0x00, 0x9b, 0x96,
+    0x16, 0xb0, 0xcb, 0xc1, 0xa9, 0x3e, 0x70, 0xc6, 0x33, 0x4e, 0x1b, 0xd6, 0xef, 0xe2, 0x79, 0x08,
+    0x85, 0x0a, 0xb0, 0x34, 0xc6, 0x59, 0xfe, 0xf2, 0x95, 0x79, 0xbe, 0x4f, 0x5f, 0x8b, 0x0a, 0x1a,
+    0x22, 0x5d, 0x77, 0xa7, 0x64, 0x0e, 0xef, 0x12, 0x78, 0xa6, 0xbb, 0x6b, 0x69, 0x44, 0x75, 0xa1,
+    0xf5, 0x8e, 0xb9, 0x12, 0x8c, 0xd5, 0x92, 0x09, 0xdf, 0x19, 0xfc, 0x27, 0xe5, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x12, 0x14, 0xb3, 0xa7, 0x6a,
+    0xda, 0xd5, 0x2b, 0xb6,
+    // #201600
+    0x80, 0x13, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 0x9d, 0x6f, 0x4e, 0x09, 0xd5, 0x79, 0xc9, 0x30,
+    0x15, 0xa8, 0x3e, 0x90, 0x81, 0xfe, 0xe8, 0x3a, 0x5c, 0x8b, 0x1b, 0xa3, 0xc8, 0x65, 0x16, 0xb6,
+    0x1f, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x25, 0x39, 0x93, 0x17, 0xbb, 0x5c, 0x7c, 0x4d,
+    0xae, 0xfe, 0x8f, 0xe2, 0xc4, 0xdf, 0xac, 0x0c, 0xea, 0x7e, 0x4e, 0x85, 0x91, 0x3c, 0xd6, 0x67,
+    0x03, 0x03, 0x77, 0x24, 0x0c, 0xad, 0xfe, 0x93, 0xa4, 0x90, 0x6b, 0x50, 0x08, 0x7e, 0x05, 0x1a,
+    0x84, 0x29, 0x7d, 0xf7, 0xd0, 0x9a, 0xcd, 0xf9, 0xc9, 0x95, 0x9a, 0x17, 0x54, 0xda, 0x9d, 0xae,
+    0x91, 0x6e, 0x70, 0xbe, 0xf9, 0xf1, 0x31, 0xad, 0x30, 0xef, 0x8b, 0xe2, 0xa5, 0x03, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1b, 0xd1, 0x9c, 0x9a, 0xd8,
+    0x59, 0x6d, 0xd8, 0xd0,
+    // #221760
+    0x40, 0x62, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 0x74, 0x7c, 0xcc, 0x50, 0x7c, 0xb0, 0xbe, 0x8b,
+    0x45, 0x8d, 0xaa, 0xaf, 0x94, 0xc1, 0x68, 0xf4, 0x8a, 0x55, 0x5f, 0xda, 0x09, 0x95, 0xa8, 0x4c,
+    0xb3, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x14, 0x60, 0xf2, 0xf1, 0x85, 0x5d, 0x75, 0xfc,
+    0x1b, 0xe8, 0xaa, 0xf2, 0x1b, 0x58, 0xb0, 0x04, 0xfe, 0xca, 0xae, 0x04, 0xff, 0xc6, 0x81, 0xb9,
+    0xc6, 0xcf, 0xda, 0x64, 0x1f, 0x62, 0x21, 0xd7, 0x36, 0x7a, 0x21, 0x51, 0x5c, 0x98, 0x04, 0x1a,
+    0x23, 0x6d, 0x0d, 0xff, 0x01, 0xf4, 0xd1, 0x4b, 0x26, 0xd3, 0x08, 0x09, 0xb4, 0x60, 0x25, 0x39,
+    0x89, 0x35, 0x33, 0x9e, 0x0f, 0x02, 0xd6, 0x5e, 0xea, 0x77, 0xdd, 0x85, 0xfc, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2a, 0xe0, 0xd8, 0x5d, 0x5e,
+    0xf4, 0xc3, 0xf6, 0x78,
+    // #241920
+    0x00, 0xb1, 0x03, 0x00, 0x02, 0x00, 0x00, 0x00, 0x41, 0x0a, 0xbe, 0xab, 0xf0, 0x07, 0xc1, 0x24,
+    0x79, 0x61, 0xd2, 0xac, 0xd1, 0x33, 0x39, 0x3f, 0xaf, 0xea, 0x89, 0xaf, 0x19, 0xee, 0x6f, 0xb6,
+    0xd9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x37, 0xeb, 0x13, 0xc1, 0x17, 0xf5, 0x09, 0x92,
+    0x89, 0xa4, 0x3a, 0xbb, 0xd5, 0xa1, 0x73, 0xfe, 0xf0, 0x40, 0x47, 0xdb, 0x98, 0x0c, 0x0c, 0xb8,
+    0x4c, 0x6a, 0x19, 0x30, 0xf3, 0xb9, 0xc6, 0x14, 0x1e, 0x30, 0xbe, 0x51, 0x15, 0xde, 0x00, 0x1a,
+    0x8c, 0x14, 0x31, 0xed, 0xfa, 0x50, 0x7b, 0x26, 0x08, 0x73, 0xcc, 0xee, 0x6a, 0x4b, 0x87, 0x75,
+    0x88, 0xc4, 0x0c, 0xaf, 0x9a, 0x73, 0x35, 0x46, 0xd1, 0x9a, 0x25, 0x9f, 0xb7, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x52, 0xe3, 0xb2, 0x50, 0xdd,
+    0x86, 0x00, 0xd6, 0xed,
+    // #262080
+    0xc0, 0xff, 0x03, 0x00, 0x02, 0x00, 0x00, 0x00, 0xc1, 0xff, 0x84, 0xe9, 0x5f, 0x9a, 0x73, 0xd7,
+    0x60, 0xb3, 0x7e, 0x44, 0x40, 0x56, 0xb7, 0x48, 0x67, 0xfc, 0xd8, 0xa3, 0x82, 0xe1, 0x3c, 0xc1,
+    0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x98, 0x74, 0x1b, 0xf1, 0xf6, 0x80, 0x6b,
+    0x26, 0xbc, 0x84, 0x96, 0xf4, 0xef, 0xbc, 0xcd, 0x52, 0xca, 0x36, 0xb2, 0x7b, 0x82, 0x7c, 0x2d,
+    0xfb, 0x6f, 0x1f, 0x05, 0x5e, 0x72, 0xc3, 0xa4, 0xd8, 0x76, 0x51, 0x52, 0xca, 0xb0, 0x16, 0x19,
+    0x1b, 0x45, 0x80, 0x76, 0xe2, 0xd0, 0x35, 0x82, 0x76, 0xdc, 0xfd, 0xff, 0x72, 0xce, 0x02, 0x7d,
+    0x75, 0xb0, 0xb7, 0xd3, 0xb8, 0xc6, 0xea, 0x3d, 0xc3, 0xe1, 0x7b, 0xa7, 0x0a, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x6c, 0xc4, 0x2d, 0x7f, 0xd0,
+    0x0b, 0x16, 0xf4, 0x51,
+    // #282240
+    0x80, 0x4e, 0x04, 0x00, 0x02, 0x00, 0x00, 0x00, 0xe0, 0x3f, 0x40, 0x1b, 0xd7, 0xd2, 0x48, 0x4a,
+    0x32, 0x3e, 0xcd, 0x4b, 0x6b, 0xf9, 0x94, 0x5a, 0x1a, 0x35, 0xde, 0x61, 0xa4, 0x42, 0x35, 0x51,
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0xb2, 0xdf, 0x22, 0x38, 0x2e, 0x43, 0xf5,
+    0xb5, 0x27, 0xc0, 0xa6, 0xb8, 0xb2, 0x30, 0xbc, 0xcb, 0x93, 0x94, 0x70, 0x43, 0xb7, 0xf9, 0x35,
+    0x7a, 0xd3, 0xf6, 0x59, 0x1f, 0x28, 0x97, 0x49, 0x8e, 0x6a, 0xe2, 0x52, 0x2c, 0xf5, 0x01, 0x19,
+    0xa2, 0xca, 0x67, 0x35, 0xa8, 0x5c, 0xde, 0x06, 0x23, 0x8a, 0xfd, 0xde, 0xcf, 0x6a, 0xc4, 0xe0,
+    0x63, 0x37, 0x76, 0x69, 0x66, 0x28, 0x07, 0x96, 0x52, 0xe7, 0x9e, 0xef, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x0b, 0xbd, 0x54, 0x1d, 0x5a,
+    0x61, 0x92, 0x3e, 0x1d,
+    // #302400
+    0x40, 0x9d, 0x04, 0x00, 0x02, 0x00, 0x00, 0x00, 0x66, 0x53, 0x33, 0x17, 0x89, 0x44, 0x2d, 0xa3,
+    0x8f, 0xf4, 0x05, 0xa9, 0xf3, 0x80, 0x7c, 0x7d, 0x34, 0x07, 0xa7, 0xe0, 0x85, 0xb5, 0xe9, 0x0e,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc5, 0x65, 0x2b, 0xd2, 0x1f, 0x27, 0xa0, 0x87,
+    0x35, 0x15, 0xc5, 0xa5, 0x38, 0xfc, 0x74, 0x1e, 0xe6, 0x12, 0x01, 0xd7, 0x24, 0x13, 0xc1, 0x85,
+    0x6e, 0x09, 0x86, 0x70, 0x7c, 0xe3, 0x60, 0x4d, 0xee, 0x79, 0x80, 0x53, 0x42, 0x28, 0x69, 0x18,
+    0x6b, 0xda, 0x24, 0xf3, 0x70, 0xb1, 0x1b, 0xf9, 0xeb, 0xe5, 0x74, 0x7a, 0x57, 0x96, 0x3e, 0x1c,
+    0xff, 0x61, 0xf4, 0xca, 0x8a, 0x35, 0xaf, 0xda, 0xc4, 0x32, 0x21, 0x47, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x6d, 0x82, 0xe3, 0xc9, 0x3a, 0x69,
+    0xc3, 0xf4, 0x9d, 0x40,
+    // #322560
+    0x00, 0xec, 0x04, 0x00, 0x02, 0x00, 0x00, 0x00, 0x0f, 0x6a, 0xf9, 0x38, 0x32, 0x0a, 0x7e, 0xfb,
+    0x35, 0x4d, 0xf9, 0xda, 0x98, 0xf3, 0xe5, 0xc0, 0xa1, 0xde, 0x07, 0x15, 0xa2, 0xd1, 0x07, 0x16,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xba, 0xba, 0x50, 0xa2, 0x11, 0x6b, 0x65, 0x02,
+    0x2b, 0x43, 0x7a, 0x9c, 0x91, 0x2c, 0x83, 0xd1, 0x8c, 0x39, 0xa1, 0x61, 0xd8, 0x8d, 0x5d, 0x26,
+    0x10, 0x11, 0x41, 0x3c, 0x79, 0x57, 0x0b, 0x73, 0x50, 0x87, 0x24, 0x54, 0x93, 0xb8, 0x1f, 0x18,
+    0x69, 0xe5, 0x70, 0x2b, 0xa1, 0xcf, 0x01, 0xf1, 0x69, 0x54, 0x02, 0x09, 0xdd, 0x41, 0xe3, 0x10,
+    0x96, 0x51, 0x2e, 0x39, 0x78, 0x05, 0xfe, 0xd4, 0xd9, 0x2d, 0xdf, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0xc8, 0xcf, 0x1d, 0x42, 0x68, 0x3d,
+    0xa6, 0x10, 0xee, 0x60
+};
+
 @interface WSParametersFactoryMain ()
 
 @property (nonatomic, strong) WSMutableParameters *parameters;
@@ -84,7 +264,7 @@
         [parameters addDnsSeed:@"seed.bitnodes.io"];
         [parameters addDnsSeed:@"bitseed.xf2.org"];
         
-        [parameters loadCheckpointsFromHex:@"010000002f82b87670845faadde3fedd0dbf5040db62ba2b25c23e2c8408c17400000000ed73df5023c8e8f477fb965fe4c3cbfe5ee34b7d8b56c3efa3f3f9c0b275c91318526a4affff001dd953970400c04e0000064ec14ec14ec1010000001a231097b6ab6279c80f24674a2c8ee5b9a848e1d45715ad89b6358100000000a822bafe6ed8600e3ffce6d61d10df1927eafe9bbf677cb44c4d209f143c6ba8db8c784b5746651cce22211800809d000006aa83470b022201000000934c2bd5a456180b404341a380d20f51d0862b38311deb4d9505450900000000299a1702e49cf69bc3d0a6eee27510cc3cca5a427e1d000b2ccaf907116aaf4822c6124c64ba0e1c5423c2040040ec000007033108918048f5010000000e860de65c35a94d2e335be7d79aabb6e3ddf3918e6d65c61e5b230000000000e36abc2127229d3a94ae0e2067a0a75cab61629d5b2f01b927df43b6c0025a08976f954ced66471bfb11bb0300003b010007573c8422533f6201000000ddf75090bebe04fd00bd5d54945a7e775ff21a012374e284fe5a0200000000007a71100da32b454f15e1863b6dda148c830f92c0e99806c10f69ac6392ea3cb9335a214dcb04041b24da04f800c08901000806f5a2514ecc5ae0010000003d03ef67e92310f1f1161fcf6e3631bcd25a93e5e422b5ac84a30000000000007096173096e73db173c4b21ae76bbbbf655ebb5bd9662e91da721144c54eeada8c79bb4dfa98001b5898b8540080d8010008426823e1d78011b6010000000a5d88ccd0c56b9bbe4c84acae7250a2d4dc5ba92f52783dd3070000000000002c92030e6281be57bec776b084dc316febfcb2487ab96ec71708af36531955e976af494e864a091a1dda09ed004027020009047170e1c12bfa4b3001000000c48381c43b1d2ebd386c70971289aa69e974ff281fedd27f1b03000000000000fcec0145025b8ac811b486fc91f07f5a39a2170c2eee1066238dda4545af70b6c8df094fd7690d1a350999b50000760200090b2788722844ce4bff01000000b807c2dec8b735f71bba13196f69dc26d2c75ea831862bd7b4040000000000009061c7196a009b9616b0cbc1a93e70c6334e1bd6efe27908850ab034c659fef29579be4f5f8b0a1a225d77a700c0c40200091214b3a76adad52bb6010000009d6f4e09d579c93015a83e9081fee83a5c8b1ba3c86516b61f0400000000000025399317bb5c7c4daefe8fe2c4dfac0cea7e4e85913cd667030377240cadfe93a4906b50087e051a84297df70080130300091bd19c9ad8596dd8d001000000747ccc507cb0be8b458daaaf94c168f48a555fda0995a84cb3030000000000001460f2f1855d75fc1be8aaf21b58b004fecaae04ffc681b9c6cfda641f6221d7367a21515c98041a236d0dff0040620300092ae0d85d5ef4c3f67802000000410abeabf007c1247961d2acd133393fafea89af19ee6fb6d90000000000000037eb13c117f5099289a43abbd5a173fef04047db980c0cb84c6a1930f3b9c6141e30be5115de001a8c1431ed0000b103000952e3b250dd8600d6ed02000000c1ff84e95f9a73d760b37e444056b74867fcd8a382e13cc110000000000000003998741bf1f6806b26bc8496f4efbccd52ca36b27b827c2dfb6f1f055e72c3a4d8765152cab016191b45807600c0ff03000a016cc42d7fd00b16f45102000000e03f401bd7d2484a323ecd4b6bf9945a1a35de61a442355102000000000000003eb2df22382e43f5b527c0a6b8b230bccb93947043b7f9357ad3f6591f2897498e6ae2522cf50119a2ca673500804e04000a100bbd541d5a61923e1d020000006653331789442da38ff405a9f3807c7d3407a7e085b5e90e0000000000000000c5652bd21f27a0873515c5a538fc741ee61201d72413c1856e0986707ce3604dee798053422869186bda24f300409d04000a6d82e3c93a69c3f49d40020000000f6af938320a7efb354df9da98f3e5c0a1de0715a2d107160000000000000000baba50a2116b65022b437a9c912c83d18c39a161d88d5d261011413c79570b735087245493b81f1869e5702b0000ec04000b01c8cf1d42683da610ee60"];
+        [parameters loadCheckpointsFromTable:WSParametersMainCheckpoints length:sizeof(WSParametersMainCheckpoints)];
 
         self.parameters = parameters;
     }
@@ -46,6 +46,175 @@
 // The IsStandard() check is disabled so that non-standard transactions can be experimented with.
 //
 
+// height, header, block id, work (see WSCheckpointRecordLength)
+static const uint8_t WSParametersTestnet3Checkpoints[] = {
+    // #20160
+    0xc0, 0x4e, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x48, 0x7f, 0x6b, 0xcc, 0x6f, 0x25, 0x42, 0x7d,
+    0x55, 0x47, 0xcc, 0x2a, 0x83, 0xf1, 0x96, 0x31, 0x1b, 0xbd, 0xaf, 0x69, 0xee, 0xf3, 0x18, 0x96,
+    0x9f, 0xc4, 0x59, 0x13, 0x00, 0x00, 0x00, 0x00, 0x37, 0x04, 0x10, 0x99, 0x64, 0xec, 0xdd, 0x49,
+    0x45, 0xc2, 0x28, 0x22, 0xc9, 0x99, 0x23, 0xaf, 0xb9, 0x8e, 0x5c, 0xb0, 0x3e, 0x04, 0xf8, 0x1b,
+    0x83, 0xaa, 0x5d, 0x0a, 0x36, 0x70, 0x91, 0x4b, 0xfa, 0x17, 0x2b, 0x50, 0x56, 0x17, 0x4d, 0x1c,
+    0x00, 0x73, 0xbb, 0x7d, 0x4e, 0xc4, 0xcf, 0xb7, 0x95, 0xb8, 0x5b, 0xd5, 0xef, 0x6d, 0x89, 0x41,
+    0xd1, 0xaa, 0x32, 0x7a, 0xb1, 0x59, 0x57, 0x65, 0x9f, 0xe6, 0x9a, 0x7c, 0x0e, 0x44, 0xf5, 0x1c,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x75, 0x54,
+    0x95, 0x46, 0x4b, 0x30,
+    // #40320
+    0x80, 0x9d, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x88, 0x9e, 0x7d, 0xb0, 0xe0, 0xdb, 0xbd, 0xe6,
+    0x95, 0x1f, 0xbf, 0xaf, 0x34, 0x07, 0xc3, 0xd6, 0xfe, 0xaf, 0xbf, 0xf8, 0xe4, 0x26, 0x77, 0x9f,
+    0xb0, 0x91, 0xd1, 0x46, 0x00, 0x00, 0x00, 0x00, 0x54, 0x8e, 0xc9, 0xdc, 0x20, 0x32, 0x3b, 0x59,
+    0x7b, 0x94, 0x0d, 0x5b, 0x16, 0x72, 0x07, 0x11, 0x16, 0x6d, 0x3c, 0x11, 0x50, 0x29, 0x23, 0x5a,
+    0x4a, 0xbe, 0x1c, 0xff, 0xfb, 0x5e, 0x36, 0x47, 0x7e, 0x9d, 0xd2, 0x50, 0xff, 0xff, 0x00, 0x1d,
+    0x53, 0x2f, 0xf0, 0x6b, 0x6d, 0xee, 0x6a, 0x69, 0xe3, 0xee, 0xf0, 0x0e, 0x67, 0x73, 0x46, 0x37,
+    0xc5, 0x71, 0x31, 0x72, 0xf5, 0x2d, 0x50, 0xfb, 0x27, 0xff, 0x92, 0x8c, 0x6b, 0xf5, 0x11, 0x80,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0f, 0xe7, 0x76,
+    0x84, 0xf3, 0xec, 0x28,
+    // #60480
+    0x40, 0xec, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x73, 0xcf, 0x90, 0x04, 0x11, 0xea, 0x13, 0x98,
+    0x4e, 0x5c, 0xf0, 0xbc, 0x9a, 0x8b, 0xac, 0x46, 0x40, 0xd2, 0x2a, 0xb1, 0xd2, 0x48, 0xd6, 0x0e,
+    0x57, 0x84, 0x92, 0x3d, 0x00, 0x00, 0x00, 0x00, 0xd9, 0x55, 0x9c, 0x18, 0x3e, 0x23, 0x54, 0xf3,
+    0x57, 0xf3, 0xa2, 0xe9, 0x9e, 0x06, 0xfa, 0xe3, 0x3c, 0xb9, 0xab, 0x07, 0xe2, 0x36, 0x58, 0x13,
+    0xed, 0x61, 0x05, 0x8b, 0x96, 0xab, 0x35, 0x04, 0xf1, 0x1c, 0x49, 0x51, 0x8a, 0xca, 0x1e, 0x1c,
+    0x0a, 0xba, 0x90, 0x51, 0xee, 0x2c, 0x95, 0xf6, 0xb8, 0x8e, 0x45, 0x88, 0xf7, 0x38, 0x2d, 0xc3,
+    0xa3, 0x5f, 0xc7, 0xa5, 0xc0, 0x88, 0x87, 0xa5, 0x48, 0x30, 0xa4, 0xa6, 0xcd, 0x90, 0x0f, 0x13,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x15, 0xff, 0x29,
+    0x05, 0xe4, 0x01, 0x78,
+    // #80640
+    0x00, 0x3b, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x63, 0xbf, 0x07, 0xe9, 0x54, 0x69, 0x7b, 0x4c,
+    0x2b, 0x43, 0xc5, 0xf5, 0x96, 0xe1, 0xc1, 0x63, 0x84, 0x9a, 0xc0, 0x58, 0x62, 0x18, 0xe3, 0xf4,
+    0x0f, 0x13, 0x10, 0x02, 0x00, 0x00, 0x00, 0x00, 0x4c, 0x40, 0xe5, 0xa6, 0x82, 0x7e, 0x80, 0x62,
+    0xd3, 0x1b, 0x90, 0xf6, 0x9a, 0x9b, 0xaf, 0xe8, 0x9f, 0x5b, 0xeb, 0xb4, 0xf6, 0x56, 0x72, 0xb7,
+    0xd8, 0xe5, 0x0a, 0x58, 0x92, 0x49, 0x15, 0x88, 0xf1, 0xee, 0x99, 0x51, 0x48, 0x1c, 0x01, 0x1c,
+    0x81, 0x35, 0x49, 0x15, 0x1c, 0x73, 0x19, 0x96, 0x44, 0xa4, 0x01, 0x82, 0xf0, 0x86, 0xd5, 0x73,
+    0x33, 0x6e, 0x97, 0x8f, 0x06, 0xb3, 0x8d, 0x91, 0x28, 0xc0, 0xa9, 0x51, 0x8b, 0x0a, 0x2d, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x6d, 0x7e,
+    0xa4, 0x9f, 0xe0, 0x1b,
+    // #100800
+    0xc0, 0x89, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x19, 0x39, 0xe9, 0x22, 0x69, 0x2d, 0x67, 0xe9,
+    0xda, 0x0c, 0x51, 0x20, 0x82, 0xb3, 0xca, 0xae, 0xba, 0xf0, 0x4f, 0xac, 0x89, 0x49, 0x9b, 0x07,
+    0xf3, 0x10, 0xaf, 0x00, 0x00, 0x00, 0x00, 0x00, 0x22, 0xc4, 0xfd, 0x8d, 0xd0, 0x50, 0xb0, 0x4b,
+    0xac, 0x68, 0x5e, 0x24, 0xa0, 0xd0, 0xd6, 0xd2, 0x11, 0x01, 0xad, 0x60, 0x5b, 0xc9, 0xef, 0xfe,
+    0xd2, 0xa6, 0x54, 0x01, 0x6e, 0x90, 0x38, 0x36, 0xb2, 0x64, 0x0c, 0x52, 0x07, 0xd9, 0x00, 0x1c,
+    0xda, 0x8a, 0x7f, 0xb7, 0x00, 0x90, 0xbe, 0xb3, 0x57, 0x32, 0x30, 0x9e, 0x3e, 0x67, 0x9c, 0x2d,
+    0x4c, 0xb8, 0x49, 0x49, 0xcb, 0x90, 0xa5, 0x0a, 0x7b, 0x3f, 0x6f, 0xf8, 0x12, 0x31, 0xa3, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x43, 0xda, 0xfa,
+    0xa1, 0xce, 0x81, 0x6a,
+    // #120960
+    0x80, 0xd8, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0xdf, 0x4e, 0xc6, 0xed, 0x71, 0xe5, 0xe7, 0xe5,
+    0xd8, 0x5c, 0xe9, 0x3e, 0x0a, 0x6c, 0xba, 0xb9, 0xae, 0x11, 0xe6, 0x02, 0xf2, 0x64, 0x22, 0x1f,
+    0xc4, 0x63, 0x21, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb7, 0xfa, 0x74, 0xdd, 0xbd, 0x34, 0x7c, 0x80,
+    0x98, 0xf6, 0xe2, 0x01, 0xf5, 0x0c, 0x71, 0x0d, 0x2c, 0x66, 0xb9, 0x45, 0x0a, 0x07, 0x0d, 0xbc,
+    0x9e, 0x70, 0xac, 0x1f, 0x03, 0x39, 0x6e, 0x04, 0xe7, 0x09, 0x60, 0x52, 0x4c, 0xdf, 0x00, 0x1c,
+    0x32, 0x37, 0x1f, 0x7c, 0x0c, 0x0d, 0x96, 0x84, 0x4d, 0x90, 0x00, 0x00, 0x2b, 0xca, 0xf8, 0xe2,
+    0xac, 0x5b, 0x1c, 0xb3, 0xbb, 0x85, 0x3b, 0xd1, 0xfd, 0x08, 0x7f, 0x6e, 0xe5, 0x67, 0x33, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf1, 0x89, 0x04,
+    0x88, 0x69, 0xc5, 0x92,
+    // #141120
+    0x40, 0x27, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0xba, 0x1e, 0x00, 0xd6, 0xa2, 0x10, 0x87, 0x13,
+    0x06, 0x68, 0x76, 0x98, 0x49, 0x57, 0xfe, 0x6e, 0x08, 0x96, 0x57, 0xe7, 0xbd, 0xe7, 0xdb, 0xd7,
+    0x29, 0xc4, 0x61, 0x2f, 0x00, 0x00, 0x00, 0x00, 0x77, 0x12, 0x59, 0xeb, 0xf6, 0x36, 0x21, 0x78,
+    0x1f, 0xce, 0xed, 0x96, 0x70, 0x20, 0x1b, 0x87, 0x89, 0x7a, 0xfa, 0x88, 0x52, 0x15, 0x85, 0x80,
+    0x2b, 0x99, 0x0f, 0x72, 0x30, 0x0d, 0x16, 0x32, 0xe4, 0xb7, 0x85, 0x52, 0xf0, 0xff, 0x0f, 0x1c,
+    0x5a, 0x2b, 0x41, 0x3a, 0x9f, 0xab, 0xd6, 0x7e, 0x4c, 0xad, 0x07, 0x79, 0xe6, 0xe4, 0xd0, 0xfa,
+    0xb3, 0xb6, 0xc6, 0xa4, 0x89, 0xc3, 0x4c, 0xe3, 0x00, 0xcd, 0x3a, 0x1c, 0x55, 0x2f, 0xda, 0x07,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x51, 0x5e, 0x6e,
+    0x86, 0xab, 0x61, 0x04,
+    // #161280
+    0x00, 0x76, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x73, 0xc7, 0xbc, 0xf3, 0xfe, 0xa4, 0xb3, 0x8a,
+    0x53, 0x83, 0x2e, 0xae, 0xf7, 0x61, 0x59, 0x1e, 0x25, 0x51, 0x4d, 0x6b, 0x8b, 0xcb, 0xe8, 0xe4,
+    0x0e, 0x62, 0xb6, 0x0c, 0x00, 0x00, 0x00, 0x00, 0xc6, 0xc2, 0x40, 0xc9, 0x50, 0xa6, 0x10, 0x12,
+    0x5c, 0x23, 0xa1, 0xa6, 0x33, 0xfc, 0x53, 0x2d, 0xc4, 0xff, 0xd3, 0xc3, 0xef, 0xef, 0x67, 0x82,
+    0xa5, 0x5c, 0x3f, 0x7a, 0x7c, 0xb6, 0xe6, 0xa8, 0x92, 0x28, 0xca, 0x52, 0xfc, 0xff, 0x03, 0x1c,
+    0xa0, 0x5b, 0x2a, 0x6a, 0x86, 0x34, 0x51, 0xf9, 0x6e, 0x20, 0x85, 0x70, 0x69, 0x99, 0x67, 0xe2,
+    0xdf, 0x80, 0x39, 0x59, 0xad, 0x9b, 0xa3, 0xaa, 0x02, 0x57, 0xec, 0x1a, 0x9a, 0xb7, 0xd1, 0x01,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x34, 0x41, 0x2f,
+    0xfb, 0x6a, 0x17, 0x28,
+    // #181440
+    0xc0, 0xc4, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x89, 0xca, 0xf4, 0x25, 0x25, 0x68, 0x55, 0x80,
+    0x99, 0x76, 0x7d, 0xaf, 0x41, 0x3f, 0x38, 0x67, 0x8c, 0x3c, 0x10, 0xa0, 0xa6, 0x38, 0x4e, 0xc1,
+    0x9f, 0xe0, 0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0xa3, 0x2a, 0x17, 0x93, 0xad, 0x96, 0xdb, 0xbd,
+    0x7a, 0x3e, 0xca, 0xc4, 0xea, 0x32, 0x49, 0x8a, 0x89, 0x41, 0x82, 0x23, 0x4a, 0x70, 0xc1, 0x2f,
+    0xc2, 0xb8, 0x63, 0x44, 0xc7, 0x9f, 0xb7, 0x8f, 0xb7, 0xe0, 0xfc, 0x52, 0xe6, 0x6c, 0x33, 0x1b,
+    0x69, 0xd0, 0x4b, 0xe6, 0x7e, 0x30, 0xe1, 0x61, 0xb8, 0xd0, 0x8d, 0x5c, 0x69, 0x5a, 0xa7, 0x77,
+    0xd5, 0xb9, 0xd1, 0xdc, 0x37, 0x6b, 0x13, 0xc4, 0x1d, 0xc2, 0x0e, 0x3a, 0x56, 0xb4, 0x2b, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x25, 0xc6, 0x21,
+    0x40, 0xfd, 0xb7, 0x07,
+    // #201600
+    0x80, 0x13, 0x03, 0x00, 0x02, 0x00, 0x00, 0x00, 0xee, 0x68, 0x9e, 0x4d, 0xcd, 0xc3, 0xc7, 0xda,
+    0xc5, 0x91, 0xb9, 0x8e, 0x1e, 0x4d, 0xc8, 0x3a, 0xae, 0x03, 0xff, 0x9f, 0xb9, 0xd4, 0x69, 0xd7,
+    0x04, 0xa6, 0x4c, 0x01, 0x00, 0x00, 0x00, 0x00, 0xbf, 0xff, 0xad, 0xed, 0x2a, 0x67, 0x82, 0x1e,
+    0xb5, 0x72, 0x9b, 0x36, 0x2d, 0x61, 0x37, 0x47, 0xe8, 0x98, 0xd0, 0x8d, 0x6c, 0x83, 0xb5, 0x70,
+    0x46, 0x46, 0xc2, 0x6c, 0x13, 0x14, 0x6f, 0x4c, 0x6d, 0xe9, 0x13, 0x53, 0xc0, 0x2a, 0x60, 0x1b,
+    0x3a, 0x81, 0x7f, 0x87, 0x38, 0x8e, 0x49, 0x72, 0xb0, 0xb1, 0xa3, 0x42, 0xa2, 0xad, 0xcb, 0xaf,
+    0x43, 0x85, 0x95, 0xfe, 0x15, 0x30, 0xde, 0x45, 0x1c, 0x32, 0x14, 0x13, 0xb7, 0x6b, 0x37, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x53, 0xe9, 0x26,
+    0xd0, 0x9e, 0xbe, 0x87,
+    // #221760
+    0x40, 0x62, 0x03, 0x00, 0x02, 0x00, 0x00, 0x00, 0xa8, 0xf9, 0xd8, 0x09, 0x11, 0xfb, 0xdc, 0x7f,
+    0x0e, 0x6f, 0x81, 0xcd, 0xfa, 0x91, 0x25, 0x27, 0x5c, 0x78, 0xd0, 0x36, 0x18, 0x81, 0x0c, 0xda,
+    0x42, 0x3a, 0x34, 0x00, 0x00, 0x00, 0x00, 0x00, 0x13, 0xa3, 0xd1, 0x57, 0x79, 0xe6, 0x0d, 0x22,
+    0x1c, 0xeb, 0x89, 0x84, 0x1c, 0x81, 0xf0, 0xe0, 0x9e, 0x32, 0x11, 0x96, 0x9f, 0xb1, 0x36, 0xa4,
+    0xc5, 0xf2, 0x26, 0x26, 0x74, 0x62, 0x31, 0xf9, 0xe7, 0x03, 0x4b, 0x53, 0xf0, 0xff, 0x0f, 0x1b,
+    0xd2, 0xaf, 0x1b, 0xa9, 0xac, 0xb9, 0xf1, 0x42, 0x6d, 0x68, 0xf0, 0x0e, 0x6b, 0x8c, 0x5c, 0x56,
+    0xf4, 0xad, 0x05, 0x7c, 0xbc, 0xbe, 0x53, 0x31, 0x31, 0xbb, 0x60, 0x06, 0x3a, 0x3e, 0x09, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x5d, 0x1b, 0xee,
+    0x04, 0xd9, 0x99, 0x87,
+    // #241920
+    0x00, 0xb1, 0x03, 0x00, 0x02, 0x00, 0x00, 0x00, 0x62, 0x24, 0xe3, 0xc5, 0xc7, 0x39, 0xd0, 0xff,
+    0x81, 0xa0, 0xf6, 0xe0, 0xc3, 0x87, 0xd9, 0xdc, 0xd1, 0xb1, 0x01, 0x96, 0xdd, 0x87, 0xf1, 0xb6,
+    0xd0, 0x36, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x81, 0x84, 0xab, 0x79, 0xe5, 0x22, 0x4c, 0x41,
+    0xd2, 0xae, 0x40, 0xf1, 0xd2, 0xb6, 0x01, 0x58, 0x57, 0x5e, 0xb6, 0x10, 0x11, 0x36, 0xab, 0x8c,
+    0xa1, 0x42, 0xa9, 0x91, 0x55, 0x16, 0xb7, 0xb5, 0xa5, 0x97, 0x6e, 0x53, 0x0d, 0x54, 0x05, 0x1b,
+    0xe5, 0xeb, 0x3f, 0x14, 0xe4, 0x6c, 0x62, 0xb2, 0x37, 0xcc, 0xae, 0xf0, 0x6d, 0x1e, 0xee, 0xd2,
+    0xcb, 0xf0, 0x38, 0x60, 0x88, 0xc0, 0xb8, 0x49, 0x20, 0x32, 0x52, 0x3d, 0x19, 0xeb, 0x03, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x06, 0x7f, 0xdc,
+    0x4b, 0x84, 0x63, 0x66,
+    // #262080
+    0xc0, 0xff, 0x03, 0x00, 0x02, 0x00, 0x00, 0x00, 0x8e, 0x86, 0xba, 0x6b, 0x5c, 0xff, 0xc6, 0x03,
+    0x8e, 0xf4, 0x1b, 0x73, 0x60, 0x4e, 0xb8, 0xe5, 0xbc, 0x6b, 0x79, 0x7a, 0x0e, 0x58, 0x80, 0xaa,
+    0x8c, 0x1f, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0xe1, 0x63, 0x12, 0x20, 0xa3, 0xb7, 0x03,
+    0x62, 0x89, 0x22, 0x4a, 0x08, 0x2e, 0x86, 0x8b, 0x77, 0x0e, 0x69, 0x6f, 0x69, 0xc9, 0x98, 0xc0,
+    0x3d, 0x35, 0x4a, 0x6c, 0x03, 0xf0, 0x33, 0x4d, 0x58, 0xcf, 0x98, 0x53, 0xe6, 0x44, 0x02, 0x1b,
+    0x53, 0x27, 0x9c, 0x73, 0xa7, 0x48, 0x8d, 0xca, 0x86, 0xd6, 0x87, 0xb0, 0xbc, 0x4d, 0xb8, 0xa5,
+    0x12, 0x01, 0x2b, 0xc1, 0xbc, 0x29, 0x73, 0x6d, 0xc2, 0xfa, 0x3e, 0xb2, 0x8c, 0x2b, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x78, 0xd7, 0x72,
+    0xda, 0xb5, 0xc3, 0x4f,
+    // #282240
+    0x80, 0x4e, 0x04, 0x00, 0x02, 0x00, 0x00, 0x00, 0x60, 0xb7, 0xca, 0x3e, 0x51, 0x87, 0x04, 0x0b,
+    0xf5, 0xe6, 0x50, 0x49, 0x97, 0xf6, 0x39, 0xe2, 0xa6, 0xc3, 0xcf, 0x98, 0x4e, 0x87, 0xeb, 0x05,
+    0xcd, 0x8f, 0x2e, 0x0d, 0x00, 0x00, 0x00, 0x00, 0x42, 0x93, 0x3b, 0x32, 0xca, 0x96, 0xd8, 0xd0,
+    0x65, 0xbe, 0x03, 0x71, 0x5a, 0x3b, 0x09, 0xff, 0xcf, 0xb8, 0x97, 0xd6, 0x11, 0xf8, 0x78, 0x26,
+    0x66, 0x9a, 0xcb, 0x69, 0x63, 0xba, 0x64, 0xb1, 0xe1, 0x1e, 0x2d, 0x54, 0xff, 0xff, 0x00, 0x1d,
+    0xba, 0xda, 0xe2, 0x8a, 0x49, 0xf4, 0x90, 0x27, 0x95, 0x49, 0xd5, 0xb4, 0x1e, 0x8c, 0x75, 0xd5,
+    0xae, 0xfa, 0xe1, 0xbc, 0xf4, 0x2c, 0xd3, 0x90, 0x8a, 0x2f, 0x13, 0xbd, 0xda, 0x13, 0x3f, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5c, 0x0d, 0x9a, 0xc4,
+    0x7f, 0x5d, 0xcc, 0x89,
+    // #302400
+    0x40, 0x9d, 0x04, 0x00, 0x02, 0x00, 0x00, 0x00, 0xa5, 0x89, 0x5a, 0x55, 0xe1, 0x29, 0x1f, 0xc5,
+    0x75, 0xf2, 0x1f, 0x10, 0x7a, 0xdf, 0xb2, 0x4f, 0x4a, 0xdf, 0xba, 0x8a, 0x75, 0xde, 0xb7, 0x16,
+    0xed, 0x32, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc6, 0xcd, 0x67, 0x32, 0xa0, 0x4c, 0x51, 0xf0,
+    0x8b, 0x2a, 0xf9, 0xed, 0x32, 0x77, 0xdd, 0xf8, 0x3f, 0x5c, 0xb9, 0x7c, 0xf6, 0xe9, 0x0b, 0x30,
+    0xdd, 0xa2, 0x6f, 0x1a, 0xa2, 0xf5, 0x75, 0x24, 0x5f, 0x5c, 0x44, 0x54, 0x5e, 0x60, 0x33, 0x1a,
+    0x02, 0x42, 0x03, 0xfb, 0x2d, 0xd3, 0x29, 0xbe, 0x80, 0x3f, 0x02, 0x3a, 0x30, 0xf9, 0x7e, 0x53,
+    0x05, 0x55, 0x75, 0xb9, 0xed, 0xe8, 0x26, 0x34, 0xc3, 0xa7, 0xe0, 0xeb, 0x93, 0x1c, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x6c, 0xbd, 0x85, 0x7d,
+    0x49, 0x33, 0x4f, 0xe6
+};
+
 @interface WSParametersFactoryTestnet3 ()
 
 @property (nonatomic, strong) WSMutableParameters *parameters;
@@ -96,7 +265,7 @@
         [parameters addDnsSeed:@"testnet-seed.bluematt.me"];
 //        [parameters addDnsSeed:@"testnet-seed.alexykot.me"]; // seems offline as of 02/07/2015
 
-        [parameters loadCheckpointsFromHex:@"01000000487f6bcc6f25427d5547cc2a83f196311bbdaf69eef318969fc45913000000003704109964ecdd4945c22822c99923afb98e5cb03e04f81b83aa5d0a3670914bfa172b5056174d1c0073bb7d00c04e00000701755495464b3002000000889e7db0e0dbbde6951fbfaf3407c3d6feafbff8e426779fb091d14600000000548ec9dc20323b597b940d5b16720711166d3c115029235a4abe1cfffb5e36477e9dd250ffff001d532ff06b00809d0000070fe77684f3ec280200000073cf900411ea13984e5cf0bc9a8bac4640d22ab1d248d60e5784923d00000000d9559c183e2354f357f3a2e99e06fae33cb9ab07e2365813ed61058b96ab3504f11c49518aca1e1c0aba90510040ec00000715ff2905e401780200000063bf07e954697b4c2b43c5f596e1c163849ac0586218e3f40f131002000000004c40e5a6827e8062d31b90f69a9bafe89f5bebb4f65672b7d8e50a5892491588f1ee9951481c011c8135491500003b010007206d7ea49fe01b020000001939e922692d67e9da0c512082b3caaebaf04fac89499b07f310af000000000022c4fd8dd050b04bac685e24a0d0d6d21101ad605bc9effed2a654016e903836b2640c5207d9001cda8a7fb700c08901000743dafaa1ce816a02000000df4ec6ed71e5e7e5d85ce93e0a6cbab9ae11e602f264221fc463210000000000b7fa74ddbd347c8098f6e201f50c710d2c66b9450a070dbc9e70ac1f03396e04e70960524cdf001c32371f7c0080d8010007f189048869c59202000000ba1e00d6a2108713066876984957fe6e089657e7bde7dbd729c4612f00000000771259ebf63621781fceed9670201b87897afa88521585802b990f72300d1632e4b78552f0ff0f1c5a2b413a00402702000802515e6e86ab61040200000073c7bcf3fea4b38a53832eaef761591e25514d6b8bcbe8e40e62b60c00000000c6c240c950a610125c23a1a633fc532dc4ffd3c3efef6782a55c3f7a7cb6e6a89228ca52fcff031ca05b2a6a0000760200080334412ffb6a17280200000089caf4252568558099767daf413f38678c3c10a0a6384ec19fe0290000000000a32a1793ad96dbbd7a3ecac4ea32498a894182234a70c12fc2b86344c79fb78fb7e0fc52e66c331b69d04be600c0c40200080425c62140fdb70702000000ee689e4dcdc3c7dac591b98e1e4dc83aae03ff9fb9d469d704a64c0100000000bfffaded2a67821eb5729b362d613747e898d08d6c83b5704646c26c13146f4c6de91353c02a601b3a817f870080130300080453e926d09ebe8702000000a8f9d80911fbdc7f0e6f81cdfa9125275c78d03618810cda423a34000000000013a3d15779e60d221ceb89841c81f0e09e3211969fb136a4c5f22626746231f9e7034b53f0ff0f1bd2af1ba9004062030008055d1bee04d99987020000006224e3c5c739d0ff81a0f6e0c387d9dcd1b10196dd87f1b6d0360e00000000008184ab79e5224c41d2ae40f1d2b60158575eb6101136ab8ca142a9915516b7b5a5976e530d54051be5eb3f140000b103000809067fdc4b846366020000008e86ba6b5cffc6038ef41b73604eb8e5bc6b797a0e5880aa8c1f01000000000042e1631220a3b7036289224a082e868b770e696f69c998c03d354a6c03f0334d58cf9853e644021b53279c7300c0ff0300080c78d772dab5c34f0200000060b7ca3e5187040bf5e6504997f639e2a6c3cf984e87eb05cd8f2e0d0000000042933b32ca96d8d065be03715a3b09ffcfb897d611f87826669acb6963ba64b1e11e2d54ffff001dbadae28a00804e0400085c0d9ac47f5dcc8902000000a5895a55e1291fc575f21f107adfb24f4adfba8a75deb716ed32000000000000c6cd6732a04c51f08b2af9ed3277ddf83f5cb97cf6e90b30dda26f1aa2f575245f5c44545e60331a024203fb00409d0400086cbd857d49334fe6"];
+        [parameters loadCheckpointsFromTable:WSParametersTestnet3Checkpoints length:sizeof(WSParametersTestnet3Checkpoints)];
         
         self.parameters = parameters;
     }
@@ -45,6 +45,7 @@
 - (BOOL)containsAddress:(WSAddress *)address;
 - (BOOL)containsUnspent:(WSTransactionOutPoint *)unspent;
 - (double)estimatedFalsePositiveRate;
+- (WSBIP37Flags)flags;
 
 @end
 
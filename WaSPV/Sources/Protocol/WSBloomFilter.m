@@ -88,6 +88,11 @@
     return [self.filter estimatedFalsePositiveRate];
 }
 
+- (WSBIP37Flags)flags
+{
+    return self.filter.parameters.flags;
+}
+
 - (NSString *)description
 {
     return [self.filter description];
@@ -36,11 +36,13 @@
 //
 
 extern const NSInteger          WSMessageHeaderLength;
+extern const NSUInteger         WSMessageCommandLength;
 extern const NSUInteger         WSMessageMaxLength;
 extern const NSUInteger         WSMessageMaxInventories;
 extern const NSUInteger         WSMessageAddrMaxCount;
 extern const NSUInteger         WSMessageBlocksMaxCount;
 extern const NSUInteger         WSMessageHeadersMaxCount;
+extern const NSUInteger         WSMessageFilteraddMaxLength;
 
 extern NSString *const          WSMessageType_VERSION;
 extern NSString *const          WSMessageType_VERACK;
@@ -28,11 +28,13 @@
 #import "WSMessage.h"
 
 const NSInteger         WSMessageHeaderLength                   = 24;
+const NSUInteger        WSMessageCommandLength                  = 12;
 const NSUInteger        WSMessageMaxLength                      = 0x02000000;
 const NSUInteger        WSMessageMaxInventories                 = 50000;
 const NSUInteger        WSMessageAddrMaxCount                   = 1000;
 const NSUInteger        WSMessageBlocksMaxCount                 = 500;
 const NSUInteger        WSMessageHeadersMaxCount                = 2000;
+const NSUInteger        WSMessageFilteraddMaxLength             = 520;
 
 NSString *const         WSMessageType_VERSION                   = @"version";
 NSString *const         WSMessageType_VERACK                    = @"verack";
@@ -37,6 +37,7 @@
 - (id<WSParameters>)parameters;
 
 - (id<WSMessage>)messageFromType:(NSString *)type payload:(WSBuffer *)payload error:(NSError **)error;
+- (id<WSMessage>)messageFromCommand:(const char *)command payload:(WSBuffer *)payload error:(NSError **)error; // null-padded, WSMessageCommandLength bytes
 
 @end
 
@@ -57,7 +58,7 @@
 #import "WSMessagePong.h"
 #import "WSMessageReject.h"
 #import "WSMessageFilterload.h"
-//#import "WSMessageFilteradd.h"
+#import "WSMessageFilteradd.h"
 //#import "WSMessageFilterclear.h"
 #import "WSMessageMerkleblock.h"
 //#import "WSMessageAlert.h"
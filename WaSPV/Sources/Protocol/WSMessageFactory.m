@@ -28,6 +28,45 @@
 #import "WSMessageFactory.h"
 #import "WSErrors.h"
 
+#define WSMessageFactoryCommandLength   12
+#define WSMessageFactoryCommandsCount   (sizeof(WSMessageFactoryCommands) / WSMessageFactoryCommandLength)
+
+// null-padded as in message header, most frequent first
+static const char WSMessageFactoryCommands[][WSMessageFactoryCommandLength] = {
+    "inv",
+    "tx",
+    "merkleblock",
+    "headers",
+    "block",
+    "ping",
+    "pong",
+    "addr",
+    "getdata",
+    "notfound",
+    "version",
+    "verack",
+    "reject",
+    "getblocks",
+    "getheaders",
+    "getaddr",
+    "mempool",
+    "filterload"
+};
+
+// same order as commands, Nil if undecodable
+static __unsafe_unretained Class WSMessageFactoryDecoders[WSMessageFactoryCommandsCount];
+
+static inline BOOL WSMessageFactoryCommandEquals(const char *a, const char *b)
+{
+    uint64_t a64, b64;
+    uint32_t a32, b32;
+    memcpy(&a64, a, sizeof(a64));
+    memcpy(&b64, b, sizeof(b64));
+    memcpy(&a32, a + sizeof(a64), sizeof(a32));
+    memcpy(&b32, b + sizeof(b64), sizeof(b32));
+    return ((a64 == b64) && (a32 == b32));
+}
+
 @interface WSMessageFactory ()
 
 @property (nonatomic, strong) id<WSParameters> parameters;
@@ -36,6 +75,40 @@
 
 @implementation WSMessageFactory
 
++ (void)initialize
+{
+    if (self != [WSMessageFactory class]) {
+        return;
+    }
+    
+    const Class decoders[] = {
+        [WSMessageInv class],
+        [WSMessageTx class],
+        [WSMessageMerkleblock class],
+        [WSMessageHeaders class],
+        [WSMessageBlock class],
+        [WSMessagePing class],
+        [WSMessagePong class],
+        [WSMessageAddr class],
+        [WSMessageGetdata class],
+        [WSMessageNotfound class],
+        [WSMessageVersion class],
+        [WSMessageVerack class],
+        [WSMessageReject class],
+        Nil,
+        Nil,
+        Nil,
+        Nil,
+        Nil
+    };
+    NSAssert(sizeof(decoders) / sizeof(Class) == WSMessageFactoryCommandsCount, @"Decoders and commands differ in count");
+
+    for (NSUInteger i = 0; i < WSMessageFactoryCommandsCount; ++i) {
+        NSAssert(!decoders[i] || [decoders[i] conformsToProtocol:@protocol(WSBufferDecoder)], @"%@ is not a decoder", decoders[i]);
+        WSMessageFactoryDecoders[i] = decoders[i];
+    }
+}
+
 - (instancetype)initWithParameters:(id<WSParameters>)parameters
 {
     WSExceptionCheckIllegal(parameters != nil, @"Nil parameters");
@@ -49,25 +122,35 @@
 - (id<WSMessage>)messageFromType:(NSString *)type payload:(WSBuffer *)payload error:(NSError *__autoreleasing *)error
 {
     WSExceptionCheckIllegal(type != nil, @"Nil type");
-    WSExceptionCheckIllegal(payload != nil, @"Nil payload");
     
-#warning XXX: would not handle messages of type "factory" in the future (rename class?)
+    char command[WSMessageFactoryCommandLength];
+    memset(command, 0, sizeof(command));
+    strncpy(command, type.UTF8String, sizeof(command));
+
+    return [self messageFromCommand:command payload:payload error:error];
+}
+
+- (id<WSMessage>)messageFromCommand:(const char *)command payload:(WSBuffer *)payload error:(NSError *__autoreleasing *)error
+{
+    WSExceptionCheckIllegal(command != NULL, @"NULL command");
+    WSExceptionCheckIllegal(payload != nil, @"Nil payload");
     
-    NSString *className = [NSString stringWithFormat:@"WSMessage%@", [type capitalizedString]];
-    Class clazz = NSClassFromString(className);
-    if (!clazz || (clazz == [self class])) {
-        WSErrorSetUserInfo(error, WSErrorCodeUnknownMessage, @{WSErrorMessageTypeKey: type}, @"Unknown message '%@'", type);
-        return nil;
+    for (NSUInteger i = 0; i < WSMessageFactoryCommandsCount; ++i) {
+        if (!WSMessageFactoryCommandEquals(command, WSMessageFactoryCommands[i])) {
+            continue;
+        }
+        Class clazz = WSMessageFactoryDecoders[i];
+        if (!clazz) {
+            WSErrorSet(error, WSErrorCodeUndecodableMessage, @"Undecodable message '%s'", WSMessageFactoryCommands[i]);
+            return nil;
+        }
+        return [[clazz alloc] initWithParameters:self.parameters buffer:payload from:0 available:payload.length error:error];
     }
-    if (![clazz conformsToProtocol:@protocol(WSBufferDecoder)]) {
-        WSErrorSet(error, WSErrorCodeUndecodableMessage, @"Undecodable message '%@'", type);
-        return nil;
-    }
-    id<WSMessage> message = [[clazz alloc] initWithParameters:self.parameters buffer:payload from:0 available:payload.length error:error];
-//    if (message) {
-//        NSAssert(message.originalPayload, @"Decoded messages should retain original payload");
-//    }
-    return message;
+
+    // fallback
+    NSString *type = [[NSString alloc] initWithBytes:command length:strnlen(command, WSMessageFactoryCommandLength) encoding:NSUTF8StringEncoding];
+    WSErrorSetUserInfo(error, WSErrorCodeUnknownMessage, @{WSErrorMessageTypeKey: (type ? : @"")}, @"Unknown message '%@'", type);
+    return nil;
 }
 
 @end
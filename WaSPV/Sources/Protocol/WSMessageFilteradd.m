@@ -0,0 +1,85 @@
+//
+//  WSMessageFilteradd.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 28/06/14.
+//  Copyright (c) 2014 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSMessageFilteradd.h"
+#import "WSErrors.h"
+#import "NSData+Binary.h"
+
+@interface WSMessageFilteradd ()
+
+@property (nonatomic, strong) NSData *data;
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters data:(NSData *)data;
+
+@end
+
+@implementation WSMessageFilteradd
+
++ (instancetype)messageWithParameters:(id<WSParameters>)parameters data:(NSData *)data
+{
+    return [[self alloc] initWithParameters:parameters data:data];
+}
+
+- (instancetype)initWithParameters:(id<WSParameters>)parameters data:(NSData *)data
+{
+    WSExceptionCheckIllegal(data != nil, @"Nil data");
+    WSExceptionCheckIllegal(data.length <= WSMessageFilteraddMaxLength, @"Data too long (%u > %u)", data.length, WSMessageFilteraddMaxLength);
+
+    if ((self = [super initWithParameters:parameters])) {
+        self.data = data;
+    }
+    return self;
+}
+
+#pragma mark WSMessage
+
+- (NSString *)messageType
+{
+    return WSMessageType_FILTERADD;
+}
+
+- (NSString *)payloadDescriptionWithIndent:(NSUInteger)indent
+{
+    return [NSString stringWithFormat:@"{data=%@}", [self.data hexString]];
+}
+
+#pragma mark WSBufferEncoder
+
+- (void)appendToMutableBuffer:(WSMutableBuffer *)buffer
+{
+    [buffer appendVarData:self.data];
+}
+
+- (WSBuffer *)toBuffer
+{
+    // var_int + data
+    WSMutableBuffer *buffer = [[WSMutableBuffer alloc] initWithCapacity:(9 + self.data.length)];
+    [self appendToMutableBuffer:buffer];
+    return buffer;
+}
+
+@end
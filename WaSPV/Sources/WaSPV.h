@@ -45,6 +45,8 @@
 
 #import "WSBlockStore.h"
 #import "WSMemoryBlockStore.h"
+#import "WSOrphanPool.h"
+#import "WSFileBlockStore.h"
 #import "WSCoreDataManager.h"
 #import "WSBlockHeader.h"
 #import "WSStorableBlock.h"
@@ -0,0 +1,162 @@
+//
+//  WSAddressIndex.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+#import "WSAddressIndex.h"
+#import "WSAddress.h"
+#import "WSHash160.h"
+#import "WSBitcoin.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+static const NSUInteger WSAddressIndexMinCapacity       = 64;   // power of 2
+static const NSUInteger WSAddressIndexMaxLoadFactor     = 2;    // count <= capacity / 2
+
+typedef struct {
+    uint8_t used;
+    uint8_t version;
+    uint8_t hash160[20];
+} WSAddressIndexSlot;
+
+@interface WSAddressIndex ()
+
+@property (nonatomic, strong) NSMutableData *slots; // WSAddressIndexSlot
+@property (nonatomic, assign) NSUInteger capacity;
+@property (nonatomic, assign) NSUInteger count;
+
+- (WSAddressIndexSlot *)slotForVersion:(uint8_t)version hash160:(const uint8_t *)hash160;
+- (void)growToCapacity:(NSUInteger)capacity;
+
+@end
+
+@implementation WSAddressIndex
+
+- (instancetype)init
+{
+    return [self initWithCapacity:0];
+}
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity
+{
+    if ((self = [super init])) {
+        NSUInteger slotsCapacity = WSAddressIndexMinCapacity;
+        while (slotsCapacity < WSAddressIndexMaxLoadFactor * capacity) {
+            slotsCapacity <<= 1;
+        }
+        self.capacity = slotsCapacity;
+        self.slots = [[NSMutableData alloc] initWithLength:slotsCapacity * sizeof(WSAddressIndexSlot)];
+        self.count = 0;
+    }
+    return self;
+}
+
+- (BOOL)addAddress:(WSAddress *)address
+{
+    WSExceptionCheckIllegal(address != nil, @"Nil address");
+    NSAssert(address.hash160.length == WSHash160Length, @"Unexpected hash160 length (%u)", address.hash160.length);
+
+    WSAddressIndexSlot *slot = [self slotForVersion:address.version hash160:address.hash160.bytes];
+    if (slot->used) {
+        return NO;
+    }
+    slot->used = 1;
+    slot->version = address.version;
+    memcpy(slot->hash160, address.hash160.bytes, sizeof(slot->hash160));
+    ++self.count;
+    
+    if (self.count * WSAddressIndexMaxLoadFactor > self.capacity) {
+        [self growToCapacity:(self.capacity << 1)];
+    }
+    return YES;
+}
+
+- (void)addAddresses:(id<NSFastEnumeration>)addresses
+{
+    WSExceptionCheckIllegal(addresses != nil, @"Nil addresses");
+
+    for (WSAddress *address in addresses) {
+        [self addAddress:address];
+    }
+}
+
+- (BOOL)containsAddress:(WSAddress *)address
+{
+    if (!address) {
+        return NO;
+    }
+    return [self slotForVersion:address.version hash160:address.hash160.bytes]->used;
+}
+
+- (void)removeAllAddresses
+{
+    memset(self.slots.mutableBytes, 0, self.slots.length);
+    self.count = 0;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"{count=%u, capacity=%u}", self.count, self.capacity];
+}
+
+#pragma mark Helpers
+
+// hash160 is uniformly distributed, leading bytes are a good hash already
+- (WSAddressIndexSlot *)slotForVersion:(uint8_t)version hash160:(const uint8_t *)hash160
+{
+    WSAddressIndexSlot *slots = self.slots.mutableBytes;
+    const NSUInteger mask = self.capacity - 1;
+
+    uint32_t hash;
+    memcpy(&hash, hash160, sizeof(hash));
+    
+    NSUInteger i = (hash ^ version) & mask;
+    while (slots[i].used) {
+        if ((slots[i].version == version) && (memcmp(slots[i].hash160, hash160, sizeof(slots[i].hash160)) == 0)) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return &slots[i];
+}
+
+- (void)growToCapacity:(NSUInteger)capacity
+{
+    NSMutableData *oldSlots = self.slots;
+    const NSUInteger oldCapacity = self.capacity;
+
+    self.capacity = capacity;
+    self.slots = [[NSMutableData alloc] initWithLength:capacity * sizeof(WSAddressIndexSlot)];
+
+    const WSAddressIndexSlot *oldSlot = oldSlots.bytes;
+    for (NSUInteger i = 0; i < oldCapacity; ++i, ++oldSlot) {
+        if (!oldSlot->used) {
+            continue;
+        }
+        WSAddressIndexSlot *slot = [self slotForVersion:oldSlot->version hash160:oldSlot->hash160];
+        *slot = *oldSlot;
+    }
+}
+
+@end
@@ -42,6 +42,7 @@
 #import "WSScript.h"
 #import "WSStorableBlock.h"
 #import "WSTransactionMetadata.h"
+#import "WSAddressIndex.h"
 #import "WSConfig.h"
 #import "WSBitcoin.h"
 #import "WSMacros.h"
@@ -72,6 +73,7 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
     // transient (not sensitive)
     NSString *_path;
     NSMutableDictionary *_txsById;                      // WSHash256 -> WSSignedTransaction
+    WSAddressIndex *_addressIndex;                      // external + internal addresses
     NSSet *_spentOutpoints;                             // WSTransactionOutPoint
     NSOrderedSet *_unspentOutpoints;                    // WSTransactionOutPoint
     NSSet *_invalidTxIds;                               // WSHash256
@@ -299,7 +301,7 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
 - (BOOL)isWalletAddress:(WSAddress *)address
 {
     @synchronized (self) {
-        return ([_allExternalAddresses containsObject:address] || [_allInternalAddresses containsObject:address]);
+        return [_addressIndex containsAddress:address];
     }
 }
 
@@ -690,6 +692,10 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
             _txsById[tx.txId] = tx;
         }
         
+        _addressIndex = [[WSAddressIndex alloc] initWithCapacity:(_allExternalAddresses.count + _allInternalAddresses.count)];
+        [_addressIndex addAddresses:_allExternalAddresses];
+        [_addressIndex addAddresses:_allInternalAddresses];
+
         [self recalculateSpendsAndBalance];
         [self generateAddressesWithLookAhead:(4 * _gapLimit) forced:YES];
         
@@ -758,10 +764,11 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
         
         __block NSUInteger accountOfFirstUnusedAddress = targetAddresses.count;
         __block NSUInteger numberOfUsedAddresses = 0;
+        NSSet *usedAddresses = _usedAddresses; // no copies, we're synchronized
         
         [targetAddresses enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id obj, NSUInteger idx, BOOL *stop) {
             WSAddress *address = obj;
-            if ([self.usedAddresses containsObject:address]) {
+            if ([usedAddresses containsObject:address]) {
                 numberOfUsedAddresses = idx + 1;
                 *stop = YES;
             }
@@ -799,6 +806,7 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
         for (NSUInteger i = firstGenAccount; i < lastGenAccount; ++i) {
             WSAddress *address = [[targetChain publicKeyForAccount:(uint32_t)i] addressWithParameters:self.parameters];
             [targetAddresses addObject:address];
+            [_addressIndex addAddress:address];
         }
         
         const NSUInteger expectedWatchedCount = lastGenAccount - *currentAccount;
@@ -882,6 +890,68 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
     return YES;
 }
 
+- (NSArray *)bloomFilterDataNotCoveredByFilter:(WSBloomFilter *)bloomFilter
+{
+    WSExceptionCheckIllegal(bloomFilter != nil, @"Nil bloomFilter");
+    
+    NSMutableArray *uncoveredData = [[NSMutableArray alloc] init];
+
+    @synchronized (self) {
+        NSArray *chains = @[self.safeExternalChain, self.safeInternalChain];
+        NSArray *counts = @[@(_allExternalAddresses.count), @(_allInternalAddresses.count)];
+        
+        for (NSUInteger i = 0; i < 2; ++i) {
+            id<WSBIP32Keyring> chain = chains[i];
+            const uint32_t numberOfWatchedAddresses = [counts[i] unsignedIntegerValue];
+            
+            for (uint32_t account = 0; account < numberOfWatchedAddresses; ++account) {
+                WSPublicKey *pubKey = [chain publicKeyForAccount:account];
+                NSData *pubKeyData = [pubKey encodedData];
+                NSData *hash160Data = [pubKey hash160].data;
+                
+                if (![bloomFilter containsData:pubKeyData]) {
+                    [uncoveredData addObject:pubKeyData];
+                }
+                if (![bloomFilter containsData:hash160Data]) {
+                    [uncoveredData addObject:hash160Data];
+                }
+            }
+        }
+    }
+    return uncoveredData;
+}
+
+- (NSArray *)bloomFilterData
+{
+    NSMutableArray *data = [[NSMutableArray alloc] init];
+
+    @synchronized (self) {
+        NSArray *chains = @[self.safeExternalChain, self.safeInternalChain];
+        NSArray *counts = @[@(_allExternalAddresses.count), @(_allInternalAddresses.count)];
+        
+        for (NSUInteger i = 0; i < 2; ++i) {
+            id<WSBIP32Keyring> chain = chains[i];
+            const uint32_t numberOfWatchedAddresses = [counts[i] unsignedIntegerValue];
+            
+            for (uint32_t account = 0; account < numberOfWatchedAddresses; ++account) {
+                WSPublicKey *pubKey = [chain publicKeyForAccount:account];
+
+                [data addObject:[pubKey encodedData]];
+                [data addObject:[pubKey hash160].data];
+            }
+        }
+    }
+    return data;
+}
+
+// public key and its hash160 per watched address
+- (NSUInteger)bloomFilterElementCount
+{
+    @synchronized (self) {
+        return 2 * (_allExternalAddresses.count + _allInternalAddresses.count);
+    }
+}
+
 #elif (WASPV_WALLET_FILTER == WASPV_WALLET_FILTER_UNSPENT)
 
 - (WSBloomFilter *)bloomFilterWithParameters:(WSBIP37FilterParameters *)parameters
@@ -938,6 +1008,53 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
     return YES;
 }
 
+- (NSArray *)bloomFilterDataNotCoveredByFilter:(WSBloomFilter *)bloomFilter
+{
+    WSExceptionCheckIllegal(bloomFilter != nil, @"Nil bloomFilter");
+    
+    NSMutableArray *uncoveredData = [[NSMutableArray alloc] init];
+
+    @synchronized (self) {
+        for (NSOrderedSet *addresses in @[_allExternalAddresses, _allInternalAddresses]) {
+            for (WSAddress *address in addresses) {
+                if (![bloomFilter containsAddress:address]) {
+                    [uncoveredData addObject:address.hash160.data];
+                }
+            }
+        }
+        for (WSTransactionOutPoint *unspent in _unspentOutpoints) {
+            if (![bloomFilter containsUnspent:unspent]) {
+                [uncoveredData addObject:[[unspent toBuffer] data]];
+            }
+        }
+    }
+    return uncoveredData;
+}
+
+- (NSArray *)bloomFilterData
+{
+    NSMutableArray *data = [[NSMutableArray alloc] init];
+
+    @synchronized (self) {
+        for (NSOrderedSet *addresses in @[_allExternalAddresses, _allInternalAddresses]) {
+            for (WSAddress *address in addresses) {
+                [data addObject:address.hash160.data];
+            }
+        }
+        for (WSTransactionOutPoint *unspent in _unspentOutpoints) {
+            [data addObject:[[unspent toBuffer] data]];
+        }
+    }
+    return data;
+}
+
+- (NSUInteger)bloomFilterElementCount
+{
+    @synchronized (self) {
+        return _allExternalAddresses.count + _allInternalAddresses.count + _unspentOutpoints.count;
+    }
+}
+
 #else
 
 - (WSBloomFilter *)bloomFilterWithParameters:(WSBIP37FilterParameters *)parameters
@@ -954,6 +1071,21 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
     return YES;
 }
 
+- (NSArray *)bloomFilterDataNotCoveredByFilter:(WSBloomFilter *)bloomFilter
+{
+    return @[];
+}
+
+- (NSArray *)bloomFilterData
+{
+    return @[];
+}
+
+- (NSUInteger)bloomFilterElementCount
+{
+    return 0;
+}
+
 #endif
 
 - (BOOL)isRelevantTransaction:(WSSignedTransaction *)transaction
@@ -1003,7 +1135,7 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
         // http://bitcoin.stackexchange.com/questions/3870/what-order-do-transactions-appear-in-a-block-is-it-up-to-the-miner
         //
         
-        // relevant if inputs spend wallet transaction
+        // relevant if inputs spend wallet transaction (hashed by txId)
         for (WSSignedTransactionInput *input in transaction.inputs) {
             if (_txsById[input.outpoint.txId]) {
                 isRelevant = YES;
@@ -1013,19 +1145,17 @@ NSString *const WSHDWalletDefaultChainsPath      = @"m/0'";
         
         // if transaction is relevant from previous checks, receivingAddresses must be filled anyway (if not nil)
         if (!isRelevant || receivingAddresses) {
-            NSSet *txOutputAddresses = [transaction outputAddresses];
-            
-            // relevant if outputs contain at least one wallet address
-            NSMutableOrderedSet *walletReceivingAddresses = [NSMutableOrderedSet orderedSetWithSet:txOutputAddresses];
-
-#warning TODO: wallet, optimize this
-            NSMutableOrderedSet *allAddresses = [_allExternalAddresses mutableCopy];
-            [allAddresses unionOrderedSet:_allInternalAddresses];
-            [walletReceivingAddresses intersectOrderedSet:allAddresses];
 
-            if (walletReceivingAddresses.count > 0) {
+            // relevant if outputs contain at least one wallet address
+            for (WSTransactionOutput *output in transaction.outputs) {
+                if (![_addressIndex containsAddress:output.address]) {
+                    continue;
+                }
                 isRelevant = YES;
-                [receivingAddresses addObjectsFromArray:[walletReceivingAddresses array]];
+                if (!receivingAddresses) {
+                    break;
+                }
+                [receivingAddresses addObject:output.address];
             }
         }
         
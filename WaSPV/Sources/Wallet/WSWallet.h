@@ -104,6 +104,9 @@ extern NSString *const WSWalletTransactionsMetadataKey;
 - (BOOL)generateAddressesWithLookAhead:(NSUInteger)lookAhead;
 - (WSBloomFilter *)bloomFilterWithParameters:(WSBIP37FilterParameters *)parameters;
 - (BOOL)isCoveredByBloomFilter:(WSBloomFilter *)bloomFilter;
+- (NSArray *)bloomFilterDataNotCoveredByFilter:(WSBloomFilter *)bloomFilter; // NSData, elements to insert for full coverage
+- (NSArray *)bloomFilterData; // NSData, all elements a filter must contain for full coverage
+- (NSUInteger)bloomFilterElementCount; // bloomFilterData count, without building the elements
 - (BOOL)isRelevantTransaction:(WSSignedTransaction *)transaction;
 - (BOOL)isRelevantTransaction:(WSSignedTransaction *)transaction savingReceivingAddresses:(NSMutableSet *)receivingAddresses;
 - (BOOL)registerTransaction:(WSSignedTransaction *)transaction didGenerateNewAddresses:(BOOL *)didGenerateNewAddresses;
@@ -119,13 +119,19 @@
     DDLogInfo(@"Embeddable hex: %@", [checkpoints hexString]);
     DDLogInfo(@"Size: %u", checkpoints.length);
 
+    NSMutableArray *blocks = [[NSMutableArray alloc] init];
     NSUInteger offset = 0;
     while (offset < checkpoints.length) {
         WSStorableBlock *block = [[WSStorableBlock alloc] initWithParameters:self.networkParameters buffer:checkpoints from:offset available:(checkpoints.length - offset) error:NULL];
         DDLogInfo(@"%@", block);
+        [blocks addObject:block];
         offset += [block estimatedSize];
     }
     XCTAssertEqual(offset, checkpoints.length);
+
+    // WSParametersFactory* embed this as a constant array
+    NSData *table = WSCheckpointsTableFromBlocks(blocks);
+    DDLogInfo(@"Embeddable table (%u bytes): %@", table.length, [table hexString]);
 }
 
 - (NSString *)filename
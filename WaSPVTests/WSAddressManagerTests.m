@@ -0,0 +1,149 @@
+//
+//  WSAddressManagerTests.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "XCTestCase+WaSPV.h"
+#import "WSAddressManager.h"
+#import "WSNetworkAddress.h"
+
+@interface WSAddressManagerTests : XCTestCase
+
+@property (nonatomic, strong) NSString *path;
+
+@end
+
+@implementation WSAddressManagerTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    self.networkType = WSNetworkTypeTestnet3;
+    self.path = [self mockPathForFile:@"AddressManagerTests.addresses"];
+
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:NULL];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+- (void)testTriedFirst
+{
+    WSAddressManager *manager = [[WSAddressManager alloc] initWithParameters:self.networkParameters];
+    const uint32_t now = WSCurrentTimestamp();
+    NSArray *hosts = @[@"10.0.0.1", @"10.1.0.1", @"10.2.0.1", @"10.3.0.1"];
+
+    NSMutableArray *addresses = [[NSMutableArray alloc] init];
+    for (NSString *host in hosts) {
+        [addresses addObject:WSNetworkAddressMake(WSNetworkIPv4FromHost(host), [self.networkParameters peerPort], 0, now)];
+    }
+    XCTAssertEqual([manager addAddresses:addresses], hosts.count);
+    XCTAssertEqual([manager addAddresses:addresses], 0);
+    XCTAssertEqual(manager.count, hosts.count);
+    XCTAssertEqual(manager.triedCount, 0);
+    XCTAssertTrue([manager containsHost:hosts[2]]);
+    XCTAssertFalse([manager containsHost:@"10.4.0.1"]);
+
+    // fastest tried host wins
+    XCTAssertFalse([manager hasRecentSuccess]);
+    [manager didConnectToAddress:addresses[1]];
+    [manager didConnectToAddress:addresses[3]];
+    XCTAssertTrue([manager hasRecentSuccess]);
+    [manager setPingTime:0.5 forHost:hosts[1]];
+    [manager setPingTime:0.05 forHost:hosts[3]];
+    XCTAssertEqual(manager.triedCount, 2);
+
+    WSNetworkAddress *best = [manager bestAddressPassingTest:^BOOL(WSNetworkAddress *address) {
+        return [address.host isEqualToString:hosts[1]] || [address.host isEqualToString:hosts[3]];
+    }];
+    XCTAssertEqualObjects(best.host, hosts[3]);
+
+    // excluded by test
+    best = [manager bestAddressPassingTest:^BOOL(WSNetworkAddress *address) {
+        return [address.host isEqualToString:hosts[0]];
+    }];
+    XCTAssertEqualObjects(best.host, hosts[0]);
+    XCTAssertNil([manager bestAddressPassingTest:^BOOL(WSNetworkAddress *address) {
+        return NO;
+    }]);
+
+    [manager removeHost:hosts[3]];
+    XCTAssertFalse([manager containsHost:hosts[3]]);
+    XCTAssertEqual(manager.count, hosts.count - 1);
+    XCTAssertEqual(manager.triedCount, 1);
+}
+
+- (void)testReload
+{
+    WSAddressManager *manager = [[WSAddressManager alloc] initWithParameters:self.networkParameters path:self.path];
+    XCTAssertEqual(manager.count, 0);
+
+    const uint32_t now = WSCurrentTimestamp();
+    NSMutableArray *addresses = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < 20; ++i) {
+        NSString *host = [NSString stringWithFormat:@"192.168.%u.%u", (unsigned)(i / 10), (unsigned)(i % 10 + 1)];
+        [addresses addObject:WSNetworkAddressMake(WSNetworkIPv4FromHost(host), [self.networkParameters peerPort], 1, now - (uint32_t)i)];
+    }
+    const NSUInteger added = [manager addAddresses:addresses];
+    XCTAssertEqual(manager.count, added);
+    [manager didConnectToAddress:WSNetworkAddressMake(WSNetworkIPv4FromHost(@"192.168.0.1"), 18444, 1, now)];
+    [manager setPingTime:0.123 forHost:@"192.168.0.1"];
+
+    NSError *error;
+    XCTAssertTrue([manager saveWithError:&error], @"Unable to save addresses: %@", error);
+
+    WSAddressManager *reloaded = [[WSAddressManager alloc] initWithParameters:self.networkParameters path:self.path];
+    XCTAssertEqual(reloaded.count, manager.count);
+    XCTAssertEqual(reloaded.triedCount, 1);
+    for (WSNetworkAddress *address in addresses) {
+        XCTAssertEqual([reloaded containsHost:address.host], [manager containsHost:address.host]);
+    }
+
+    WSNetworkAddress *best = [reloaded bestAddressPassingTest:^BOOL(WSNetworkAddress *address) {
+        return [address.host isEqualToString:@"192.168.0.1"];
+    }];
+    XCTAssertEqualObjects(best.host, @"192.168.0.1");
+    XCTAssertEqual(best.port, 18444);
+    XCTAssertTrue([reloaded hasRecentSuccess]);
+
+    // entry count beyond file length is discarded
+    NSMutableData *data = [[NSData dataWithContentsOfFile:self.path] mutableCopy];
+    const uint32_t count = UINT32_MAX;
+    [data replaceBytesInRange:NSMakeRange(20, sizeof(count)) withBytes:&count];
+    [data writeToFile:self.path atomically:YES];
+    reloaded = [[WSAddressManager alloc] initWithParameters:self.networkParameters path:self.path];
+    XCTAssertEqual(reloaded.count, 0);
+    XCTAssertFalse([reloaded hasRecentSuccess]);
+
+    // garbage is discarded
+    [[@"garbage" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:self.path atomically:YES];
+    reloaded = [[WSAddressManager alloc] initWithParameters:self.networkParameters path:self.path];
+    XCTAssertEqual(reloaded.count, 0);
+}
+
+@end
@@ -28,6 +28,8 @@
 #import "XCTestCase+WaSPV.h"
 #import "WSPublicKey.h"
 #import "NSData+Base58.h"
+#import "WSAddress.h"
+#import "WSAddressIndex.h"
 
 @interface WSAddressTests : XCTestCase
 
@@ -84,4 +86,41 @@
     XCTAssertEqualObjects(address, expAddress);
 }
 
+- (void)testAddressIndex
+{
+    WSAddressIndex *index = [[WSAddressIndex alloc] init];
+    NSMutableArray *addresses = [[NSMutableArray alloc] init];
+
+    // beyond initial capacity
+    for (NSUInteger i = 0; i < 500; ++i) {
+        NSMutableData *data = [[NSMutableData alloc] initWithLength:WSHash160Length];
+        SecRandomCopyBytes(kSecRandomDefault, data.length, data.mutableBytes);
+
+        WSAddress *address = [[WSAddress alloc] initWithParameters:self.networkParameters
+                                                           version:[self.networkParameters publicKeyAddressVersion]
+                                                           hash160:WSHash160FromData(data)];
+        XCTAssertFalse([index containsAddress:address]);
+        XCTAssertTrue([index addAddress:address]);
+        [addresses addObject:address];
+    }
+    XCTAssertEqual(index.count, addresses.count);
+
+    for (WSAddress *address in addresses) {
+        XCTAssertTrue([index containsAddress:address]);
+        XCTAssertFalse([index addAddress:address]);
+
+        // same hash160 as P2SH is a different address
+        WSAddress *scriptAddress = [[WSAddress alloc] initWithParameters:self.networkParameters
+                                                                 version:[self.networkParameters scriptAddressVersion]
+                                                                 hash160:address.hash160];
+        XCTAssertFalse([index containsAddress:scriptAddress]);
+    }
+    XCTAssertEqual(index.count, addresses.count);
+    XCTAssertFalse([index containsAddress:nil]);
+
+    [index removeAllAddresses];
+    XCTAssertEqual(index.count, 0);
+    XCTAssertFalse([index containsAddress:addresses.firstObject]);
+}
+
 @end
@@ -27,6 +27,8 @@
 
 #import "XCTestCase+WaSPV.h"
 #import "WSBloomFilter.h"
+#import "WSBloomFilterTuner.h"
+#import "WSBloomFilterSimulator.h"
 
 @interface WSBIP37Tests : XCTestCase
 
@@ -79,6 +81,43 @@
     }
 }
 
+- (void)testFilterCopy
+{
+    WSBIP37FilterParameters *parameters = [[WSBIP37FilterParameters alloc] init];
+    parameters.falsePositiveRate = 0.01;
+    parameters.tweak = 0xdeadbeef;
+    parameters.flags = WSBIP37FlagsUpdateAll;
+    WSMutableBloomFilter *filter = [[WSMutableBloomFilter alloc] initWithParameters:parameters capacity:10];
+
+    NSArray *insertStrings = @[@"abcdef", @"0023834f", @"84938c"];
+    for (NSString *string in insertStrings) {
+        [filter insertData:string.dataFromHex];
+    }
+
+    WSBloomFilter *copy = [filter copy];
+    WSMutableBloomFilter *mutableCopy = [filter mutableCopy];
+    NSData *expData = [filter toBuffer].data;
+    XCTAssertEqualObjects([copy toBuffer].data, expData);
+    XCTAssertEqualObjects([mutableCopy toBuffer].data, expData);
+
+    // tweak (4) and flags (1) trail the serialized filter
+    uint32_t tweak;
+    NSData *copyData = [copy toBuffer].data;
+    [copyData getBytes:&tweak range:NSMakeRange(copyData.length - 5, sizeof(tweak))];
+    XCTAssertEqual(CFSwapInt32LittleToHost(tweak), parameters.tweak);
+
+    // copy hashes with the original tweak, same insertion sets the same bits
+    NSData *newData = @"00fbd97c".dataFromHex;
+    [filter insertData:newData];
+    [mutableCopy insertData:newData];
+    XCTAssertEqualObjects([mutableCopy toBuffer].data, [filter toBuffer].data);
+    XCTAssertTrue([mutableCopy containsData:newData]);
+    for (NSString *string in insertStrings) {
+        XCTAssertTrue([copy containsData:string.dataFromHex]);
+        XCTAssertTrue([mutableCopy containsData:string.dataFromHex]);
+    }
+}
+
 - (void)testFilterFromBreadwallet
 {
     WSBIP37FilterParameters *parameters = [[WSBIP37FilterParameters alloc] init];
@@ -110,6 +149,132 @@
     XCTAssertEqualObjects(@"03614e9b050000000000000001".dataFromHex, f.toBuffer.data, @"[BRBloomFilter data:]");
 }
 
+- (void)testMurmurHash3
+{
+    // from bitcoind hash_tests.cpp
+    XCTAssertEqual(WSBIP37MurmurHash3(NULL, 0, 0x00000000), 0x00000000);
+    XCTAssertEqual(WSBIP37MurmurHash3(NULL, 0, 0xfba4c795), 0x6a396f08);
+    XCTAssertEqual(WSBIP37MurmurHash3(NULL, 0, 0xffffffff), 0x81f16f39);
+    
+    NSArray *hexStrings = @[@"00", @"0011", @"001122", @"00112233", @"0011223344", @"001122334455", @"00112233445566", @"0011223344556677", @"001122334455667788"];
+    const uint32_t expected[] = {0x514e28b7, 0x16c6b7ab, 0x8eb51c3d, 0xb4471bf8, 0xe2301fa8, 0xfc2e4a15, 0xb074502c, 0x8034d2a0, 0xb4698def};
+    for (NSUInteger i = 0; i < hexStrings.count; ++i) {
+        NSData *data = [hexStrings[i] dataFromHex];
+        XCTAssertEqual(WSBIP37MurmurHash3(data.bytes, data.length, 0x00000000), expected[i], @"MurmurHash3(%@)", hexStrings[i]);
+    }
+}
+
+- (void)testFilterFixedLengths
+{
+    WSBIP37FilterParameters *parameters = [[WSBIP37FilterParameters alloc] init];
+    parameters.falsePositiveRate = 0.0001;
+    WSMutableBloomFilter *filter = [[WSMutableBloomFilter alloc] initWithParameters:parameters capacity:100];
+    
+    // hash160, compressed/uncompressed public keys, outpoint
+    const NSUInteger lengths[] = {20, 33, 36, 65};
+    NSMutableArray *elements = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+        NSMutableData *data = [[NSMutableData alloc] initWithLength:lengths[i]];
+        SecRandomCopyBytes(kSecRandomDefault, data.length, data.mutableBytes);
+        [elements addObject:data];
+
+        XCTAssertFalse([filter containsData:data]);
+        [filter insertData:data];
+        XCTAssertTrue([filter containsData:data]);
+    }
+    
+    // reinsertion doesn't dirty filter
+    const double rate = [filter estimatedFalsePositiveRate];
+    [filter insertData:elements.firstObject];
+    XCTAssertEqual([filter estimatedFalsePositiveRate], rate);
+
+    // copies hash with same tweak
+    WSMutableBloomFilter *copy = [filter mutableCopy];
+    for (NSData *data in elements) {
+        XCTAssertTrue([copy containsData:data]);
+    }
+    XCTAssertEqualObjects([copy toBuffer].data, [filter toBuffer].data);
+}
+
+- (void)testBloomFilterRecords
+{
+    NSString *path = [self mockPathForFile:@"BIP37Tests.records"];
+    NSError *error;
+
+    NSString *contents = @"# txCount,relevantTxCount,txBytes\n500,0,125000\n\n  20,2,5000  \n1,1,250\n";
+    XCTAssertTrue([contents writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:&error], @"Error: %@", error);
+    NSArray *records = [WSBloomFilterSimulator recordsWithContentsOfFile:path error:&error];
+    XCTAssertEqual(records.count, 3, @"Error: %@", error);
+    XCTAssertEqual([records[1] txCount], 20);
+    XCTAssertEqual([records[1] relevantTxCount], 2);
+    XCTAssertEqual([records[1] txBytes], 5000);
+
+    // wrong number of fields
+    error = nil;
+    [@"500,0,125000\n500,0\n" writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    XCTAssertNil([WSBloomFilterSimulator recordsWithContentsOfFile:path error:&error]);
+    XCTAssertEqualObjects(error.domain, WSErrorDomain);
+    XCTAssertEqual(error.code, WSErrorCodeMalformed);
+
+    // more relevant than total transactions
+    error = nil;
+    [@"500,501,125000\n" writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+    XCTAssertNil([WSBloomFilterSimulator recordsWithContentsOfFile:path error:&error]);
+    XCTAssertEqual(error.code, WSErrorCodeMalformed);
+
+    // missing file
+    error = nil;
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    XCTAssertNil([WSBloomFilterSimulator recordsWithContentsOfFile:path error:&error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testBloomFilterTuner
+{
+    const double minRate = 0.000001;
+    const double maxRate = 0.01;
+    
+    // tighter rates mean larger filters
+    XCTAssertLessThan([WSBloomFilterTuner filterSizeForElements:5000 falsePositiveRate:maxRate],
+                      [WSBloomFilterTuner filterSizeForElements:5000 falsePositiveRate:minRate]);
+    
+    // 2000 blocks of 500 transactions, one relevant every 50 blocks
+    NSMutableArray *records = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < 2000; ++i) {
+        [records addObject:[WSBloomFilterBlockRecord recordWithTxCount:500 relevantTxCount:((i % 50) == 0) txBytes:(500 * 250)]];
+    }
+    WSBloomFilterSimulator *simulator = [[WSBloomFilterSimulator alloc] initWithRecords:records elements:5000 peers:3];
+    
+    WSBloomFilterTuner *tuner = [[WSBloomFilterTuner alloc] initWithTxsPerBlock:500];
+    tuner.minFalsePositiveRate = minRate;
+    tuner.maxFalsePositiveRate = maxRate;
+    
+    // far from tip favours tight filters, close to tip loose ones
+    const double farRate = [tuner falsePositiveRateForElements:5000 blocksLeft:100000 peers:3];
+    const double nearRate = [tuner falsePositiveRateForElements:5000 blocksLeft:0 peers:3];
+    XCTAssertGreaterThanOrEqual(farRate, minRate);
+    XCTAssertLessThanOrEqual(nearRate, maxRate);
+    XCTAssertLessThan(farRate, nearRate);
+    
+    const uint64_t tightBytes = [simulator totalBytesWithFalsePositiveRate:minRate];
+    const uint64_t looseBytes = [simulator totalBytesWithFalsePositiveRate:maxRate];
+    const uint64_t tunedBytes = [simulator totalBytesWithTuner:tuner];
+    DDLogInfo(@"Bytes: %llu (tight), %llu (loose), %llu (tuned, %u resets)",
+              tightBytes, looseBytes, tunedBytes, [simulator numberOfResets]);
+    
+    XCTAssertLessThan(tunedBytes, tightBytes);
+    XCTAssertLessThan(tunedBytes, looseBytes);
+    
+    // underestimated traffic (worse filters, busier blocks) is corrected by a reset
+    simulator.falsePositiveMultiplier = 3.0;
+    tuner = [[WSBloomFilterTuner alloc] initWithTxsPerBlock:50];
+    tuner.minFalsePositiveRate = minRate;
+    tuner.maxFalsePositiveRate = maxRate;
+    const uint64_t correctedBytes = [simulator totalBytesWithTuner:tuner];
+    XCTAssertGreaterThan([simulator numberOfResets], 0);
+    XCTAssertLessThan(correctedBytes, [simulator totalBytesWithFalsePositiveRate:maxRate]);
+}
+
 - (void)subInsertFilter:(WSMutableBloomFilter *)filter hexString:(NSString *)hexString
 {
     NSData *data = [hexString dataFromHex];
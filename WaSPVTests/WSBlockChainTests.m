@@ -30,6 +30,7 @@
 #import "WSBlockMacros.h"
 #import "WSBlockLocator.h"
 #import "WSFilteredBlock.h"
+#import "WSPartialMerkleTree.h"
 
 static WSBlockHeader *WSMakeDummyHeader(id<WSParameters> networkParameters, WSHash256 *blockId, WSHash256 *previousBlockId, NSUInteger work);
 static NSOrderedSet *WSMakeDummyTransactions(id<WSParameters> networkParameters, WSHash256 *blockId);
@@ -61,6 +62,130 @@ static NSOrderedSet *WSMakeDummyTransactions(id<WSParameters> networkParameters,
     XCTAssertEqualObjects(headId, chain.head.blockId);
 }
 
+- (void)testDisconnectedHead
+{
+    self.networkType = WSNetworkTypeTestnet3;
+
+    WSMemoryBlockStore *store = [[WSMemoryBlockStore alloc] initWithParameters:self.networkParameters];
+    WSStorableBlock *block = store.head;
+    for (NSUInteger i = 0; i < 10; ++i) {
+        WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                                  version:2
+                                                          previousBlockId:block.blockId
+                                                               merkleRoot:WSHash256Zero()
+                                                                timestamp:(block.header.timestamp + 600)
+                                                                     bits:block.header.bits
+                                                                    nonce:0];
+        block = [block buildNextBlockFromHeader:header transactions:nil];
+        [store putBlock:block];
+        [store setHead:block];
+    }
+    XCTAssertEqual(store.size, 11);
+
+    // e.g. a checkpoint
+    WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                              version:2
+                                                      previousBlockId:WSHash256Zero()
+                                                           merkleRoot:WSHash256Zero()
+                                                            timestamp:block.header.timestamp
+                                                                 bits:block.header.bits
+                                                                nonce:0];
+    WSStorableBlock *checkpoint = [[WSStorableBlock alloc] initWithHeader:header transactions:nil height:100];
+    [store putBlock:checkpoint];
+    [store setHead:checkpoint];
+
+    // old chain is not kept as a fork
+    XCTAssertEqual(store.size, 1);
+    XCTAssertEqualObjects(store.head.blockId, checkpoint.blockId);
+    XCTAssertEqualObjects([store blockAtHeight:100].blockId, checkpoint.blockId);
+    XCTAssertNil([store blockAtHeight:5]);
+    XCTAssertNil([store blockForId:block.blockId]);
+}
+
+- (void)testAddBlockHeaders
+{
+    self.networkType = WSNetworkTypeTestnet3;
+
+    id<WSBlockStore> store = [[WSMemoryBlockStore alloc] initWithParameters:self.networkParameters];
+    WSBlockChain *chain = [[WSBlockChain alloc] initWithStore:store];
+    NSArray *headers = [self localHeaders];
+    NSArray *firstHalf = [headers subarrayWithRange:NSMakeRange(0, 10)];
+    NSArray *secondHalf = [headers subarrayWithRange:NSMakeRange(10, 10)];
+    NSArray *blocks;
+    NSError *error;
+
+    // orphans first
+    blocks = [chain addBlockHeaders:secondHalf reorganizeBlock:NULL connectedOrphans:NULL error:&error];
+    XCTAssertEqual(blocks.count, 0);
+    XCTAssertNil(error);
+    XCTAssertEqual(chain.currentHeight, 0);
+
+    XCTAssertEqual(chain.orphanPool.count, 10);
+
+    NSArray *connectedOrphans;
+    blocks = [chain addBlockHeaders:firstHalf reorganizeBlock:NULL connectedOrphans:&connectedOrphans error:&error];
+    XCTAssertEqual(blocks.count, 10);
+    XCTAssertEqual(connectedOrphans.count, 10);
+    XCTAssertNil(error);
+    XCTAssertEqualObjects([blocks.lastObject blockId], [firstHalf.lastObject blockId]);
+    XCTAssertEqualObjects([connectedOrphans.lastObject blockId], [secondHalf.lastObject blockId]);
+    XCTAssertEqual(chain.orphanPool.count, 0);
+    XCTAssertEqual(chain.orphanPool.connectedCount, 10);
+
+    // duplicates are ignored
+    blocks = [chain addBlockHeaders:firstHalf reorganizeBlock:NULL connectedOrphans:NULL error:&error];
+    XCTAssertEqual(blocks.count, 0);
+    XCTAssertNil(error);
+
+    WSBlockChain *expectedChain = [self chainWithLocalHeaders];
+    XCTAssertEqual(chain.currentHeight, expectedChain.currentHeight);
+    XCTAssertEqualObjects(chain.head.blockId, expectedChain.head.blockId);
+    const WSUInt256 work = chain.head.work;
+    const WSUInt256 expectedWork = expectedChain.head.work;
+    XCTAssertTrue(WSUInt256Compare(&work, &expectedWork) == 0);
+}
+
+- (void)testOrphanPool
+{
+    self.networkType = WSNetworkTypeTestnet3;
+
+    NSArray *headers = [self localHeaders];
+    WSOrphanPool *pool = [[WSOrphanPool alloc] initWithCapacity:5];
+
+    // oldest evicted first
+    for (WSBlockHeader *header in headers) {
+        [pool addBlock:[[WSStorableBlock alloc] initWithHeader:header transactions:nil]];
+    }
+    XCTAssertEqual(pool.count, 5);
+    XCTAssertEqual(pool.addedCount, headers.count);
+    XCTAssertEqual(pool.evictedCount, headers.count - 5);
+    XCTAssertFalse([pool containsBlockId:[headers[0] blockId]]);
+    XCTAssertTrue([pool containsBlockId:[headers.lastObject blockId]]);
+
+    // indexed by parent
+    WSBlockHeader *lastHeader = headers.lastObject;
+    XCTAssertTrue([pool hasChildrenOfBlockId:lastHeader.previousBlockId]);
+    NSArray *children = [pool removeChildrenOfBlockId:lastHeader.previousBlockId];
+    XCTAssertEqual(children.count, 1);
+    XCTAssertEqualObjects([children.firstObject blockId], lastHeader.blockId);
+    XCTAssertEqual(pool.count, 4);
+    XCTAssertEqual(pool.connectedCount, 1);
+    XCTAssertNil([pool removeChildrenOfBlockId:lastHeader.previousBlockId]);
+
+    // re-adding refreshes age, next oldest is evicted instead
+    const NSUInteger oldest = headers.count - 5;
+    [pool addBlock:[[WSStorableBlock alloc] initWithHeader:headers[oldest] transactions:nil]];
+    XCTAssertEqual(pool.count, 4);
+    [pool addBlock:[[WSStorableBlock alloc] initWithHeader:headers[0] transactions:nil]];
+    [pool addBlock:[[WSStorableBlock alloc] initWithHeader:headers[1] transactions:nil]];
+    XCTAssertEqual(pool.count, 5);
+    XCTAssertTrue([pool containsBlockId:[headers[oldest] blockId]]);
+    XCTAssertFalse([pool containsBlockId:[headers[oldest + 1] blockId]]);
+
+    [pool removeAllBlocks];
+    XCTAssertEqual(pool.count, 0);
+}
+
 - (void)testIds
 {
     self.networkType = WSNetworkTypeTestnet3;
@@ -123,6 +248,138 @@ static NSOrderedSet *WSMakeDummyTransactions(id<WSParameters> networkParameters,
     XCTAssertEqualObjects(previousBlock.blockId, WSHash256FromHex(@"000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943"));
 }
 
+- (void)testAncestor
+{
+    self.networkType = WSNetworkTypeTestnet3;
+
+    WSBlockChain *chain = [self chainWithLocalHeaders];
+    WSStorableBlock *head = chain.head;
+
+    XCTAssertEqualObjects([head ancestorAtHeight:head.height inChain:chain], head);
+    XCTAssertEqualObjects([head ancestorAtHeight:17 inChain:chain].blockId, WSHash256FromHex(@"00000000fe198cce4c8abf9dca0fee1182cb130df966cc428ad2a230df8da743"));
+    XCTAssertEqualObjects([head ancestorAtHeight:7 inChain:chain].blockId, WSHash256FromHex(@"00000000e29e3aa65f3d12440eac9081844c464aeba7c6e6121dfc8ac0c02ba6"));
+    XCTAssertEqualObjects([head ancestorAtHeight:0 inChain:chain].blockId, WSHash256FromHex(@"000000000933ea01ad0ee984209779baaec3ced90fa3f408719526f8d77f4943"));
+    XCTAssertNil([head ancestorAtHeight:(head.height + 1) inChain:chain]);
+
+    // same as walking back one by one
+    WSStorableBlock *block = head;
+    while (block) {
+        for (uint32_t height = 0; height <= block.height; ++height) {
+            WSStorableBlock *expBlock = [head ancestorAtHeight:height inChain:chain];
+            XCTAssertEqualObjects([block ancestorAtHeight:height inChain:chain], expBlock);
+        }
+        block = [block previousBlockInChain:chain];
+    }
+
+    // unlinked fork block, as if loaded from store
+    WSStorableBlock *forkBase = [head ancestorAtHeight:(head.height - 3) inChain:chain];
+    WSBlockHeader *forkHeader = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                                  version:2
+                                                          previousBlockId:forkBase.blockId
+                                                               merkleRoot:WSHash256Zero()
+                                                                timestamp:(forkBase.header.timestamp + 600)
+                                                                     bits:forkBase.header.bits
+                                                                    nonce:0];
+    WSStorableBlock *forkBlock = [[WSStorableBlock alloc] initWithHeader:forkHeader transactions:nil height:(forkBase.height + 1)];
+    XCTAssertEqualObjects([forkBlock ancestorAtHeight:forkBase.height inChain:chain], forkBase);
+    XCTAssertEqualObjects([forkBlock ancestorAtHeight:7 inChain:chain], [head ancestorAtHeight:7 inChain:chain]);
+
+    for (uint32_t height = 2; height < 100000; ++height) {
+        XCTAssertLessThan(WSBlockGetSkipHeight(height), height);
+    }
+}
+
+- (void)testRetargetIndex
+{
+    self.networkType = WSNetworkTypeMain;
+
+    id<WSBlockStore> store = [[WSMemoryBlockStore alloc] initWithParameters:self.networkParameters];
+    WSBlockChain *chain = [[WSBlockChain alloc] initWithStore:store];
+
+    const uint32_t retargetInterval = [self.networkParameters retargetInterval];
+    const uint32_t maxBits = [self.networkParameters maxProofOfWork];
+    const uint32_t spacing = 300;
+
+    // periods at half target spacing
+    WSFilteredBlock *genesis = [self.networkParameters genesisBlock];
+    WSStorableBlock *block = [[WSStorableBlock alloc] initWithHeader:genesis.header transactions:nil height:0];
+    NSMutableArray *blocks = [[NSMutableArray alloc] init];
+    [blocks addObject:block];
+
+    for (uint32_t height = 1; height < 2 * retargetInterval; ++height) {
+        WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                                  version:2
+                                                          previousBlockId:block.blockId
+                                                               merkleRoot:WSHash256Zero()
+                                                                timestamp:(genesis.header.timestamp + height * spacing)
+                                                                     bits:maxBits
+                                                                    nonce:height];
+
+        block = [block buildNextBlockFromHeader:header transactions:nil];
+        [blocks addObject:block];
+    }
+
+    // first block of own period, nil for period starts
+    for (WSStorableBlock *linkedBlock in blocks) {
+        WSStorableBlock *periodStartBlock = [linkedBlock valueForKey:@"periodStartBlock"];
+        if (linkedBlock.height % retargetInterval == 0) {
+            XCTAssertNil(periodStartBlock);
+        }
+        else {
+            XCTAssertEqual(periodStartBlock, blocks[linkedBlock.height - linkedBlock.height % retargetInterval]);
+        }
+    }
+
+    // new target from timespan between linked period start and last block
+    WSStorableBlock *periodStart = blocks[retargetInterval];
+    WSStorableBlock *periodEnd = blocks.lastObject;
+    WSUInt256 target;
+    WSBlockSetBits(&target, maxBits);
+    WSUInt256MultiplyWord(&target, &target, periodEnd.header.timestamp - periodStart.header.timestamp);
+    WSUInt256DivideWord(&target, &target, [self.networkParameters retargetTimespan]);
+    const uint32_t expectedBits = WSBlockGetBits(&target);
+    XCTAssertNotEqual(expectedBits, maxBits);
+
+    for (NSNumber *bits in @[@(expectedBits), @(maxBits)]) {
+        WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                                  version:2
+                                                          previousBlockId:periodEnd.blockId
+                                                               merkleRoot:WSHash256Zero()
+                                                                timestamp:(periodEnd.header.timestamp + spacing)
+                                                                     bits:bits.unsignedIntValue
+                                                                    nonce:0];
+
+        WSStorableBlock *transitionBlock = [periodEnd buildNextBlockFromHeader:header transactions:nil];
+        XCTAssertTrue([transitionBlock isTransitionBlock]);
+        XCTAssertNil([transitionBlock valueForKey:@"periodStartBlock"]);
+
+        NSError *error;
+        const BOOL isValid = [transitionBlock validateTargetInChain:chain error:&error];
+        if (bits.unsignedIntValue == expectedBits) {
+            XCTAssertTrue(isValid, @"Unexpected error: %@", error);
+        }
+        else {
+            XCTAssertFalse(isValid);
+            XCTAssertEqual(error.code, WSErrorCodeInvalidBlock);
+        }
+    }
+
+    // unlinked as if loaded from store, relinked on validation
+    for (WSStorableBlock *linkedBlock in blocks) {
+        [store putBlock:linkedBlock];
+        [store setHead:linkedBlock];
+    }
+    WSStorableBlock *storedBlock = blocks[retargetInterval + 10];
+    WSStorableBlock *loadedBlock = [[WSStorableBlock alloc] initWithHeader:storedBlock.header transactions:nil height:storedBlock.height work:storedBlock.workData];
+    WSStorableBlock *nextBlock = [loadedBlock buildNextBlockFromHeader:[blocks[storedBlock.height + 1] header] transactions:nil];
+    XCTAssertNil([nextBlock valueForKey:@"periodStartBlock"]);
+
+    NSError *error;
+    XCTAssertTrue([nextBlock validateTargetInChain:chain error:&error], @"Unexpected error: %@", error);
+    XCTAssertEqual([loadedBlock valueForKey:@"periodStartBlock"], periodStart);
+    XCTAssertEqual([nextBlock valueForKey:@"periodStartBlock"], periodStart);
+}
+
 - (void)testEmptyLocator
 {
     self.networkType = WSNetworkTypeTestnet3;
@@ -507,36 +764,44 @@ static NSOrderedSet *WSMakeDummyTransactions(id<WSParameters> networkParameters,
 
 #pragma mark Helpers
 
+- (NSArray *)localHeaders
+{
+    // from height #1
+    NSArray *hexes = @[@"0100000043497fd7f826957108f4a30fd9cec3aeba79972084e90ead01ea330900000000bac8b0fa927c0ac8234287e33c5f74d38d354820e24756ad709d7038fc5f31f020e7494dffff001d03e4b67200",
+                       @"0100000006128e87be8b1b4dea47a7247d5528d2702c96826c7a648497e773b800000000e241352e3bec0a95a6217e10c3abb54adfa05abb12c126695595580fb92e222032e7494dffff001d00d2353400",
+                       @"0100000020782a005255b657696ea057d5b98f34defcf75196f64f6eeac8026c0000000041ba5afc532aae03151b8aa87b65e1594f97504a768e010c98c0add79216247186e7494dffff001d058dc2b600",
+                       @"0100000010befdc16d281e40ecec65b7c9976ddc8fd9bc9752da5827276e898b000000004c976d5776dda2da30d96ee810cd97d23ba852414990d64c4c720f977e651f2daae7494dffff001d02a9764000",
+                       @"01000000dde5b648f594fdd2ec1c4083762dd13b197bb1381e74b1fff90a5d8b00000000b3c6c6c1118c3b6abaa17c5aa74ee279089ad34dc3cec3640522737541cb016818e8494dffff001d02da84c000",
+                       @"01000000a1213bd4754a6606444b97b5e8c46e9b7832773ff434bd5f87ac45bc00000000d1e7026986a9cd247b5b85a3f30ecbabb6d61840d0abb81f905c411d5fc145e831e8494dffff001d004138f900",
+                       @"010000007b0a09f26fdde2c432167d8349681c7801d0128f4dfae4dc5e68336600000000c1d71f59ce4419c793eb829380a41dc1ad48c19fcb0083b8f67094d5cae263ad81e8494dffff001d004ddad500",
+                       @"01000000a62bc0c08afc1d12e6c6a7eb4a464c848190ac0e44123d5fa63a9ee2000000000214335cde9edeb6aa0195f68c08e5e46b07043e24aeff51fd9a3ff992ce6976a0e8494dffff001d02f3392700",
+                       @"01000000f9e2142a93185496f7b21314d8b6fa736d0a30fa3a6d339ab3a1ba9c0000000061974472615d348df6de106dbaaa08cf4dec65e39cefc62af6097b967b9bea52fde8494dffff001d00ca48a200",
+                       @"010000001e93aa99c8ff9749037d74a2207f299502fa81d56a4ea2ad5330ff50000000002ec2266c3249ce2e079059e0aec01a2d8d8306a468ad3f18f06051f2c3b1645435e9494dffff001d008918cf00",
+                       @"010000002e9afd58b91f15c3ec9eb0f01ed9d503134da1918b6bb416a9920e700000000029fb495afdb58f3a26d1c90fafec93aed840e2fa37ad6173ba1e7fadb7121ee57de9494dffff001d02e7f31800",
+                       @"0100000027e0ca29a9802c0a2390ecfa90a9bd814fecc54446510e155652dead000000007e8d5344557575c8f018cc62a32e8e0bd80638643b4ec34945ec4662fcab138142ea494dffff001d04acbc3c00",
+                       @"01000000001f3ada9b561378e324e80ee68facd5d232f72f773b86328393054700000000eaf3be35e3f0ace8b6abdeb5509d72999eae2329657238b53fa437e319c8e96b99ea494dffff001d027801a800",
+                       @"01000000781bc7847e15c3b936a6a6a178e38fa29ee6e4916a8a62e10795c69200000000d44c3443fa8bd88bf32b94b9257f09ce6fb6ec0d5420504d631568f8685200dfa1ea494dffff001d01f781d000",
+                       @"01000000133991a938b505ee8f6f347f313c3372d82a9d8b42b08b0dd0fc086400000000a0ef58c239e0197a65aa248c2cf52c437d8c8ea30d1b835e630a87c941f7d4e9adea494dffff001d030ef2e000",
+                       @"0100000028d34cdb13e555032e4bec55fcce3d0fef8212803fb1bab851e1259400000000542c71544b9f28bd5a6fec95ecd509ae49d0b04f8718c685d0751f71d38285d0c3ea494dffff001d056b311500",
+                       @"010000006b00cf1ce31b33fe1e2c4648a0834dedd972ffb2a2f341f75ad7cbc400000000adebf7afcbf176f765aec16b74d92896f55c3d65e14dd1a8becee0871000291751eb494dffff001d006f85e800",
+                       @"0100000043a78ddf30a2d28a42cc66f90d13cb8211ee0fca9dbf8a4cce8c19fe000000004edbd2b89cb6d6fd69b575a62bd4e3103b1e0ce19e31bccf9a093ad8ccd753cf7deb494dffff001d0591a0b300",
+                       @"01000000489ac81592595a4004e14331cb096ffef12b1daf709f6378e9c3558d00000000c757bebd6f2c2c071a3cf739a4cf98b27441809790a5cf40652b46df8a98a473b0eb494dffff001d011aedb600",
+                       @"01000000a9c570a45d959023551f9a694ace9c12206174f21383f30949ca3b9b00000000eaf93dbbfb3551a1ff8b6bd5ba4cea7508e790c23cd07b9d9e791936a79d5fd4b3eb494dffff001d0385a7dd00"];
+
+    NSMutableArray *headers = [[NSMutableArray alloc] initWithCapacity:hexes.count];
+    for (NSString *hex in hexes) {
+        [headers addObject:WSBlockHeaderFromHex(self.networkParameters, hex)];
+    }
+    return headers;
+}
+
 - (WSBlockChain *)chainWithLocalHeaders
 {
     id<WSBlockStore> store = [[WSMemoryBlockStore alloc] initWithParameters:self.networkParameters];
     WSBlockChain *chain = [[WSBlockChain alloc] initWithStore:store];
 
-    // from height #1
-    NSArray *headers = @[@"0100000043497fd7f826957108f4a30fd9cec3aeba79972084e90ead01ea330900000000bac8b0fa927c0ac8234287e33c5f74d38d354820e24756ad709d7038fc5f31f020e7494dffff001d03e4b67200",
-                         @"0100000006128e87be8b1b4dea47a7247d5528d2702c96826c7a648497e773b800000000e241352e3bec0a95a6217e10c3abb54adfa05abb12c126695595580fb92e222032e7494dffff001d00d2353400",
-                         @"0100000020782a005255b657696ea057d5b98f34defcf75196f64f6eeac8026c0000000041ba5afc532aae03151b8aa87b65e1594f97504a768e010c98c0add79216247186e7494dffff001d058dc2b600",
-                         @"0100000010befdc16d281e40ecec65b7c9976ddc8fd9bc9752da5827276e898b000000004c976d5776dda2da30d96ee810cd97d23ba852414990d64c4c720f977e651f2daae7494dffff001d02a9764000",
-                         @"01000000dde5b648f594fdd2ec1c4083762dd13b197bb1381e74b1fff90a5d8b00000000b3c6c6c1118c3b6abaa17c5aa74ee279089ad34dc3cec3640522737541cb016818e8494dffff001d02da84c000",
-                         @"01000000a1213bd4754a6606444b97b5e8c46e9b7832773ff434bd5f87ac45bc00000000d1e7026986a9cd247b5b85a3f30ecbabb6d61840d0abb81f905c411d5fc145e831e8494dffff001d004138f900",
-                         @"010000007b0a09f26fdde2c432167d8349681c7801d0128f4dfae4dc5e68336600000000c1d71f59ce4419c793eb829380a41dc1ad48c19fcb0083b8f67094d5cae263ad81e8494dffff001d004ddad500",
-                         @"01000000a62bc0c08afc1d12e6c6a7eb4a464c848190ac0e44123d5fa63a9ee2000000000214335cde9edeb6aa0195f68c08e5e46b07043e24aeff51fd9a3ff992ce6976a0e8494dffff001d02f3392700",
-                         @"01000000f9e2142a93185496f7b21314d8b6fa736d0a30fa3a6d339ab3a1ba9c0000000061974472615d348df6de106dbaaa08cf4dec65e39cefc62af6097b967b9bea52fde8494dffff001d00ca48a200",
-                         @"010000001e93aa99c8ff9749037d74a2207f299502fa81d56a4ea2ad5330ff50000000002ec2266c3249ce2e079059e0aec01a2d8d8306a468ad3f18f06051f2c3b1645435e9494dffff001d008918cf00",
-                         @"010000002e9afd58b91f15c3ec9eb0f01ed9d503134da1918b6bb416a9920e700000000029fb495afdb58f3a26d1c90fafec93aed840e2fa37ad6173ba1e7fadb7121ee57de9494dffff001d02e7f31800",
-                         @"0100000027e0ca29a9802c0a2390ecfa90a9bd814fecc54446510e155652dead000000007e8d5344557575c8f018cc62a32e8e0bd80638643b4ec34945ec4662fcab138142ea494dffff001d04acbc3c00",
-                         @"01000000001f3ada9b561378e324e80ee68facd5d232f72f773b86328393054700000000eaf3be35e3f0ace8b6abdeb5509d72999eae2329657238b53fa437e319c8e96b99ea494dffff001d027801a800",
-                         @"01000000781bc7847e15c3b936a6a6a178e38fa29ee6e4916a8a62e10795c69200000000d44c3443fa8bd88bf32b94b9257f09ce6fb6ec0d5420504d631568f8685200dfa1ea494dffff001d01f781d000",
-                         @"01000000133991a938b505ee8f6f347f313c3372d82a9d8b42b08b0dd0fc086400000000a0ef58c239e0197a65aa248c2cf52c437d8c8ea30d1b835e630a87c941f7d4e9adea494dffff001d030ef2e000",
-                         @"0100000028d34cdb13e555032e4bec55fcce3d0fef8212803fb1bab851e1259400000000542c71544b9f28bd5a6fec95ecd509ae49d0b04f8718c685d0751f71d38285d0c3ea494dffff001d056b311500",
-                         @"010000006b00cf1ce31b33fe1e2c4648a0834dedd972ffb2a2f341f75ad7cbc400000000adebf7afcbf176f765aec16b74d92896f55c3d65e14dd1a8becee0871000291751eb494dffff001d006f85e800",
-                         @"0100000043a78ddf30a2d28a42cc66f90d13cb8211ee0fca9dbf8a4cce8c19fe000000004edbd2b89cb6d6fd69b575a62bd4e3103b1e0ce19e31bccf9a093ad8ccd753cf7deb494dffff001d0591a0b300",
-                         @"01000000489ac81592595a4004e14331cb096ffef12b1daf709f6378e9c3558d00000000c757bebd6f2c2c071a3cf739a4cf98b27441809790a5cf40652b46df8a98a473b0eb494dffff001d011aedb600",
-                         @"01000000a9c570a45d959023551f9a694ace9c12206174f21383f30949ca3b9b00000000eaf93dbbfb3551a1ff8b6bd5ba4cea7508e790c23cd07b9d9e791936a79d5fd4b3eb494dffff001d0385a7dd00"];
-    
     NSError *error;
-    for (NSString *hex in headers) {
-        WSBlockHeader *header = WSBlockHeaderFromHex(self.networkParameters, hex);
+    for (WSBlockHeader *header in [self localHeaders]) {
 //        DDLogInfo(@"Header: %@", header);
         XCTAssertTrue([chain addBlockWithHeader:header reorganizeBlock:NULL error:&error], @"Unable to add block %@: %@", header.blockId, error);
     }
@@ -548,32 +813,28 @@ static NSOrderedSet *WSMakeDummyTransactions(id<WSParameters> networkParameters,
 
 static WSBlockHeader *WSMakeDummyHeader(id<WSParameters> networkParameters, WSHash256 *blockId, WSHash256 *previousBlockId, NSUInteger work)
 {
-    BIGNUM bnLargest;
-    BIGNUM bnTarget;
-    BIGNUM bnWork;
-    
-    BN_init(&bnLargest);
-    BN_init(&bnTarget);
-    BN_init(&bnWork);
-    
-    BN_CTX *ctx = BN_CTX_new();
-    BN_set_bit(&bnLargest, 256);
-    BN_set_word(&bnWork, work);
-    BN_div(&bnTarget, NULL, &bnLargest, &bnWork, ctx);
-    BN_sub(&bnTarget, &bnTarget, BN_value_one());
-    BN_CTX_free(ctx);
+    WSUInt256 largest;
+    WSUInt256 target;
+    WSUInt256 remainder;
+    WSUInt256 divisor;
+    WSUInt256 one;
+
+    // target = 2^256 / work - 1, where 2^256 = largest + 1
+    memset(largest.words, 0xff, sizeof(largest.words));
+    WSUInt256SetWord(&divisor, (uint32_t)work);
+    WSUInt256SetWord(&one, 1);
+    WSUInt256Divide(&target, &remainder, &largest, &divisor);
+    WSUInt256Add(&remainder, &remainder, &one);
+    if (WSUInt256Compare(&remainder, &divisor) == 0) {
+        WSUInt256Add(&target, &target, &one);
+    }
+    WSUInt256Subtract(&target, &target, &one);
     
-    const uint32_t bits = WSBlockGetBits(&bnTarget);
+    const uint32_t bits = WSBlockGetBits(&target);
     
-    //    DDLogCInfo(@"Largest: %s", BN_bn2dec(&bnLargest));
-    //    DDLogCInfo(@"Target: %s", BN_bn2dec(&bnTarget));
-    //    DDLogCInfo(@"Work: %s", BN_bn2dec(&bnWork));
+    //    DDLogCInfo(@"Target: %@", WSUInt256GetDecimalString(&target));
     //    DDLogCInfo(@"Bits: %x", bits);
     
-    BN_free(&bnLargest);
-    BN_free(&bnTarget);
-    BN_free(&bnWork);
-    
     WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:networkParameters
                                                               version:2
                                                       previousBlockId:previousBlockId
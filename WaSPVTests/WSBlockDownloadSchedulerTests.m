@@ -0,0 +1,126 @@
+//
+//  WSBlockDownloadSchedulerTests.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "XCTestCase+WaSPV.h"
+#import "WaSPV.h"
+#import "WSFilteredBlock.h"
+#import "WSPartialMerkleTree.h"
+#import "WSBlockDownloadScheduler.h"
+
+@interface WSBlockDownloadSchedulerTests : XCTestCase
+
+@end
+
+@implementation WSBlockDownloadSchedulerTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    self.networkType = WSNetworkTypeTestnet3;
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+- (void)testDownloadScheduler
+{
+    NSArray *headers = [self chainedHeadersWithCount:20];
+    NSMutableArray *blockIds = [[NSMutableArray alloc] initWithCapacity:headers.count];
+    NSMutableDictionary *filteredBlocks = [[NSMutableDictionary alloc] initWithCapacity:headers.count];
+    for (WSBlockHeader *header in headers) {
+        WSPartialMerkleTree *tree = [[WSPartialMerkleTree alloc] initWithTxCount:1 hashes:@[header.merkleRoot] flags:[@"00" dataFromHex] error:NULL];
+        [blockIds addObject:header.blockId];
+        filteredBlocks[header.blockId] = [[WSFilteredBlock alloc] initWithHeader:header partialMerkleTree:tree];
+    }
+
+    id peer1 = [[NSObject alloc] init];
+    id peer2 = [[NSObject alloc] init];
+    WSBlockDownloadScheduler *scheduler = [[WSBlockDownloadScheduler alloc] init];
+    scheduler.windowSize = 5;
+    scheduler.maxWindowsPerPeer = 1;
+    [scheduler enqueueBlockIds:blockIds];
+    [scheduler enqueueBlockIds:blockIds];
+    XCTAssertEqual(scheduler.numberOfPendingBlocks, headers.count);
+
+    // consecutive windows, bounded per peer
+    NSArray *window1 = [scheduler assignWindowToPeer:peer1 atTime:0.0];
+    NSArray *window2 = [scheduler assignWindowToPeer:peer2 atTime:0.0];
+    XCTAssertEqualObjects(window1, [blockIds subarrayWithRange:NSMakeRange(0, 5)]);
+    XCTAssertEqualObjects(window2, [blockIds subarrayWithRange:NSMakeRange(5, 5)]);
+    XCTAssertNil([scheduler assignWindowToPeer:peer1 atTime:0.0]);
+
+    // only assigned peer completes, blocks are dequeued in chain order
+    NSMutableArray *dequeuedIds = [[NSMutableArray alloc] init];
+    void (^handler)(WSFilteredBlock *, NSOrderedSet *, id) = ^(WSFilteredBlock *filteredBlock, NSOrderedSet *transactions, id peer) {
+        [dequeuedIds addObject:filteredBlock.header.blockId];
+    };
+    XCTAssertFalse([scheduler completeFilteredBlock:filteredBlocks[window2[0]] transactions:[NSOrderedSet orderedSet] fromPeer:peer1 atTime:1.0]);
+    for (WSHash256 *blockId in window2) {
+        XCTAssertTrue([scheduler completeFilteredBlock:filteredBlocks[blockId] transactions:[NSOrderedSet orderedSet] fromPeer:peer2 atTime:1.0]);
+    }
+    XCTAssertEqual([scheduler dequeueCompletedBlocksWithHandler:handler], 0);
+    XCTAssertEqual([scheduler numberOfWindowsForPeer:peer2], 0);
+
+    // stalled window is reassigned from its first block
+    XCTAssertEqualObjects([scheduler releaseWindowsIdleSince:0.5], [NSSet setWithObject:peer1]);
+    XCTAssertEqualObjects([scheduler assignWindowToPeer:peer2 atTime:2.0], window1);
+    for (WSHash256 *blockId in window1) {
+        XCTAssertTrue([scheduler completeFilteredBlock:filteredBlocks[blockId] transactions:[NSOrderedSet orderedSet] fromPeer:peer2 atTime:2.0]);
+    }
+    XCTAssertEqual([scheduler dequeueCompletedBlocksWithHandler:handler], 10);
+    XCTAssertEqualObjects(dequeuedIds, [blockIds subarrayWithRange:NSMakeRange(0, 10)]);
+    XCTAssertEqual(scheduler.numberOfPendingBlocks, headers.count - 10);
+
+    [scheduler reset];
+    XCTAssertEqual(scheduler.numberOfPendingBlocks, 0);
+    XCTAssertNil([scheduler assignWindowToPeer:peer1 atTime:3.0]);
+}
+
+#pragma mark Helpers
+
+- (NSArray *)chainedHeadersWithCount:(NSUInteger)count
+{
+    NSMutableArray *headers = [[NSMutableArray alloc] initWithCapacity:count];
+    WSHash256 *previousBlockId = [self.networkParameters genesisBlockId];
+    for (NSUInteger i = 0; i < count; ++i) {
+        WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                                  version:2
+                                                          previousBlockId:previousBlockId
+                                                               merkleRoot:WSHash256Compute([NSData dataWithBytes:&i length:sizeof(i)])
+                                                                timestamp:(uint32_t)(WSCurrentTimestamp() + i)
+                                                                     bits:[self.networkParameters maxProofOfWork]
+                                                                    nonce:0];
+        [headers addObject:header];
+        previousBlockId = header.blockId;
+    }
+    return headers;
+}
+
+@end
@@ -32,9 +32,23 @@
 #import "WSBlock.h"
 #import "WSFilteredBlock.h"
 #import "WSPartialMerkleTree.h"
+#import "WSBlockMatcher.h"
+#import "WSBloomFilter.h"
+#import "WSTransaction.h"
+#import "WSTransactionInput.h"
+#import "WSTransactionOutput.h"
+#import "WSTransactionOutPoint.h"
+#import "WSScript.h"
 #import "WSMessageFactory.h"
 #import "WSStorableBlock.h"
 #import "WSBlockMacros.h"
+#import "WSParameters.h"
+
+@interface WSBlockHeader ()
+
+- (WSHash256 *)computeBlockId;
+
+@end
 
 @interface WSStorableBlock ()
 
@@ -95,6 +109,21 @@
     XCTAssertEqualObjects(blockId, expBlockId);
 }
 
+- (void)testRawBlockHeader
+{
+    WSBlockHeader *header = WSBlockHeaderFromHex(self.networkParameters, @"020000005bd7027635cbcca125a156377643b86f6dd2b820a0741d39b4a7000000000000fca15af0cbaae20e8cd6d8c613ca058b291f793da7925db7e30b71db349479353f9cb5536431011b8818102d00");
+    WSBlockHeader *rawHeader = [[WSBlockHeader alloc] initWithParameters:self.networkParameters bytes:header.bytes blockId:nil];
+
+    XCTAssertEqualObjects(rawHeader, header);
+    XCTAssertEqualObjects(rawHeader.blockId, WSHash256FromHex(@"00000000000008ac05a77ab8a82ce8de160fc88307732282e43a47a3f8735fd8"));
+    XCTAssertEqualObjects(rawHeader.previousBlockId, WSHash256FromHex(@"000000000000a7b4391d74a020b8d26d6fb843763756a125a1cccb357602d75b"));
+    XCTAssertEqual(rawHeader.version, 2);
+    XCTAssertEqual(rawHeader.bits, 0x1b013164);
+    XCTAssertTrue([rawHeader hasPreviousBlockId:rawHeader.previousBlockId]);
+    XCTAssertFalse([rawHeader hasPreviousBlockId:rawHeader.blockId]);
+    XCTAssertEqualObjects([[rawHeader toBuffer] hexString], [[header toBuffer] hexString]);
+}
+
 - (void)testParseBlock
 {
     WSBlock *block = WSBlockFromHex(self.networkParameters, @"01000000c300ab8b147c7792994375e70c33168391cfd78db6a627926d0fb5a900000000da3f1c08e2d6ffe82fb99ffab4fc969ad014e7dabbd37cccc697cb573b39b939c9f2a749ffff001d0893788f0101000000010000000000000000000000000000000000000000000000000000000000000000ffffffff0704ffff001d0176ffffffff0100f2052a01000000434104c8808d044bc43f17bc8b1a0c332b082029d6e059d12f30b91df9dc844fc6651ad1527e0551b7fceaac302714e63de5677d7427344b958885373a0d82899054c5ac00000000");
@@ -151,6 +180,86 @@
     }
 }
 
+- (void)testBuildPartialMerkleTree
+{
+    NSMutableArray *txIds = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < 7; ++i) {
+        NSMutableData *data = [[NSMutableData alloc] initWithLength:WSHash256Length];
+        SecRandomCopyBytes(kSecRandomDefault, data.length, data.mutableBytes);
+        [txIds addObject:[[WSHash256 alloc] initWithData:data]];
+    }
+    
+    WSPartialMerkleTree *fullTree = [[WSPartialMerkleTree alloc] initWithTxIds:txIds matches:[NSIndexSet indexSetWithIndexesInRange:NSMakeRange(0, txIds.count)]];
+    WSPartialMerkleTree *emptyTree = [[WSPartialMerkleTree alloc] initWithTxIds:txIds matches:[NSIndexSet indexSet]];
+    XCTAssertEqualObjects(emptyTree.merkleRoot, fullTree.merkleRoot);
+    XCTAssertEqual(emptyTree.hashes.count, 1);
+    
+    NSMutableIndexSet *matches = [[NSMutableIndexSet alloc] init];
+    [matches addIndex:1];
+    [matches addIndex:4];
+    [matches addIndex:6];
+    WSPartialMerkleTree *tree = [[WSPartialMerkleTree alloc] initWithTxIds:txIds matches:matches];
+    XCTAssertEqualObjects(tree.merkleRoot, fullTree.merkleRoot);
+    for (NSUInteger i = 0; i < txIds.count; ++i) {
+        XCTAssertEqual([tree containsTransactionWithId:txIds[i]], [matches containsIndex:i], @"txId #%u", i);
+    }
+    
+    WSBuffer *buffer = [tree toBuffer];
+    NSError *error;
+    WSPartialMerkleTree *decodedTree = [[WSPartialMerkleTree alloc] initWithParameters:self.networkParameters buffer:buffer from:0 available:buffer.length error:&error];
+    XCTAssertNotNil(decodedTree, @"%@", error);
+    XCTAssertEqualObjects(decodedTree.merkleRoot, tree.merkleRoot);
+    XCTAssertEqualObjects(decodedTree.hashes, tree.hashes);
+}
+
+- (void)testBlockMatcher
+{
+    WSBlock *block = WSBlockFromHex(self.networkParameters, @"01000000c300ab8b147c7792994375e70c33168391cfd78db6a627926d0fb5a900000000da3f1c08e2d6ffe82fb99ffab4fc969ad014e7dabbd37cccc697cb573b39b939c9f2a749ffff001d0893788f0101000000010000000000000000000000000000000000000000000000000000000000000000ffffffff0704ffff001d0176ffffffff0100f2052a01000000434104c8808d044bc43f17bc8b1a0c332b082029d6e059d12f30b91df9dc844fc6651ad1527e0551b7fceaac302714e63de5677d7427344b958885373a0d82899054c5ac00000000");
+    WSSignedTransaction *coinbase = [block.transactions firstObject];
+    NSData *pubKeyData = [[[coinbase outputAtIndex:0].script.chunks firstObject] pushData];
+    
+    NSOrderedSet *transactions;
+    WSBlockMatcher *matcher = [[WSBlockMatcher alloc] initWithData:@[] flags:WSBIP37FlagsUpdateAll];
+    WSFilteredBlock *filteredBlock = [matcher filteredBlockWithBlock:block transactions:&transactions];
+    XCTAssertEqualObjects(filteredBlock.partialMerkleTree.merkleRoot, block.header.merkleRoot);
+    XCTAssertEqual(transactions.count, 0);
+    
+    matcher = [[WSBlockMatcher alloc] initWithData:@[pubKeyData] flags:WSBIP37FlagsUpdateAll];
+    filteredBlock = [matcher filteredBlockWithBlock:block transactions:&transactions];
+    XCTAssertEqualObjects(filteredBlock.partialMerkleTree.merkleRoot, block.header.merkleRoot);
+    XCTAssertEqualObjects(transactions, [NSOrderedSet orderedSetWithObject:coinbase]);
+    XCTAssertTrue([filteredBlock containsTransactionWithId:coinbase.txId]);
+    
+    // spends matched output
+    WSScriptBuilder *builder = [[WSScriptBuilder alloc] init];
+    [builder appendOpcode:WSScriptOpcode_OP_RETURN];
+    WSTransactionOutPoint *outpoint = [WSTransactionOutPoint outpointWithParameters:self.networkParameters txId:coinbase.txId index:0];
+    WSSignedTransactionInput *input = [[WSSignedTransactionInput alloc] initWithOutpoint:outpoint script:[builder build]];
+    WSTransactionOutput *output = [[WSTransactionOutput alloc] initWithParameters:self.networkParameters script:[builder build] value:1000];
+    WSSignedTransaction *spending = [[WSSignedTransaction alloc] initWithSignedInputs:[NSOrderedSet orderedSetWithObject:input]
+                                                                              outputs:[NSOrderedSet orderedSetWithObject:output]
+                                                                                error:NULL];
+    XCTAssertTrue([matcher matchTransaction:spending]);
+    
+    WSBlockMatcher *staticMatcher = [[WSBlockMatcher alloc] initWithData:@[pubKeyData] flags:WSBIP37FlagsUpdateNone];
+    XCTAssertTrue([staticMatcher matchTransaction:coinbase]);
+    XCTAssertFalse([staticMatcher matchTransaction:spending]);
+    
+    // coinbase output is P2PK
+    WSBlockMatcher *pubKeyMatcher = [[WSBlockMatcher alloc] initWithData:@[pubKeyData] flags:WSBIP37FlagsUpdateP2PubKeyOnly];
+    XCTAssertTrue([pubKeyMatcher matchTransaction:coinbase]);
+    XCTAssertTrue([pubKeyMatcher matchTransaction:spending]);
+    
+    WSBIP37FilterParameters *parameters = [[WSBIP37FilterParameters alloc] init];
+    parameters.flags = WSBIP37FlagsUpdateAll;
+    WSMutableBloomFilter *bloomFilter = [[WSMutableBloomFilter alloc] initWithParameters:parameters capacity:10];
+    [bloomFilter insertData:pubKeyData];
+    WSBlockMatcher *bloomMatcher = [[WSBlockMatcher alloc] initWithBloomFilter:bloomFilter];
+    XCTAssertTrue([bloomMatcher matchTransaction:coinbase]);
+    XCTAssertTrue([bloomMatcher matchTransaction:spending]);
+    XCTAssertFalse([bloomFilter containsUnspent:outpoint]);
+}
+
 - (void)testVerifyBlockHeaders
 {
     NSArray *headers = @[@"0100000043497fd7f826957108f4a30fd9cec3aeba79972084e90ead01ea330900000000bac8b0fa927c0ac8234287e33c5f74d38d354820e24756ad709d7038fc5f31f020e7494dffff001d03e4b67200",
@@ -186,6 +295,38 @@
     }
 }
 
+- (void)testVerifyBlockHeadersBatch
+{
+    NSArray *hexes = @[@"0100000043497fd7f826957108f4a30fd9cec3aeba79972084e90ead01ea330900000000bac8b0fa927c0ac8234287e33c5f74d38d354820e24756ad709d7038fc5f31f020e7494dffff001d03e4b67200",
+                       @"0100000006128e87be8b1b4dea47a7247d5528d2702c96826c7a648497e773b800000000e241352e3bec0a95a6217e10c3abb54adfa05abb12c126695595580fb92e222032e7494dffff001d00d2353400",
+                       @"0100000020782a005255b657696ea057d5b98f34defcf75196f64f6eeac8026c0000000041ba5afc532aae03151b8aa87b65e1594f97504a768e010c98c0add79216247186e7494dffff001d058dc2b600"];
+
+    NSMutableArray *headers = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < 2000; ++i) {
+        [headers addObject:WSBlockHeaderFromHex(self.networkParameters, hexes[i % hexes.count])];
+    }
+
+    NSError *error;
+    XCTAssertEqual([WSBlockHeader verifyHeaders:headers error:&error], NSNotFound);
+    XCTAssertNil(error);
+
+    // invalid nonce breaks proof-of-work, lowest index must win over later chunks
+    WSBlockHeader *valid = headers[0];
+    WSBlockHeader *invalid = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                               version:valid.version
+                                                       previousBlockId:valid.previousBlockId
+                                                            merkleRoot:valid.merkleRoot
+                                                             timestamp:valid.timestamp
+                                                                  bits:valid.bits
+                                                                 nonce:(valid.nonce + 1)];
+    headers[1800] = invalid;
+    headers[1234] = invalid;
+    headers[1500] = invalid;
+
+    XCTAssertEqual([WSBlockHeader verifyHeaders:headers error:&error], 1234);
+    XCTAssertEqual(error.code, WSErrorCodeInvalidBlock);
+}
+
 - (void)testVerifyFilteredBlocks
 {
     NSArray *blocks = @[@"020000005bd7027635cbcca125a156377643b86f6dd2b820a0741d39b4a7000000000000fca15af0cbaae20e8cd6d8c613ca058b291f793da7925db7e30b71db349479353f9cb5536431011b8818102d12000000120763f91fe0bb2d89c0284588556f466123a1fb76cf591d7aa196115a1ed0cafa1fe750aeb68a59570d7be7f0b8f62698d6242b84db50bf6e314d10ca624789dd9a628ae55f7b1f7c652b99259503705b106c7cbe300e0a77054be720caec243668ff80caa26851ea1170462bf96e91e0bbe23da9949e1b0520e20983aca3406167febc07e28ca2163b9243f6878c53ceeeb71d18528f40bbc19c03dfd194e77f523e3d286d0856d951992ca24970abc98cd0b5a61bffe472583ecc60f06c3c033034b6b8b9d215df13bd46fcd8f26a3a12300a8f0213676ecd27ec8a51ecb18eeca10647a8a0c5466f5ac0d65623b7783eb83095379a15d99c7a86867fb951c098f8fbef7589f8bb9b09f290547af41eabb511037023359e8877a37574034c11b3f0acc28f3b97ecd78f3d9d3e96919a90d3067018fe981c10a0bb0148ddef696d74fa51489b4b1a3e03c0a888a71171b8c4936169ece50c71e7444281b305a92a2011c92a479b505340e1cdc48a0854536db8f2937a55a7cf07d2f59f26f6d3ed175b94b22798a73b723109901a30a94ad261c63a928acb8ca17a8019992515c074d1dfa3bd43935a1274b00c4d12fd87ee2ff0608d58d581e4e729af530b021808b863656bf47ece10a6c4f6a5a4173737a5cd113580d2f7e13bcd14201bea62b08a42110fb85b4e0e7116179b482a706edd4a8e975fe9b6df39931cc55ae6221d7cfc745b8d4234279fc7f3dc057f03b0ef29f942e929b9f52f28267f77fd98713c3f05a0de8922d1392ce26f60239865a38a8c94e5e4e7eb90a51245dc7a05ffffffff3f",
@@ -208,6 +349,34 @@
     }
 }
 
+- (void)testCheckpoints
+{
+    self.networkType = WSNetworkTypeMain;
+
+    WSStorableBlock *checkpoint = [self.networkParameters checkpointAtHeight:40320];
+    XCTAssertEqual(checkpoint.height, 40320);
+    XCTAssertEqualObjects(checkpoint.blockId, WSHash256FromHex(@"0000000045861e169b5a961b7034f8de9e98022e7a39100dde3ae3ea240d7245"));
+    XCTAssertEqualObjects(checkpoint.header.blockId, [checkpoint.header computeBlockId]);
+    XCTAssertNil([self.networkParameters checkpointAtHeight:40321]);
+    XCTAssertNil([self.networkParameters checkpointAtHeight:0]);
+
+    XCTAssertEqual([self.networkParameters lastCheckpointBeforeTimestamp:1266191579].height, 40320);
+    XCTAssertEqual([self.networkParameters lastCheckpointBeforeTimestamp:1266191578].height, 20160);
+    XCTAssertEqual([self.networkParameters lastCheckpointBeforeTimestamp:0].height, 0);
+    XCTAssertEqual([self.networkParameters lastCheckpointBeforeTimestamp:UINT32_MAX].height, [[self.networkParameters checkpoints].lastObject height]);
+
+    // table round trip
+    NSArray *checkpoints = [self.networkParameters checkpoints];
+    WSMutableParameters *parameters = [[WSMutableParameters alloc] initWithNetworkType:WSNetworkTypeMain];
+    NSData *table = WSCheckpointsTableFromBlocks(checkpoints);
+    [parameters loadCheckpointsFromTable:table.bytes length:table.length];
+    for (WSStorableBlock *cp in checkpoints) {
+        WSStorableBlock *loadedCp = [parameters checkpointAtHeight:cp.height];
+        XCTAssertEqualObjects(loadedCp.blockId, cp.blockId);
+        XCTAssertEqualObjects(loadedCp.workString, cp.workString);
+    }
+}
+
 - (void)testMaxHash
 {
     BIGNUM target;
@@ -223,19 +392,56 @@
 
 - (void)testCompactMaxTarget
 {
-    BIGNUM target;
+    WSUInt256 target;
     NSString *expHex = @"00000000ffff0000000000000000000000000000000000000000000000000000";
     const uint32_t expBits = 0x1d00ffff;
     
-    BN_init(&target);
-
-    BN_bin2bn([expHex dataFromHex].bytes, 32, &target);
+    WSBlockWorkFromData(&target, [expHex dataFromHex]);
     const uint32_t bits = WSBlockGetBits(&target);
     DDLogInfo(@"Bits    : %x", bits);
     DDLogInfo(@"Expected: %x", expBits);
     XCTAssertEqual(bits, expBits);
 
-    BN_free(&target);
+    WSUInt256 expTarget;
+    XCTAssertTrue(WSBlockSetBits(&expTarget, expBits));
+    XCTAssertEqual(WSUInt256Compare(&target, &expTarget), 0);
+    XCTAssertEqualObjects([WSBlockDataFromWork(&target) hexString], @"ffff0000000000000000000000000000000000000000000000000000");
+}
+
+- (void)testCompactInvalid
+{
+    WSUInt256 target;
+
+    XCTAssertFalse(WSBlockSetBits(&target, 0x04923456)); // negative
+    XCTAssertFalse(WSBlockSetBits(&target, 0xff123456)); // overflow
+    XCTAssertTrue(WSBlockSetBits(&target, 0x01803456));  // zero, sign bit shifted out
+    XCTAssertTrue(WSUInt256IsZero(&target));
+}
+
+- (void)testWork
+{
+    WSUInt256 work;
+
+    WSBlockGetWorkFromBits(&work, 0x1d00ffff);
+    XCTAssertEqualObjects(WSUInt256GetDecimalString(&work), @"4295032833");
+
+    // cached
+    WSBlockGetWorkFromBits(&work, 0x1d00ffff);
+    XCTAssertEqualObjects(WSUInt256GetDecimalString(&work), @"4295032833");
+
+    // block #310261
+    WSBlockGetWorkFromBits(&work, 406937553);
+    XCTAssertEqualObjects(WSUInt256GetDecimalString(&work), @"72235843789679429742");
+
+    WSUInt256 sum;
+    WSUInt256Add(&sum, &work, &work);
+    XCTAssertEqualObjects(WSUInt256GetDecimalString(&sum), @"144471687579358859484");
+    XCTAssertEqual(WSUInt256Compare(&sum, &work), 1);
+    XCTAssertEqual(WSUInt256Compare(&work, &sum), -1);
+
+    WSUInt256 decoded;
+    WSBlockWorkFromData(&decoded, WSBlockDataFromWork(&sum));
+    XCTAssertEqual(WSUInt256Compare(&decoded, &sum), 0);
 }
 
 - (void)testDifficulty
@@ -0,0 +1,67 @@
+//
+//  WSBloomFilterSimulator.h
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import <Foundation/Foundation.h>
+
+@class WSBloomFilterTuner;
+
+#pragma mark -
+
+@interface WSBloomFilterBlockRecord : NSObject
+
++ (instancetype)recordWithTxCount:(NSUInteger)txCount relevantTxCount:(NSUInteger)relevantTxCount txBytes:(NSUInteger)txBytes;
+- (NSUInteger)txCount;
+- (NSUInteger)relevantTxCount;
+- (NSUInteger)txBytes;
+
+@end
+
+#pragma mark -
+
+//
+// replays recorded blocks offline and counts the bytes a filtering policy
+// would transfer (filters loaded on peers plus matched transactions)
+//
+// false positives are deterministic, i.e. expected count carried over blocks
+//
+@interface WSBloomFilterSimulator : NSObject
+
+@property (nonatomic, assign) double falsePositiveMultiplier; // 1.0, actual / nominal rate of loaded filters
+
+// one block per line: txCount,relevantTxCount,txBytes ('#' for comments)
++ (NSArray *)recordsWithContentsOfFile:(NSString *)path error:(NSError **)error;
+
+- (instancetype)initWithRecords:(NSArray *)records elements:(NSUInteger)elements peers:(NSUInteger)peers; // WSBloomFilterBlockRecord
+- (NSArray *)records;
+- (NSUInteger)elements;
+- (NSUInteger)peers;
+
+- (uint64_t)totalBytesWithFalsePositiveRate:(double)falsePositiveRate;
+- (uint64_t)totalBytesWithTuner:(WSBloomFilterTuner *)tuner;
+- (NSUInteger)numberOfResets; // last simulation
+
+@end
@@ -0,0 +1,194 @@
+//
+//  WSBloomFilterSimulator.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "WSBloomFilterSimulator.h"
+#import "WSBloomFilterTuner.h"
+#import "WSMacros.h"
+#import "WSErrors.h"
+
+@interface WSBloomFilterBlockRecord ()
+
+@property (nonatomic, assign) NSUInteger txCount;
+@property (nonatomic, assign) NSUInteger relevantTxCount;
+@property (nonatomic, assign) NSUInteger txBytes;
+
+@end
+
+@implementation WSBloomFilterBlockRecord
+
++ (instancetype)recordWithTxCount:(NSUInteger)txCount relevantTxCount:(NSUInteger)relevantTxCount txBytes:(NSUInteger)txBytes
+{
+    WSExceptionCheckIllegal(txCount > 0, @"Non-positive txCount");
+    WSExceptionCheckIllegal(relevantTxCount <= txCount, @"More relevant than total transactions (%u > %u)", relevantTxCount, txCount);
+    
+    WSBloomFilterBlockRecord *record = [[self alloc] init];
+    record.txCount = txCount;
+    record.relevantTxCount = relevantTxCount;
+    record.txBytes = txBytes;
+    return record;
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"{txCount=%u, relevantTxCount=%u, txBytes=%u}", self.txCount, self.relevantTxCount, self.txBytes];
+}
+
+@end
+
+#pragma mark -
+
+@interface WSBloomFilterSimulator ()
+
+@property (nonatomic, strong) NSArray *records;
+@property (nonatomic, assign) NSUInteger elements;
+@property (nonatomic, assign) NSUInteger peers;
+@property (nonatomic, assign) NSUInteger numberOfResets;
+
+- (uint64_t)totalBytesWithTuner:(WSBloomFilterTuner *)tuner falsePositiveRate:(double)falsePositiveRate;
+
+@end
+
+@implementation WSBloomFilterSimulator
+
++ (NSArray *)recordsWithContentsOfFile:(NSString *)path error:(NSError *__autoreleasing *)error
+{
+    WSExceptionCheckIllegal(path != nil, @"Nil path");
+    
+    NSString *contents = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:error];
+    if (!contents) {
+        return nil;
+    }
+    
+    NSMutableArray *records = [[NSMutableArray alloc] init];
+    NSUInteger lineNumber = 0;
+    for (NSString *line in [contents componentsSeparatedByCharactersInSet:[NSCharacterSet newlineCharacterSet]]) {
+        ++lineNumber;
+
+        NSString *trimmedLine = [line stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if ((trimmedLine.length == 0) || [trimmedLine hasPrefix:@"#"]) {
+            continue;
+        }
+        
+        NSArray *fields = [trimmedLine componentsSeparatedByString:@","];
+        if (fields.count != 3) {
+            WSErrorSet(error, WSErrorCodeMalformed, @"Expected 3 fields at line %u (%u)", lineNumber, fields.count);
+            return nil;
+        }
+        
+        const NSInteger txCount = [fields[0] integerValue];
+        const NSInteger relevantTxCount = [fields[1] integerValue];
+        const NSInteger txBytes = [fields[2] integerValue];
+        if ((txCount <= 0) || (relevantTxCount < 0) || (relevantTxCount > txCount) || (txBytes < 0)) {
+            WSErrorSet(error, WSErrorCodeMalformed, @"Inconsistent block record at line %u: %@", lineNumber, trimmedLine);
+            return nil;
+        }
+
+        [records addObject:[WSBloomFilterBlockRecord recordWithTxCount:txCount relevantTxCount:relevantTxCount txBytes:txBytes]];
+    }
+    return records;
+}
+
+- (instancetype)init
+{
+    WSExceptionRaiseUnsupported(@"Use initWithRecords:elements:peers:");
+    return nil;
+}
+
+- (instancetype)initWithRecords:(NSArray *)records elements:(NSUInteger)elements peers:(NSUInteger)peers
+{
+    WSExceptionCheckIllegal(records.count > 0, @"Empty records");
+    WSExceptionCheckIllegal(peers > 0, @"Non-positive peers");
+    
+    if ((self = [super init])) {
+        self.records = records;
+        self.elements = elements;
+        self.peers = peers;
+        self.falsePositiveMultiplier = 1.0;
+    }
+    return self;
+}
+
+- (uint64_t)totalBytesWithFalsePositiveRate:(double)falsePositiveRate
+{
+    return [self totalBytesWithTuner:nil falsePositiveRate:falsePositiveRate];
+}
+
+- (uint64_t)totalBytesWithTuner:(WSBloomFilterTuner *)tuner
+{
+    WSExceptionCheckIllegal(tuner != nil, @"Nil tuner");
+    
+    return [self totalBytesWithTuner:tuner falsePositiveRate:0.0];
+}
+
+#pragma mark Helpers
+
+// fixed rate if tuner is nil
+- (uint64_t)totalBytesWithTuner:(WSBloomFilterTuner *)tuner falsePositiveRate:(double)falsePositiveRate
+{
+    const NSUInteger count = self.records.count;
+    double rate = falsePositiveRate;
+    if (tuner) {
+        rate = [tuner falsePositiveRateForElements:self.elements blocksLeft:count peers:self.peers];
+        [tuner resetWithElements:self.elements falsePositiveRate:rate];
+    }
+
+    uint64_t totalBytes = [WSBloomFilterTuner filterSizeForElements:self.elements falsePositiveRate:rate] * self.peers;
+    double falsePositivesCarry = 0.0;
+    self.numberOfResets = 0;
+
+    NSUInteger i = 0;
+    for (WSBloomFilterBlockRecord *record in self.records) {
+        const NSUInteger irrelevantTxCount = record.txCount - record.relevantTxCount;
+
+        falsePositivesCarry += MIN(rate * self.falsePositiveMultiplier, 1.0) * irrelevantTxCount;
+        const NSUInteger falsePositives = MIN((NSUInteger)falsePositivesCarry, irrelevantTxCount);
+        falsePositivesCarry -= falsePositives;
+
+        const NSUInteger matchedTxCount = record.relevantTxCount + falsePositives;
+        const NSUInteger matchedBytes = (NSUInteger)((double)record.txBytes * matchedTxCount / record.txCount);
+        totalBytes += matchedBytes;
+        ++i;
+
+        if (!tuner) {
+            continue;
+        }
+
+        [tuner addBlockWithTxCount:record.txCount matchedTxCount:matchedTxCount relevantTxCount:record.relevantTxCount matchedBytes:matchedBytes];
+
+        const NSUInteger blocksLeft = count - i;
+        if ([tuner shouldResetWithBlocksLeft:blocksLeft peers:self.peers]) {
+            rate = [tuner falsePositiveRateForElements:self.elements blocksLeft:blocksLeft peers:self.peers];
+            [tuner resetWithElements:self.elements falsePositiveRate:rate];
+
+            totalBytes += [WSBloomFilterTuner filterSizeForElements:self.elements falsePositiveRate:rate] * self.peers;
+            ++self.numberOfResets;
+        }
+    }
+    return totalBytes;
+}
+
+@end
@@ -0,0 +1,294 @@
+//
+//  WSFileBlockStoreTests.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "XCTestCase+WaSPV.h"
+#import "WSFileBlockStore.h"
+#import "WSStorableBlock.h"
+#import "WSBlockHeader.h"
+#import "WSHash256.h"
+
+@interface WSFileBlockStoreTests : XCTestCase
+
+@property (nonatomic, strong) NSString *path;
+
+- (WSFileBlockStore *)openStore;
+- (NSArray *)mockBlocksFromBlock:(WSStorableBlock *)block count:(NSUInteger)count nonce:(uint32_t)nonce;
+- (void)store:(WSFileBlockStore *)store appendBlocks:(NSArray *)blocks;
+
+@end
+
+@implementation WSFileBlockStoreTests
+
+- (void)setUp
+{
+    [super setUp];
+
+    self.networkType = WSNetworkTypeTestnet3;
+    self.path = [self mockPathForFile:@"FileBlockStoreTests.headers"];
+
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:NULL];
+    [[NSFileManager defaultManager] removeItemAtPath:[self.path stringByAppendingPathExtension:@"index"] error:NULL];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+- (void)testGenesis
+{
+    WSFileBlockStore *store = [self openStore];
+
+    XCTAssertEqualObjects(store.head.blockId, [self.networkParameters genesisBlockId]);
+    XCTAssertEqualObjects([store blockAtHeight:0].blockId, [self.networkParameters genesisBlockId]);
+    XCTAssertEqual(store.size, 1);
+}
+
+- (void)testReload
+{
+    WSFileBlockStore *store = [self openStore];
+    NSArray *blocks = [self mockBlocksFromBlock:store.head count:20 nonce:0];
+    [self store:store appendBlocks:blocks];
+
+    WSStorableBlock *head = blocks.lastObject;
+    XCTAssertEqual(store.head.height, 20);
+
+    store = nil;
+    store = [self openStore];
+
+    XCTAssertEqual(store.size, 21);
+    XCTAssertEqualObjects(store.head.blockId, head.blockId);
+    XCTAssertEqualObjects(store.head.workString, head.workString);
+    XCTAssertEqual(store.head.height, 20);
+
+    WSStorableBlock *block = [store blockAtHeight:5];
+    XCTAssertEqualObjects(block.blockId, [blocks[4] blockId]);
+    XCTAssertEqualObjects([store blockForId:block.blockId], block);
+    XCTAssertEqual([store blockForId:block.blockId].height, 5);
+    XCTAssertNil([store blockAtHeight:21]);
+    XCTAssertNil([store blockForId:WSHash256Zero()]);
+}
+
+- (void)testReplaceHead
+{
+    WSFileBlockStore *store = [self openStore];
+    [self store:store appendBlocks:[self mockBlocksFromBlock:store.head count:5 nonce:0]];
+    XCTAssertNil([store blockForId:store.head.blockId].transactions);
+
+    WSStorableBlock *head = [[WSStorableBlock alloc] initWithHeader:store.head.header
+                                                      transactions:[[NSOrderedSet alloc] init]
+                                                            height:store.head.height
+                                                              work:store.head.workData];
+    [store putBlock:head];
+
+    XCTAssertNotNil(store.head.transactions);
+    XCTAssertNotNil([store blockForId:head.blockId].transactions);
+}
+
+- (void)testReorganize
+{
+    WSFileBlockStore *store = [self openStore];
+    NSArray *mainBlocks = [self mockBlocksFromBlock:store.head count:10 nonce:0];
+    [self store:store appendBlocks:mainBlocks];
+
+    // fork at #5
+    NSArray *forkBlocks = [self mockBlocksFromBlock:mainBlocks[4] count:8 nonce:1];
+    for (WSStorableBlock *block in forkBlocks) {
+        [store putBlock:block];
+    }
+    XCTAssertEqual(store.size, 11 + 8);
+    XCTAssertEqualObjects(store.head.blockId, [mainBlocks.lastObject blockId]);
+
+    [store setHead:forkBlocks.lastObject];
+    XCTAssertEqual(store.head.height, 13);
+    XCTAssertEqualObjects([store blockAtHeight:5].blockId, [mainBlocks[4] blockId]);
+    XCTAssertEqualObjects([store blockAtHeight:6].blockId, [forkBlocks[0] blockId]);
+    XCTAssertNil([store blockAtHeight:14]);
+
+    // old branch is now a fork
+    XCTAssertEqual(store.size, 14 + 5);
+    XCTAssertEqual([store blockForId:[mainBlocks.lastObject blockId]].height, 10);
+
+    // forks are not persisted
+    store = nil;
+    store = [self openStore];
+    XCTAssertEqual(store.size, 14);
+    XCTAssertEqualObjects(store.head.blockId, [forkBlocks.lastObject blockId]);
+    XCTAssertEqualObjects([store blockAtHeight:6].blockId, [forkBlocks[0] blockId]);
+    XCTAssertNil([store blockForId:[mainBlocks.lastObject blockId]]);
+}
+
+- (void)testDisconnectedHead
+{
+    WSFileBlockStore *store = [self openStore];
+    [self store:store appendBlocks:[self mockBlocksFromBlock:store.head count:10 nonce:0]];
+
+    // e.g. a checkpoint
+    WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                              version:2
+                                                      previousBlockId:WSHash256Zero()
+                                                           merkleRoot:WSHash256Zero()
+                                                            timestamp:[self.networkParameters genesisBlock].header.timestamp
+                                                                 bits:[self.networkParameters genesisBlock].header.bits
+                                                                nonce:0];
+    WSStorableBlock *checkpoint = [[WSStorableBlock alloc] initWithHeader:header transactions:nil height:100];
+    [store putBlock:checkpoint];
+    [store setHead:checkpoint];
+
+    // old chain is not kept as a fork
+    XCTAssertEqual(store.size, 1);
+    XCTAssertEqualObjects(store.head.blockId, checkpoint.blockId);
+    XCTAssertEqualObjects([store blockAtHeight:100].blockId, checkpoint.blockId);
+    XCTAssertNil([store blockAtHeight:5]);
+}
+
+- (void)testPartialRecord
+{
+    WSFileBlockStore *store = [self openStore];
+    NSArray *blocks = [self mockBlocksFromBlock:store.head count:10 nonce:0];
+    [self store:store appendBlocks:blocks];
+    store = nil;
+
+    // e.g. crash while appending
+    NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:self.path];
+    [handle seekToEndOfFile];
+    [handle writeData:[[NSMutableData alloc] initWithLength:50]];
+    [handle closeFile];
+
+    store = [self openStore];
+    XCTAssertEqual(store.size, 11);
+    XCTAssertEqualObjects(store.head.blockId, [blocks.lastObject blockId]);
+
+    // appends right after the last whole record
+    NSArray *moreBlocks = [self mockBlocksFromBlock:store.head count:5 nonce:0];
+    [self store:store appendBlocks:moreBlocks];
+    store = nil;
+
+    store = [self openStore];
+    XCTAssertEqual(store.size, 16);
+    XCTAssertEqualObjects([store blockAtHeight:11].blockId, [moreBlocks.firstObject blockId]);
+    XCTAssertEqualObjects(store.head.blockId, [moreBlocks.lastObject blockId]);
+}
+
+- (void)testTrim
+{
+    WSFileBlockStore *store = [self openStore];
+    [self store:store appendBlocks:[self mockBlocksFromBlock:store.head count:20 nonce:0]];
+    while (store.size > 5) {
+        [store removeTailBlock];
+    }
+    XCTAssertEqual(store.size, 5);
+    XCTAssertNil([store blockAtHeight:15]);
+    XCTAssertNotNil([store blockAtHeight:16]);
+
+    store = nil;
+    store = [self openStore];
+    XCTAssertEqual(store.size, 5);
+    XCTAssertEqual(store.head.height, 20);
+}
+
+- (void)testCompaction
+{
+    const NSUInteger liveCount = 10;
+    const NSUInteger recordLength = 148;
+
+    WSFileBlockStore *store = [self openStore];
+    NSArray *blocks = [self mockBlocksFromBlock:store.head count:(2 * 4096 + liveCount) nonce:0];
+    [self store:store appendBlocks:blocks];
+
+    // compaction kicks in once trimmed records outnumber live ones
+    while (store.size > liveCount) {
+        [store removeTailBlock];
+    }
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:self.path error:NULL];
+    XCTAssertLessThan([attributes fileSize], blocks.count * recordLength);
+
+    WSStorableBlock *head = blocks.lastObject;
+    WSStorableBlock *tail = blocks[blocks.count - liveCount];
+    XCTAssertEqualObjects(store.head.blockId, head.blockId);
+    XCTAssertEqualObjects([store blockAtHeight:tail.height].blockId, tail.blockId);
+    XCTAssertEqualObjects([store blockForId:tail.blockId].blockId, tail.blockId);
+    XCTAssertNil([store blockAtHeight:(tail.height - 1)]);
+
+    store = nil;
+    store = [self openStore];
+    XCTAssertEqual(store.size, liveCount);
+    XCTAssertEqualObjects(store.head.blockId, head.blockId);
+    XCTAssertEqual([store blockForId:tail.blockId].height, tail.height);
+    XCTAssertNil([store blockForId:[blocks.firstObject blockId]]);
+}
+
+- (void)testTruncate
+{
+    WSFileBlockStore *store = [self openStore];
+    [self store:store appendBlocks:[self mockBlocksFromBlock:store.head count:20 nonce:0]];
+    [store truncate];
+
+    XCTAssertEqual(store.size, 1);
+    XCTAssertEqualObjects(store.head.blockId, [self.networkParameters genesisBlockId]);
+}
+
+#pragma mark Helpers
+
+- (WSFileBlockStore *)openStore
+{
+    NSError *error;
+    WSFileBlockStore *store = [[WSFileBlockStore alloc] initWithParameters:self.networkParameters path:self.path error:&error];
+    XCTAssertNotNil(store, @"Unable to open store: %@", error);
+    return store;
+}
+
+// proof-of-work is not verified by the store
+- (NSArray *)mockBlocksFromBlock:(WSStorableBlock *)block count:(NSUInteger)count nonce:(uint32_t)nonce
+{
+    NSMutableArray *blocks = [[NSMutableArray alloc] initWithCapacity:count];
+    WSStorableBlock *previousBlock = block;
+    for (NSUInteger i = 0; i < count; ++i) {
+        WSBlockHeader *header = [[WSBlockHeader alloc] initWithParameters:self.networkParameters
+                                                                  version:2
+                                                          previousBlockId:previousBlock.blockId
+                                                               merkleRoot:WSHash256Zero()
+                                                                timestamp:(previousBlock.header.timestamp + 600)
+                                                                     bits:previousBlock.header.bits
+                                                                    nonce:nonce];
+
+        previousBlock = [previousBlock buildNextBlockFromHeader:header transactions:nil];
+        [blocks addObject:previousBlock];
+    }
+    return blocks;
+}
+
+// same as WSBlockChain
+- (void)store:(WSFileBlockStore *)store appendBlocks:(NSArray *)blocks
+{
+    for (WSStorableBlock *block in blocks) {
+        [store putBlock:block];
+        [store setHead:block];
+    }
+}
+
+@end
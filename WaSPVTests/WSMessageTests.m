@@ -34,6 +34,7 @@
 #import "WSBlockLocator.h"
 #import "WSPeer.h"
 #import "WSProtocolDeserializer.h"
+#import "WSInventory.h"
 
 @interface WSMessageTests : XCTestCase
 
@@ -91,27 +92,139 @@
         [data appendData:d];
     }
 
-    NSInputStream *streamFull = [[NSInputStream alloc] initWithData:data];
-    [streamFull open];
-    
-    id<WSMessage> messageFull = [deserializer parseMessageFromStream:streamFull error:&error];
+    [deserializer appendBytes:data.bytes length:data.length];
+    id<WSMessage> messageFull = [deserializer parseMessageWithError:&error];
     XCTAssertNotNil(messageFull);
     DDLogInfo(@"Message (full, %u bytes): %@", messageFull.length, messageFull);
     XCTAssertNil(error, @"Error: %@", error);
 
-//    id<WSMessage> messagePartial = nil;
-//    [deserializer resetBuffers];
-//    while (!messagePartial) {
-//        [deserializer appendData:data];
-//        messagePartial = [deserializer parseMessageWithError:&error];
-//        
-//        if (messagePartial) {
-//            DDLogInfo(@"Message (parts): %@", messagePartial);
-//        }
-//        XCTAssertNil(error, @"Error: %@", error);
-//    }
-//
-//    XCTAssertEqualObjects([messageFull toBuffer], [messagePartial toBuffer]);
+    id<WSMessage> messagePartial = nil;
+    [deserializer resetBuffers];
+    for (NSData *d in parts) {
+        XCTAssertNil(messagePartial);
+        [deserializer appendBytes:d.bytes length:d.length];
+        messagePartial = [deserializer parseMessageWithError:&error];
+        XCTAssertNil(error, @"Error: %@", error);
+        if (messagePartial) {
+            DDLogInfo(@"Message (parts): %@", messagePartial);
+            break;
+        }
+    }
+
+    XCTAssertNotNil(messagePartial);
+    XCTAssertEqualObjects(messagePartial.messageType, messageFull.messageType);
+}
+
+- (void)testDeserializerStream
+{
+    WSProtocolDeserializer *deserializer = [[WSProtocolDeserializer alloc] initWithParameters:self.networkParameters host:@"0.0.0.0" port:10000];
+
+    NSMutableArray *inventories = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < 200; ++i) {
+        const uint32_t n = (uint32_t)i;
+        WSHash256 *hash = WSHash256Compute([NSData dataWithBytes:&n length:sizeof(n)]);
+        [inventories addObject:[[WSInventory alloc] initWithType:WSInventoryTypeTx hash:hash]];
+    }
+    WSMessagePing *ping = [WSMessagePing messageWithParameters:self.networkParameters];
+    WSMessageInv *inv = [WSMessageInv messageWithParameters:self.networkParameters inventories:inventories];
+
+    // garbage, then a small message and a large (borrowed) one
+    NSMutableData *data = [[@"deadbeef0b11" dataFromHex] mutableCopy];
+    [data appendData:[ping toNetworkBufferWithHeaderLength:NULL].data];
+    [data appendData:[inv toNetworkBufferWithHeaderLength:NULL].data];
+
+    NSMutableArray *messages = [[NSMutableArray alloc] init];
+    const NSUInteger partLength = 1000;
+    for (NSUInteger offset = 0; offset < data.length; offset += partLength) {
+        const NSUInteger length = MIN(partLength, data.length - offset);
+        [deserializer appendBytes:((const uint8_t *)data.bytes + offset) length:length];
+
+        NSError *error;
+        id<WSMessage> message;
+        while ((message = [deserializer parseMessageWithError:&error])) {
+            [messages addObject:message];
+        }
+        XCTAssertNil(error, @"Error: %@", error);
+    }
+
+    XCTAssertEqual(messages.count, 2);
+    XCTAssertEqualObjects([messages[0] messageType], ping.messageType);
+    XCTAssertEqual([messages[0] nonce], ping.nonce);
+
+    NSArray *parsedInventories = [messages[1] inventories];
+    XCTAssertEqual(parsedInventories.count, inventories.count);
+    for (NSUInteger i = 0; i < inventories.count; ++i) {
+        XCTAssertEqualObjects([parsedInventories[i] inventoryHash], [inventories[i] inventoryHash]);
+    }
+}
+
+- (void)testDeserializerChunkReuse
+{
+    WSProtocolDeserializer *deserializer = [[WSProtocolDeserializer alloc] initWithParameters:self.networkParameters host:@"0.0.0.0" port:10000];
+
+    NSMutableArray *inventories = [[NSMutableArray alloc] init];
+    for (NSUInteger i = 0; i < 200; ++i) {
+        const uint32_t n = (uint32_t)i;
+        WSHash256 *hash = WSHash256Compute([NSData dataWithBytes:&n length:sizeof(n)]);
+        [inventories addObject:[[WSInventory alloc] initWithType:WSInventoryTypeTx hash:hash]];
+    }
+    NSData *data = [[WSMessageInv messageWithParameters:self.networkParameters inventories:inventories] toNetworkBufferWithHeaderLength:NULL].data;
+
+    // stream several chunks worth of borrowed payloads, only the first message outlives its read
+    id<WSMessage> firstMessage = nil;
+    NSUInteger count = 0;
+    for (NSUInteger i = 0; i < 100; ++i) {
+        @autoreleasepool {
+            [deserializer appendBytes:data.bytes length:data.length];
+
+            NSError *error;
+            id<WSMessage> message = [deserializer parseMessageWithError:&error];
+            XCTAssertNotNil(message, @"Error: %@", error);
+            XCTAssertEqualObjects([[message inventories].lastObject inventoryHash], [inventories.lastObject inventoryHash]);
+            if (!firstMessage) {
+                firstMessage = message;
+            }
+            ++count;
+        }
+    }
+    XCTAssertEqual(count, 100);
+
+    NSArray *parsedInventories = [firstMessage inventories];
+    XCTAssertEqual(parsedInventories.count, inventories.count);
+    for (NSUInteger i = 0; i < inventories.count; ++i) {
+        XCTAssertEqualObjects([parsedInventories[i] inventoryHash], [inventories[i] inventoryHash]);
+    }
+}
+
+- (void)testFilteradd
+{
+    NSData *data = [@"99108ad8ed9bb6274d3980bab5a85c048f0950c8" dataFromHex];
+    WSMessageFilteradd *filteradd = [WSMessageFilteradd messageWithParameters:self.networkParameters data:data];
+    XCTAssertEqualObjects(filteradd.messageType, WSMessageType_FILTERADD);
+    XCTAssertEqualObjects([filteradd toBuffer].data, [@"1499108ad8ed9bb6274d3980bab5a85c048f0950c8" dataFromHex]);
+
+    NSData *longData = [NSMutableData dataWithLength:(WSMessageFilteraddMaxLength + 1)];
+    XCTAssertThrows([WSMessageFilteradd messageWithParameters:self.networkParameters data:longData]);
+}
+
+- (void)testFactoryCommands
+{
+    WSMessageFactory *factory = [[WSMessageFactory alloc] initWithParameters:self.networkParameters];
+    WSBuffer *payload = WSBufferFromHex(@"0102030405060708");
+    NSError *error;
+
+    id<WSMessage> message = [factory messageFromCommand:"ping\0\0\0\0\0\0\0" payload:payload error:&error];
+    XCTAssertTrue([message isKindOfClass:[WSMessagePing class]]);
+    XCTAssertEqual([(WSMessagePing *)message nonce], 0x0807060504030201ULL);
+
+    message = [factory messageFromType:@"getaddr" payload:payload error:&error];
+    XCTAssertNil(message);
+    XCTAssertEqual(error.code, WSErrorCodeUndecodableMessage);
+
+    message = [factory messageFromType:@"checkorder" payload:payload error:&error];
+    XCTAssertNil(message);
+    XCTAssertEqual(error.code, WSErrorCodeUnknownMessage);
+    XCTAssertEqualObjects(error.userInfo[WSErrorMessageTypeKey], @"checkorder");
 }
 
 - (void)testVarInt
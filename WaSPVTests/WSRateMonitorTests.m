@@ -0,0 +1,80 @@
+//
+//  WSRateMonitorTests.m
+//  WaSPV
+//
+//  Created by Davide De Rosa on 17/10/26.
+//  Copyright (c) 2026 Davide De Rosa. All rights reserved.
+//
+//  http://github.com/keeshux
+//  http://twitter.com/keeshux
+//  http://davidederosa.com
+//
+//  This file is part of WaSPV.
+//
+//  WaSPV is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  WaSPV is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with WaSPV.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#import "XCTestCase+WaSPV.h"
+#import "WSRateMonitor.h"
+
+@interface WSRateMonitorTests : XCTestCase
+
+@end
+
+@implementation WSRateMonitorTests
+
+- (void)setUp
+{
+    [super setUp];
+}
+
+- (void)tearDown
+{
+    [super tearDown];
+}
+
+- (void)testRateMonitor
+{
+    WSRateMonitor *monitor = [[WSRateMonitor alloc] initWithWindow:10.0];
+    [monitor resetAtTime:100.0];
+    for (NSUInteger i = 0; i < 5; ++i) {
+        [monitor addBlocks:5 bytes:1000 atTime:(100.5 + i)];
+    }
+
+    // rates only cover elapsed time until window is full
+    XCTAssertFalse([monitor hasFullWindowAtTime:105.0]);
+    XCTAssertEqualWithAccuracy([monitor blocksPerSecondAtTime:105.0], 5.0, 0.001);
+    for (NSUInteger i = 5; i < 10; ++i) {
+        [monitor addBlocks:5 bytes:1000 atTime:(100.5 + i)];
+    }
+    XCTAssertTrue([monitor hasFullWindowAtTime:110.0]);
+    XCTAssertEqualWithAccuracy([monitor blocksPerSecondAtTime:110.0], 5.0, 0.001);
+    XCTAssertEqualWithAccuracy([monitor bytesPerSecondAtTime:110.0], 1000.0, 0.001);
+
+    // old samples slide out of window
+    XCTAssertEqualWithAccuracy([monitor blocksPerSecondAtTime:115.0], 2.5, 0.001);
+    XCTAssertEqualWithAccuracy([monitor bytesPerSecondAtTime:115.0], 500.0, 0.001);
+    XCTAssertEqualWithAccuracy([monitor blocksPerSecondAtTime:125.0], 0.0, 0.001);
+
+    // reused slots drop expired samples
+    [monitor addBlocks:20 bytes:0 atTime:122.5];
+    XCTAssertEqualWithAccuracy([monitor blocksPerSecondAtTime:125.0], 2.0, 0.001);
+
+    [monitor resetAtTime:125.0];
+    XCTAssertEqualWithAccuracy([monitor blocksPerSecondAtTime:130.0], 0.0, 0.001);
+    XCTAssertFalse([monitor hasFullWindowAtTime:130.0]);
+    XCTAssertTrue([monitor hasFullWindowAtTime:135.0]);
+}
+
+@end